@@ -0,0 +1,27 @@
+#include "AdvisorThread.h"
+
+AdvisorThread::AdvisorThread(CSQLite3Advisor &advisor, const QString &dbPath, const CSQLite3Schema &schema,
+                             const QString &workload, const AdvisorOptions &opts, QObject *parent)
+    : QThread(parent)
+    , m_advisor(advisor)
+    , m_dbPath(dbPath.toStdString())
+    , m_schema(schema)
+    , m_workload(workload.toStdString())
+    , m_opts(opts)
+    , m_ok(false)
+{
+    m_advisor.ClearCancel();
+}
+
+void AdvisorThread::cancel()
+{
+    m_advisor.Cancel();
+}
+
+void AdvisorThread::run()
+{
+    // 先计抽样的表，再计在副本上规划的语句
+    m_ok = m_advisor.Run(m_dbPath, m_schema, m_workload, m_opts, [this](int done, int total) {
+        emit progress(done, total);
+    });
+}
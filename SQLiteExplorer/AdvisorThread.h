@@ -0,0 +1,44 @@
+#ifndef ADVISORTHREAD_H
+#define ADVISORTHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3Advisor.h"
+
+/*
+** Run a CSQLite3Advisor over a workload in the background.  The advisor
+** plans the workload on an in-memory copy of the database built from
+** the schema, which this thread keeps a copy of; candidates and plans
+** are read from the caller's advisor after finished().
+*/
+class AdvisorThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    AdvisorThread(CSQLite3Advisor& advisor, const QString& dbPath, const CSQLite3Schema& schema,
+                  const QString& workload, const AdvisorOptions& opts, QObject* parent = 0);
+
+    // 停止分析，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_advisor.IsCancelled(); }
+
+signals:
+    void progress(int done, int total);
+
+protected:
+    void run();
+
+private:
+    CSQLite3Advisor&    m_advisor;
+    string              m_dbPath;
+    CSQLite3Schema      m_schema;
+    string              m_workload;
+    AdvisorOptions      m_opts;
+    bool                m_ok;
+};
+
+#endif // ADVISORTHREAD_H
@@ -0,0 +1,26 @@
+#include "AnalyzeThread.h"
+
+AnalyzeThread::AnalyzeThread(CSQLite3Analyze &analyze, const QString &dbPath, const CSQLite3Schema &schema,
+                             const AnalyzeOptions &opts, QObject *parent)
+    : QThread(parent)
+    , m_analyze(analyze)
+    , m_dbPath(dbPath.toStdString())
+    , m_schema(schema)
+    , m_opts(opts)
+    , m_ok(false)
+{
+    m_analyze.ClearCancel();
+}
+
+void AnalyzeThread::cancel()
+{
+    m_analyze.Cancel();
+}
+
+void AnalyzeThread::run()
+{
+    // 每完成一个b-tree报告一次
+    m_ok = m_analyze.Run(m_dbPath, m_schema, m_opts, [this](int done, int total) {
+        emit progress(done, total);
+    });
+}
@@ -0,0 +1,43 @@
+#ifndef ANALYZETHREAD_H
+#define ANALYZETHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3Analyze.h"
+
+/*
+** Compute the statistics of ANALYZE in the background.  The copied
+** schema names every index with its key columns and collations; the
+** stat1/stat4 rows are read from the caller's CSQLite3Analyze after
+** finished().
+*/
+class AnalyzeThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    AnalyzeThread(CSQLite3Analyze& analyze, const QString& dbPath, const CSQLite3Schema& schema,
+                  const AnalyzeOptions& opts, QObject* parent = 0);
+
+    // 停止统计，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_analyze.IsCancelled(); }
+
+signals:
+    void progress(int done, int total);
+
+protected:
+    void run();
+
+private:
+    CSQLite3Analyze&    m_analyze;
+    string              m_dbPath;
+    CSQLite3Schema      m_schema;
+    AnalyzeOptions      m_opts;
+    bool                m_ok;
+};
+
+#endif // ANALYZETHREAD_H
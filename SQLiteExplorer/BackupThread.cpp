@@ -0,0 +1,24 @@
+#include "BackupThread.h"
+
+BackupThread::BackupThread(const QString &srcPath, const QString &dstPath, const BackupOptions &opts, QObject *parent)
+    : QThread(parent)
+    , m_srcPath(srcPath)
+    , m_dstPath(dstPath)
+    , m_opts(opts)
+    , m_ok(false)
+{
+
+}
+
+void BackupThread::cancel()
+{
+    m_backup.Cancel();
+}
+
+void BackupThread::run()
+{
+    m_ok = m_backup.Run(m_srcPath.toStdString(), m_dstPath.toStdString(), m_opts,
+        [&](int done, int total, double mbPerSec) {
+            emit progress(done, total, mbPerSec);
+        });
+}
@@ -0,0 +1,43 @@
+#ifndef BACKUPTHREAD_H
+#define BACKUPTHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3Backup.h"
+
+/*
+** Run a CSQLite3Backup in the background.  Progress carries the pages
+** copied so far and the copy rate, so the dialog can show the throughput
+** of the copy as well as how far it got.
+*/
+class BackupThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    BackupThread(const QString& srcPath, const QString& dstPath, const BackupOptions& opts, QObject* parent = 0);
+
+    // 停止复制，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_backup.IsCancelled(); }
+    QString error() const { return QString::fromStdString(m_backup.GetError()); }
+    const BackupResult& result() const { return m_backup.GetResult(); }
+
+signals:
+    void progress(int done, int total, double mbPerSec);
+
+protected:
+    void run();
+
+private:
+    QString         m_srcPath;
+    QString         m_dstPath;
+    BackupOptions   m_opts;
+    bool            m_ok;
+    CSQLite3Backup  m_backup;
+};
+
+#endif // BACKUPTHREAD_H
@@ -0,0 +1,109 @@
+#include "BtreeLayout.h"
+
+#include <map>
+#include <algorithm>
+
+void LayoutBtree(const vector<PageUsageInfo> &infos, const vector<double> &widths,
+                 double rankGap, double slotSize,
+                 vector<BtreeLayoutPos> &pos, double *pWidth, double *pHeight)
+{
+    int n = (int)infos.size();
+    pos.assign(n, BtreeLayoutPos());
+
+    // 1. 确定布局中的父节点：溢出页串成链，挂在上一个溢出页下面
+    map<int, int> index;
+    map<pair<int, int>, int> lastOverflow;
+    for (int i=0; i<n; ++i)
+    {
+        const PageUsageInfo& info = infos[i];
+        int parent = -1;
+        if (info.type == PAGE_TYPE_OVERFLOW)
+        {
+            pair<int, int> key(info.parent, info.overflow_cell_idx);
+            map<pair<int, int>, int>::iterator it = lastOverflow.find(key);
+            if (info.overflow_page_idx > 1 && it != lastOverflow.end())
+                parent = it->second;
+            lastOverflow[key] = i;
+        }
+        if (parent < 0 && info.parent)
+        {
+            map<int, int>::iterator it = index.find(info.parent);
+            if (it != index.end()) parent = it->second;
+        }
+        pos[i].parent = parent;
+        pos[i].depth = 0;
+        pos[i].x = pos[i].y = 0;
+        index[info.pgno] = i;
+    }
+
+    // 子节点按输入顺序排列(即cell顺序)，用CSR形式保存
+    vector<int> first(n+1, 0);
+    for (int i=0; i<n; ++i)
+    {
+        if (pos[i].parent >= 0) first[pos[i].parent+1]++;
+    }
+    for (int i=0; i<n; ++i)
+    {
+        first[i+1] += first[i];
+    }
+    vector<int> children(first[n]);
+    vector<int> fill(first.begin(), first.end()-1);
+    for (int i=0; i<n; ++i)
+    {
+        if (pos[i].parent >= 0) children[fill[pos[i].parent]++] = i;
+    }
+
+    // 2. 非递归后序遍历：叶子依次占用一个位置，内部节点居中于首尾子节点
+    vector<double> rankWidth;
+    vector<pair<int, int> > stack;
+    double slot = 0;
+    for (int root=0; root<n; ++root)
+    {
+        if (pos[root].parent >= 0) continue;
+        stack.push_back(make_pair(root, first[root]));
+        while (!stack.empty())
+        {
+            int node = stack.back().first;
+            int& next = stack.back().second;
+            if (next < first[node+1])
+            {
+                int child = children[next++];
+                pos[child].depth = pos[node].depth + 1;
+                stack.push_back(make_pair(child, first[child]));
+                continue;
+            }
+
+            if (first[node] == first[node+1])
+            {
+                pos[node].y = slot + slotSize / 2;
+                slot += slotSize;
+            }
+            else
+            {
+                pos[node].y = (pos[children[first[node]]].y + pos[children[first[node+1]-1]].y) / 2;
+            }
+
+            int depth = pos[node].depth;
+            if ((int)rankWidth.size() <= depth) rankWidth.resize(depth+1, 0);
+            double w = node < (int)widths.size() ? widths[node] : 0;
+            rankWidth[depth] = std::max(rankWidth[depth], w);
+            stack.pop_back();
+        }
+    }
+
+    // 3. 每一层的宽度取该层最宽的节点
+    vector<double> rankX(rankWidth.size(), 0);
+    double x = 0;
+    for (size_t d=0; d<rankWidth.size(); ++d)
+    {
+        rankX[d] = x + rankWidth[d] / 2;
+        x += rankWidth[d] + rankGap;
+    }
+    for (int i=0; i<n; ++i)
+    {
+        pos[i].x = rankX[pos[i].depth];
+    }
+
+    if (pWidth) *pWidth = rankWidth.empty() ? 0 : x - rankGap;
+    if (pHeight) *pHeight = slot;
+}
@@ -0,0 +1,36 @@
+#ifndef BTREELAYOUT_H
+#define BTREELAYOUT_H
+
+#include <vector>
+#include "SQLite3DB.h"
+
+using std::vector;
+
+// 一个页在布局中的位置
+struct BtreeLayoutPos
+{
+    double x;       // 层次方向的坐标(根在0)
+    double y;       // 同一层内的坐标
+    int    depth;   // 所在层
+    int    parent;  // 布局中的父节点在输入中的下标，根为-1
+};
+
+/*
+** Tidy layered layout of the pages returned by PageUsageBtree.
+**
+** B-trees are balanced and their children are already in key order, so
+** the Reingold-Tilford layout reduces to: every leaf gets the next slot
+** in depth-first order and every interior page is centred over its first
+** and last child.  Overflow pages are chained below the page holding the
+** cell, one slot per chain.  Runs in O(n) without recursion, so trees
+** with hundreds of thousands of pages are laid out in milliseconds.
+**
+** widths[i] is the extent of node i along the rank direction; rankGap and
+** slotSize are the space between ranks and the distance between slots.
+** The returned extents are written to *pWidth and *pHeight.
+*/
+void LayoutBtree(const vector<PageUsageInfo>& infos, const vector<double>& widths,
+                 double rankGap, double slotSize,
+                 vector<BtreeLayoutPos>& pos, double* pWidth, double* pHeight);
+
+#endif // BTREELAYOUT_H
@@ -0,0 +1,90 @@
+#include "BtreeLocality.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+static bool isLeafPage(PageType type)
+{
+    return type == PAGE_TYPE_INDEX_LEAF || type == PAGE_TYPE_TABLE_LEAF;
+}
+
+void ComputeBtreeLocality(const vector<PageUsageInfo> &infos, int pageSize,
+                          const ReadCostModel &model, BtreeLocality &out)
+{
+    string name = out.name;
+    out = BtreeLocality();
+    out.name = name;
+    out.pages = (int)infos.size();
+
+    // 1. 叶子的键顺序与物理顺序
+    vector<int> leaves;
+    vector<int> scan;
+    for (auto it=infos.begin(); it!=infos.end(); ++it)
+    {
+        if (isLeafPage(it->type))
+        {
+            leaves.push_back(it->pgno);
+            scan.push_back(it->pgno);
+        }
+        else if (it->type == PAGE_TYPE_OVERFLOW)
+        {
+            scan.push_back(it->pgno);
+        }
+    }
+    // 只有根页的b-tree，根页就是叶子
+    if (leaves.empty() && !infos.empty())
+    {
+        leaves.push_back(infos[0].pgno);
+        scan.insert(scan.begin(), infos[0].pgno);
+    }
+
+    out.leaves = (int)leaves.size();
+    if (!leaves.empty())
+    {
+        int64_t total = 0;
+        int forward = 0;
+        int run = 1;
+        out.longestRun = 1;
+        for (size_t i=1; i<leaves.size(); ++i)
+        {
+            int gap = leaves[i] - leaves[i-1];
+            total += std::abs(gap);
+            out.maxSeek = std::max(out.maxSeek, std::abs(gap));
+            if (gap < 0) out.backwardJumps++;
+            if (gap == 1)
+            {
+                forward++;
+                run++;
+                out.longestRun = std::max(out.longestRun, run);
+            }
+            else
+            {
+                run = 1;
+            }
+        }
+        if (leaves.size() > 1)
+        {
+            out.avgSeek = (double)total / (leaves.size()-1);
+            out.forwardPct = 100.0 * forward / (leaves.size()-1);
+        }
+        else
+        {
+            out.forwardPct = 100.0;
+        }
+    }
+
+    // 2. 代价模型：跳到预读窗口以外的位置需要一次定位，窗口内跳过的页也要读
+    if (scan.empty() || model.mbPerSec <= 0) return;
+    double pageMs = pageSize / (model.mbPerSec * 1024 * 1024) * 1000;
+    double ms = model.seekMs + pageMs;
+    for (size_t i=1; i<scan.size(); ++i)
+    {
+        int gap = scan[i] - scan[i-1];
+        if (gap >= 1 && gap <= model.readaheadPages)
+            ms += gap * pageMs;
+        else
+            ms += model.seekMs + pageMs;
+    }
+    out.scanMs = ms;
+    out.idealMs = model.seekMs + scan.size() * pageMs;
+}
@@ -0,0 +1,52 @@
+#ifndef BTREELOCALITY_H
+#define BTREELOCALITY_H
+
+#include <vector>
+#include "SQLite3DB.h"
+
+using std::vector;
+
+// 顺序读的代价模型，默认值接近普通机械硬盘
+struct ReadCostModel
+{
+    double seekMs;          // 一次随机定位的时间(毫秒)
+    double mbPerSec;        // 顺序读的吞吐(MB/s)
+    int    readaheadPages;  // 向前跳过不超过该页数时按顺序读计算(预读)
+
+    ReadCostModel() : seekMs(8), mbPerSec(150), readaheadPages(32) {}
+};
+
+// 一棵b-tree的叶子按键顺序与物理顺序的对比
+struct BtreeLocality
+{
+    string name;
+    int    pages;           // b-tree中的页数(含溢出页)
+    int    leaves;          // 叶子页数
+    double avgSeek;         // 相邻叶子之间的平均距离(页)
+    int    maxSeek;         // 相邻叶子之间的最大距离(页)
+    int    longestRun;      // 物理上连续的最长叶子序列
+    double forwardPct;      // 下一个叶子紧跟在当前叶子之后的比例(%)
+    int    backwardJumps;   // 下一个叶子在当前叶子之前的次数
+    double scanMs;          // 按键顺序全表扫描的估计时间
+    double idealMs;         // 所有页连续存放时的估计时间
+
+    BtreeLocality()
+        : pages(0), leaves(0), avgSeek(0), maxSeek(0), longestRun(0)
+        , forwardPct(0), backwardJumps(0), scanMs(0), idealMs(0)
+    {}
+};
+
+/*
+** Compare the key order of a b-tree with its physical order in the file.
+**
+** infos are the pages of one b-tree as returned by PageUsageBtree: in
+** pre-order with the children in cell order, so the leaves appear in key
+** order and every overflow chain follows the leaf that owns it.  The seek
+** statistics are taken over the leaves; the scan cost replays the pages a
+** full scan reads (leaves and their overflow pages, interior pages are
+** assumed cached) against the cost model.
+*/
+void ComputeBtreeLocality(const vector<PageUsageInfo>& infos, int pageSize,
+                          const ReadCostModel& model, BtreeLocality& out);
+
+#endif // BTREELOCALITY_H
@@ -0,0 +1,90 @@
+#include "BtreeSizeThread.h"
+
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+// 结果最长的发送间隔
+static const int SIZE_BATCH_MS = 100;
+
+BtreeSizeThread::BtreeSizeThread(const QString &path, QObject *parent)
+    : QThread(parent)
+    , m_path(path)
+    , m_running(false)
+{
+
+}
+
+BtreeSizeThread::~BtreeSizeThread()
+{
+    stop();
+}
+
+void BtreeSizeThread::enqueue(const QStringList &names, const QVector<int> &roots)
+{
+    QMutexLocker lock(&m_mutex);
+    m_names << names;
+    m_roots << roots;
+    if (!m_running)
+    {
+        // 上一次的run()已经决定退出，等它结束后再启动
+        wait();
+        m_running = true;
+        start(QThread::LowPriority);
+    }
+}
+
+void BtreeSizeThread::stop()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_names.clear();
+        m_roots.clear();
+    }
+    m_scan.Cancel();
+    wait();
+}
+
+void BtreeSizeThread::run()
+{
+    // 文件大小可能已经变化，每次启动时重新读文件头
+    if (!m_scan.Open(m_path.toStdString()))
+    {
+        QMutexLocker lock(&m_mutex);
+        m_names.clear();
+        m_roots.clear();
+        m_running = false;
+        return;
+    }
+
+    QStringList names;
+    QVector<qint64> bytes;
+    QElapsedTimer timer;
+    timer.start();
+    for (;;)
+    {
+        QString name;
+        int root;
+        {
+            QMutexLocker lock(&m_mutex);
+            if (m_names.isEmpty() || m_scan.IsCancelled())
+            {
+                m_running = false;
+                break;
+            }
+            name = m_names.takeFirst();
+            root = m_roots.takeFirst();
+        }
+
+        names << name;
+        bytes << (qint64)m_scan.CountPages(root) * m_scan.PageSize();
+        if (timer.elapsed() >= SIZE_BATCH_MS)
+        {
+            emit sized(names, bytes);
+            names.clear();
+            bytes.clear();
+            timer.restart();
+        }
+    }
+    if (names.size())
+        emit sized(names, bytes);
+}
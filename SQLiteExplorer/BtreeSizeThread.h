@@ -0,0 +1,49 @@
+#ifndef BTREESIZETHREAD_H
+#define BTREESIZETHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMutex>
+
+#include "SQLite3RawScan.h"
+
+/*
+** Count the pages of b-trees for the size badges of the tree view.
+** Requests are queued with enqueue() as tree items become visible; the
+** thread starts on demand, reads the file with its own handle through
+** CSQLite3RawScan::CountPages and stops when the queue is empty.
+*/
+class BtreeSizeThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    BtreeSizeThread(const QString& path, QObject* parent = 0);
+    ~BtreeSizeThread();
+
+    const QString& path() const { return m_path; }
+
+    // 加入要计算的b-tree，必要时启动线程
+    void enqueue(const QStringList& names, const QVector<int>& roots);
+
+    // 清空队列并停止，等待线程结束
+    void stop();
+
+signals:
+    void sized(const QStringList& names, const QVector<qint64>& bytes);
+
+protected:
+    void run();
+
+private:
+    QString         m_path;
+    QMutex          m_mutex;
+    QStringList     m_names;
+    QVector<int>    m_roots;
+    bool            m_running;
+    CSQLite3RawScan m_scan;
+};
+
+#endif // BTREESIZETHREAD_H
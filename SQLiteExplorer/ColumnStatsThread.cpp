@@ -0,0 +1,27 @@
+#include "ColumnStatsThread.h"
+
+ColumnStatsThread::ColumnStatsThread(CSQLite3ColumnStats &stats, const QString &dbPath, const CSQLite3Schema &schema,
+                                     const QString &table, const ColumnStatsOptions &opts, QObject *parent)
+    : QThread(parent)
+    , m_stats(stats)
+    , m_dbPath(dbPath.toStdString())
+    , m_schema(schema)
+    , m_table(table.toStdString())
+    , m_opts(opts)
+    , m_ok(false)
+{
+    m_stats.ClearCancel();
+}
+
+void ColumnStatsThread::cancel()
+{
+    m_stats.Cancel();
+}
+
+void ColumnStatsThread::run()
+{
+    // done/total是已解码的叶子页数
+    m_ok = m_stats.Run(m_dbPath, m_schema, m_table, m_opts, [this](int done, int total) {
+        emit progress(done, total);
+    });
+}
@@ -0,0 +1,44 @@
+#ifndef COLUMNSTATSTHREAD_H
+#define COLUMNSTATSTHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3ColumnStats.h"
+
+/*
+** Compute the column statistics of one table in the background.  Only
+** the table's root page and stored fields are needed from the schema,
+** which is copied; the per-column results fill the caller's
+** CSQLite3ColumnStats and are read after finished().
+*/
+class ColumnStatsThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    ColumnStatsThread(CSQLite3ColumnStats& stats, const QString& dbPath, const CSQLite3Schema& schema,
+                      const QString& table, const ColumnStatsOptions& opts, QObject* parent = 0);
+
+    // 停止统计，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_stats.IsCancelled(); }
+
+signals:
+    void progress(int done, int total);
+
+protected:
+    void run();
+
+private:
+    CSQLite3ColumnStats&    m_stats;
+    string                  m_dbPath;
+    CSQLite3Schema          m_schema;
+    string                  m_table;
+    ColumnStatsOptions      m_opts;
+    bool                    m_ok;
+};
+
+#endif // COLUMNSTATSTHREAD_H
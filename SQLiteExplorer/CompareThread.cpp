@@ -0,0 +1,30 @@
+#include "CompareThread.h"
+
+CompareThread::CompareThread(CSQLite3Compare &compare, const QStringList &paths, const CompareOptions &opts,
+                             QObject *parent)
+    : QThread(parent)
+    , m_compare(compare)
+    , m_paths(paths)
+    , m_opts(opts)
+    , m_ok(false)
+{
+    m_compare.ClearCancel();
+}
+
+void CompareThread::cancel()
+{
+    m_compare.Cancel();
+}
+
+void CompareThread::run()
+{
+    vector<string> paths;
+    for (int i=0; i<m_paths.size(); ++i)
+    {
+        paths.push_back(m_paths[i].toStdString());
+    }
+    // 每读完一个文件报告一次，来自同时读取文件的各个池线程
+    m_ok = m_compare.Run(paths, m_opts, [this](int done, int total) {
+        emit progress(done, total);
+    });
+}
@@ -0,0 +1,41 @@
+#ifndef COMPARETHREAD_H
+#define COMPARETHREAD_H
+
+#include <QThread>
+#include <QStringList>
+
+#include "SQLite3Compare.h"
+
+/*
+** Run a CSQLite3Compare over a list of files in the background.  The
+** results stay in the compare object owned by the caller, which must
+** not touch it until the thread has finished.
+*/
+class CompareThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    CompareThread(CSQLite3Compare& compare, const QStringList& paths, const CompareOptions& opts,
+                  QObject* parent = 0);
+
+    // 停止比较，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_compare.IsCancelled(); }
+
+signals:
+    void progress(int done, int total);
+
+protected:
+    void run();
+
+private:
+    CSQLite3Compare&    m_compare;
+    QStringList         m_paths;
+    CompareOptions      m_opts;
+    bool                m_ok;
+};
+
+#endif // COMPARETHREAD_H
@@ -0,0 +1,327 @@
+#include "DatabaseWatcher.h"
+#include "SQLite3File.h"
+
+#include <QFileInfo>
+#include <set>
+
+// 轮询间隔(毫秒)，用于QFileSystemWatcher收不到通知的情况(网络盘、新建的-wal文件等)
+static const int WATCH_POLL_INTERVAL = 1000;
+
+// WAL文件头和帧头的大小
+static const int WAL_HEADER_SIZE = 32;
+static const int WAL_FRAME_HEADER_SIZE = 24;
+// WAL文件头的魔数，最低位为1时校验和按大端计算
+static const quint32 WAL_MAGIC = 0x377f0682;
+
+// WAL的累积校验和，与sqlite的walChecksumBytes相同；n是8的倍数
+static void walChecksum(bool bigEndian, const unsigned char* a, int n, quint32* s)
+{
+    quint32 s0 = s[0], s1 = s[1];
+    for (int i=0; i<n; i+=8)
+    {
+        quint32 x0, x1;
+        if (bigEndian)
+        {
+            x0 = get4(a+i);
+            x1 = get4(a+i+4);
+        }
+        else
+        {
+            x0 = (quint32)a[i] | ((quint32)a[i+1]<<8) | ((quint32)a[i+2]<<16) | ((quint32)a[i+3]<<24);
+            x1 = (quint32)a[i+4] | ((quint32)a[i+5]<<8) | ((quint32)a[i+6]<<16) | ((quint32)a[i+7]<<24);
+        }
+        s0 += x0 + s1;
+        s1 += x1 + s0;
+    }
+    s[0] = s0;
+    s[1] = s1;
+}
+
+PageHashThread::PageHashThread(const QString &path, QObject *parent)
+    : QThread(parent)
+    , path(path)
+    , m_cancel(false)
+{
+
+}
+
+void PageHashThread::run()
+{
+    if (!HashPages(path.toStdString(), hashes, NULL, &m_cancel))
+        hashes.clear();
+}
+
+DatabaseWatcher::DatabaseWatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_pWatcher = new QFileSystemWatcher(this);
+    connect(m_pWatcher, SIGNAL(fileChanged(QString)), this, SLOT(onFileChanged(QString)));
+
+    m_pPollTimer = new QTimer(this);
+    connect(m_pPollTimer, SIGNAL(timeout()), this, SLOT(onPollTimeout()));
+    m_pPollTimer->start(WATCH_POLL_INTERVAL);
+}
+
+DatabaseWatcher::~DatabaseWatcher()
+{
+    QStringList paths = m_states.keys();
+    foreach (QString path, paths)
+    {
+        removePath(path);
+    }
+}
+
+void DatabaseWatcher::addPath(const QString &path)
+{
+    if (m_states.contains(path)) return;
+
+    WatchState& st = m_states[path];
+    QFileInfo fi(path);
+    st.dbSize = fi.size();
+    st.dbModified = fi.lastModified();
+
+    CSQLite3File file;
+    unsigned char a[4];
+    if (file.Open(path.toStdString()) && file.Read(24, a, 4) == 4)
+    {
+        st.changeCounter = get4(a);
+    }
+
+    // 已有的WAL帧不算变化，只记录位置
+    QVector<int> pages;
+    readWalFrames(path, st, pages);
+
+    m_pWatcher->addPath(path);
+    if (QFileInfo::exists(path + "-wal")) m_pWatcher->addPath(path + "-wal");
+
+    // 计算初始的页哈希，作为之后比较的基准
+    startHash(path, st);
+}
+
+qint64 DatabaseWatcher::memoryUsed() const
+{
+    qint64 used = 0;
+    for (auto it=m_states.begin(); it!=m_states.end(); ++it)
+    {
+        used += it->hashes.capacity() * sizeof(uint64_t);
+        // 新的哈希按与旧的一样大计算，线程中的vector不能在这里读取
+        if (it->thread)
+            used += HashBufferBytes() + it->hashes.capacity() * sizeof(uint64_t);
+    }
+    return used;
+}
+
+void DatabaseWatcher::removePath(const QString &path)
+{
+    auto it = m_states.find(path);
+    if (it == m_states.end()) return;
+
+    if (it->thread)
+    {
+        it->thread->disconnect(this);
+        it->thread->cancel();
+        it->thread->wait();
+        delete it->thread;
+    }
+    m_states.erase(it);
+
+    m_pWatcher->removePath(path);
+    m_pWatcher->removePath(path + "-wal");
+}
+
+void DatabaseWatcher::onFileChanged(const QString &file)
+{
+    QString path = file;
+    if (path.endsWith("-wal")) path.chop(4);
+    if (m_states.contains(path)) check(path);
+}
+
+void DatabaseWatcher::onPollTimeout()
+{
+    QStringList paths = m_states.keys();
+    foreach (QString path, paths)
+    {
+        check(path);
+    }
+}
+
+void DatabaseWatcher::check(const QString &path)
+{
+    auto it = m_states.find(path);
+    if (it == m_states.end()) return;
+
+    // 文件被替换后QFileSystemWatcher会丢失监视，重新加上
+    QStringList files = m_pWatcher->files();
+    if (!files.contains(path) && QFileInfo::exists(path)) m_pWatcher->addPath(path);
+    QString wal = path + "-wal";
+    if (!files.contains(wal) && QFileInfo::exists(wal)) m_pWatcher->addPath(wal);
+
+    // 1. WAL中新增的帧，页号直接从帧头读出
+    QVector<int> pages;
+    readWalFrames(path, *it, pages);
+    if (!pages.isEmpty())
+    {
+        emit databaseChanged(path, pages);
+
+        // 槽函数中可能已经移除了该路径
+        it = m_states.find(path);
+        if (it == m_states.end()) return;
+    }
+
+    // 2. 主文件变化时重新计算页哈希
+    QFileInfo fi(path);
+    WatchState& st = *it;
+    quint32 counter = st.changeCounter;
+    CSQLite3File file;
+    unsigned char a[4];
+    if (file.Open(path.toStdString()) && file.Read(24, a, 4) == 4)
+    {
+        counter = get4(a);
+    }
+
+    if (counter == st.changeCounter && fi.size() == st.dbSize && fi.lastModified() == st.dbModified)
+    {
+        return;
+    }
+    st.changeCounter = counter;
+    st.dbSize = fi.size();
+    st.dbModified = fi.lastModified();
+
+    if (st.thread)
+    {
+        st.pending = true;
+        return;
+    }
+    startHash(path, st);
+}
+
+void DatabaseWatcher::startHash(const QString &path, WatchState &st)
+{
+    st.pending = false;
+    st.thread = new PageHashThread(path);
+    connect(st.thread, SIGNAL(finished()), this, SLOT(onHashFinished()));
+    st.thread->start(QThread::LowPriority);
+}
+
+void DatabaseWatcher::onHashFinished()
+{
+    PageHashThread* thread = qobject_cast<PageHashThread*>(sender());
+    if (thread == NULL) return;
+
+    QString path = thread->path;
+    auto it = m_states.find(path);
+    if (it == m_states.end() || it->thread != thread)
+    {
+        thread->deleteLater();
+        return;
+    }
+
+    WatchState& st = *it;
+    st.thread = NULL;
+
+    QVector<int> pages;
+    if (!st.hashes.empty())
+    {
+        const vector<uint64_t>& hashes = thread->hashes;
+        for (size_t i=0; i<hashes.size(); ++i)
+        {
+            if (i >= st.hashes.size() || st.hashes[i] != hashes[i])
+                pages.push_back((int)i+1);
+        }
+    }
+    st.hashes.swap(thread->hashes);
+    thread->deleteLater();
+
+    bool pending = st.pending;
+    if (!pages.isEmpty())
+    {
+        emit databaseChanged(path, pages);
+    }
+
+    // 槽函数中可能已经移除了该路径
+    it = m_states.find(path);
+    if (pending && it != m_states.end())
+    {
+        startHash(path, *it);
+    }
+}
+
+void DatabaseWatcher::readWalFrames(const QString &path, WatchState &st, QVector<int> &pages)
+{
+    CSQLite3File wal;
+    if (!wal.Open((path + "-wal").toStdString()))
+    {
+        st.walSize = 0;
+        return;
+    }
+
+    qint64 size = wal.Size();
+    unsigned char hdr[WAL_HEADER_SIZE];
+    if (size < WAL_HEADER_SIZE || wal.Read(0, hdr, WAL_HEADER_SIZE) != WAL_HEADER_SIZE)
+    {
+        st.walSize = 0;
+        return;
+    }
+
+    // 魔数的最低位表示校验和按大端还是小端计算，头的校验和不对时WAL中没有有效的帧
+    quint32 magic = get4(hdr);
+    int pagesize = (int)get4(hdr+8);
+    if (pagesize == 1) pagesize = 65536;
+    quint32 cksum[2] = { 0, 0 };
+    bool bigEndian = (magic & 1) != 0;
+    walChecksum(bigEndian, hdr, 24, cksum);
+    if ((magic & 0xFFFFFFFE) != WAL_MAGIC || pagesize < 512 || (pagesize & (pagesize-1)) != 0
+        || cksum[0] != get4(hdr+24) || cksum[1] != get4(hdr+28))
+    {
+        st.walSize = 0;
+        return;
+    }
+    quint32 salt = get4(hdr+16);
+    quint32 salt2 = get4(hdr+20);
+
+    // 同一轮WAL从上次的提交帧之后继续读，WAL被重置(checkpoint后重写或截断)时从第一帧开始
+    qint64 frameSize = WAL_FRAME_HEADER_SIZE + pagesize;
+    qint64 ofst = WAL_HEADER_SIZE;
+    if (salt == st.walSalt && size >= st.walSize && st.walSize > WAL_HEADER_SIZE)
+    {
+        ofst = st.walSize;
+        cksum[0] = st.walCksum[0];
+        cksum[1] = st.walCksum[1];
+    }
+
+    // salt不同或校验和不对的帧是上一轮WAL留下的或还没写完，sqlite读到这里就停止；
+    // 提交帧之前的帧属于还没提交的事务，等提交后再报告
+    qint64 committed = ofst;
+    quint32 committedCksum[2] = { cksum[0], cksum[1] };
+    std::set<int> pgnos, uncommitted;
+    vector<unsigned char> frame(frameSize);
+    for (; ofst + frameSize <= size; ofst += frameSize)
+    {
+        unsigned char* a = &frame[0];
+        if (wal.Read(ofst, a, (int)frameSize) != frameSize) break;
+        if (get4(a+8) != salt || get4(a+12) != salt2) break;
+        walChecksum(bigEndian, a, 8, cksum);
+        walChecksum(bigEndian, a + WAL_FRAME_HEADER_SIZE, pagesize, cksum);
+        if (cksum[0] != get4(a+16) || cksum[1] != get4(a+20)) break;
+
+        int pgno = (int)get4(a);
+        if (pgno > 0) uncommitted.insert(pgno);
+        if (get4(a+4) != 0)
+        {
+            pgnos.insert(uncommitted.begin(), uncommitted.end());
+            uncommitted.clear();
+            committed = ofst + frameSize;
+            committedCksum[0] = cksum[0];
+            committedCksum[1] = cksum[1];
+        }
+    }
+    for (auto it=pgnos.begin(); it!=pgnos.end(); ++it)
+    {
+        pages.push_back(*it);
+    }
+
+    st.walSize = committed;
+    st.walSalt = salt;
+    st.walCksum[0] = committedCksum[0];
+    st.walCksum[1] = committedCksum[1];
+}
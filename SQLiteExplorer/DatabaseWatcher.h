@@ -0,0 +1,102 @@
+#ifndef DATABASEWATCHER_H
+#define DATABASEWATCHER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMap>
+#include <QVector>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include "PageHash.h"
+
+// 在后台计算一个文件的页哈希
+class PageHashThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    PageHashThread(const QString& path, QObject* parent = 0);
+
+    // 停止计算，不等待线程结束
+    void cancel() { m_cancel = true; }
+
+    QString          path;
+    vector<uint64_t> hashes;
+
+protected:
+    void run();
+
+private:
+    std::atomic<bool> m_cancel;
+};
+
+/*
+** Watch open database files for modifications made by other processes.
+**
+** The database and its -wal file are watched with QFileSystemWatcher,
+** backed by a cheap poll of size, mtime and the header file change
+** counter.  Pages appended to the WAL are read from the frame headers
+** the way sqlite replays the log: frames must carry the header's salt
+** and a valid cumulative checksum, and only frames up to the last commit
+** frame count, so pages of a transaction still being written are
+** reported when it commits.  When the main file changes its pages are
+** re-hashed in the background and compared with the previous hashes.
+** Only the numbers of the changed pages are reported.
+*/
+class DatabaseWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseWatcher(QObject* parent = 0);
+    ~DatabaseWatcher();
+
+    void addPath(const QString& path);
+    void removePath(const QString& path);
+
+    // 立即检查一次，例如本程序自己修改了文件之后
+    void checkNow(const QString& path) { check(path); }
+
+    // 保存的页哈希和正在计算的哈希占用的内存
+    qint64 memoryUsed() const;
+
+signals:
+    void databaseChanged(const QString& path, const QVector<int>& pages);
+
+private slots:
+    void onFileChanged(const QString& file);
+    void onPollTimeout();
+    void onHashFinished();
+
+private:
+    struct WatchState
+    {
+        quint32          changeCounter;
+        qint64           dbSize;
+        QDateTime        dbModified;
+        qint64           walSize;   // 已读到的位置，最后一个提交帧之后
+        quint32          walSalt;
+        quint32          walCksum[2];   // walSize处的累积校验和
+        vector<uint64_t> hashes;
+        PageHashThread*  thread;
+        bool             pending;   // 计算哈希期间文件再次变化
+
+        WatchState() : changeCounter(0), dbSize(0), walSize(0), walSalt(0), thread(NULL), pending(false)
+        {
+            walCksum[0] = walCksum[1] = 0;
+        }
+    };
+
+    void check(const QString& path);
+    void startHash(const QString& path, WatchState& st);
+    void readWalFrames(const QString& path, WatchState& st, QVector<int>& pages);
+
+private:
+    QFileSystemWatcher*        m_pWatcher;
+    QTimer*                    m_pPollTimer;
+    QMap<QString, WatchState>  m_states;
+};
+
+#endif // DATABASEWATCHER_H
@@ -0,0 +1,248 @@
+#include "DialogAdvisor.h"
+#include "AdvisorThread.h"
+#include "SQLite3DB.h"
+
+#include <QLineEdit>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QTabWidget>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QFileDialog>
+#include <QApplication>
+#include <QClipboard>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+// 表格中SQL显示的最大长度
+static const int ADVISOR_SQL_CHARS = 120;
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+DialogAdvisor::DialogAdvisor(CSQLite3DB *pSqlite, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+    , m_pThread(NULL)
+{
+    setWindowTitle(tr("Index advisor - %1").arg(QString::fromStdString(pSqlite->GetPath())));
+    resize(1000, 640);
+
+    m_pWorkload = new QLineEdit(this);
+    m_pWorkload->setPlaceholderText(tr("SQL file with the statements of the workload"));
+    QPushButton* browseBtn = new QPushButton(tr("Browse..."), this);
+    QHBoxLayout* fileBar = new QHBoxLayout;
+    fileBar->addWidget(new QLabel(tr("Workload:"), this));
+    fileBar->addWidget(m_pWorkload, 1);
+    fileBar->addWidget(browseBtn);
+
+    AdvisorOptions opts;
+    m_pSampleRows = new QSpinBox(this);
+    m_pSampleRows->setRange(100, 1000000);
+    m_pSampleRows->setSingleStep(1000);
+    m_pSampleRows->setValue(opts.sampleRows);
+    m_pSampleRows->setToolTip(tr("Rows sampled per table to estimate the statistics of a candidate index"));
+    m_pMaxColumns = new QSpinBox(this);
+    m_pMaxColumns->setRange(1, 16);
+    m_pMaxColumns->setValue(opts.maxColumns);
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Sample rows:"), this));
+    bar->addWidget(m_pSampleRows);
+    bar->addWidget(new QLabel(tr("Max columns:"), this));
+    bar->addWidget(m_pMaxColumns);
+    bar->addStretch();
+
+    m_pIndexes = new QTableWidget(this);
+    m_pIndexes->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pIndexes->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pIndexes->setColumnCount(7);
+    m_pIndexes->setHorizontalHeaderLabels(QStringList() << tr("Index") << tr("Table") << tr("Est. pages")
+                                          << tr("Pages saved") << tr("Maintenance") << tr("Net")
+                                          << tr("Statements"));
+    m_pIndexes->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    m_pStatements = new QTableWidget(this);
+    m_pStatements->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pStatements->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pStatements->setColumnCount(6);
+    m_pStatements->setHorizontalHeaderLabels(QStringList() << tr("Count") << tr("SQL") << tr("Cost before")
+                                             << tr("Cost after") << tr("Uses") << tr("Error"));
+    m_pStatements->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+
+    QTabWidget* tabs = new QTabWidget(this);
+    tabs->addTab(m_pIndexes, tr("Recommended indexes"));
+    tabs->addTab(m_pStatements, tr("Statements"));
+
+    m_pStatus = new QLabel(this);
+    m_pStartBtn = new QPushButton(tr("Analyze"), this);
+    m_pCopyBtn = new QPushButton(tr("Copy DDL"), this);
+    m_pCopyBtn->setEnabled(false);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addWidget(m_pStatus, 1);
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(m_pCopyBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(fileBar);
+    layout->addLayout(bar);
+    layout->addWidget(tabs, 1);
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(browseBtn, SIGNAL(clicked()), this, SLOT(browse()));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(m_pCopyBtn, SIGNAL(clicked()), this, SLOT(copyDdl()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+DialogAdvisor::~DialogAdvisor()
+{
+    stop();
+}
+
+void DialogAdvisor::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogAdvisor::browse()
+{
+    QString path = QFileDialog::getOpenFileName(this, tr("Open workload"), QString(),
+                                                tr("SQL (*.sql *.txt *.log);;All files (*)"));
+    if (!path.isEmpty()) m_pWorkload->setText(path);
+}
+
+void DialogAdvisor::start()
+{
+    if (m_pThread)
+    {
+        // 正在分析时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+
+    string text, err;
+    if (!CSQLite3Advisor::ReadFile(m_pWorkload->text().toStdString(), text, err))
+    {
+        m_pStatus->setText(QString::fromStdString(err));
+        return;
+    }
+
+    AdvisorOptions opts;
+    opts.sampleRows = m_pSampleRows->value();
+    opts.maxColumns = m_pMaxColumns->value();
+
+    m_pCopyBtn->setEnabled(false);
+    m_pThread = new AdvisorThread(m_advisor, QString::fromStdString(m_pSqlite->GetPath()), m_pSqlite->GetSchema(),
+                                  QString::fromStdString(text), opts);
+    connect(m_pThread, SIGNAL(progress(int,int)), this, SLOT(onProgress(int,int)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pStatus->setText(tr("Measuring b-trees and generating candidates..."));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pThread->start();
+}
+
+void DialogAdvisor::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pStartBtn->setText(tr("Analyze"));
+}
+
+void DialogAdvisor::onProgress(int done, int total)
+{
+    m_pStatus->setText(tr("%1 / %2 tables sampled and statements explained").arg(done).arg(total));
+}
+
+void DialogAdvisor::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    stop();
+    if (!ok)
+    {
+        m_pStatus->setText(QString::fromStdString(m_advisor.GetError()));
+        return;
+    }
+    fill();
+}
+
+void DialogAdvisor::fill()
+{
+    const vector<IndexCandidate>& indexes = m_advisor.Recommendations();
+    m_pIndexes->setSortingEnabled(false);
+    m_pIndexes->setRowCount(0);
+    for (auto it=indexes.begin(); it!=indexes.end(); ++it)
+    {
+        int row = m_pIndexes->rowCount();
+        m_pIndexes->insertRow(row);
+        m_pIndexes->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(it->ddl)));
+        m_pIndexes->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(it->table)));
+        m_pIndexes->setItem(row, 2, numberItem((double)it->estPages));
+        m_pIndexes->setItem(row, 3, numberItem(it->saved, 1));
+        m_pIndexes->setItem(row, 4, numberItem(it->maintenance, 1));
+        m_pIndexes->setItem(row, 5, numberItem(it->Net(), 1));
+        m_pIndexes->setItem(row, 6, numberItem(it->statements));
+    }
+    m_pIndexes->setSortingEnabled(true);
+
+    const vector<AdvisorStatement>& stmts = m_advisor.Statements();
+    m_pStatements->setSortingEnabled(false);
+    m_pStatements->setRowCount(0);
+    int nError = 0;
+    for (auto it=stmts.begin(); it!=stmts.end(); ++it)
+    {
+        if (!it->err.empty()) nError++;
+        int row = m_pStatements->rowCount();
+        m_pStatements->insertRow(row);
+        QString sql = QString::fromStdString(it->sql).simplified();
+        if (sql.size() > ADVISOR_SQL_CHARS) sql = sql.left(ADVISOR_SQL_CHARS) + "...";
+        QTableWidgetItem* sqlItem = new QTableWidgetItem(sql);
+        sqlItem->setToolTip(tr("%1\n\nBefore:\n%2\nAfter:\n%3").arg(QString::fromStdString(it->sql))
+                            .arg(QString::fromStdString(it->basePlan)).arg(QString::fromStdString(it->newPlan)));
+        QString uses;
+        for (auto i=it->indexes.begin(); i!=it->indexes.end(); ++i)
+            uses += (uses.isEmpty() ? "" : ", ") + QString::fromStdString(*i);
+
+        m_pStatements->setItem(row, 0, numberItem(it->count));
+        m_pStatements->setItem(row, 1, sqlItem);
+        m_pStatements->setItem(row, 5, new QTableWidgetItem(QString::fromStdString(it->err)));
+        if (!it->err.empty()) continue;
+        m_pStatements->setItem(row, 2, numberItem(it->baseCost, 1));
+        m_pStatements->setItem(row, 3, numberItem(it->newCost, 1));
+        m_pStatements->setItem(row, 4, new QTableWidgetItem(uses));
+    }
+    m_pStatements->setSortingEnabled(true);
+
+    m_pCopyBtn->setEnabled(!indexes.empty());
+    m_pStatus->setText(tr("%1 distinct statements (%2 not explained), %3 indexes recommended")
+                       .arg(stmts.size()).arg(nError).arg(indexes.size()));
+}
+
+void DialogAdvisor::copyDdl()
+{
+    QString ddl;
+    const vector<IndexCandidate>& indexes = m_advisor.Recommendations();
+    for (auto it=indexes.begin(); it!=indexes.end(); ++it)
+    {
+        ddl += QString::fromStdString(it->ddl) + ";\n";
+    }
+    QApplication::clipboard()->setText(ddl);
+    m_pStatus->setText(tr("Copied %1 CREATE INDEX statements").arg(indexes.size()));
+}
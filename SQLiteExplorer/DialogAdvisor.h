@@ -0,0 +1,59 @@
+#ifndef DIALOGADVISOR_H
+#define DIALOGADVISOR_H
+
+#include <QDialog>
+
+#include "SQLite3Advisor.h"
+
+class CSQLite3DB;
+class QLineEdit;
+class QTableWidget;
+class QSpinBox;
+class QPushButton;
+class QLabel;
+class AdvisorThread;
+
+/*
+** Suggest indexes for a workload of SQL statements read from a file.
+** The recommendations are ranked by the page reads they save over the
+** whole workload; the statements grid shows every distinct statement
+** with its estimated cost before and after, and its plans as tooltip.
+*/
+class DialogAdvisor : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogAdvisor(CSQLite3DB* pSqlite, QWidget *parent = 0);
+    ~DialogAdvisor();
+
+protected:
+    void reject();
+
+private slots:
+    void browse();
+    void start();
+    void copyDdl();
+    void onProgress(int done, int total);
+    void onFinished();
+
+private:
+    void stop();
+    void fill();
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    CSQLite3Advisor m_advisor;
+    AdvisorThread*  m_pThread;
+
+    QLineEdit*      m_pWorkload;
+    QSpinBox*       m_pSampleRows;
+    QSpinBox*       m_pMaxColumns;
+    QTableWidget*   m_pIndexes;
+    QTableWidget*   m_pStatements;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+    QPushButton*    m_pCopyBtn;
+};
+
+#endif // DIALOGADVISOR_H
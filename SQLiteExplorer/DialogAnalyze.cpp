@@ -0,0 +1,238 @@
+#include "DialogAnalyze.h"
+#include "AnalyzeThread.h"
+#include "SQLite3ColumnStats.h"
+#include "SQLite3DB.h"
+
+#include <QCheckBox>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QSplitter>
+#include <QPushButton>
+#include <QLabel>
+#include <QMessageBox>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+// 样本值显示的最大长度
+static const int ANALYZE_VALUE_CHARS = 80;
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+static QTableWidget* newTable(const QStringList& labels, QWidget* parent)
+{
+    QTableWidget* table = new QTableWidget(parent);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setColumnCount(labels.size());
+    table->setHorizontalHeaderLabels(labels);
+    table->horizontalHeader()->setStretchLastSection(true);
+    return table;
+}
+
+DialogAnalyze::DialogAnalyze(CSQLite3DB *pSqlite, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+    , m_pThread(NULL)
+{
+    setWindowTitle(tr("Offline ANALYZE - %1").arg(QString::fromStdString(pSqlite->GetPath())));
+    resize(1000, 640);
+
+    m_pStat4 = new QCheckBox(tr("Generate sqlite_stat4 samples"), this);
+    m_pStat4->setToolTip(tr("Keeps one byte per index entry while the samples are chosen"));
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Statistics are computed from the pages; the database is not locked."), this), 1);
+    bar->addWidget(m_pStat4);
+
+    m_pEntries = newTable(QStringList() << tr("Table") << tr("Index") << tr("Current stat")
+                          << tr("New stat") << tr("Change") << tr("Max change %") << tr("Pages read")
+                          << tr("Samples") << tr("Note"), this);
+    m_pSamples = newTable(QStringList() << tr("First column") << tr("neq") << tr("nlt") << tr("ndlt"), this);
+    m_pSamples->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    QSplitter* splitter = new QSplitter(Qt::Vertical, this);
+    splitter->addWidget(m_pEntries);
+    splitter->addWidget(m_pSamples);
+    splitter->setStretchFactor(0, 3);
+    splitter->setStretchFactor(1, 1);
+
+    m_pStatus = new QLabel(this);
+    m_pStartBtn = new QPushButton(tr("Compute"), this);
+    m_pWriteBtn = new QPushButton(tr("Write to database"), this);
+    m_pWriteBtn->setEnabled(false);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addWidget(m_pStatus, 1);
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(m_pWriteBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(bar);
+    layout->addWidget(splitter, 1);
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(m_pEntries, SIGNAL(itemSelectionChanged()), this, SLOT(onEntrySelected()));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(m_pWriteBtn, SIGNAL(clicked()), this, SLOT(write()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+DialogAnalyze::~DialogAnalyze()
+{
+    stop();
+}
+
+void DialogAnalyze::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogAnalyze::start()
+{
+    if (m_pThread)
+    {
+        // 正在统计时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+
+    AnalyzeOptions opts;
+    opts.stat4 = m_pStat4->isChecked();
+
+    m_pWriteBtn->setEnabled(false);
+    m_pEntries->setRowCount(0);
+    m_pSamples->setRowCount(0);
+    m_pThread = new AnalyzeThread(m_analyze, QString::fromStdString(m_pSqlite->GetPath()), m_pSqlite->GetSchema(), opts);
+    connect(m_pThread, SIGNAL(progress(int,int)), this, SLOT(onProgress(int,int)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pStatus->setText(tr("Walking index b-trees..."));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pThread->start();
+}
+
+void DialogAnalyze::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pStartBtn->setText(tr("Compute"));
+}
+
+void DialogAnalyze::onProgress(int done, int total)
+{
+    m_pStatus->setText(tr("%1 / %2 b-trees walked").arg(done).arg(total));
+}
+
+void DialogAnalyze::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    stop();
+    if (!ok)
+    {
+        m_pStatus->setText(QString::fromStdString(m_analyze.GetError()));
+        return;
+    }
+    fill();
+}
+
+void DialogAnalyze::fill()
+{
+    static const char* changes[] = { QT_TR_NOOP("unchanged"), QT_TR_NOOP("changed"),
+                                     QT_TR_NOOP("new"), QT_TR_NOOP("removed") };
+    const vector<AnalyzeEntry>& entries = m_analyze.Entries();
+    m_pEntries->setSortingEnabled(false);
+    m_pEntries->setRowCount(0);
+    int nChanged = 0;
+    for (size_t i=0; i<entries.size(); ++i)
+    {
+        const AnalyzeEntry& e = entries[i];
+        if (e.change != ANALYZE_UNCHANGED) nChanged++;
+        int row = m_pEntries->rowCount();
+        m_pEntries->insertRow(row);
+        QTableWidgetItem* tblItem = new QTableWidgetItem(QString::fromStdString(e.tbl));
+        tblItem->setData(Qt::UserRole, (int)i);
+        m_pEntries->setItem(row, 0, tblItem);
+        m_pEntries->setItem(row, 1, new QTableWidgetItem(e.idx.empty() ? QString("NULL") : QString::fromStdString(e.idx)));
+        m_pEntries->setItem(row, 2, new QTableWidgetItem(QString::fromStdString(e.oldStat)));
+        m_pEntries->setItem(row, 3, new QTableWidgetItem(QString::fromStdString(e.stat)));
+        m_pEntries->setItem(row, 4, new QTableWidgetItem(tr(changes[e.change])));
+        if (e.change == ANALYZE_CHANGED) m_pEntries->setItem(row, 5, numberItem(e.maxChange * 100, 1));
+        m_pEntries->setItem(row, 6, numberItem(e.pages));
+        if (!e.samples.empty() || e.oldSamples > 0)
+            m_pEntries->setItem(row, 7, new QTableWidgetItem(tr("%1 -> %2").arg(e.oldSamples).arg(e.samples.size())));
+        m_pEntries->setItem(row, 8, new QTableWidgetItem(QString::fromStdString(e.note)));
+        if (e.change != ANALYZE_UNCHANGED)
+        {
+            for (int c=0; c<m_pEntries->columnCount(); ++c)
+            {
+                if (m_pEntries->item(row, c)) m_pEntries->item(row, c)->setForeground(Qt::blue);
+            }
+        }
+    }
+    m_pEntries->setSortingEnabled(true);
+    m_pEntries->resizeColumnsToContents();
+
+    QString status = tr("%1 rows, %2 differ from sqlite_stat1").arg(entries.size()).arg(nChanged);
+    if (m_pStat4->isChecked() && !m_analyze.HasStat4Table())
+        status += tr("; the database has no sqlite_stat4, samples will not be written");
+    m_pStatus->setText(status);
+    m_pWriteBtn->setEnabled(!entries.empty());
+}
+
+void DialogAnalyze::onEntrySelected()
+{
+    m_pSamples->setRowCount(0);
+    QList<QTableWidgetItem*> items = m_pEntries->selectedItems();
+    if (items.isEmpty()) return;
+    QTableWidgetItem* tblItem = m_pEntries->item(items[0]->row(), 0);
+    int i = tblItem ? tblItem->data(Qt::UserRole).toInt() : -1;
+    const vector<AnalyzeEntry>& entries = m_analyze.Entries();
+    if (i < 0 || i >= (int)entries.size()) return;
+
+    const vector<Stat4Row>& samples = entries[i].samples;
+    for (size_t k=0; k<samples.size(); ++k)
+    {
+        StatValue value;
+        CSQLite3ColumnStats::DecodeFirstField((const unsigned char*)samples[k].sample.data(),
+                                              (int)samples[k].sample.size(), value);
+        m_pSamples->insertRow((int)k);
+        m_pSamples->setItem((int)k, 0, new QTableWidgetItem(QString::fromStdString(value.ToString(ANALYZE_VALUE_CHARS))));
+        m_pSamples->setItem((int)k, 1, new QTableWidgetItem(QString::fromStdString(Stat4Row::Join(samples[k].neq))));
+        m_pSamples->setItem((int)k, 2, new QTableWidgetItem(QString::fromStdString(Stat4Row::Join(samples[k].nlt))));
+        m_pSamples->setItem((int)k, 3, new QTableWidgetItem(QString::fromStdString(Stat4Row::Join(samples[k].ndlt))));
+    }
+}
+
+void DialogAnalyze::write()
+{
+    if (QMessageBox::question(this, tr("SQLiteExplorer"),
+                              tr("Replace the rows of the analyzed tables in sqlite_stat1%1?")
+                              .arg(m_pStat4->isChecked() && m_analyze.HasStat4Table() ? tr(" and sqlite_stat4") : QString()))
+        != QMessageBox::Yes)
+        return;
+
+    string err;
+    if (!m_analyze.Write(m_pSqlite->GetPath(), err))
+    {
+        m_pStatus->setText(tr("Not written: %1").arg(QString::fromStdString(err)));
+        return;
+    }
+    m_pWriteBtn->setEnabled(false);
+    m_pStatus->setText(tr("Written. Open connections use the new statistics after reopening "
+                          "the database or running ANALYZE sqlite_schema."));
+}
@@ -0,0 +1,56 @@
+#ifndef DIALOGANALYZE_H
+#define DIALOGANALYZE_H
+
+#include <QDialog>
+
+#include "SQLite3Analyze.h"
+
+class CSQLite3DB;
+class QCheckBox;
+class QTableWidget;
+class QPushButton;
+class QLabel;
+class AnalyzeThread;
+
+/*
+** sqlite_stat1 (and optionally sqlite_stat4) as ANALYZE would write it,
+** computed from the pages without locking the database, next to the
+** rows the database has now.  Write replaces the rows of the analyzed
+** tables in one short transaction.
+*/
+class DialogAnalyze : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogAnalyze(CSQLite3DB* pSqlite, QWidget *parent = 0);
+    ~DialogAnalyze();
+
+protected:
+    void reject();
+
+private slots:
+    void start();
+    void write();
+    void onProgress(int done, int total);
+    void onFinished();
+    void onEntrySelected();
+
+private:
+    void stop();
+    void fill();
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    CSQLite3Analyze m_analyze;
+    AnalyzeThread*  m_pThread;
+
+    QCheckBox*      m_pStat4;
+    QTableWidget*   m_pEntries;
+    QTableWidget*   m_pSamples;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+    QPushButton*    m_pWriteBtn;
+};
+
+#endif // DIALOGANALYZE_H
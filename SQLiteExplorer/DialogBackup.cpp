@@ -0,0 +1,190 @@
+#include "DialogBackup.h"
+#include "BackupThread.h"
+
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QLabel>
+#include <QFileInfo>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+DialogBackup::DialogBackup(CSQLite3DB *pSqlite, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+    , m_pThread(NULL)
+{
+    setWindowTitle(tr("Snapshot"));
+    resize(560, 220);
+
+    QString path = m_pSqlite ? QString::fromStdString(m_pSqlite->GetPath()) : QString();
+    QFileInfo fi(path);
+
+    BackupOptions opts;
+    m_pPath = new QLineEdit(this);
+    if (path.size())
+        m_pPath->setText(fi.absolutePath() + "/" + fi.completeBaseName() + "-snapshot." + fi.suffix());
+    QPushButton* browseBtn = new QPushButton(tr("..."), this);
+    QHBoxLayout* pathBar = new QHBoxLayout;
+    pathBar->addWidget(m_pPath, 1);
+    pathBar->addWidget(browseBtn);
+
+    m_pPagesPerStep = new QSpinBox(this);
+    m_pPagesPerStep->setRange(0, 1000000);
+    m_pPagesPerStep->setSpecialValueText(tr("All at once"));
+    m_pPagesPerStep->setValue(opts.pagesPerStep);
+    m_pSleepMs = new QSpinBox(this);
+    m_pSleepMs->setRange(0, 10000);
+    m_pSleepMs->setSuffix(" ms");
+    m_pSleepMs->setValue(opts.sleepMs);
+    m_pVerify = new QCheckBox(tr("Compare page hashes with the source afterwards"), this);
+    m_pVerify->setChecked(opts.verify);
+
+    QFormLayout* form = new QFormLayout;
+    form->addRow(tr("Copy to:"), pathBar);
+    form->addRow(tr("Pages per step:"), m_pPagesPerStep);
+    form->addRow(tr("Sleep between steps:"), m_pSleepMs);
+    form->addRow(tr("Verify:"), m_pVerify);
+
+    m_pProgress = new QProgressBar(this);
+    m_pProgress->setRange(0, 100);
+    m_pProgress->setValue(0);
+    m_pStatus = new QLabel(this);
+    m_pStatus->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    m_pStartBtn = new QPushButton(tr("Start"), this);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addStretch();
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(form);
+    layout->addWidget(m_pProgress);
+    layout->addWidget(m_pStatus);
+    layout->addStretch();
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(browseBtn, SIGNAL(clicked()), this, SLOT(browse()));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+DialogBackup::~DialogBackup()
+{
+    stop();
+}
+
+void DialogBackup::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogBackup::browse()
+{
+    QString path = QFileDialog::getSaveFileName(this, tr("Snapshot"), m_pPath->text());
+    if (path.size())
+        m_pPath->setText(path);
+}
+
+void DialogBackup::start()
+{
+    if (m_pThread)
+    {
+        // 正在复制时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+    if (m_pSqlite == NULL) return;
+
+    QString src = QString::fromStdString(m_pSqlite->GetPath());
+    QString dst = m_pPath->text().trimmed();
+    if (dst.isEmpty()) return;
+    if (QFileInfo(dst).absoluteFilePath() == QFileInfo(src).absoluteFilePath())
+    {
+        QMessageBox::information(this, tr("SQLiteExplorer"), tr("Choose a file other than the database itself"));
+        return;
+    }
+    if (QFileInfo::exists(dst) &&
+        QMessageBox::question(this, tr("SQLiteExplorer"), tr("%1 exists, overwrite it?").arg(dst)) != QMessageBox::Yes)
+    {
+        return;
+    }
+
+    BackupOptions opts;
+    opts.pagesPerStep = m_pPagesPerStep->value();
+    opts.sleepMs = m_pSleepMs->value();
+    opts.verify = m_pVerify->isChecked();
+
+    m_pThread = new BackupThread(src, dst, opts);
+    connect(m_pThread, SIGNAL(progress(int,int,double)), this, SLOT(onProgress(int,int,double)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pProgress->setValue(0);
+    m_pStatus->setText(tr("Copying..."));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pThread->start();
+}
+
+void DialogBackup::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pStartBtn->setText(tr("Start"));
+}
+
+void DialogBackup::onProgress(int done, int total, double mbPerSec)
+{
+    int pageSize = m_pSqlite ? m_pSqlite->GetPageSize() : 0;
+    m_pProgress->setValue(total > 0 ? (int)((qint64)done * 100 / total) : 0);
+    m_pStatus->setText(tr("%1 / %2 pages (%3 MB), %4 MB/s")
+                       .arg(done).arg(total)
+                       .arg((double)done * pageSize / (1024.0*1024.0), 0, 'f', 1)
+                       .arg(mbPerSec, 0, 'f', 1));
+}
+
+void DialogBackup::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    bool cancelled = m_pThread->cancelled();
+    QString err = m_pThread->error();
+    BackupResult res = m_pThread->result();
+    stop();
+
+    if (cancelled)
+    {
+        m_pProgress->setValue(0);
+        m_pStatus->setText(tr("Cancelled"));
+        return;
+    }
+    if (!ok)
+    {
+        m_pStatus->setText(res.verified && res.mismatches > 0
+                           ? tr("%1 (%2 pages)").arg(err).arg(res.mismatches) : err);
+        return;
+    }
+
+    QString msg = tr("%1 pages copied in %2 s, %3 steps, restarted %4 times")
+            .arg(res.pages).arg(res.seconds, 0, 'f', 1).arg(res.steps).arg(res.restarts);
+    if (res.verified)
+    {
+        msg += "\n" + (res.verifyNote.empty() ? tr("Verified: every page matches the source")
+                                              : tr("Verified: %1").arg(QString::fromStdString(res.verifyNote)));
+    }
+    m_pProgress->setValue(100);
+    m_pStatus->setText(msg);
+}
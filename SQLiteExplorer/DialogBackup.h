@@ -0,0 +1,54 @@
+#ifndef DIALOGBACKUP_H
+#define DIALOGBACKUP_H
+
+#include <QDialog>
+
+#include "SQLite3DB.h"
+
+class QLineEdit;
+class QSpinBox;
+class QCheckBox;
+class QProgressBar;
+class QPushButton;
+class QLabel;
+class BackupThread;
+
+/*
+** Take a consistent snapshot of the database with the online backup API
+** while other processes keep writing to it.  The copy runs on a worker
+** thread a few pages per step with a pause in between.
+*/
+class DialogBackup : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogBackup(CSQLite3DB* pSqlite, QWidget *parent = 0);
+    ~DialogBackup();
+
+protected:
+    void reject();
+
+private slots:
+    void browse();
+    void start();
+    void onProgress(int done, int total, double mbPerSec);
+    void onFinished();
+
+private:
+    void stop();
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    BackupThread*   m_pThread;
+
+    QLineEdit*      m_pPath;
+    QSpinBox*       m_pPagesPerStep;
+    QSpinBox*       m_pSleepMs;
+    QCheckBox*      m_pVerify;
+    QProgressBar*   m_pProgress;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+};
+
+#endif // DIALOGBACKUP_H
@@ -0,0 +1,291 @@
+#include "DialogColumnStats.h"
+#include "ColumnStatsThread.h"
+#include "SQLite3DB.h"
+
+#include <QComboBox>
+#include <QCheckBox>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QTabWidget>
+#include <QSplitter>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <algorithm>
+
+// 表格中值显示的最大长度
+static const int COLSTATS_VALUE_CHARS = 80;
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : (double)(qint64)(val + 0.5));
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+static QTableWidgetItem* valueItem(const StatValue& val)
+{
+    QTableWidgetItem* item = new QTableWidgetItem(QString::fromStdString(val.ToString(COLSTATS_VALUE_CHARS)));
+    item->setToolTip(QString::fromStdString(val.ToString(1024)));
+    return item;
+}
+
+static QTableWidget* newTable(const QStringList& labels, QWidget* parent)
+{
+    QTableWidget* table = new QTableWidget(parent);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setColumnCount(labels.size());
+    table->setHorizontalHeaderLabels(labels);
+    table->horizontalHeader()->setStretchLastSection(true);
+    return table;
+}
+
+DialogColumnStats::DialogColumnStats(CSQLite3DB *pSqlite, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+    , m_pThread(NULL)
+{
+    setWindowTitle(tr("Column statistics - %1").arg(QString::fromStdString(pSqlite->GetPath())));
+    resize(1000, 680);
+
+    // 只列出rowid表
+    m_pTable = new QComboBox(this);
+    const vector<SchemaObject>& objects = pSqlite->GetSchema().Objects();
+    for (auto it=objects.begin(); it!=objects.end(); ++it)
+    {
+        if (it->type == "table" && it->rootpage > 1 && !it->withoutRowid)
+            m_pTable->addItem(QString::fromStdString(it->name));
+    }
+
+    ColumnStatsOptions opts;
+    m_pSampleLeaves = new QSpinBox(this);
+    m_pSampleLeaves->setRange(1, 1000000);
+    m_pSampleLeaves->setSingleStep(100);
+    m_pSampleLeaves->setValue(opts.sampleLeaves);
+    m_pSampleLeaves->setToolTip(tr("Leaf pages decoded, picked uniformly at random"));
+    m_pExact = new QCheckBox(tr("Exact (read every leaf)"), this);
+    m_pBuckets = new QSpinBox(this);
+    m_pBuckets->setRange(2, 256);
+    m_pBuckets->setValue(opts.buckets);
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Table:"), this));
+    bar->addWidget(m_pTable, 1);
+    bar->addWidget(new QLabel(tr("Sample leaves:"), this));
+    bar->addWidget(m_pSampleLeaves);
+    bar->addWidget(m_pExact);
+    bar->addWidget(new QLabel(tr("Buckets:"), this));
+    bar->addWidget(m_pBuckets);
+
+    m_pColumns = newTable(QStringList() << tr("Column") << tr("Type") << tr("Null %") << tr("Distinct")
+                          << tr("stat1 distinct") << tr("Avg bytes") << tr("Min") << tr("Max")
+                          << tr("Storage classes"), this);
+    m_pTop = newTable(QStringList() << tr("Value") << tr("Est. rows") << tr("Fraction"), this);
+    m_pHistogram = newTable(QStringList() << tr("Upper bound") << tr("Est. rows")
+                            << tr("Distinct in sample"), this);
+    m_pStat4 = newTable(QStringList() << tr("Sample value") << tr("stat4 eq") << tr("Est. eq")
+                        << tr("stat4 lt") << tr("Est. lt"), this);
+    m_pTop->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_pHistogram->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_pStat4->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    QTabWidget* tabs = new QTabWidget(this);
+    tabs->addTab(m_pTop, tr("Most common values"));
+    tabs->addTab(m_pHistogram, tr("Histogram"));
+    tabs->addTab(m_pStat4, tr("sqlite_stat4"));
+
+    QSplitter* splitter = new QSplitter(Qt::Vertical, this);
+    splitter->addWidget(m_pColumns);
+    splitter->addWidget(tabs);
+
+    m_pStatus = new QLabel(this);
+    m_pStartBtn = new QPushButton(tr("Compute"), this);
+    m_pStartBtn->setEnabled(m_pTable->count() > 0);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addWidget(m_pStatus, 1);
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(bar);
+    layout->addWidget(splitter, 1);
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(m_pExact, SIGNAL(toggled(bool)), this, SLOT(onExactToggled(bool)));
+    connect(m_pColumns, SIGNAL(itemSelectionChanged()), this, SLOT(onColumnSelected()));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+DialogColumnStats::~DialogColumnStats()
+{
+    stop();
+}
+
+void DialogColumnStats::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogColumnStats::onExactToggled(bool exact)
+{
+    m_pSampleLeaves->setEnabled(!exact);
+}
+
+void DialogColumnStats::start()
+{
+    if (m_pThread)
+    {
+        // 正在统计时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+
+    ColumnStatsOptions opts;
+    opts.sampleLeaves = m_pExact->isChecked() ? 0 : m_pSampleLeaves->value();
+    opts.buckets = m_pBuckets->value();
+
+    m_pColumns->setRowCount(0);
+    m_pTop->setRowCount(0);
+    m_pHistogram->setRowCount(0);
+    m_pStat4->setRowCount(0);
+    m_pThread = new ColumnStatsThread(m_stats, QString::fromStdString(m_pSqlite->GetPath()), m_pSqlite->GetSchema(),
+                                      m_pTable->currentText(), opts);
+    connect(m_pThread, SIGNAL(progress(int,int)), this, SLOT(onProgress(int,int)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pStatus->setText(tr("Reading leaf pages..."));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pThread->start();
+}
+
+void DialogColumnStats::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pStartBtn->setText(tr("Compute"));
+}
+
+void DialogColumnStats::onProgress(int done, int total)
+{
+    m_pStatus->setText(tr("%1 / %2 leaf pages decoded").arg(done).arg(total));
+}
+
+void DialogColumnStats::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    stop();
+    if (!ok)
+    {
+        m_pStatus->setText(QString::fromStdString(m_stats.GetError()));
+        return;
+    }
+    fill();
+}
+
+void DialogColumnStats::fill()
+{
+    const vector<ColumnStat>& columns = m_stats.Columns();
+    m_pColumns->setSortingEnabled(false);
+    m_pColumns->setRowCount(0);
+    for (size_t i=0; i<columns.size(); ++i)
+    {
+        const ColumnStat& c = columns[i];
+        int row = m_pColumns->rowCount();
+        m_pColumns->insertRow(row);
+        QTableWidgetItem* nameItem = new QTableWidgetItem(QString::fromStdString(c.name));
+        nameItem->setData(Qt::UserRole, (int)i);
+        m_pColumns->setItem(row, 0, nameItem);
+        m_pColumns->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(c.declType)));
+        m_pColumns->setItem(row, 2, numberItem(c.NullFraction() * 100, 2));
+        QTableWidgetItem* distinct = numberItem(c.distinct);
+        distinct->setToolTip(c.distinctExact ? tr("Exact") : tr("Estimated"));
+        m_pColumns->setItem(row, 3, distinct);
+        if (c.stat1Distinct >= 0)
+        {
+            // stat1的不同值包括NULL
+            QTableWidgetItem* stat1 = numberItem(c.stat1Distinct);
+            stat1->setToolTip(tr("N/a1 of index %1, NULL counted as a value; ours with NULL: %2")
+                              .arg(QString::fromStdString(c.statIndex))
+                              .arg((qint64)(c.distinct + (c.nulls > 0 ? 1 : 0) + 0.5)));
+            m_pColumns->setItem(row, 4, stat1);
+        }
+        m_pColumns->setItem(row, 5, numberItem(c.AvgBytes(), 1));
+        m_pColumns->setItem(row, 6, valueItem(c.minValue));
+        m_pColumns->setItem(row, 7, valueItem(c.maxValue));
+
+        QStringList classes;
+        if (c.ints > 0) classes << tr("INTEGER %1").arg(c.ints);
+        if (c.reals > 0) classes << tr("REAL %1").arg(c.reals);
+        if (c.texts > 0) classes << tr("TEXT %1").arg(c.texts);
+        if (c.blobs > 0) classes << tr("BLOB %1").arg(c.blobs);
+        if (c.nulls > 0) classes << tr("NULL %1").arg(c.nulls);
+        m_pColumns->setItem(row, 8, new QTableWidgetItem(classes.join(", ")));
+    }
+    m_pColumns->setSortingEnabled(true);
+    m_pColumns->resizeColumnsToContents();
+
+    const RawScanStats& scan = m_stats.ScanStats();
+    qint64 rows = (qint64)(m_stats.EstimatedRows() + 0.5);
+    QString status = m_stats.Exact() ? tr("%1 rows in %2 leaves (exact)").arg(rows).arg(scan.totalLeaves)
+                                     : tr("~%1 rows, %2 of %3 leaves sampled").arg(rows).arg(scan.leaves).arg(scan.totalLeaves);
+    if (scan.badPages + scan.badCells > 0)
+        status += tr(", %1 bad pages, %2 bad cells skipped").arg(scan.badPages).arg(scan.badCells);
+    m_pStatus->setText(status + tr(", %1 s").arg(scan.seconds, 0, 'f', 2));
+    if (m_pColumns->rowCount() > 0) m_pColumns->selectRow(0);
+}
+
+void DialogColumnStats::onColumnSelected()
+{
+    m_pTop->setRowCount(0);
+    m_pHistogram->setRowCount(0);
+    m_pStat4->setRowCount(0);
+    QList<QTableWidgetItem*> items = m_pColumns->selectedItems();
+    if (items.isEmpty()) return;
+    QTableWidgetItem* nameItem = m_pColumns->item(items[0]->row(), 0);
+    int i = nameItem ? nameItem->data(Qt::UserRole).toInt() : -1;
+    const vector<ColumnStat>& columns = m_stats.Columns();
+    if (i < 0 || i >= (int)columns.size()) return;
+    const ColumnStat& c = columns[i];
+
+    double rows = std::max(m_stats.EstimatedRows(), 1.0);
+    for (size_t k=0; k<c.topK.size(); ++k)
+    {
+        m_pTop->insertRow((int)k);
+        m_pTop->setItem((int)k, 0, valueItem(c.topK[k].value));
+        m_pTop->setItem((int)k, 1, numberItem(c.topK[k].rows));
+        m_pTop->setItem((int)k, 2, numberItem(c.topK[k].rows / rows, 4));
+        if (c.topApprox)
+            m_pTop->item((int)k, 1)->setToolTip(tr("Lower bound: rare values were dropped from the count"));
+    }
+    for (size_t k=0; k<c.histogram.size(); ++k)
+    {
+        m_pHistogram->insertRow((int)k);
+        m_pHistogram->setItem((int)k, 0, valueItem(c.histogram[k].upper));
+        m_pHistogram->setItem((int)k, 1, numberItem(c.histogram[k].rows));
+        m_pHistogram->setItem((int)k, 2, numberItem(c.histogram[k].distinct));
+    }
+    for (size_t k=0; k<c.stat4.size(); ++k)
+    {
+        const Stat4Check& s = c.stat4[k];
+        m_pStat4->insertRow((int)k);
+        m_pStat4->setItem((int)k, 0, valueItem(s.value));
+        m_pStat4->setItem((int)k, 1, numberItem(s.neq));
+        m_pStat4->setItem((int)k, 2, numberItem(s.estEq));
+        m_pStat4->setItem((int)k, 3, numberItem(s.nlt));
+        m_pStat4->setItem((int)k, 4, numberItem(s.estLt));
+    }
+}
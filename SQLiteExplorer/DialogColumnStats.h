@@ -0,0 +1,62 @@
+#ifndef DIALOGCOLUMNSTATS_H
+#define DIALOGCOLUMNSTATS_H
+
+#include <QDialog>
+
+#include "SQLite3ColumnStats.h"
+
+class CSQLite3DB;
+class QComboBox;
+class QCheckBox;
+class QTableWidget;
+class QSpinBox;
+class QPushButton;
+class QLabel;
+class ColumnStatsThread;
+
+/*
+** Column statistics of a table from a sample of its leaf pages, or from
+** all of them.  The grid has one row per stored column; selecting a row
+** shows its most common values, its histogram and, when an index starts
+** with the column, the sqlite_stat4 samples next to our estimates.
+*/
+class DialogColumnStats : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogColumnStats(CSQLite3DB* pSqlite, QWidget *parent = 0);
+    ~DialogColumnStats();
+
+protected:
+    void reject();
+
+private slots:
+    void start();
+    void onExactToggled(bool exact);
+    void onProgress(int done, int total);
+    void onFinished();
+    void onColumnSelected();
+
+private:
+    void stop();
+    void fill();
+
+private:
+    CSQLite3DB*         m_pSqlite;
+    CSQLite3ColumnStats m_stats;
+    ColumnStatsThread*  m_pThread;
+
+    QComboBox*      m_pTable;
+    QSpinBox*       m_pSampleLeaves;
+    QCheckBox*      m_pExact;
+    QSpinBox*       m_pBuckets;
+    QTableWidget*   m_pColumns;
+    QTableWidget*   m_pTop;
+    QTableWidget*   m_pHistogram;
+    QTableWidget*   m_pStat4;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+};
+
+#endif // DIALOGCOLUMNSTATS_H
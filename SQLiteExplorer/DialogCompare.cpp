@@ -0,0 +1,299 @@
+#include "DialogCompare.h"
+#include "CompareThread.h"
+
+#include <QListWidget>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QTabWidget>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QDir>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+#define COMPARE_MB (1024.0*1024.0)
+
+// 异常值的背景色
+static const QColor COMPARE_OUTLIER_COLOR(255, 200, 200);
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+static QTableWidgetItem* markItem(QTableWidgetItem* item, bool outlier)
+{
+    if (outlier) item->setBackground(COMPARE_OUTLIER_COLOR);
+    return item;
+}
+
+DialogCompare::DialogCompare(const QStringList &paths, QWidget *parent)
+    : QDialog(parent)
+    , m_pThread(NULL)
+    , m_hasResult(false)
+{
+    setWindowTitle(tr("Compare databases"));
+    resize(1000, 640);
+
+    m_pFiles = new QListWidget(this);
+    m_pFiles->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_pFiles->addItems(paths);
+    m_pFiles->setMaximumHeight(120);
+    QPushButton* addBtn = new QPushButton(tr("Add Files..."), this);
+    QPushButton* folderBtn = new QPushButton(tr("Add Folder..."), this);
+    QPushButton* removeBtn = new QPushButton(tr("Remove"), this);
+    QVBoxLayout* fileBtns = new QVBoxLayout;
+    fileBtns->addWidget(addBtn);
+    fileBtns->addWidget(folderBtn);
+    fileBtns->addWidget(removeBtn);
+    fileBtns->addStretch();
+    QHBoxLayout* fileBar = new QHBoxLayout;
+    fileBar->addWidget(m_pFiles, 1);
+    fileBar->addLayout(fileBtns);
+
+    CompareOptions opts;
+    m_pIo = new QSpinBox(this);
+    m_pIo->setRange(1, 64);
+    m_pIo->setValue(opts.ioConcurrency);
+    m_pIo->setToolTip(tr("Number of files read at the same time"));
+    m_pThreshold = new QDoubleSpinBox(this);
+    m_pThreshold->setRange(1, 50);
+    m_pThreshold->setDecimals(1);
+    m_pThreshold->setSingleStep(0.5);
+    m_pThreshold->setValue(opts.threshold);
+    m_pThreshold->setToolTip(tr("Robust z-score above which a value is highlighted"));
+    m_pOnlyOutliers = new QCheckBox(tr("Only outliers"), this);
+
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Files read at once:"), this));
+    bar->addWidget(m_pIo);
+    bar->addWidget(new QLabel(tr("Outlier threshold:"), this));
+    bar->addWidget(m_pThreshold);
+    bar->addWidget(m_pOnlyOutliers);
+    bar->addStretch();
+
+    m_pObjects = new QTableWidget(this);
+    m_pObjects->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pObjects->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pObjects->setColumnCount(7);
+    m_pObjects->setHorizontalHeaderLabels(QStringList() << tr("File") << tr("Object") << tr("Type")
+                                          << tr("Rows") << tr("Pages") << tr("Overflow") << tr("Fill %"));
+    m_pObjects->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    m_pFileStats = new QTableWidget(this);
+    m_pFileStats->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pFileStats->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pFileStats->setColumnCount(7);
+    m_pFileStats->setHorizontalHeaderLabels(QStringList() << tr("File") << tr("Pages") << tr("Page size")
+                                            << tr("Size (MB)") << tr("Freelist") << tr("Schema") << tr("Error"));
+    m_pFileStats->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    QTabWidget* tabs = new QTabWidget(this);
+    tabs->addTab(m_pObjects, tr("Tables and indexes"));
+    tabs->addTab(m_pFileStats, tr("Files"));
+
+    m_pStatus = new QLabel(this);
+    m_pStartBtn = new QPushButton(tr("Compare"), this);
+    m_pExportBtn = new QPushButton(tr("Export CSV..."), this);
+    m_pExportBtn->setEnabled(false);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addWidget(m_pStatus, 1);
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(m_pExportBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(fileBar);
+    layout->addLayout(bar);
+    layout->addWidget(tabs, 1);
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(addBtn, SIGNAL(clicked()), this, SLOT(addFiles()));
+    connect(folderBtn, SIGNAL(clicked()), this, SLOT(addFolder()));
+    connect(removeBtn, SIGNAL(clicked()), this, SLOT(removeFiles()));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(m_pExportBtn, SIGNAL(clicked()), this, SLOT(exportCsv()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+    connect(m_pThreshold, SIGNAL(valueChanged(double)), this, SLOT(onThresholdChanged()));
+    connect(m_pOnlyOutliers, SIGNAL(toggled(bool)), this, SLOT(refill()));
+}
+
+DialogCompare::~DialogCompare()
+{
+    stop();
+}
+
+void DialogCompare::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogCompare::addFiles()
+{
+    QStringList paths = QFileDialog::getOpenFileNames(this, tr("Add databases"));
+    m_pFiles->addItems(paths);
+}
+
+void DialogCompare::addFolder()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Add all files of a folder"));
+    if (dir.isEmpty()) return;
+    QDir d(dir);
+    foreach (QString name, d.entryList(QDir::Files, QDir::Name))
+    {
+        m_pFiles->addItem(QDir::toNativeSeparators(d.absoluteFilePath(name)));
+    }
+}
+
+void DialogCompare::removeFiles()
+{
+    qDeleteAll(m_pFiles->selectedItems());
+}
+
+void DialogCompare::start()
+{
+    if (m_pThread)
+    {
+        // 正在比较时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+    QStringList paths;
+    for (int i=0; i<m_pFiles->count(); ++i)
+    {
+        paths << m_pFiles->item(i)->text();
+    }
+    if (paths.isEmpty()) return;
+
+    CompareOptions opts;
+    opts.ioConcurrency = m_pIo->value();
+    opts.threshold = m_pThreshold->value();
+
+    m_hasResult = false;
+    m_pExportBtn->setEnabled(false);
+    m_pThread = new CompareThread(m_compare, paths, opts);
+    connect(m_pThread, SIGNAL(progress(int,int)), this, SLOT(onProgress(int,int)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pStatus->setText(tr("Reading %1 files...").arg(paths.size()));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pThread->start();
+}
+
+void DialogCompare::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pStartBtn->setText(tr("Compare"));
+}
+
+void DialogCompare::onProgress(int done, int total)
+{
+    m_pStatus->setText(tr("%1 / %2 files").arg(done).arg(total));
+}
+
+void DialogCompare::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool cancelled = m_pThread->cancelled();
+    stop();
+
+    // 取消时也显示已经读完的文件
+    m_hasResult = true;
+    m_pExportBtn->setEnabled(true);
+    refill();
+    if (cancelled)
+        m_pStatus->setText(tr("Cancelled; ") + m_pStatus->text());
+}
+
+void DialogCompare::onThresholdChanged()
+{
+    if (!m_hasResult || m_pThread) return;
+    m_compare.FindOutliers(m_pThreshold->value());
+    refill();
+}
+
+void DialogCompare::refill()
+{
+    if (!m_hasResult) return;
+    bool only = m_pOnlyOutliers->isChecked();
+    const vector<CompareFile>& files = m_compare.Files();
+    const vector<CompareObject>& objects = m_compare.Objects();
+
+    m_pObjects->setSortingEnabled(false);
+    m_pObjects->setRowCount(0);
+    int nOutlier = 0;
+    for (auto it=objects.begin(); it!=objects.end(); ++it)
+    {
+        if (it->outliers) nOutlier++;
+        if (only && it->outliers == 0) continue;
+
+        int row = m_pObjects->rowCount();
+        m_pObjects->insertRow(row);
+        QString path = QString::fromStdString(files[it->file].path);
+        m_pObjects->setItem(row, 0, new QTableWidgetItem(path));
+        QTableWidgetItem* name = markItem(new QTableWidgetItem(QString::fromStdString(it->name)), it->missing);
+        if (it->missing) name->setToolTip(tr("Missing in this file, present in most files"));
+        m_pObjects->setItem(row, 1, name);
+        m_pObjects->setItem(row, 2, new QTableWidgetItem(QString::fromStdString(it->type)));
+        if (it->missing) continue;
+        m_pObjects->setItem(row, 3, markItem(numberItem((double)it->stats.entries), it->outliers & COMPARE_ROWS));
+        m_pObjects->setItem(row, 4, markItem(numberItem((double)(it->stats.pages + it->stats.overflow)), it->outliers & COMPARE_PAGES));
+        m_pObjects->setItem(row, 5, numberItem((double)it->stats.overflow));
+        m_pObjects->setItem(row, 6, markItem(numberItem(it->stats.Fill() * 100, 1), it->outliers & COMPARE_FILL));
+    }
+    m_pObjects->setSortingEnabled(true);
+
+    m_pFileStats->setSortingEnabled(false);
+    m_pFileStats->setRowCount(0);
+    int nBadFile = 0;
+    for (auto it=files.begin(); it!=files.end(); ++it)
+    {
+        if (it->outliers) nBadFile++;
+        if (only && it->outliers == 0 && it->err.empty()) continue;
+
+        int row = m_pFileStats->rowCount();
+        m_pFileStats->insertRow(row);
+        m_pFileStats->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(it->path)));
+        m_pFileStats->setItem(row, 6, new QTableWidgetItem(QString::fromStdString(it->err)));
+        if (it->err.size()) continue;
+        m_pFileStats->setItem(row, 1, markItem(numberItem((double)it->pages), it->outliers & COMPARE_FILE_PAGES));
+        m_pFileStats->setItem(row, 2, numberItem(it->pageSize));
+        m_pFileStats->setItem(row, 3, markItem(numberItem(it->pages * it->pageSize / COMPARE_MB, 2), it->outliers & COMPARE_FILE_PAGES));
+        m_pFileStats->setItem(row, 4, markItem(numberItem((double)it->freelist), it->outliers & COMPARE_FREELIST));
+        m_pFileStats->setItem(row, 5, markItem(new QTableWidgetItem(it->outliers & COMPARE_SCHEMA ? tr("differs") : tr("same")),
+                                               it->outliers & COMPARE_SCHEMA));
+    }
+    m_pFileStats->setSortingEnabled(true);
+
+    m_pStatus->setText(tr("%1 files, %2 objects; %3 outlying objects, %4 outlying files")
+                       .arg(files.size()).arg(objects.size()).arg(nOutlier).arg(nBadFile));
+}
+
+void DialogCompare::exportCsv()
+{
+    if (!m_hasResult || m_pThread) return;
+    QString path = QFileDialog::getSaveFileName(this, tr("Export comparison"), "compare.csv", tr("CSV (*.csv)"));
+    if (path.isEmpty()) return;
+    string err;
+    if (!m_compare.WriteCsv(path.toStdString(), err))
+        m_pStatus->setText(QString::fromStdString(err));
+    else
+        m_pStatus->setText(tr("Exported to %1").arg(path));
+}
@@ -0,0 +1,65 @@
+#ifndef DIALOGCOMPARE_H
+#define DIALOGCOMPARE_H
+
+#include <QDialog>
+
+#include "SQLite3Compare.h"
+
+class QListWidget;
+class QTableWidget;
+class QSpinBox;
+class QDoubleSpinBox;
+class QCheckBox;
+class QPushButton;
+class QLabel;
+class CompareThread;
+
+/*
+** Compare page statistics of many database files that share a schema.
+** Two sortable grids list every table and index of every file and every
+** file's size and freelist; values that stand out against the other
+** files are highlighted, and the threshold can be changed afterwards
+** without reading the files again.
+*/
+class DialogCompare : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogCompare(const QStringList& paths, QWidget *parent = 0);
+    ~DialogCompare();
+
+protected:
+    void reject();
+
+private slots:
+    void addFiles();
+    void addFolder();
+    void removeFiles();
+    void start();
+    void exportCsv();
+    void refill();
+    void onThresholdChanged();
+    void onProgress(int done, int total);
+    void onFinished();
+
+private:
+    void stop();
+
+private:
+    CSQLite3Compare m_compare;
+    CompareThread*  m_pThread;
+    bool            m_hasResult;
+
+    QListWidget*    m_pFiles;
+    QSpinBox*       m_pIo;
+    QDoubleSpinBox* m_pThreshold;
+    QCheckBox*      m_pOnlyOutliers;
+    QTableWidget*   m_pObjects;
+    QTableWidget*   m_pFileStats;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+    QPushButton*    m_pExportBtn;
+};
+
+#endif // DIALOGCOMPARE_H
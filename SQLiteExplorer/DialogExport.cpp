@@ -0,0 +1,281 @@
+#include "DialogExport.h"
+#include "ExportThread.h"
+#include "Parallel.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QLabel>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+#define EXPORT_MB (1024.0*1024.0)
+
+// 查询模式下结果表中唯一一行的名称
+static const char* EXPORT_QUERY_NAME = "query";
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+DialogExport::DialogExport(CSQLite3DB *pSqlite, const QString &sql, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+    , m_sql(sql.trimmed())
+    , m_pThread(NULL)
+{
+    setWindowTitle(m_sql.isEmpty() ? tr("Export tables") : tr("Export query result"));
+    resize(760, 460);
+
+    ExportOptions opts;
+    m_pFormat = new QComboBox(this);
+    m_pFormat->addItem(tr("CSV"), EXPORT_CSV);
+    m_pFormat->addItem(tr("JSON Lines"), EXPORT_JSONL);
+    m_pFormat->addItem(tr("Columnar (.sqlx)"), EXPORT_COLUMNAR);
+    m_pBatchRows = new QSpinBox(this);
+    m_pBatchRows->setRange(1, 1000000);
+    m_pBatchRows->setValue(opts.batchRows);
+    m_pThreads = new QSpinBox(this);
+    m_pThreads->setRange(1, 64);
+    m_pThreads->setValue(ParallelThreadCount());
+    m_pThreads->setEnabled(m_sql.isEmpty());
+
+    QString dbPath = m_pSqlite ? QString::fromStdString(m_pSqlite->GetPath()) : QString();
+    QFileInfo fi(dbPath);
+    m_pOutput = new QLineEdit(this);
+    m_pOutput->setText(m_sql.isEmpty() ? fi.absolutePath()
+                                       : fi.absolutePath() + "/" + fi.completeBaseName() + "-query.csv");
+    QPushButton* browseBtn = new QPushButton(tr("..."), this);
+
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Format:"), this));
+    bar->addWidget(m_pFormat);
+    bar->addWidget(new QLabel(tr("Batch rows:"), this));
+    bar->addWidget(m_pBatchRows);
+    bar->addWidget(new QLabel(tr("Threads:"), this));
+    bar->addWidget(m_pThreads);
+    bar->addStretch();
+
+    QHBoxLayout* outBar = new QHBoxLayout;
+    outBar->addWidget(new QLabel(m_sql.isEmpty() ? tr("Directory:") : tr("File:"), this));
+    outBar->addWidget(m_pOutput, 1);
+    outBar->addWidget(browseBtn);
+
+    QStringList headers;
+    headers << tr("Name") << tr("Rows") << tr("MB") << tr("Seconds") << tr("Rows/s") << tr("Status");
+    m_pTable = new QTableWidget(this);
+    m_pTable->setColumnCount(headers.size());
+    m_pTable->setHorizontalHeaderLabels(headers);
+    m_pTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pTable->verticalHeader()->setVisible(false);
+    m_pTable->horizontalHeader()->setStretchLastSection(true);
+
+    QStringList names;
+    if (m_sql.size())
+    {
+        names << EXPORT_QUERY_NAME;
+    }
+    else if (m_pSqlite)
+    {
+        table_content tb;
+        cell_content hdr;
+        m_pSqlite->ExecuteCmd("select name from sqlite_master where type in ('table', 'view') order by name", tb, hdr);
+        for (auto it=tb.begin(); it!=tb.end(); ++it)
+        {
+            names << QString::fromStdString(it->at(0));
+        }
+    }
+    m_pTable->setRowCount(names.size());
+    for (int i=0; i<names.size(); ++i)
+    {
+        QTableWidgetItem* item = new QTableWidgetItem(names[i]);
+        if (m_sql.isEmpty())
+        {
+            item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+            item->setCheckState(names[i].startsWith("sqlite_") ? Qt::Unchecked : Qt::Checked);
+        }
+        m_pTable->setItem(i, 0, item);
+    }
+    m_pTable->resizeColumnToContents(0);
+
+    m_pStatus = new QLabel(this);
+    m_pStartBtn = new QPushButton(tr("Export"), this);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addWidget(m_pStatus, 1);
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(bar);
+    layout->addLayout(outBar);
+    layout->addWidget(m_pTable, 1);
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(browseBtn, SIGNAL(clicked()), this, SLOT(browse()));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+DialogExport::~DialogExport()
+{
+    stop();
+}
+
+void DialogExport::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogExport::browse()
+{
+    QString path = m_sql.isEmpty()
+            ? QFileDialog::getExistingDirectory(this, tr("Export to"), m_pOutput->text())
+            : QFileDialog::getSaveFileName(this, tr("Export to"), m_pOutput->text());
+    if (path.size())
+        m_pOutput->setText(path);
+}
+
+int DialogExport::rowOf(const QString &name) const
+{
+    for (int i=0; i<m_pTable->rowCount(); ++i)
+    {
+        if (m_pTable->item(i, 0)->text() == name) return i;
+    }
+    return -1;
+}
+
+void DialogExport::start()
+{
+    if (m_pThread)
+    {
+        // 正在导出时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+    if (m_pSqlite == NULL) return;
+
+    ExportOptions opts;
+    opts.format = (ExportFormat)m_pFormat->currentData().toInt();
+    opts.batchRows = m_pBatchRows->value();
+    opts.nThreads = m_pThreads->value();
+
+    vector<ExportJob> jobs;
+    QString out = m_pOutput->text().trimmed();
+    if (out.isEmpty()) return;
+    if (m_sql.size())
+    {
+        ExportJob job;
+        job.name = EXPORT_QUERY_NAME;
+        job.sql = m_sql.toStdString();
+        job.path = out.toStdString();
+        jobs.push_back(job);
+    }
+    else
+    {
+        QDir dir(out);
+        if (!dir.exists() && !dir.mkpath("."))
+        {
+            QMessageBox::information(this, tr("SQLiteExplorer"), tr("Cannot create %1").arg(out));
+            return;
+        }
+        for (int i=0; i<m_pTable->rowCount(); ++i)
+        {
+            QTableWidgetItem* item = m_pTable->item(i, 0);
+            if (item->checkState() != Qt::Checked) continue;
+            QString name = item->text();
+            QString quoted = name;
+            quoted.replace("\"", "\"\"");
+
+            ExportJob job;
+            job.name = name.toStdString();
+            job.sql = ("SELECT * FROM \"" + quoted + "\"").toStdString();
+            job.path = dir.filePath(name + "." + CSQLite3Export::Extension(opts.format)).toStdString();
+            jobs.push_back(job);
+        }
+    }
+    if (jobs.empty()) return;
+
+    for (int i=0; i<m_pTable->rowCount(); ++i)
+    {
+        for (int c=1; c<m_pTable->columnCount(); ++c)
+        {
+            delete m_pTable->takeItem(i, c);
+        }
+    }
+    m_pTable->setSortingEnabled(false);
+
+    m_pThread = new ExportThread(QString::fromStdString(m_pSqlite->GetPath()), jobs, opts);
+    connect(m_pThread, SIGNAL(progress(qint64,double)), this, SLOT(onProgress(qint64,double)));
+    connect(m_pThread, SIGNAL(jobDone(QString,qint64,qint64,double,QString)),
+            this, SLOT(onJobDone(QString,qint64,qint64,double,QString)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pStatus->setText(tr("Exporting..."));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pThread->start();
+}
+
+void DialogExport::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pStartBtn->setText(tr("Export"));
+}
+
+void DialogExport::onProgress(qint64 rows, double rowsPerSec)
+{
+    m_pStatus->setText(tr("%1 rows, %2 rows/s").arg(rows).arg(rowsPerSec, 0, 'f', 0));
+}
+
+void DialogExport::onJobDone(const QString &name, qint64 rows, qint64 bytes, double seconds, const QString &err)
+{
+    int row = rowOf(name);
+    if (row < 0) return;
+    m_pTable->setItem(row, 1, numberItem((double)rows));
+    m_pTable->setItem(row, 2, numberItem(bytes / EXPORT_MB, 2));
+    m_pTable->setItem(row, 3, numberItem(seconds, 2));
+    m_pTable->setItem(row, 4, numberItem(seconds > 0 ? rows / seconds : 0));
+    QTableWidgetItem* status = new QTableWidgetItem(err.isEmpty() ? tr("OK") : err);
+    if (err.size())
+        status->setForeground(Qt::red);
+    m_pTable->setItem(row, 5, status);
+}
+
+void DialogExport::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    bool cancelled = m_pThread->cancelled();
+    QString err = m_pThread->error();
+    QString text = m_pStatus->text();
+    stop();
+
+    m_pTable->setSortingEnabled(true);
+    if (cancelled)
+        m_pStatus->setText(tr("Cancelled"));
+    else if (!ok)
+        m_pStatus->setText(err);
+    else
+        m_pStatus->setText(tr("Done: %1").arg(text));
+}
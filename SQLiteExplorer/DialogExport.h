@@ -0,0 +1,58 @@
+#ifndef DIALOGEXPORT_H
+#define DIALOGEXPORT_H
+
+#include <QDialog>
+
+#include "SQLite3DB.h"
+
+class QTableWidget;
+class QComboBox;
+class QSpinBox;
+class QLineEdit;
+class QPushButton;
+class QLabel;
+class ExportThread;
+
+/*
+** Export tables (several at a time) or the result of one query to CSV,
+** JSON Lines or the columnar format of CSQLite3Export.  Rows are
+** streamed on worker threads, the dialog only shows the counters.
+*/
+class DialogExport : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // sql为空时导出所选的表，否则导出这条查询的结果
+    explicit DialogExport(CSQLite3DB* pSqlite, const QString& sql = QString(), QWidget *parent = 0);
+    ~DialogExport();
+
+protected:
+    void reject();
+
+private slots:
+    void browse();
+    void start();
+    void onProgress(qint64 rows, double rowsPerSec);
+    void onJobDone(const QString& name, qint64 rows, qint64 bytes, double seconds, const QString& err);
+    void onFinished();
+
+private:
+    void stop();
+    int rowOf(const QString& name) const;
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    QString         m_sql;
+    ExportThread*   m_pThread;
+
+    QComboBox*      m_pFormat;
+    QSpinBox*       m_pBatchRows;
+    QSpinBox*       m_pThreads;
+    QLineEdit*      m_pOutput;
+    QTableWidget*   m_pTable;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+};
+
+#endif // DIALOGEXPORT_H
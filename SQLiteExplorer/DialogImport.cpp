@@ -0,0 +1,203 @@
+#include "DialogImport.h"
+#include "ImportThread.h"
+
+#include <QLineEdit>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QLabel>
+#include <QFileInfo>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <algorithm>
+
+DialogImport::DialogImport(CSQLite3DB *pSqlite, CWorkspace *pWorkspace, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+    , m_pWorkspace(pWorkspace)
+    , m_pThread(NULL)
+{
+    setWindowTitle(tr("Import"));
+    resize(560, 320);
+
+    ImportOptions opts;
+    m_pPath = new QLineEdit(this);
+    QPushButton* browseBtn = new QPushButton(tr("..."), this);
+    QHBoxLayout* pathBar = new QHBoxLayout;
+    pathBar->addWidget(m_pPath, 1);
+    pathBar->addWidget(browseBtn);
+
+    m_pFormat = new QComboBox(this);
+    m_pFormat->addItem(tr("CSV"), IMPORT_CSV);
+    m_pFormat->addItem(tr("JSON Lines"), IMPORT_JSONL);
+    m_pTable = new QLineEdit(this);
+    m_pHeader = new QCheckBox(tr("First line holds the column names"), this);
+    m_pHeader->setChecked(opts.header);
+    m_pDelimiter = new QLineEdit(QString(QChar(opts.delimiter)), this);
+    m_pDelimiter->setMaxLength(1);
+    m_pCommitRows = new QSpinBox(this);
+    m_pCommitRows->setRange(0, 100000000);
+    m_pCommitRows->setSpecialValueText(tr("One transaction"));
+    m_pCommitRows->setValue(opts.commitRows);
+    m_pThreads = new QSpinBox(this);
+    m_pThreads->setRange(1, 64);
+    int nThreads = ParallelThreadCount();
+    int chunkBytes = CSQLite3Import::ChunkBytes(m_pWorkspace->WorkerBudget(), nThreads);
+    m_pThreads->setValue(std::min(nThreads, m_pWorkspace->Threads(CSQLite3Import::WorkerMemory(chunkBytes))));
+    m_pUnsafe = new QCheckBox(tr("journal_mode=OFF, synchronous=OFF (scratch data only)"), this);
+    m_pUnsafe->setChecked(opts.unsafeFast);
+
+    QFormLayout* form = new QFormLayout;
+    form->addRow(tr("File:"), pathBar);
+    form->addRow(tr("Format:"), m_pFormat);
+    form->addRow(tr("Table:"), m_pTable);
+    form->addRow(tr("Header:"), m_pHeader);
+    form->addRow(tr("Delimiter:"), m_pDelimiter);
+    form->addRow(tr("Rows per transaction:"), m_pCommitRows);
+    form->addRow(tr("Parser threads:"), m_pThreads);
+    form->addRow(tr("Fast:"), m_pUnsafe);
+
+    m_pProgress = new QProgressBar(this);
+    m_pProgress->setRange(0, 100);
+    m_pProgress->setValue(0);
+    m_pStatus = new QLabel(this);
+
+    m_pStartBtn = new QPushButton(tr("Import"), this);
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addStretch();
+    btnBar->addWidget(m_pStartBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(form);
+    layout->addWidget(m_pProgress);
+    layout->addWidget(m_pStatus);
+    layout->addStretch();
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(browseBtn, SIGNAL(clicked()), this, SLOT(browse()));
+    connect(m_pFormat, SIGNAL(currentIndexChanged(int)), this, SLOT(onFormatChanged(int)));
+    connect(m_pStartBtn, SIGNAL(clicked()), this, SLOT(start()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+}
+
+DialogImport::~DialogImport()
+{
+    stop();
+}
+
+void DialogImport::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogImport::browse()
+{
+    QString path = QFileDialog::getOpenFileName(this, tr("Import"), m_pPath->text(),
+                                                tr("CSV (*.csv *.txt);;JSON Lines (*.jsonl *.json);;All (*.*)"));
+    if (path.isEmpty()) return;
+    m_pPath->setText(path);
+
+    QFileInfo fi(path);
+    if (m_pTable->text().isEmpty())
+        m_pTable->setText(fi.completeBaseName());
+    QString suffix = fi.suffix().toLower();
+    m_pFormat->setCurrentIndex(suffix == "jsonl" || suffix == "json" ? 1 : 0);
+}
+
+void DialogImport::onFormatChanged(int index)
+{
+    bool csv = m_pFormat->itemData(index).toInt() == IMPORT_CSV;
+    m_pHeader->setEnabled(csv);
+    m_pDelimiter->setEnabled(csv);
+}
+
+void DialogImport::start()
+{
+    if (m_pThread)
+    {
+        // 正在导入时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+    if (m_pSqlite == NULL) return;
+
+    QString src = m_pPath->text().trimmed();
+    QString table = m_pTable->text().trimmed();
+    if (src.isEmpty() || table.isEmpty()) return;
+
+    ImportOptions opts;
+    opts.format = (ImportFormat)m_pFormat->currentData().toInt();
+    opts.table = table.toStdString();
+    opts.header = m_pHeader->isChecked();
+    QString delim = m_pDelimiter->text();
+    opts.delimiter = delim.size() ? delim.at(0).toLatin1() : ',';
+    if (delim == "\\t" || opts.delimiter == 0) opts.delimiter = '\t';
+    opts.commitRows = m_pCommitRows->value();
+    opts.nThreads = m_pThreads->value();
+    opts.chunkBytes = CSQLite3Import::ChunkBytes(m_pWorkspace->WorkerBudget(), opts.nThreads);
+    opts.unsafeFast = m_pUnsafe->isChecked();
+    opts.pool = &m_pWorkspace->Pool();
+    if (opts.unsafeFast &&
+        QMessageBox::question(this, tr("SQLiteExplorer"),
+                              tr("Without a journal a crash during the import can corrupt the whole database. Continue?")) != QMessageBox::Yes)
+    {
+        return;
+    }
+
+    m_pThread = new ImportThread(QString::fromStdString(m_pSqlite->GetPath()), src, opts);
+    connect(m_pThread, SIGNAL(progress(qint64,double,qint64,qint64)), this, SLOT(onProgress(qint64,double,qint64,qint64)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pProgress->setValue(0);
+    m_pStatus->setText(tr("Importing..."));
+    m_pStartBtn->setText(tr("Cancel"));
+    m_pWorkspace->Charge(this, opts.nThreads * CSQLite3Import::WorkerMemory(opts.chunkBytes));
+    m_pThread->start();
+}
+
+void DialogImport::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pWorkspace->Charge(this, 0);
+    m_pStartBtn->setText(tr("Import"));
+}
+
+void DialogImport::onProgress(qint64 rows, double rowsPerSec, qint64 bytes, qint64 total)
+{
+    m_pProgress->setValue(total > 0 ? (int)(bytes * 100 / total) : 0);
+    m_pStatus->setText(tr("%1 rows, %2 rows/s").arg(rows).arg(rowsPerSec, 0, 'f', 0));
+}
+
+void DialogImport::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    bool cancelled = m_pThread->cancelled();
+    QString err = m_pThread->error();
+    qint64 rows = m_pThread->rows();
+    double seconds = m_pThread->seconds();
+    stop();
+
+    if (cancelled)
+        m_pStatus->setText(tr("Cancelled, the last transaction was rolled back"));
+    else if (!ok)
+        m_pStatus->setText(err);
+    else
+        m_pStatus->setText(tr("%1 rows imported in %2 s (%3 rows/s)")
+                           .arg(rows).arg(seconds, 0, 'f', 1).arg(seconds > 0 ? rows / seconds : 0, 0, 'f', 0));
+}
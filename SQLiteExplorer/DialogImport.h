@@ -0,0 +1,63 @@
+#ifndef DIALOGIMPORT_H
+#define DIALOGIMPORT_H
+
+#include <QDialog>
+
+#include "SQLite3DB.h"
+#include "Workspace.h"
+
+class QLineEdit;
+class QComboBox;
+class QSpinBox;
+class QCheckBox;
+class QProgressBar;
+class QPushButton;
+class QLabel;
+class ImportThread;
+
+/*
+** Load a CSV or JSON Lines file into a table of the current database.
+** Parsing and inserting run on the workspace's worker pool, with as many
+** parsers by default as the memory budget allows; the table is created
+** from the first rows when it does not exist.
+*/
+class DialogImport : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DialogImport(CSQLite3DB* pSqlite, CWorkspace* pWorkspace, QWidget *parent = 0);
+    ~DialogImport();
+
+protected:
+    void reject();
+
+private slots:
+    void browse();
+    void start();
+    void onFormatChanged(int index);
+    void onProgress(qint64 rows, double rowsPerSec, qint64 bytes, qint64 total);
+    void onFinished();
+
+private:
+    void stop();
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    CWorkspace*     m_pWorkspace;
+    ImportThread*   m_pThread;
+
+    QLineEdit*      m_pPath;
+    QComboBox*      m_pFormat;
+    QLineEdit*      m_pTable;
+    QCheckBox*      m_pHeader;
+    QLineEdit*      m_pDelimiter;
+    QSpinBox*       m_pCommitRows;
+    QSpinBox*       m_pThreads;
+    QCheckBox*      m_pUnsafe;
+    QProgressBar*   m_pProgress;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pStartBtn;
+};
+
+#endif // DIALOGIMPORT_H
@@ -0,0 +1,145 @@
+#include "DialogLocality.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QApplication>
+
+// 扫描时间超过理想值的该倍数时认为值得VACUUM
+static const double LOCALITY_VACUUM_RATIO = 2.0;
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+DialogLocality::DialogLocality(CSQLite3DB *pSqlite, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+{
+    setWindowTitle(tr("B-tree locality"));
+    resize(900, 480);
+
+    ReadCostModel model;
+    m_pSeekMs = new QDoubleSpinBox(this);
+    m_pSeekMs->setRange(0, 100);
+    m_pSeekMs->setDecimals(2);
+    m_pSeekMs->setSuffix(" ms");
+    m_pSeekMs->setValue(model.seekMs);
+    m_pMBps = new QDoubleSpinBox(this);
+    m_pMBps->setRange(1, 100000);
+    m_pMBps->setSuffix(" MB/s");
+    m_pMBps->setValue(model.mbPerSec);
+    m_pReadahead = new QSpinBox(this);
+    m_pReadahead->setRange(0, 65536);
+    m_pReadahead->setSuffix(tr(" pages"));
+    m_pReadahead->setValue(model.readaheadPages);
+    QPushButton* analyzeBtn = new QPushButton(tr("Analyze"), this);
+
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Seek:"), this));
+    bar->addWidget(m_pSeekMs);
+    bar->addWidget(new QLabel(tr("Throughput:"), this));
+    bar->addWidget(m_pMBps);
+    bar->addWidget(new QLabel(tr("Readahead:"), this));
+    bar->addWidget(m_pReadahead);
+    bar->addWidget(analyzeBtn);
+    bar->addStretch();
+
+    QStringList headers;
+    headers << tr("Name") << tr("Pages") << tr("Leaves") << tr("Avg seek") << tr("Max seek")
+            << tr("Longest run") << tr("Forward %") << tr("Backward") << tr("Scan ms")
+            << tr("Ideal ms") << tr("Slowdown");
+    m_pTable = new QTableWidget(this);
+    m_pTable->setColumnCount(headers.size());
+    m_pTable->setHorizontalHeaderLabels(headers);
+    m_pTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pTable->verticalHeader()->setVisible(false);
+
+    m_pSummary = new QLabel(this);
+    m_pSummary->setWordWrap(true);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(bar);
+    layout->addWidget(m_pTable, 1);
+    layout->addWidget(m_pSummary);
+    setLayout(layout);
+
+    connect(analyzeBtn, SIGNAL(clicked()), this, SLOT(analyze()));
+    analyze();
+}
+
+void DialogLocality::analyze()
+{
+    if(m_pSqlite == NULL) return;
+
+    ReadCostModel model;
+    model.seekMs = m_pSeekMs->value();
+    model.mbPerSec = m_pMBps->value();
+    model.readaheadPages = m_pReadahead->value();
+    int pageSize = m_pSqlite->GetPageSize();
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    vector<string> names = m_pSqlite->GetAllBtreeNames();
+    vector<BtreeLocality> results;
+    for(auto it=names.begin(); it!=names.end(); ++it)
+    {
+        BtreeLocality loc;
+        loc.name = *it;
+        ComputeBtreeLocality(m_pSqlite->GetBtreePageUsage(*it), pageSize, model, loc);
+        results.push_back(loc);
+    }
+    QApplication::restoreOverrideCursor();
+
+    m_pTable->setSortingEnabled(false);
+    m_pTable->setRowCount((int)results.size());
+    double scanMs = 0, idealMs = 0;
+    QStringList worth;
+    for(size_t i=0; i<results.size(); ++i)
+    {
+        const BtreeLocality& loc = results[i];
+        double slowdown = loc.idealMs > 0 ? loc.scanMs / loc.idealMs : 1;
+        int row = (int)i;
+        m_pTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(loc.name)));
+        m_pTable->setItem(row, 1, numberItem(loc.pages));
+        m_pTable->setItem(row, 2, numberItem(loc.leaves));
+        m_pTable->setItem(row, 3, numberItem(loc.avgSeek, 1));
+        m_pTable->setItem(row, 4, numberItem(loc.maxSeek));
+        m_pTable->setItem(row, 5, numberItem(loc.longestRun));
+        m_pTable->setItem(row, 6, numberItem(loc.forwardPct, 1));
+        m_pTable->setItem(row, 7, numberItem(loc.backwardJumps));
+        m_pTable->setItem(row, 8, numberItem(loc.scanMs, 1));
+        m_pTable->setItem(row, 9, numberItem(loc.idealMs, 1));
+        m_pTable->setItem(row, 10, numberItem(slowdown, 2));
+
+        if(slowdown >= LOCALITY_VACUUM_RATIO && loc.leaves > 1)
+        {
+            for(int col=0; col<m_pTable->columnCount(); ++col)
+                m_pTable->item(row, col)->setBackground(QColor(255, 220, 200));
+            worth << QString::fromStdString(loc.name);
+        }
+        scanMs += loc.scanMs;
+        idealMs += loc.idealMs;
+    }
+    m_pTable->setSortingEnabled(true);
+    m_pTable->sortByColumn(10, Qt::DescendingOrder);
+    m_pTable->resizeColumnsToContents();
+
+    // VACUUM之后所有b-tree的页都是连续的，节省的时间即扫描时间与理想时间之差
+    QString summary = tr("Scanning every b-tree once: %1 ms now, about %2 ms after VACUUM.")
+            .arg(scanMs, 0, 'f', 0).arg(idealMs, 0, 'f', 0);
+    if(!worth.isEmpty())
+        summary += " " + tr("Scans of %1 are at least %2x slower than a contiguous layout.")
+                .arg(worth.join(", ")).arg(LOCALITY_VACUUM_RATIO);
+    m_pSummary->setText(summary);
+}
@@ -0,0 +1,37 @@
+#ifndef DIALOGLOCALITY_H
+#define DIALOGLOCALITY_H
+
+#include <QDialog>
+
+#include "BtreeLocality.h"
+
+class QTableWidget;
+class QDoubleSpinBox;
+class QSpinBox;
+class QLabel;
+
+/*
+** Locality of every b-tree of a database: how far apart consecutive
+** leaves are in the file and what a full scan costs under a simple
+** seek/throughput model compared with a freshly vacuumed layout.
+*/
+class DialogLocality : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogLocality(CSQLite3DB* pSqlite, QWidget *parent = 0);
+
+private slots:
+    void analyze();
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    QTableWidget*   m_pTable;
+    QDoubleSpinBox* m_pSeekMs;
+    QDoubleSpinBox* m_pMBps;
+    QSpinBox*       m_pReadahead;
+    QLabel*         m_pSummary;
+};
+
+#endif // DIALOGLOCALITY_H
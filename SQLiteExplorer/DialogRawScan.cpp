@@ -0,0 +1,353 @@
+#include "DialogRawScan.h"
+#include "RawScanThread.h"
+#include "Parallel.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QLabel>
+#include <QFileDialog>
+#include <QRegExp>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+// 预览的行数
+static const int RAWSCAN_PREVIEW_ROWS = 1000;
+
+/*
+** Column names of a CREATE TABLE statement and the index of its INTEGER
+** PRIMARY KEY column, whose value lives in the rowid and is stored as
+** NULL in the record.  Only the column list is split, at the commas
+** outside parentheses and quotes; table constraints are skipped.
+*/
+static QStringList parseColumns(const QString& sql, int& ipk)
+{
+    QStringList names;
+    ipk = -1;
+    int open = sql.indexOf('(');
+    if (open < 0) return names;
+
+    QStringList defs;
+    QString cur;
+    int depth = 0;
+    QChar quote;
+    for (int i=open+1; i<sql.size(); ++i)
+    {
+        QChar ch = sql[i];
+        if (!quote.isNull())
+        {
+            if (ch == quote) quote = QChar();
+        }
+        else if (ch == '"' || ch == '\'' || ch == '`' || ch == '[')
+        {
+            quote = ch == '[' ? QChar(']') : ch;
+        }
+        else if (ch == '(')
+        {
+            depth++;
+        }
+        else if (ch == ')')
+        {
+            if (depth-- == 0) break;
+        }
+        else if (ch == ',' && depth == 0)
+        {
+            defs << cur.trimmed();
+            cur.clear();
+            continue;
+        }
+        cur += ch;
+    }
+    defs << cur.trimmed();
+
+    QRegExp constraint("^(CONSTRAINT|PRIMARY|UNIQUE|CHECK|FOREIGN)\\b", Qt::CaseInsensitive);
+    QRegExp intPk("^\\S+\\s+INTEGER\\s+PRIMARY\\s+KEY\\b", Qt::CaseInsensitive);
+    for (int i=0; i<defs.size(); ++i)
+    {
+        QString def = defs[i];
+        if (def.isEmpty() || constraint.indexIn(def) == 0) continue;
+        if (intPk.indexIn(def) == 0 && ipk < 0) ipk = names.size();
+
+        QString name = def;
+        QChar first = def[0];
+        if (first == '"' || first == '`' || first == '[')
+        {
+            int end = def.indexOf(first == '[' ? QChar(']') : first, 1);
+            name = def.mid(1, end > 0 ? end-1 : -1);
+        }
+        else
+        {
+            name = def.section(QRegExp("\\s+"), 0, 0);
+        }
+        names << name;
+    }
+    return names;
+}
+
+DialogRawScan::DialogRawScan(const QString &path, QWidget *parent)
+    : QDialog(parent)
+    , m_path(path)
+    , m_pThread(NULL)
+    , m_benchmark(false)
+{
+    setWindowTitle(tr("Raw b-tree scan"));
+    resize(860, 560);
+
+    m_pPath = new QLineEdit(path, this);
+    QPushButton* browseBtn = new QPushButton(tr("File..."), this);
+    m_pPageSize = new QSpinBox(this);
+    m_pPageSize->setRange(0, 65536);
+    m_pPageSize->setSpecialValueText(tr("from header"));
+    QPushButton* loadBtn = new QPushButton(tr("Load"), this);
+
+    QHBoxLayout* fileBar = new QHBoxLayout;
+    fileBar->addWidget(new QLabel(tr("File:"), this));
+    fileBar->addWidget(m_pPath, 1);
+    fileBar->addWidget(browseBtn);
+    fileBar->addWidget(new QLabel(tr("Page size:"), this));
+    fileBar->addWidget(m_pPageSize);
+    fileBar->addWidget(loadBtn);
+
+    m_pTable = new QComboBox(this);
+    m_pTable->setMinimumContentsLength(24);
+    m_pOrder = new QComboBox(this);
+    m_pOrder->addItem(tr("Key order"), RAWSCAN_KEY_ORDER);
+    m_pOrder->addItem(tr("Physical order"), RAWSCAN_PHYSICAL_ORDER);
+    m_pThreads = new QSpinBox(this);
+    m_pThreads->setRange(1, 64);
+    m_pThreads->setValue(ParallelThreadCount());
+
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Table:"), this));
+    bar->addWidget(m_pTable);
+    bar->addWidget(new QLabel(tr("Order:"), this));
+    bar->addWidget(m_pOrder);
+    bar->addWidget(new QLabel(tr("Threads:"), this));
+    bar->addWidget(m_pThreads);
+    bar->addStretch();
+
+    m_pPreview = new QTableWidget(this);
+    m_pPreview->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pPreview->setSelectionBehavior(QAbstractItemView::SelectRows);
+
+    m_pStatus = new QLabel(this);
+    m_pStatus->setWordWrap(true);
+    m_pScanBtn = new QPushButton(tr("Scan"), this);
+    m_pBenchBtn = new QPushButton(tr("Benchmark"), this);
+    m_pBenchBtn->setToolTip(tr("Scan the table raw, then read it again with SELECT * and compare"));
+    QPushButton* closeBtn = new QPushButton(tr("Close"), this);
+    QHBoxLayout* btnBar = new QHBoxLayout;
+    btnBar->addWidget(m_pStatus, 1);
+    btnBar->addWidget(m_pScanBtn);
+    btnBar->addWidget(m_pBenchBtn);
+    btnBar->addWidget(closeBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(fileBar);
+    layout->addLayout(bar);
+    layout->addWidget(m_pPreview, 1);
+    layout->addLayout(btnBar);
+    setLayout(layout);
+
+    connect(browseBtn, SIGNAL(clicked()), this, SLOT(browse()));
+    connect(loadBtn, SIGNAL(clicked()), this, SLOT(loadTables()));
+    connect(m_pScanBtn, SIGNAL(clicked()), this, SLOT(scan()));
+    connect(m_pBenchBtn, SIGNAL(clicked()), this, SLOT(benchmark()));
+    connect(closeBtn, SIGNAL(clicked()), this, SLOT(reject()));
+
+    if (path.size())
+        loadTables();
+}
+
+DialogRawScan::~DialogRawScan()
+{
+    stop();
+}
+
+void DialogRawScan::reject()
+{
+    stop();
+    QDialog::reject();
+}
+
+void DialogRawScan::browse()
+{
+    QString path = QFileDialog::getOpenFileName(this, tr("Open file"), m_pPath->text());
+    if (path.isEmpty()) return;
+    m_pPath->setText(path);
+    loadTables();
+}
+
+void DialogRawScan::loadTables()
+{
+    stop();
+    m_path = m_pPath->text().trimmed();
+    m_tables.clear();
+    m_pTable->clear();
+    if (m_path.isEmpty()) return;
+
+    // 页1在sqlite看来也是一张表
+    CSQLite3RawScan rs;
+    if (!rs.Open(m_path.toStdString(), m_pPageSize->value()))
+    {
+        m_pStatus->setText(QString::fromStdString(rs.GetError()));
+        return;
+    }
+    vector<RawTable> found;
+    rs.ListTables(found);
+
+    RawTable master;
+    master.type = "table";
+    master.name = "sqlite_master";
+    master.root = 1;
+    master.sql = "CREATE TABLE sqlite_master(type text, name text, tbl_name text, rootpage int, sql text)";
+    m_tables.push_back(master);
+    for (auto it=found.begin(); it!=found.end(); ++it)
+    {
+        if (it->type == "table" && it->root > 0)
+            m_tables.push_back(*it);
+    }
+    // root为0扫描所有表叶子
+    RawTable all;
+    m_tables.push_back(all);
+
+    for (auto it=m_tables.begin(); it!=m_tables.end(); ++it)
+    {
+        m_pTable->addItem(it->root > 0 ? QString::fromStdString(it->name) : tr("(all table leaves)"));
+    }
+    m_pTable->setCurrentIndex(m_tables.size() > 2 ? 1 : 0);
+
+    const RawScanStats& stats = rs.GetStats();
+    m_pStatus->setText(tr("Page size %1, %2 pages, %3 tables%4")
+                       .arg(rs.PageSize()).arg(rs.PageCount()).arg(m_tables.size() - 2)
+                       .arg(stats.badPages || stats.badCells ? tr(" (schema page damaged)") : QString()));
+}
+
+void DialogRawScan::scan()
+{
+    start(false);
+}
+
+void DialogRawScan::benchmark()
+{
+    start(true);
+}
+
+void DialogRawScan::start(bool benchmark)
+{
+    if (m_pThread)
+    {
+        // 正在扫描时按钮用于取消
+        m_pThread->cancel();
+        return;
+    }
+    int index = m_pTable->currentIndex();
+    if (index < 0 || index >= (int)m_tables.size()) return;
+    const RawTable& table = m_tables[index];
+
+    int ipk = -1;
+    QStringList names = parseColumns(QString::fromStdString(table.sql), ipk);
+
+    RawScanOptions opts;
+    opts.order = (RawScanOrder)m_pOrder->currentData().toInt();
+    opts.ipkColumn = ipk;
+    opts.nThreads = m_pThreads->value();
+
+    m_pPreview->clear();
+    m_pPreview->setRowCount(0);
+    m_pPreview->setColumnCount(names.size());
+    m_pPreview->setHorizontalHeaderLabels(names);
+
+    m_benchmark = benchmark && table.root > 0;
+    m_pThread = new RawScanThread(m_path, m_pPageSize->value(), table, opts,
+                                  m_benchmark, RAWSCAN_PREVIEW_ROWS);
+    connect(m_pThread, SIGNAL(progress(int,int)), this, SLOT(onProgress(int,int)));
+    connect(m_pThread, SIGNAL(finished()), this, SLOT(onFinished()));
+    m_pStatus->setText(tr("Scanning..."));
+    (benchmark ? m_pBenchBtn : m_pScanBtn)->setText(tr("Cancel"));
+    (benchmark ? m_pScanBtn : m_pBenchBtn)->setEnabled(false);
+    m_pThread->start();
+}
+
+void DialogRawScan::stop()
+{
+    if (m_pThread)
+    {
+        m_pThread->disconnect(this);
+        m_pThread->cancel();
+        m_pThread->wait();
+        delete m_pThread;
+        m_pThread = NULL;
+    }
+    m_pScanBtn->setText(tr("Scan"));
+    m_pBenchBtn->setText(tr("Benchmark"));
+    m_pScanBtn->setEnabled(true);
+    m_pBenchBtn->setEnabled(true);
+}
+
+void DialogRawScan::onProgress(int done, int total)
+{
+    m_pStatus->setText(tr("%1 / %2 pages").arg(done).arg(total));
+}
+
+void DialogRawScan::onFinished()
+{
+    if (m_pThread == NULL) return;
+    bool ok = m_pThread->succeeded();
+    bool cancelled = m_pThread->cancelled();
+    QString err = m_pThread->error();
+    RawScanStats raw = m_pThread->rawStats();
+    RawScanStats sql = m_pThread->sqlStats();
+    QString sqlErr = m_pThread->sqlError();
+    QList<QStringList> rows = m_pThread->preview();
+    QList<qint64> rowids = m_pThread->previewRowids();
+    stop();
+
+    // 记录的字段可能比建表语句多(损坏或者没有schema)
+    int nCol = m_pPreview->columnCount();
+    for (int r=0; r<rows.size(); ++r)
+    {
+        nCol = qMax(nCol, rows[r].size());
+    }
+    m_pPreview->setColumnCount(nCol);
+    m_pPreview->setRowCount(rows.size());
+    for (int r=0; r<rows.size(); ++r)
+    {
+        m_pPreview->setVerticalHeaderItem(r, new QTableWidgetItem(QString::number(rowids[r])));
+        for (int c=0; c<rows[r].size(); ++c)
+        {
+            m_pPreview->setItem(r, c, new QTableWidgetItem(rows[r][c]));
+        }
+    }
+
+    if (cancelled)
+    {
+        m_pStatus->setText(tr("Cancelled"));
+        return;
+    }
+    if (!ok)
+    {
+        m_pStatus->setText(err);
+        return;
+    }
+
+    QString text = tr("%1 rows from %2 leaves (%3 interior, %4 overflow pages) in %5 s, %6 rows/s")
+            .arg((qint64)raw.rows).arg(raw.leaves).arg(raw.interior).arg(raw.overflow)
+            .arg(raw.seconds, 0, 'f', 3).arg(raw.seconds > 0 ? raw.rows / raw.seconds : 0, 0, 'f', 0);
+    if (raw.badPages || raw.badCells)
+        text += tr("; skipped %1 bad pages, %2 bad cells").arg(raw.badPages).arg((qint64)raw.badCells);
+    if (m_benchmark)
+    {
+        if (sqlErr.size())
+            text += tr("\nSQL: %1").arg(sqlErr);
+        else
+            text += tr("\nSQL: %1 rows in %2 s, %3 rows/s (raw scan %4x)")
+                    .arg((qint64)sql.rows).arg(sql.seconds, 0, 'f', 3)
+                    .arg(sql.seconds > 0 ? sql.rows / sql.seconds : 0, 0, 'f', 0)
+                    .arg(raw.seconds > 0 ? sql.seconds / raw.seconds : 0, 0, 'f', 2);
+    }
+    m_pStatus->setText(text);
+}
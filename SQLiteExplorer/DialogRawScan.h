@@ -0,0 +1,63 @@
+#ifndef DIALOGRAWSCAN_H
+#define DIALOGRAWSCAN_H
+
+#include <QDialog>
+
+#include "SQLite3RawScan.h"
+
+class QTableWidget;
+class QComboBox;
+class QSpinBox;
+class QLineEdit;
+class QPushButton;
+class QLabel;
+class RawScanThread;
+
+/*
+** Read a table straight from the b-tree pages with CSQLite3RawScan.
+** The file does not have to be open in the main window, nor even be a
+** database sqlite accepts: the table list comes from a raw scan of page
+** 1 and "(all table leaves)" recovers rows without any schema.
+** Benchmark runs the same table through SELECT * for comparison.
+*/
+class DialogRawScan : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogRawScan(const QString& path, QWidget *parent = 0);
+    ~DialogRawScan();
+
+protected:
+    void reject();
+
+private slots:
+    void browse();
+    void loadTables();
+    void scan();
+    void benchmark();
+    void onProgress(int done, int total);
+    void onFinished();
+
+private:
+    void start(bool benchmark);
+    void stop();
+
+private:
+    QString         m_path;
+    vector<RawTable> m_tables;
+    RawScanThread*  m_pThread;
+    bool            m_benchmark;
+
+    QLineEdit*      m_pPath;
+    QSpinBox*       m_pPageSize;
+    QComboBox*      m_pTable;
+    QComboBox*      m_pOrder;
+    QSpinBox*       m_pThreads;
+    QTableWidget*   m_pPreview;
+    QLabel*         m_pStatus;
+    QPushButton*    m_pScanBtn;
+    QPushButton*    m_pBenchBtn;
+};
+
+#endif // DIALOGRAWSCAN_H
@@ -0,0 +1,117 @@
+#include "DialogVacuumPredict.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QApplication>
+
+#define VACUUM_PREDICT_MB (1024.0*1024.0)
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+DialogVacuumPredict::DialogVacuumPredict(CSQLite3DB *pSqlite, QWidget *parent)
+    : QDialog(parent)
+    , m_pSqlite(pSqlite)
+{
+    setWindowTitle(tr("Vacuum prediction"));
+    resize(860, 480);
+
+    QStringList headers;
+    headers << tr("Name") << tr("Kind") << tr("Pages") << tr("After") << tr("Reclaimed")
+            << tr("Leaves") << tr("Leaves after") << tr("Overflow") << tr("Fill %") << tr("Fill after %");
+    m_pTable = new QTableWidget(this);
+    m_pTable->setColumnCount(headers.size());
+    m_pTable->setHorizontalHeaderLabels(headers);
+    m_pTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pTable->verticalHeader()->setVisible(false);
+
+    m_pSummary = new QLabel(this);
+    m_pSummary->setWordWrap(true);
+    m_pSummary->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    QPushButton* measureBtn = new QPushButton(tr("Measure throughput"), this);
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(m_pSummary, 1);
+    bar->addWidget(measureBtn, 0, Qt::AlignTop);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addLayout(bar);
+    layout->addWidget(m_pTable, 1);
+    setLayout(layout);
+
+    connect(measureBtn, SIGNAL(clicked()), this, SLOT(measure()));
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    CVacuumPredict predict;
+    if(m_pSqlite == NULL || !predict.Predict(m_pSqlite, m_estimate))
+    {
+        QApplication::restoreOverrideCursor();
+        m_pSummary->setText(QString::fromStdString(predict.GetError()));
+        return;
+    }
+    QApplication::restoreOverrideCursor();
+    measure();
+}
+
+void DialogVacuumPredict::measure()
+{
+    if(m_pSqlite == NULL || m_estimate.pageSize <= 0) return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    CVacuumPredict::MeasureThroughput(m_pSqlite->GetPath(), m_estimate.readMBps, m_estimate.writeMBps);
+    CVacuumPredict::EstimateRuntime(m_estimate);
+    QApplication::restoreOverrideCursor();
+    showEstimate();
+}
+
+void DialogVacuumPredict::showEstimate()
+{
+    const VacuumEstimate& est = m_estimate;
+    double curMB = est.curPages * est.pageSize / VACUUM_PREDICT_MB;
+    double newMB = est.newPages * est.pageSize / VACUUM_PREDICT_MB;
+    int64_t reclaimed = est.curPages - est.newPages;
+
+    QString summary = tr("File: %1 pages (%2 MB), %3 free pages.\n"
+                         "After VACUUM: about %4 pages (%5 MB), %6 pages (%7 MB) reclaimed.\n")
+            .arg((qint64)est.curPages).arg(curMB, 0, 'f', 1).arg((qint64)est.freePages)
+            .arg((qint64)est.newPages).arg(newMB, 0, 'f', 1)
+            .arg((qint64)reclaimed).arg(reclaimed * est.pageSize / VACUUM_PREDICT_MB, 0, 'f', 1);
+    if(est.seconds > 0)
+        summary += tr("Measured read %1 MB/s, write %2 MB/s: VACUUM should take about %3 s (I/O only).")
+                .arg(est.readMBps, 0, 'f', 0).arg(est.writeMBps, 0, 'f', 0).arg(est.seconds, 0, 'f', 1);
+    else
+        summary += tr("Throughput could not be measured.");
+    m_pSummary->setText(summary);
+
+    m_pTable->setSortingEnabled(false);
+    m_pTable->setRowCount((int)est.btrees.size());
+    for(size_t i=0; i<est.btrees.size(); ++i)
+    {
+        const VacuumBtreeEstimate& b = est.btrees[i];
+        int row = (int)i;
+        m_pTable->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(b.name)));
+        m_pTable->setItem(row, 1, new QTableWidgetItem(b.index ? tr("index") : tr("table")));
+        m_pTable->setItem(row, 2, numberItem(b.pages));
+        m_pTable->setItem(row, 3, numberItem(b.newPages));
+        m_pTable->setItem(row, 4, numberItem(b.pages - b.newPages));
+        m_pTable->setItem(row, 5, numberItem(b.leaves));
+        m_pTable->setItem(row, 6, numberItem(b.newLeaves));
+        m_pTable->setItem(row, 7, numberItem(b.overflows));
+        m_pTable->setItem(row, 8, numberItem(b.fill * 100, 1));
+        m_pTable->setItem(row, 9, numberItem(b.newFill * 100, 1));
+    }
+    m_pTable->setSortingEnabled(true);
+    m_pTable->sortByColumn(4, Qt::DescendingOrder);
+    m_pTable->resizeColumnsToContents();
+}
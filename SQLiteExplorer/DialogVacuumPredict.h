@@ -0,0 +1,36 @@
+#ifndef DIALOGVACUUMPREDICT_H
+#define DIALOGVACUUMPREDICT_H
+
+#include <QDialog>
+
+#include "VacuumPredict.h"
+
+class QTableWidget;
+class QLabel;
+
+/*
+** What VACUUM would reclaim, per b-tree and for the whole file, and how
+** long it is expected to take on this machine.  Nothing is written to
+** the database.
+*/
+class DialogVacuumPredict : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DialogVacuumPredict(CSQLite3DB* pSqlite, QWidget *parent = 0);
+
+private slots:
+    void measure();
+
+private:
+    void showEstimate();
+
+private:
+    CSQLite3DB*     m_pSqlite;
+    VacuumEstimate  m_estimate;
+    QTableWidget*   m_pTable;
+    QLabel*         m_pSummary;
+};
+
+#endif // DIALOGVACUUMPREDICT_H
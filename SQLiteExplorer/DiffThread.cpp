@@ -0,0 +1,47 @@
+#include "DiffThread.h"
+
+DiffThread::DiffThread(const string &oldPath, const string &newPath, int maxCells, QObject *parent)
+    : QThread(parent)
+    , m_oldPath(oldPath)
+    , m_newPath(newPath)
+    , m_maxCells(maxCells)
+{
+
+}
+
+void DiffThread::cancel()
+{
+    m_diff.Cancel();
+}
+
+void DiffThread::run()
+{
+    int nCells = 0;
+
+    m_diff.Run(m_oldPath, m_newPath,
+        [&](const PageDiff& page) {
+            emit pageChanged(page.pgno,
+                             QString::fromStdString(page.oldOwner),
+                             QString::fromStdString(page.newOwner),
+                             (int)page.oldType, (int)page.newType);
+        },
+        [&](const CellDiff& cell) {
+            if (nCells++ >= m_maxCells)
+            {
+                m_err = QString("more than %1 changed cells, stopped").arg(m_maxCells);
+                m_diff.Cancel();
+                return;
+            }
+            emit cellChanged(QString::fromStdString(cell.table), (int)cell.change,
+                             cell.rowid, QString::fromStdString(cell.key),
+                             cell.oldPgno, cell.newPgno);
+        },
+        [&](int done, int total) {
+            emit progress(done, total);
+        });
+
+    if (m_err.isEmpty())
+    {
+        m_err = QString::fromStdString(m_diff.GetError());
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef DIFFTHREAD_H
+#define DIFFTHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3Diff.h"
+
+/*
+** Run a CSQLite3Diff in the background and forward every changed page
+** and cell to the GUI thread through queued signals.
+*/
+class DiffThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    DiffThread(const string& oldPath, const string& newPath, int maxCells, QObject* parent = 0);
+
+    // 停止比较，不等待线程结束
+    void cancel();
+
+    // 获取错误信息
+    QString error() const { return m_err; }
+
+signals:
+    void pageChanged(int pgno, const QString& oldOwner, const QString& newOwner, int oldType, int newType);
+    void cellChanged(const QString& table, int change, qint64 rowid, const QString& key, int oldPgno, int newPgno);
+    void progress(int done, int total);
+
+protected:
+    void run();
+
+private:
+    string        m_oldPath;
+    string        m_newPath;
+    int           m_maxCells;
+    QString       m_err;
+    CSQLite3Diff  m_diff;
+};
+
+#endif // DIFFTHREAD_H
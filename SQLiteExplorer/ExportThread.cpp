@@ -0,0 +1,28 @@
+#include "ExportThread.h"
+
+ExportThread::ExportThread(const QString &dbPath, const vector<ExportJob> &jobs, const ExportOptions &opts, QObject *parent)
+    : QThread(parent)
+    , m_dbPath(dbPath)
+    , m_jobs(jobs)
+    , m_opts(opts)
+    , m_ok(false)
+{
+
+}
+
+void ExportThread::cancel()
+{
+    m_export.Cancel();
+}
+
+void ExportThread::run()
+{
+    m_ok = m_export.Run(m_dbPath.toStdString(), m_jobs, m_opts,
+        [&](int64_t rows, double rowsPerSec) {
+            emit progress((qint64)rows, rowsPerSec);
+        },
+        [&](const ExportStats& stats) {
+            emit jobDone(QString::fromStdString(stats.name), (qint64)stats.rows, (qint64)stats.bytes,
+                         stats.seconds, QString::fromStdString(stats.err));
+        });
+}
@@ -0,0 +1,42 @@
+#ifndef EXPORTTHREAD_H
+#define EXPORTTHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3Export.h"
+
+/*
+** Run a CSQLite3Export in the background and forward its progress and
+** per-job results to the GUI thread through queued signals.
+*/
+class ExportThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    ExportThread(const QString& dbPath, const vector<ExportJob>& jobs, const ExportOptions& opts, QObject* parent = 0);
+
+    // 停止导出，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_export.IsCancelled(); }
+    QString error() const { return QString::fromStdString(m_export.GetError()); }
+
+signals:
+    void progress(qint64 rows, double rowsPerSec);
+    void jobDone(const QString& name, qint64 rows, qint64 bytes, double seconds, const QString& err);
+
+protected:
+    void run();
+
+private:
+    QString           m_dbPath;
+    vector<ExportJob> m_jobs;
+    ExportOptions     m_opts;
+    bool              m_ok;
+    CSQLite3Export    m_export;
+};
+
+#endif // EXPORTTHREAD_H
@@ -0,0 +1,275 @@
+#include "ForceLayout.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <algorithm>
+
+// 重合的节点在这一层之后不再细分，放在同一个叶子里
+static const int FORCE_MAX_DEPTH = 40;
+// 每个工作线程一次处理的节点数
+static const int FORCE_GRAIN = 512;
+// 每步降温的比例
+static const double FORCE_COOLING = 0.985;
+// 温度低于该值或者最大位移小于该值时认为已经收敛
+static const double FORCE_FROZEN = 0.5;
+static const double FORCE_MIN_MOVE = 0.1;
+// 拖动节点后的温度
+static const double FORCE_REHEAT = 50;
+
+CForceLayout::CForceLayout()
+    : m_left(0), m_top(0), m_right(0), m_bottom(0)
+    , m_theta(0.7), m_temperature(0), m_lastMove(0), m_nThreads(0)
+{
+}
+
+void CForceLayout::SetGraph(const vector<double> &xs, const vector<double> &ys,
+                            const vector<pair<int, int> > &edges,
+                            double left, double top, double right, double bottom)
+{
+    int n = (int)xs.size();
+    m_xs = xs;
+    m_ys = ys;
+    m_nxs.assign(n, 0);
+    m_nys.assign(n, 0);
+    m_pinned.assign(n, 0);
+    m_left = left;
+    m_top = top;
+    m_right = right;
+    m_bottom = bottom;
+    m_temperature = std::max(right-left, bottom-top) / 10;
+    m_lastMove = m_temperature;
+
+    m_adjStart.assign(n+1, 0);
+    for (auto it=edges.begin(); it!=edges.end(); ++it)
+    {
+        if (it->first < 0 || it->first >= n || it->second < 0 || it->second >= n) continue;
+        m_adjStart[it->first+1]++;
+        m_adjStart[it->second+1]++;
+    }
+    for (int i=0; i<n; ++i)
+    {
+        m_adjStart[i+1] += m_adjStart[i];
+    }
+    m_adj.resize(m_adjStart[n]);
+    vector<int> fill(m_adjStart.begin(), m_adjStart.end()-1);
+    for (auto it=edges.begin(); it!=edges.end(); ++it)
+    {
+        if (it->first < 0 || it->first >= n || it->second < 0 || it->second >= n) continue;
+        m_adj[fill[it->first]++] = it->second;
+        m_adj[fill[it->second]++] = it->first;
+    }
+}
+
+void CForceLayout::Pin(int i, double x, double y)
+{
+    if (i < 0 || i >= Size()) return;
+    m_pinned[i] = 1;
+    m_xs[i] = x;
+    m_ys[i] = y;
+}
+
+void CForceLayout::Unpin(int i)
+{
+    if (i < 0 || i >= Size()) return;
+    m_pinned[i] = 0;
+}
+
+bool CForceLayout::Converged() const
+{
+    return m_temperature < FORCE_FROZEN || m_lastMove < FORCE_MIN_MOVE;
+}
+
+void CForceLayout::Reheat()
+{
+    m_temperature = std::max(m_temperature, FORCE_REHEAT);
+    m_lastMove = m_temperature;
+}
+
+/*
+** Build the quadtree over the current positions.  The root is the
+** bounding square of all nodes; each interior cell keeps the number of
+** nodes below it and their centre of mass.
+*/
+void CForceLayout::BuildTree()
+{
+    int n = Size();
+    double minX = m_xs[0], maxX = m_xs[0], minY = m_ys[0], maxY = m_ys[0];
+    for (int i=1; i<n; ++i)
+    {
+        minX = std::min(minX, m_xs[i]);
+        maxX = std::max(maxX, m_xs[i]);
+        minY = std::min(minY, m_ys[i]);
+        maxY = std::max(maxY, m_ys[i]);
+    }
+
+    QuadNode root;
+    root.x0 = minX;
+    root.y0 = minY;
+    root.size = std::max(maxX-minX, maxY-minY) + 1;
+    root.sx = root.sy = root.cx = root.cy = 0;
+    root.mass = 0;
+    root.child[0] = root.child[1] = root.child[2] = root.child[3] = -1;
+    root.point = -1;
+
+    m_tree.clear();
+    m_tree.reserve(2*n + 1);
+    m_tree.push_back(root);
+    for (int i=0; i<n; ++i)
+    {
+        Insert(i);
+    }
+    for (auto it=m_tree.begin(); it!=m_tree.end(); ++it)
+    {
+        if (it->mass > 0)
+        {
+            it->cx = it->sx / it->mass;
+            it->cy = it->sy / it->mass;
+        }
+    }
+}
+
+void CForceLayout::Insert(int p)
+{
+    double x = m_xs[p];
+    double y = m_ys[p];
+    int k = 0;
+    for (int depth=0; ; ++depth)
+    {
+        m_tree[k].sx += x;
+        m_tree[k].sy += y;
+        m_tree[k].mass++;
+
+        if (m_tree[k].child[0] < 0)
+        {
+            if (m_tree[k].mass == 1)
+            {
+                m_tree[k].point = p;
+                return;
+            }
+            if (depth >= FORCE_MAX_DEPTH) return;
+
+            // 叶子中已经有一个节点，分成四块后把它移到子区域
+            double half = m_tree[k].size / 2;
+            for (int q=0; q<4; ++q)
+            {
+                QuadNode c;
+                c.x0 = m_tree[k].x0 + (q & 1)*half;
+                c.y0 = m_tree[k].y0 + (q >> 1)*half;
+                c.size = half;
+                c.sx = c.sy = c.cx = c.cy = 0;
+                c.mass = 0;
+                c.child[0] = c.child[1] = c.child[2] = c.child[3] = -1;
+                c.point = -1;
+                m_tree[k].child[q] = (int)m_tree.size();
+                m_tree.push_back(c);
+            }
+
+            int old = m_tree[k].point;
+            m_tree[k].point = -1;
+            int q = (m_xs[old] >= m_tree[k].x0 + half) + 2*(m_ys[old] >= m_tree[k].y0 + half);
+            QuadNode& c = m_tree[m_tree[k].child[q]];
+            c.sx = m_xs[old];
+            c.sy = m_ys[old];
+            c.mass = 1;
+            c.point = old;
+        }
+
+        double half = m_tree[k].size / 2;
+        int q = (x >= m_tree[k].x0 + half) + 2*(y >= m_tree[k].y0 + half);
+        k = m_tree[k].child[q];
+    }
+}
+
+/*
+** Repulsion on node i.  A cell whose size seen from the node is below
+** the opening angle theta acts as a single body of its mass placed at
+** its centre of mass; otherwise its children are visited.
+*/
+void CForceLayout::Repulsion(int i, double &fx, double &fy) const
+{
+    double x = m_xs[i];
+    double y = m_ys[i];
+    double theta2 = m_theta * m_theta;
+    int stack[4*FORCE_MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+    fx = fy = 0;
+    while (top > 0)
+    {
+        const QuadNode& nd = m_tree[stack[--top]];
+        if (nd.mass == 0) continue;
+
+        double dx = x - nd.cx;
+        double dy = y - nd.cy;
+        double l = dx*dx + dy*dy;
+        if (nd.child[0] < 0 || nd.size*nd.size < theta2*l)
+        {
+            if (l > 0)
+            {
+                fx += nd.mass * dx * 75.0 / l;
+                fy += nd.mass * dy * 75.0 / l;
+            }
+            continue;
+        }
+        for (int q=0; q<4; ++q)
+        {
+            stack[top++] = nd.child[q];
+        }
+    }
+}
+
+double CForceLayout::Step()
+{
+    int n = Size();
+    if (n == 0) return 0;
+
+    BuildTree();
+    ParallelFor(n, FORCE_GRAIN, [&](int64_t begin, int64_t end) {
+        for (int64_t i=begin; i<end; ++i)
+        {
+            if (m_pinned[i])
+            {
+                m_nxs[i] = m_xs[i];
+                m_nys[i] = m_ys[i];
+                continue;
+            }
+
+            double xvel, yvel;
+            Repulsion((int)i, xvel, yvel);
+
+            // 边把两端的节点拉到一起
+            double weight = (m_adjStart[i+1] - m_adjStart[i] + 1) * 10;
+            for (int k=m_adjStart[i]; k<m_adjStart[i+1]; ++k)
+            {
+                int j = m_adj[k];
+                xvel -= (m_xs[i] - m_xs[j]) / weight;
+                yvel -= (m_ys[i] - m_ys[j]) / weight;
+            }
+
+            if (std::fabs(xvel) < 0.1 && std::fabs(yvel) < 0.1)
+                xvel = yvel = 0;
+
+            double v = std::sqrt(xvel*xvel + yvel*yvel);
+            if (v > m_temperature)
+            {
+                xvel *= m_temperature / v;
+                yvel *= m_temperature / v;
+            }
+
+            m_nxs[i] = std::min(std::max(m_xs[i] + xvel, m_left), m_right);
+            m_nys[i] = std::min(std::max(m_ys[i] + yvel, m_top), m_bottom);
+        }
+    }, m_nThreads);
+
+    double maxMove = 0;
+    for (int i=0; i<n; ++i)
+    {
+        maxMove = std::max(maxMove, std::fabs(m_nxs[i] - m_xs[i]));
+        maxMove = std::max(maxMove, std::fabs(m_nys[i] - m_ys[i]));
+    }
+    m_xs.swap(m_nxs);
+    m_ys.swap(m_nys);
+    m_temperature *= FORCE_COOLING;
+    m_lastMove = maxMove;
+    return maxMove;
+}
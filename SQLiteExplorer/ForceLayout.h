@@ -0,0 +1,85 @@
+#ifndef FORCELAYOUT_H
+#define FORCELAYOUT_H
+
+#include <vector>
+#include <utility>
+
+using std::vector;
+using std::pair;
+
+/*
+** Spring embedder used by the "StartAnimate" button of the graph view.
+**
+** The forces are the ones of the elastic nodes example: every pair of
+** nodes repels with 75*d/|d|^2 and every edge pulls its end points
+** together with d/((degree+1)*10).  The all-pairs repulsion is
+** approximated with a Barnes-Hut quadtree, so one Step() costs
+** O(n log n) instead of O(n^2), and the per-node work is spread over
+** worker threads.
+**
+** The undamped scheme of the example never settles on large graphs, so
+** the displacement of a node per step is capped by a temperature that
+** cools geometrically; the layout has converged once it is frozen or
+** nothing moves any more.
+*/
+class CForceLayout
+{
+public:
+    CForceLayout();
+
+    // 设置节点位置、边(节点下标)以及节点可以移动的范围
+    void SetGraph(const vector<double>& xs, const vector<double>& ys,
+                  const vector<pair<int, int> >& edges,
+                  double left, double top, double right, double bottom);
+
+    // 固定一个节点的位置(例如被鼠标拖动时)，不再受力移动
+    void Pin(int i, double x, double y);
+    void Unpin(int i);
+
+    // 计算一步并移动所有节点，返回本步最大的位移
+    double Step();
+
+    // 已经收敛，继续计算也不会再移动
+    bool Converged() const;
+
+    // 重新升温，例如用户拖动了节点之后
+    void Reheat();
+
+    int Size() const { return (int)m_xs.size(); }
+    const vector<double>& Xs() const { return m_xs; }
+    const vector<double>& Ys() const { return m_ys; }
+
+    // Barnes-Hut的开角，越小越精确
+    void SetTheta(double theta) { m_theta = theta; }
+    void SetThreadCount(int n) { m_nThreads = n; }
+
+private:
+    struct QuadNode
+    {
+        double  x0, y0, size;   // 区域
+        double  sx, sy;         // 区域内节点坐标之和
+        double  cx, cy;         // 质心
+        int     mass;           // 区域内节点数
+        int     child[4];
+        int     point;          // 叶子中的节点，-1表示没有
+    };
+
+    void BuildTree();
+    void Insert(int p);
+    void Repulsion(int i, double& fx, double& fy) const;
+
+private:
+    vector<double>      m_xs, m_ys;
+    vector<double>      m_nxs, m_nys;
+    vector<int>         m_adjStart;     // 邻接表(CSR)
+    vector<int>         m_adj;
+    vector<char>        m_pinned;
+    vector<QuadNode>    m_tree;
+    double              m_left, m_top, m_right, m_bottom;
+    double              m_theta;
+    double              m_temperature;  // 本步允许的最大位移
+    double              m_lastMove;
+    int                 m_nThreads;
+};
+
+#endif // FORCELAYOUT_H
@@ -0,0 +1,121 @@
+#include "ForceThread.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+// 两次发布位置的最小间隔(毫秒)，约25帧每秒
+static const int FORCE_FRAME_MS = 40;
+// 最多计算的步数，防止不收敛时一直占用CPU
+static const int FORCE_MAX_STEPS = 20000;
+
+ForceThread::ForceThread(const QVector<QPointF> &pos, const QVector<QPair<int, int> > &edges,
+                         const QRectF &bounds, QObject *parent)
+    : QThread(parent)
+    , m_cancel(false)
+    , m_snapshotPending(false)
+{
+    vector<double> xs(pos.size()), ys(pos.size());
+    for (int i=0; i<pos.size(); ++i)
+    {
+        xs[i] = pos[i].x();
+        ys[i] = pos[i].y();
+    }
+    vector<pair<int, int> > e;
+    e.reserve(edges.size());
+    for (auto it=edges.begin(); it!=edges.end(); ++it)
+    {
+        e.push_back(pair<int, int>(it->first, it->second));
+    }
+    m_layout.SetGraph(xs, ys, e, bounds.left(), bounds.top(), bounds.right(), bounds.bottom());
+}
+
+void ForceThread::cancel()
+{
+    m_cancel = true;
+}
+
+void ForceThread::pin(int i, const QPointF &pos)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pins[i] = pos;
+    m_unpins.removeAll(i);
+}
+
+void ForceThread::unpin(int i)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pins.remove(i);
+    m_unpins.push_back(i);
+}
+
+bool ForceThread::takeSnapshot(QVector<QPointF> &pos)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_snapshotPending) return false;
+    pos.swap(m_snapshot);
+    m_snapshotPending = false;
+    return true;
+}
+
+void ForceThread::publish()
+{
+    const vector<double>& xs = m_layout.Xs();
+    const vector<double>& ys = m_layout.Ys();
+
+    QMutexLocker locker(&m_mutex);
+    m_snapshot.resize((int)xs.size());
+    for (size_t i=0; i<xs.size(); ++i)
+    {
+        m_snapshot[(int)i] = QPointF(xs[i], ys[i]);
+    }
+    if (!m_snapshotPending)
+    {
+        m_snapshotPending = true;
+        emit snapshotReady();
+    }
+}
+
+void ForceThread::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int steps = 0;
+    while (!m_cancel && steps < FORCE_MAX_STEPS)
+    {
+        {
+            // 应用鼠标拖动的结果，拖动后重新升温
+            QMutexLocker locker(&m_mutex);
+            if (!m_pins.isEmpty() || !m_unpins.isEmpty())
+            {
+                for (auto it=m_pins.begin(); it!=m_pins.end(); ++it)
+                {
+                    m_layout.Pin(it.key(), it.value().x(), it.value().y());
+                }
+                for (auto it=m_unpins.begin(); it!=m_unpins.end(); ++it)
+                {
+                    m_layout.Unpin(*it);
+                }
+                m_pins.clear();
+                m_unpins.clear();
+                m_layout.Reheat();
+            }
+        }
+
+        m_layout.Step();
+        ++steps;
+
+        if (m_layout.Converged())
+            break;
+
+        if (timer.elapsed() >= FORCE_FRAME_MS)
+        {
+            timer.restart();
+            publish();
+        }
+    }
+
+    if (m_cancel) return;
+    publish();
+    emit converged(steps);
+}
@@ -0,0 +1,61 @@
+#ifndef FORCETHREAD_H
+#define FORCETHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <QPair>
+#include <QHash>
+#include <atomic>
+
+#include "ForceLayout.h"
+
+/*
+** Run CForceLayout in the background.  The positions are published at
+** most FORCE_FRAME_MS apart: the GUI thread is told with snapshotReady()
+** and fetches the latest positions with takeSnapshot(), so a slow GUI
+** never queues up stale frames.  The thread stops by itself once the
+** layout has converged.
+*/
+class ForceThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    ForceThread(const QVector<QPointF>& pos, const QVector<QPair<int, int> >& edges,
+                const QRectF& bounds, QObject* parent = 0);
+
+    // 停止计算，不等待线程结束
+    void cancel();
+
+    // 固定/释放被鼠标拖动的节点
+    void pin(int i, const QPointF& pos);
+    void unpin(int i);
+
+    // 取最新的位置，没有新位置时返回false
+    bool takeSnapshot(QVector<QPointF>& pos);
+
+signals:
+    void snapshotReady();
+    void converged(int steps);
+
+protected:
+    void run();
+
+private:
+    void publish();
+
+private:
+    CForceLayout        m_layout;
+    std::atomic<bool>   m_cancel;
+
+    QMutex              m_mutex;
+    QVector<QPointF>    m_snapshot;
+    bool                m_snapshotPending;
+    QHash<int, QPointF> m_pins;         // 待应用的固定节点
+    QVector<int>        m_unpins;
+};
+
+#endif // FORCETHREAD_H
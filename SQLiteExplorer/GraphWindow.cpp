@@ -1,6 +1,8 @@
 #include "GraphWindow.h"
 #include "ui_graphwindow.h"
 
+#include <QPainter>
+
 GraphWindow::GraphWindow(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::GraphWindow)
@@ -29,26 +31,37 @@ GraphWindow::~GraphWindow()
 
 void GraphWindow::clear()
 {
-    m_graphicsScene->clear();
-    ui->graphWidget;
+    // m_graphicsItem属于m_graphicsScene，不能直接clear场景
+    m_graphicsItem->setPixmap(QPixmap());
+    ui->graphWidget->clear();
 }
 
-void GraphWindow::SetPath(QString path)
+void GraphWindow::SetTree(const QVector<TreeNodeData> &nodes, qreal w, qreal h)
 {
-    if(path == "tmp.plain")
-    {
-        ui->graphWidget->SetPath(path);
-    }
-    else
+    ui->graphWidget->SetTree(nodes, w, h);
+
+    // 按层次细节显示时场景里只有可见部分，不生成缩略图
+    if(ui->graphWidget->IsLod())
     {
-        QPixmap px;
-        px.load(path);
-
-        m_graphicsItem->setPixmap(px);
-        m_graphicsItem->setPos(0,0);
-        m_graphicsItem->setZoomState(1);
-        qreal w = px.width();
-        qreal h = px.height();
-        m_graphicsScene->setSceneRect(-1*(w/2), -1*(h/2), w, h);
+        m_graphicsItem->setPixmap(QPixmap());
+        return;
     }
+
+    // 把整个场景绘制成图片，长边不超过4096像素
+    QGraphicsScene* scene = ui->graphWidget->scene();
+    QRectF rc = scene->sceneRect();
+    qreal ratio = qMin(1.0, 4096 / qMax(rc.width(), rc.height()));
+    QPixmap px(qMax(1, (int)(rc.width()*ratio)), qMax(1, (int)(rc.height()*ratio)));
+    px.fill(Qt::white);
+    QPainter painter(&px);
+    painter.setRenderHint(QPainter::Antialiasing);
+    scene->render(&painter, QRectF(), rc);
+    painter.end();
+
+    m_graphicsItem->setPixmap(px);
+    m_graphicsItem->setPos(0,0);
+    m_graphicsItem->setZoomState(1);
+    qreal pw = px.width();
+    qreal ph = px.height();
+    m_graphicsScene->setSceneRect(-1*(pw/2), -1*(ph/2), pw, ph);
 }
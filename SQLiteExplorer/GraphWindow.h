@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include "pixitem.h"
+#include "graphwidget.h"
 
 namespace Ui {
 class GraphWindow;
@@ -18,7 +19,8 @@ public:
 
     void clear();
 
-    void SetPath(QString path);
+    // 显示布局好的树，节点不多时同时生成一张缩略图
+    void SetTree(const QVector<TreeNodeData>& nodes, qreal w, qreal h);
 private:
     Ui::GraphWindow *ui;
 
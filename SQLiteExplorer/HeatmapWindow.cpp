@@ -0,0 +1,536 @@
+#include "HeatmapWindow.h"
+#include "PageOwnerThread.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QComboBox>
+#include <QLabel>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <cmath>
+
+// 每个tile的边长(像素)
+static const int HEATMAP_TILE = 256;
+// tile缓存的上限(KB)
+static const int HEATMAP_CACHE_KB = 64*1024;
+// 一行最多的页数
+static const int HEATMAP_MAX_COLS = 4096;
+
+static const QRgb HEATMAP_COLOR_UNUSED   = 0xFFE8E8E8;
+static const QRgb HEATMAP_COLOR_FREE     = 0xFF9E9E9E;
+static const QRgb HEATMAP_COLOR_TRUNK    = 0xFF707070;
+
+static bool isBtreePage(PageType type)
+{
+    return type == PAGE_TYPE_INDEX_INTERIOR || type == PAGE_TYPE_TABLE_INTERIOR
+        || type == PAGE_TYPE_INDEX_LEAF || type == PAGE_TYPE_TABLE_LEAF;
+}
+
+static QString pageTypeName(PageType type)
+{
+    switch(type)
+    {
+    case PAGE_TYPE_INDEX_INTERIOR:  return "IndexInterior";
+    case PAGE_TYPE_TABLE_INTERIOR:  return "TableInterior";
+    case PAGE_TYPE_INDEX_LEAF:      return "IndexLeaf";
+    case PAGE_TYPE_TABLE_LEAF:      return "TableLeaf";
+    case PAGE_TYPE_OVERFLOW:        return "Overflow";
+    case PAGE_TYPE_FREELIST_TRUNK:  return "FreelistTrunk";
+    case PAGE_TYPE_FREELIST_LEAF:   return "FreelistLeaf";
+    case PAGE_TYPE_PTR_MAP:         return "PtrMap";
+    default:                        return "Unknown";
+    }
+}
+
+HeatmapView::HeatmapView(QWidget *parent)
+    : QWidget(parent)
+    , m_cols(0)
+    , m_rows(0)
+    , m_maxLevel(0)
+    , m_tiles(HEATMAP_CACHE_KB)
+    , m_zoom(1)
+    , m_dragging(false)
+{
+    setMouseTracking(true);
+    setMinimumSize(200, 150);
+}
+
+void HeatmapView::SetColors(const QVector<QRgb> &colors)
+{
+    bool resized = colors.size() != m_colors.size();
+    m_colors = colors;
+    m_tiles.clear();
+
+    // 每行的页数取不小于sqrt(n)的2的幂，使整张图接近正方形
+    int n = m_colors.size();
+    m_cols = 16;
+    while((qint64)m_cols*m_cols < n && m_cols < HEATMAP_MAX_COLS)
+        m_cols *= 2;
+    m_rows = (n + m_cols - 1) / m_cols;
+    m_maxLevel = 0;
+    while((qMax(m_cols, m_rows) >> m_maxLevel) > HEATMAP_TILE)
+        m_maxLevel++;
+
+    if(resized)
+        fitAll();
+    update();
+}
+
+void HeatmapView::clear()
+{
+    m_colors.clear();
+    m_tiles.clear();
+    m_cols = m_rows = m_maxLevel = 0;
+    update();
+}
+
+void HeatmapView::fitAll()
+{
+    if(m_cols <= 0 || m_rows <= 0) return;
+    m_zoom = qMin((double)width() / m_cols, (double)height() / m_rows);
+    if(m_zoom <= 0) m_zoom = 1;
+    m_offset = QPointF(0, 0);
+    update();
+}
+
+/*
+** Tile (level, tx, ty).  Level 0 holds one page per pixel; each pixel of
+** level L is the average of the 2x2 pixels below it, so the tile is built
+** from four tiles of level L-1.  Pixels past the end of the file stay
+** transparent and are left out of the average.
+*/
+QImage HeatmapView::tile(int level, int tx, int ty)
+{
+    quint64 key = ((quint64)level << 56) | ((quint64)tx << 28) | (quint64)ty;
+    if(QImage* cached = m_tiles.object(key))
+        return *cached;
+
+    QImage img(HEATMAP_TILE, HEATMAP_TILE, QImage::Format_ARGB32);
+    img.fill(0);
+
+    int n = m_colors.size();
+    if(level == 0)
+    {
+        for(int y=0; y<HEATMAP_TILE; ++y)
+        {
+            qint64 row = (qint64)ty*HEATMAP_TILE + y;
+            if(row >= m_rows) break;
+            QRgb* line = (QRgb*)img.scanLine(y);
+            for(int x=0; x<HEATMAP_TILE; ++x)
+            {
+                qint64 col = (qint64)tx*HEATMAP_TILE + x;
+                qint64 idx = row*m_cols + col;
+                if(col >= m_cols || idx >= n) break;
+                line[x] = m_colors[(int)idx];
+            }
+        }
+    }
+    else
+    {
+        qint64 span = (qint64)HEATMAP_TILE << (level-1);
+        int half = HEATMAP_TILE/2;
+        for(int q=0; q<4; ++q)
+        {
+            int cx = tx*2 + (q & 1);
+            int cy = ty*2 + (q >> 1);
+            if(cx*span >= m_cols || cy*span >= m_rows) continue;
+
+            QImage child = tile(level-1, cx, cy);
+            for(int y=0; y<half; ++y)
+            {
+                const QRgb* l0 = (const QRgb*)child.constScanLine(2*y);
+                const QRgb* l1 = (const QRgb*)child.constScanLine(2*y+1);
+                QRgb* out = (QRgb*)img.scanLine((q >> 1)*half + y) + (q & 1)*half;
+                for(int x=0; x<half; ++x)
+                {
+                    QRgb px[4] = { l0[2*x], l0[2*x+1], l1[2*x], l1[2*x+1] };
+                    int r = 0, g = 0, b = 0, cnt = 0;
+                    for(int k=0; k<4; ++k)
+                    {
+                        if(qAlpha(px[k]) == 0) continue;
+                        r += qRed(px[k]);
+                        g += qGreen(px[k]);
+                        b += qBlue(px[k]);
+                        cnt++;
+                    }
+                    if(cnt > 0)
+                        out[x] = qRgb(r/cnt, g/cnt, b/cnt);
+                }
+            }
+        }
+    }
+
+    m_tiles.insert(key, new QImage(img), HEATMAP_TILE*HEATMAP_TILE*4/1024);
+    return img;
+}
+
+int HeatmapView::pageAt(const QPoint &pos) const
+{
+    if(m_cols <= 0) return 0;
+    double x = m_offset.x() + pos.x() / m_zoom;
+    double y = m_offset.y() + pos.y() / m_zoom;
+    if(x < 0 || y < 0 || x >= m_cols || y >= m_rows) return 0;
+    qint64 idx = (qint64)y * m_cols + (qint64)x;
+    return idx < m_colors.size() ? (int)idx + 1 : 0;
+}
+
+void HeatmapView::clampOffset()
+{
+    // 至少留半个视口在图内
+    double w = width() / m_zoom;
+    double h = height() / m_zoom;
+    m_offset.setX(qBound(-w/2, m_offset.x(), qMax(-w/2, m_cols - w/2)));
+    m_offset.setY(qBound(-h/2, m_offset.y(), qMax(-h/2, m_rows - h/2)));
+}
+
+void HeatmapView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    if(m_colors.isEmpty()) return;
+
+    // 选择每个tile像素在屏幕上不超过一个像素的最粗层
+    int level = 0;
+    while(level < m_maxLevel && m_zoom * (1 << (level+1)) <= 1.0)
+        level++;
+    qint64 span = (qint64)HEATMAP_TILE << level;
+
+    double x0 = qMax(0.0, m_offset.x());
+    double y0 = qMax(0.0, m_offset.y());
+    double x1 = qMin((double)m_cols, m_offset.x() + width() / m_zoom);
+    double y1 = qMin((double)m_rows, m_offset.y() + height() / m_zoom);
+    if(x1 <= x0 || y1 <= y0) return;
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, level > 0);
+    for(qint64 ty=(qint64)(y0/span); ty*span<y1; ++ty)
+    {
+        for(qint64 tx=(qint64)(x0/span); tx*span<x1; ++tx)
+        {
+            QRectF target((tx*span - m_offset.x()) * m_zoom,
+                          (ty*span - m_offset.y()) * m_zoom,
+                          span * m_zoom, span * m_zoom);
+            painter.drawImage(target, tile(level, (int)tx, (int)ty));
+        }
+    }
+
+    painter.setPen(QPen(Qt::darkGray, 0));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawRect(QRectF(-m_offset.x() * m_zoom, -m_offset.y() * m_zoom,
+                            m_cols * m_zoom, m_rows * m_zoom));
+}
+
+void HeatmapView::wheelEvent(QWheelEvent *event)
+{
+    if(m_cols <= 0) return;
+
+    // 以鼠标所在的页为中心缩放
+    QPointF anchor = m_offset + QPointF(event->pos()) / m_zoom;
+    double fit = qMin((double)width() / m_cols, (double)height() / m_rows);
+    double zoom = m_zoom * pow(2.0, event->delta() / 240.0);
+    m_zoom = qBound(qMin(fit, 1.0) / 2, zoom, 64.0);
+    m_offset = anchor - QPointF(event->pos()) / m_zoom;
+    clampOffset();
+    update();
+}
+
+void HeatmapView::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::LeftButton)
+    {
+        m_pressPos = m_lastPos = event->pos();
+        m_dragging = true;
+    }
+}
+
+void HeatmapView::mouseMoveEvent(QMouseEvent *event)
+{
+    if(m_dragging)
+    {
+        m_offset -= QPointF(event->pos() - m_lastPos) / m_zoom;
+        m_lastPos = event->pos();
+        clampOffset();
+        update();
+    }
+    emit pageHovered(pageAt(event->pos()));
+}
+
+void HeatmapView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(event->button() != Qt::LeftButton) return;
+    m_dragging = false;
+
+    // 没有拖动时算作点击
+    if((event->pos() - m_pressPos).manhattanLength() < 3)
+    {
+        int pgno = pageAt(event->pos());
+        if(pgno > 0)
+            emit pageClicked(pgno);
+    }
+}
+
+void HeatmapView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    if(m_cols > 0) clampOffset();
+}
+
+HeatmapWindow::HeatmapWindow(QWidget *parent)
+    : QWidget(parent)
+    , m_pCurSQLite3DB(NULL)
+    , m_dirty(false)
+    , m_pOwnerThread(NULL)
+    , m_ownerCounter(0)
+    , m_generation(0)
+{
+    m_pMode = new QComboBox(this);
+    m_pMode->addItem(tr("Owner"));
+    m_pMode->addItem(tr("Page type"));
+    m_pMode->addItem(tr("Fill factor"));
+    m_pMode->addItem(tr("Last changed"));
+
+    m_pInfo = new QLabel(this);
+    m_pView = new HeatmapView(this);
+
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("Color by:"), this));
+    bar->addWidget(m_pMode);
+    bar->addSpacing(16);
+    bar->addWidget(m_pInfo, 1);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setSpacing(2);
+    layout->setMargin(2);
+    layout->addLayout(bar);
+    layout->addWidget(m_pView, 1);
+    setLayout(layout);
+
+    connect(m_pMode, SIGNAL(currentIndexChanged(int)), this, SLOT(onModeChanged(int)));
+    connect(m_pView, SIGNAL(pageClicked(int)), this, SLOT(onPageClicked(int)));
+    connect(m_pView, SIGNAL(pageHovered(int)), this, SLOT(onPageHovered(int)));
+}
+
+HeatmapWindow::~HeatmapWindow()
+{
+    stopOwners();
+}
+
+void HeatmapWindow::SetDatabase(CSQLite3DB *pSqlite)
+{
+    if(pSqlite == m_pCurSQLite3DB) return;
+
+    stopOwners();
+    m_pCurSQLite3DB = pSqlite;
+    m_changedGen.clear();
+    m_generation = 0;
+    m_dirty = true;
+    if(m_pCurSQLite3DB == NULL)
+        clear();
+    else if(isVisible())
+        refresh();
+}
+
+void HeatmapWindow::PagesChanged(const QVector<int> &pages)
+{
+    if(m_pCurSQLite3DB == NULL) return;
+
+    ++m_generation;
+    foreach (int pgno, pages)
+    {
+        if(pgno <= 0) continue;
+        if(pgno >= m_changedGen.size())
+            m_changedGen.resize(pgno+1);
+        m_changedGen[pgno] = m_generation;
+    }
+
+    if(isVisible())
+        recolor();
+    else
+        m_dirty = true;
+}
+
+void HeatmapWindow::clear()
+{
+    stopOwners();
+    m_pCurSQLite3DB = NULL;
+    m_changedGen.clear();
+    m_generation = 0;
+    m_dirty = false;
+    m_pView->clear();
+    m_pInfo->clear();
+}
+
+void HeatmapWindow::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if(m_dirty)
+        refresh();
+}
+
+void HeatmapWindow::refresh()
+{
+    m_dirty = false;
+    if(m_pCurSQLite3DB == NULL)
+    {
+        m_pView->clear();
+        return;
+    }
+
+    recolor();
+}
+
+void HeatmapWindow::startOwners()
+{
+    if(m_pOwnerThread || m_pCurSQLite3DB == NULL) return;
+
+    m_pInfo->setText(tr("Classifying pages..."));
+    m_ownerCounter = m_pCurSQLite3DB->GetChangeCounter();
+    m_pOwnerThread = new PageOwnerThread(QString::fromStdString(m_pCurSQLite3DB->GetPath()));
+    connect(m_pOwnerThread, SIGNAL(finished()), this, SLOT(onOwnersReady()));
+    m_pOwnerThread->start(QThread::LowPriority);
+}
+
+void HeatmapWindow::stopOwners()
+{
+    if(m_pOwnerThread == NULL) return;
+    m_pOwnerThread->disconnect(this);
+    m_pOwnerThread->cancel();
+    m_pOwnerThread->wait();
+    delete m_pOwnerThread;
+    m_pOwnerThread = NULL;
+}
+
+void HeatmapWindow::onOwnersReady()
+{
+    // 已经被stopOwners删除的线程不再处理
+    if(sender() != m_pOwnerThread) return;
+    PageOwnerThread* thread = m_pOwnerThread;
+    m_pOwnerThread = NULL;
+    thread->deleteLater();
+    if(m_pCurSQLite3DB == NULL || thread->cancelled()) return;
+    m_pInfo->clear();
+
+    // 遍历期间文件被修改过时结果可能已过时，重新遍历
+    if(m_pCurSQLite3DB->GetChangeCounter() != m_ownerCounter)
+    {
+        startOwners();
+        return;
+    }
+    m_pCurSQLite3DB->SetPageOwners(thread->owners);
+    if(isVisible())
+        recolor();
+    else
+        m_dirty = true;
+}
+
+void HeatmapWindow::recolor()
+{
+    if(m_pCurSQLite3DB == NULL) return;
+
+    // 没有页归属表(第一次显示或被ReleaseMemory释放)时在后台建立，完成后再着色
+    const PageOwnerMap& owners = m_pCurSQLite3DB->CachedPageOwners();
+    if(owners.owner.empty())
+    {
+        startOwners();
+        return;
+    }
+    int n = (int)owners.owner.size() - 1;
+    if(n <= 0)
+    {
+        m_pView->clear();
+        return;
+    }
+
+    int mode = m_pMode->currentIndex();
+    QVector<QRgb> colors(n);
+    for(int pgno=1; pgno<=n; ++pgno)
+    {
+        int owner = owners.owner[pgno];
+        PageType type = owners.type[pgno];
+        QRgb color = HEATMAP_COLOR_UNUSED;
+        if(type == PAGE_TYPE_FREELIST_LEAF)
+            color = HEATMAP_COLOR_FREE;
+        else if(type == PAGE_TYPE_FREELIST_TRUNK)
+            color = HEATMAP_COLOR_TRUNK;
+
+        switch(mode)
+        {
+        case COLOR_BY_OWNER:
+            // 相邻的下标颜色相差较大
+            if(owner >= 0)
+                color = QColor::fromHsv((owner*137) % 360, 120 + (owner*53) % 120, 230).rgb();
+            break;
+        case COLOR_BY_TYPE:
+            switch(type)
+            {
+            case PAGE_TYPE_TABLE_INTERIOR:  color = 0xFFE1C4C4; break;
+            case PAGE_TYPE_TABLE_LEAF:      color = 0xFF62C544; break;
+            case PAGE_TYPE_INDEX_INTERIOR:  color = 0xFFC4C4E1; break;
+            case PAGE_TYPE_INDEX_LEAF:      color = 0xFF44A2C5; break;
+            case PAGE_TYPE_OVERFLOW:        color = 0xFFFEE3BA; break;
+            default: break;
+            }
+            break;
+        case COLOR_BY_FILL:
+            // 红色为空页，绿色为满页
+            if(isBtreePage(type) || type == PAGE_TYPE_OVERFLOW)
+                color = QColor::fromHsv(owners.fill[pgno] * 120 / 255, 200, 220).rgb();
+            break;
+        case COLOR_BY_CHANGED:
+        {
+            int gen = pgno < m_changedGen.size() ? m_changedGen[pgno] : 0;
+            if(gen > 0)
+            {
+                // 最近一次修改为红色，越早越接近黄色
+                int age = m_generation - gen;
+                color = QColor::fromHsv(qMin(age*12, 60), qMax(255 - age*25, 60), 240).rgb();
+            }
+            else if(color == HEATMAP_COLOR_UNUSED && owner >= 0)
+            {
+                color = 0xFFFFFFFF;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        colors[pgno-1] = color;
+    }
+    m_pView->SetColors(colors);
+}
+
+void HeatmapWindow::onModeChanged(int mode)
+{
+    Q_UNUSED(mode);
+    recolor();
+}
+
+void HeatmapWindow::onPageClicked(int pgno)
+{
+    if(m_pCurSQLite3DB == NULL) return;
+    const PageOwnerMap& owners = m_pCurSQLite3DB->CachedPageOwners();
+    if(pgno <= 0 || pgno >= (int)owners.type.size()) return;
+    emit pageActivated(pgno, owners.type[pgno]);
+}
+
+void HeatmapWindow::onPageHovered(int pgno)
+{
+    if(m_pCurSQLite3DB == NULL || pgno <= 0)
+    {
+        m_pInfo->clear();
+        return;
+    }
+    const PageOwnerMap& owners = m_pCurSQLite3DB->CachedPageOwners();
+    if(pgno >= (int)owners.type.size()) return;
+
+    PageType type = owners.type[pgno];
+    QString text = QString("Page %1  %2  %3")
+            .arg(pgno)
+            .arg(QString::fromStdString(owners.OwnerName(pgno)))
+            .arg(pageTypeName(type));
+    if(isBtreePage(type))
+        text += QString("  fill %1%").arg(owners.fill[pgno] * 100 / 255);
+    m_pInfo->setText(text);
+}
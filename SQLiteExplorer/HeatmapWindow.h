@@ -0,0 +1,143 @@
+#ifndef HEATMAPWINDOW_H
+#define HEATMAPWINDOW_H
+
+#include <QWidget>
+#include <QVector>
+#include <QCache>
+#include <QImage>
+#include <QRgb>
+
+#include "SQLite3DB.h"
+
+class QComboBox;
+class QLabel;
+class PageOwnerThread;
+
+/*
+** Draws one pixel per page, row by row in file order.  The colours are
+** kept in a flat array and the picture is cut into 256x256 tiles; tile
+** (level, x, y) covers 2^level x 2^level pages per pixel and is built
+** on demand from the four tiles of the level below, so only the tiles
+** that are on screen exist and zooming out of a 10M-page file touches
+** a handful of images.  Tiles live in a QCache bounded in memory.
+*/
+class HeatmapView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HeatmapView(QWidget *parent = 0);
+
+    // colors[i]为第i+1页的颜色
+    void SetColors(const QVector<QRgb>& colors);
+    void clear();
+
+    // 缩放到整个文件都可见
+    void fitAll();
+
+    // tile缓存占用的内存
+    qint64 cacheBytes() const { return (qint64)m_tiles.totalCost() << 10; }
+
+signals:
+    void pageClicked(int pgno);
+    void pageHovered(int pgno);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseReleaseEvent(QMouseEvent *event);
+    void resizeEvent(QResizeEvent *event);
+
+private:
+    QImage tile(int level, int tx, int ty);
+    int pageAt(const QPoint& pos) const;
+    void clampOffset();
+
+private:
+    QVector<QRgb>           m_colors;
+    int                     m_cols;         // 每行的页数
+    int                     m_rows;
+    int                     m_maxLevel;
+    QCache<quint64, QImage> m_tiles;
+
+    double  m_zoom;         // 每页在屏幕上的像素数
+    QPointF m_offset;       // 视口左上角对应的页坐标
+    QPoint  m_pressPos;
+    QPoint  m_lastPos;
+    bool    m_dragging;
+};
+
+/*
+** Physical layout of the whole file: every page coloured by the b-tree
+** that owns it, its page type, its fill factor or how recently it was
+** changed on disk.  The page classification is the single walk done by
+** CSQLite3DB::GetPageOwners.  It runs in a PageOwnerThread on a
+** connection of its own, only while the tab is shown, and the result is
+** handed to the database, which keeps it up to date on Reload; painting,
+** hovering and clicking only read that cached map.
+*/
+class HeatmapWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HeatmapWindow(QWidget *parent = 0);
+    ~HeatmapWindow();
+
+    enum ColorMode
+    {
+        COLOR_BY_OWNER = 0,
+        COLOR_BY_TYPE,
+        COLOR_BY_FILL,
+        COLOR_BY_CHANGED,
+    };
+
+    // 设置要显示的数据库，在窗口可见时才分类所有页
+    void SetDatabase(CSQLite3DB* pSqlite);
+    CSQLite3DB* GetDatabase() { return m_pCurSQLite3DB; }
+
+    // 数据库文件中有页被修改，owners已由CSQLite3DB::Reload更新
+    void PagesChanged(const QVector<int>& pages);
+
+    qint64 CacheBytes() const { return m_pView->cacheBytes(); }
+
+    void clear();
+
+signals:
+    void pageActivated(int pgno, int type);
+
+protected:
+    void showEvent(QShowEvent *event);
+
+private slots:
+    void onModeChanged(int mode);
+    void onPageClicked(int pgno);
+    void onPageHovered(int pgno);
+    void onOwnersReady();
+
+private:
+    void refresh();
+    void recolor();
+    // 在后台建立当前数据库的页归属表
+    void startOwners();
+    void stopOwners();
+
+private:
+    HeatmapView*    m_pView;
+    QComboBox*      m_pMode;
+    QLabel*         m_pInfo;
+
+    CSQLite3DB*     m_pCurSQLite3DB;
+    bool            m_dirty;
+
+    PageOwnerThread* m_pOwnerThread;
+    int              m_ownerCounter;    // 开始遍历时数据库的GetChangeCounter()
+
+    // 每页最近一次被修改时的代数，0表示打开后没有修改过
+    QVector<int>    m_changedGen;
+    int             m_generation;
+};
+
+#endif // HEATMAPWINDOW_H
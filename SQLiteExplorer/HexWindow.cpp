@@ -2,6 +2,10 @@
 #include "ui_hexwindow.h"
 
 #include "mainwindow.h"
+#include "SearchThread.h"
+#include "DiffThread.h"
+#include "SQLite3File.h"
+#include <QFileDialog>
 #include <QDebug>
 #include <QTimer>
 
@@ -38,8 +42,26 @@ HexWindow::HexWindow(QWidget *parent) :
         "alternate-background-color: rgb(141, 163, 215);}");
 
 
+    // 全文件搜索结果
+    m_pSearchResult = new QListWidget(this);
+    m_pSearchResult->setVisible(false);
+    connect(m_pSearchResult, SIGNAL(itemActivated(QListWidgetItem*)), this, SLOT(onSearchResultActivated(QListWidgetItem*)));
+
     m_pHSplitter->addWidget(m_pHexEdit);
     m_pHSplitter->addWidget(m_pPageView);
+    m_pHSplitter->addWidget(m_pSearchResult);
+
+    // 比较结果，以及另一个文件中同一页的内容
+    m_pDiffHexEdit = new QHexEdit(this);
+    m_pDiffHexEdit->setReadOnly(true);
+    m_pDiffHexEdit->setVisible(false);
+    m_pDiffResult = new QTreeWidget(this);
+    m_pDiffResult->setHeaderLabels(QStringList() << "Object" << "Change" << "Rowid/Key" << "Old Page" << "New Page");
+    m_pDiffResult->setVisible(false);
+    connect(m_pDiffResult, SIGNAL(itemActivated(QTreeWidgetItem*,int)), this, SLOT(onDiffResultActivated(QTreeWidgetItem*,int)));
+
+    m_pHSplitter->insertWidget(1, m_pDiffHexEdit);
+    m_pHSplitter->addWidget(m_pDiffResult);
 
 
     m_pTableWdiget = new QTableWidget(this);
@@ -76,6 +98,28 @@ HexWindow::HexWindow(QWidget *parent) :
 
     connect(ui->checkBox, SIGNAL(clicked(bool)), this, SLOT(onCheckBoxStatChanged(bool)));
 
+    // Init search controls
+    m_pSearchThread = NULL;
+    m_pSearchMode = new QComboBox(this);
+    m_pSearchMode->addItem("Hex", SEARCH_MODE_HEX);
+    m_pSearchMode->addItem("Text", SEARCH_MODE_TEXT);
+    m_pSearchMode->addItem("Integer", SEARCH_MODE_INTEGER);
+    m_pSearchMode->addItem("Real", SEARCH_MODE_REAL);
+    m_pSearchEdit = new QLineEdit(this);
+    m_pSearchEdit->setPlaceholderText("Search whole file");
+    m_pSearchEdit->setMinimumWidth(160);
+    m_pSearchBtn = new QPushButton("Find", this);
+    ui->widget->layout()->addWidget(m_pSearchMode);
+    ui->widget->layout()->addWidget(m_pSearchEdit);
+    ui->widget->layout()->addWidget(m_pSearchBtn);
+    connect(m_pSearchEdit, SIGNAL(returnPressed()), this, SLOT(onSearchBtnClicked()));
+    connect(m_pSearchBtn, SIGNAL(clicked(bool)), this, SLOT(onSearchBtnClicked()));
+
+    m_pDiffThread = NULL;
+    m_pDiffBtn = new QPushButton("Compare...", this);
+    ui->widget->layout()->addWidget(m_pDiffBtn);
+    connect(m_pDiffBtn, SIGNAL(clicked(bool)), this, SLOT(onDiffBtnClicked()));
+
     m_pageTypeName[PAGE_TYPE_UNKNOWN] = "Unknown";
     m_pageTypeName[PAGE_TYPE_INDEX_INTERIOR] = "IndexInterior";
     m_pageTypeName[PAGE_TYPE_TABLE_INTERIOR] = "TableInterior";
@@ -89,11 +133,23 @@ HexWindow::HexWindow(QWidget *parent) :
 
 HexWindow::~HexWindow()
 {
+    stopSearch();
+    stopDiff();
     delete ui;
 }
 
 void HexWindow::clear()
 {
+    stopSearch();
+    m_pSearchResult->clear();
+    m_searchHitItems.clear();
+    m_pSearchResult->setVisible(false);
+
+    stopDiff();
+    m_pDiffResult->clear();
+    m_pDiffResult->setVisible(false);
+    m_pDiffHexEdit->setVisible(false);
+
     ui->comboBox->clear();
     ui->comboBoxPageType->clear();
     m_pageNoAndTypes.clear();
@@ -362,91 +418,114 @@ void HexWindow::setFreeListPageHdrData(ContentArea &sNextTrunkPageNo, int &nNext
 }
 
 
-QStandardItem* HexWindow::setCellData(QStandardItem* parentItem, CSQLite3Payload &payload, ContentArea area, string raw)
+static QString upperHex(const char* raw, i64 start, i64 len)
+{
+    return QString(QByteArray(raw + start, len).toHex().data()).toUpper();
+}
+
+static QString variantText(const SQLite3Variant& var)
+{
+    QString val;
+    switch (var.type) {
+    case SQLITE_TYPE_INTEGER:
+        val = QString("%1").arg(var.iVal);
+        break;
+    case SQLITE_TYPE_FLOAT:
+        val = QString("%1").arg(var.lfVal);
+        break;
+    case SQLITE_TYPE_TEXT:
+        val = QString::fromStdString(var.text);
+        break;
+    case SQLITE_TYPE_NULL:
+        val = "(null)";
+        break;
+    case SQLITE_TYPE_BLOB:
+        val = QString::fromStdString(var.text);
+        break;
+    default:
+        break;
+    }
+    return val;
+}
+
+QStandardItem* HexWindow::setCellData(QStandardItem* parentItem, const SQLite3PageCells &cells, const SQLite3Cell &payload, const string& raw)
 {
     int base = 10;
-    QStandardItem* cells = parentItem;
-    if(cells == NULL)
+    const ContentArea& area = payload.area;
+    const char* content = cells.CellContent(payload);
+    QStandardItem* cellsItem = parentItem;
+    if(cellsItem == NULL)
     {
-        cells = new QStandardItem("Cells");
-        m_pPageViewModel->appendRow(cells);
+        cellsItem = new QStandardItem("Cells");
+        m_pPageViewModel->appendRow(cellsItem);
     }
 
-    qDebug() << "1";
     int col = 0;
-    int row = cells->rowCount();
+    int row = cellsItem->rowCount();
     QStandardItem* cell = new QStandardItem(QString("Cell[%1]").arg(row));
-    cells->setChild(row, col++, cell);
+    cellsItem->setChild(row, col++, cell);
     QString cellDesc = QString::fromStdString(raw.substr(area.m_startAddr, area.m_len));
     cellDesc = cellDesc.remove("\r").remove("\n");
-    cells->setChild(row, col++, new QStandardItem(cellDesc));
-    cells->setChild(row, col++, new QStandardItem(QString::number(area.m_startAddr, base)));
-    cells->setChild(row, col++, new QStandardItem(QString::number(area.m_len, base)));
-    cells->setChild(row, col++, new QStandardItem(upperHex(raw, area.m_startAddr, area.m_len)));
+    cellsItem->setChild(row, col++, new QStandardItem(cellDesc));
+    cellsItem->setChild(row, col++, new QStandardItem(QString::number(area.m_startAddr, base)));
+    cellsItem->setChild(row, col++, new QStandardItem(QString::number(area.m_len, base)));
+    cellsItem->setChild(row, col++, new QStandardItem(upperHex(raw, area.m_startAddr, area.m_len)));
 
-    qDebug() << "2";
     int offset = area.m_startAddr;
     row = col = 0;
     // leftChild
-    if(payload.m_leftChildLen > 0)
+    if(payload.leftChildLen > 0)
     {
-        cell->setChild(row, col++, GetItem(payload.m_leftChildStartAddr + offset, payload.m_leftChildLen, "LeftChild"));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_leftChild, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_leftChildStartAddr + offset, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_leftChildLen, base)));
-        cell->setChild(row, col++, new QStandardItem(upperHex(payload.m_cellContent, payload.m_leftChildStartAddr, payload.m_leftChildLen)));
+        cell->setChild(row, col++, GetItem(payload.leftChildStartAddr + offset, payload.leftChildLen, "LeftChild"));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.leftChild, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.leftChildStartAddr + offset, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.leftChildLen, base)));
+        cell->setChild(row, col++, new QStandardItem(upperHex(content, payload.leftChildStartAddr, payload.leftChildLen)));
         row++;
         col = 0;
     }
 
-    qDebug() << "3";
     // payloadSize
-    if(payload.m_nPayloadLen > 0)
+    if(payload.nPayloadLen > 0)
     {
-        cell->setChild(row, col++, GetItem(payload.m_nPayloadStartAddr + offset, payload.m_nPayloadLen, "PayloadSize"));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_nPayload, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_nPayloadStartAddr + offset, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_nPayloadLen, base)));
-        cell->setChild(row, col++, new QStandardItem(upperHex(payload.m_cellContent, payload.m_nPayloadStartAddr, payload.m_nPayloadLen)));
+        cell->setChild(row, col++, GetItem(payload.nPayloadStartAddr + offset, payload.nPayloadLen, "PayloadSize"));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.nPayload, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.nPayloadStartAddr + offset, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.nPayloadLen, base)));
+        cell->setChild(row, col++, new QStandardItem(upperHex(content, payload.nPayloadStartAddr, payload.nPayloadLen)));
         row++;
         col = 0;
     }
 
-    qDebug() << "4";
     // rowid
-    if(payload.m_rowidLen > 0)
+    if(payload.rowidLen > 0)
     {
-        cell->setChild(row, col++, GetItem(payload.m_rowidStartAddr + offset, payload.m_rowidLen, "RowID"));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_rowid, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_rowidStartAddr + offset, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_rowidLen, base)));
-        cell->setChild(row, col++, new QStandardItem(upperHex(payload.m_cellContent, payload.m_rowidStartAddr, payload.m_rowidLen)));
+        cell->setChild(row, col++, GetItem(payload.rowidStartAddr + offset, payload.rowidLen, "RowID"));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.rowid, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.rowidStartAddr + offset, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.rowidLen, base)));
+        cell->setChild(row, col++, new QStandardItem(upperHex(content, payload.rowidStartAddr, payload.rowidLen)));
         row++;
         col = 0;
     }
 
-    qDebug() << "5";
     // cellHeaderSize
-    if(payload.m_cellHeaderSizeLen > 0)
-    {
-        qDebug() << "HeaderSize:" << payload.m_cellHeaderSize
-                 << "startAddr:" << payload.m_cellHeaderSizeStartAddr << "offset:" << offset
-                 << "len:" << payload.m_cellHeaderSizeLen;
-        cell->setChild(row, col++, GetItem(payload.m_cellHeaderSizeStartAddr + offset, payload.m_cellHeaderSizeLen, "CellHeaderSize"));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_cellHeaderSize, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_cellHeaderSizeStartAddr + offset, base)));
-        cell->setChild(row, col++, new QStandardItem(QString::number(payload.m_cellHeaderSizeLen, base)));
-        cell->setChild(row, col++, new QStandardItem(upperHex(payload.m_cellContent, payload.m_cellHeaderSizeStartAddr, payload.m_cellHeaderSizeLen)));
+    if(payload.cellHeaderSizeLen > 0)
+    {
+        cell->setChild(row, col++, GetItem(payload.cellHeaderSizeStartAddr + offset, payload.cellHeaderSizeLen, "CellHeaderSize"));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.cellHeaderSize, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.cellHeaderSizeStartAddr + offset, base)));
+        cell->setChild(row, col++, new QStandardItem(QString::number(payload.cellHeaderSizeLen, base)));
+        cell->setChild(row, col++, new QStandardItem(upperHex(content, payload.cellHeaderSizeStartAddr, payload.cellHeaderSizeLen)));
         row++;
         col = 0;
     }
 
-    qDebug() << "6";
     // typeAndLen
-    for(int i=0; i<payload.m_datas.size(); i++)
+    for(int i=0; i<payload.nVar; i++)
     {
-        SQLite3Variant& var = payload.m_datas[i];
-        cell->setChild(row, col++, GetItem(var.tStartAddr + offset, var.tLen>payload.m_nLocal?payload.m_nLocal:var.tLen, QString("TypaAndLen[%1]").arg(i)));
+        const SQLite3Variant& var = cells.vars[payload.firstVar + i];
+        cell->setChild(row, col++, GetItem(var.tStartAddr + offset, var.tLen>payload.nLocal?payload.nLocal:var.tLen, QString("TypaAndLen[%1]").arg(i)));
         QString strDesc;
         switch(var.tVal)
         {
@@ -494,48 +573,26 @@ QStandardItem* HexWindow::setCellData(QStandardItem* parentItem, CSQLite3Payload
         cell->setChild(row, col++, new QStandardItem(strDesc));
         cell->setChild(row, col++, new QStandardItem(QString::number(var.tStartAddr + offset, base)));
         cell->setChild(row, col++, new QStandardItem(QString::number(var.tLen, base)));
-        cell->setChild(row, col++, new QStandardItem(upperHex(payload.m_cellContent, var.tStartAddr, var.tLen)));
+        cell->setChild(row, col++, new QStandardItem(upperHex(content, var.tStartAddr, var.tLen)));
 
         row++;
         col = 0;
     }
 
-    qDebug() << "7";
     // VariableContent
-    for(int i=0; i<payload.m_datas.size(); i++)
-    {
-        SQLite3Variant var = payload.m_datas[i];
-        cell->setChild(row, col++, GetItem(var.valStartAddr + offset, var.valLen>payload.m_nLocal?payload.m_nLocal:var.valLen, QString("Variable[%1]").arg(i)));
-        QString val;
-        switch (var.type) {
-        case SQLITE_TYPE_INTEGER:
-            val = QString("%1").arg(var.iVal);
-            break;
-        case SQLITE_TYPE_FLOAT:
-            val = QString("%1").arg(var.lfVal);
-            break;
-        case SQLITE_TYPE_TEXT:
-            val = QString::fromStdString(var.text);
-            break;
-        case SQLITE_TYPE_NULL:
-            val = "(null)";
-            break;
-        case SQLITE_TYPE_BLOB:
-            val = QString::fromStdString(var.text);
-            break;
-        default:
-            break;
-        }
-
-        cell->setChild(row, col++, new QStandardItem(val));
+    for(int i=0; i<payload.nVar; i++)
+    {
+        const SQLite3Variant& var = cells.vars[payload.firstVar + i];
+        cell->setChild(row, col++, GetItem(var.valStartAddr + offset, var.valLen>payload.nLocal?payload.nLocal:var.valLen, QString("Variable[%1]").arg(i)));
+        cell->setChild(row, col++, new QStandardItem(variantText(var)));
         cell->setChild(row, col++, new QStandardItem(QString::number(var.valLen==0?0:var.valStartAddr+offset, base)));
         cell->setChild(row, col++, new QStandardItem(QString::number(var.valLen, base)));
-        cell->setChild(row, col++, new QStandardItem(upperHex(payload.m_cellContent, var.valStartAddr, var.valLen)));
+        cell->setChild(row, col++, new QStandardItem(upperHex(content, var.valStartAddr, var.valLen)));
 
         row++;
         col = 0;
     }
-    return cells;
+    return cellsItem;
 }
 
 QStandardItem *HexWindow::GetItem(int start, i64 len, QString txt)
@@ -591,15 +648,25 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
     if(ui->checkBox->checkState() == Qt::Checked) document->setBaseAddress((pgno-1)*m_pCurSQLite3DB->GetPageSize());
     else document->setBaseAddress(0);
 
-    // Bulk metadata management (paints only one time)
+    // 一次性解码整页cell，树、表格和高亮都使用这一份结果
     m_payloadArea.clear();
+    m_pageCells.Clear();
+    if(decode)
+    {
+        m_pCurSQLite3DB->DecodePageCells(pgno, m_pageCells);
+        for(auto it=m_pageCells.cells.begin(); it!=m_pageCells.cells.end(); ++it)
+        {
+            m_payloadArea.push_back(it->area);
+        }
+    }
+
+    // Bulk metadata management (paints only one time)
     document->beginMetadata();
     if(decode)
     {
         ContentArea& pageHeaderArea = m_pCurSQLite3DB->m_pSqlite3Page->m_pageHeaderArea;
         ContentArea& cellidxArea = m_pCurSQLite3DB->m_pSqlite3Page->m_cellIndexArea;
-        vector<ContentArea> payloadArea = m_pCurSQLite3DB->m_pSqlite3Page->m_payloadArea;  // payload区域
-        m_payloadArea = payloadArea;
+        vector<ContentArea> payloadArea = m_payloadArea;                                    // payload区域
         ContentArea& unusedArea = m_pCurSQLite3DB->m_pSqlite3Page->m_unusedArea;            // 未使用区域
 
         document->highlightBackRange(pageHeaderArea.m_startAddr, pageHeaderArea.m_len, QColor(0x6A, 0x88, 0x82));
@@ -632,9 +699,12 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
     vector<string> pkType;
     vector<int> pkIdx;
     bool withoutRowid = false;
+    int ipk = -1;
     if(decode)
     {
         m_pCurSQLite3DB->GetTablePrimaryKey(m_curTableName.toStdString(), pkFiledName, pkType, pkIdx, withoutRowid);
+        const SchemaObject* tbl = m_pCurSQLite3DB->GetSchema().Find(m_curTableName.toStdString());
+        if(tbl) ipk = tbl->ipk;
     }
 
     QStandardItem* cellContentParentItem = NULL;
@@ -650,15 +720,13 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
         m_pTableWdiget->setHorizontalHeaderLabels(tableHeaders);
         m_pTableWdiget->setRowCount(m_payloadArea.size());
 
-        for(auto it=m_payloadArea.begin(); it!=m_payloadArea.end(); ++it)
+        for(auto it=m_pageCells.cells.begin(); it!=m_pageCells.cells.end(); ++it)
         {
-            int idx = it - m_payloadArea.begin();
-            vector<SQLite3Variant> vars;
-            m_pCurSQLite3DB->DecodeCell(pgno, idx, vars);
-            cellContentParentItem = setCellData(cellContentParentItem, *m_pCurSQLite3DB->m_pSqlite3Payload, *it, raw);
+            int idx = it - m_pageCells.cells.begin();
+            cellContentParentItem = setCellData(cellContentParentItem, m_pageCells, *it, raw);
 
-            int leftChild = m_pCurSQLite3DB->m_pSqlite3Payload->GetLeftChild();
-            i64 rowid = m_pCurSQLite3DB->m_pSqlite3Payload->GetRowid();
+            int leftChild = it->leftChild;
+            i64 rowid = it->rowid;
 
             QTableWidgetItem *name=new QTableWidgetItem();
             name->setText(QString("%1").arg(leftChild));
@@ -675,42 +743,20 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
         m_pTableWdiget->setHorizontalHeaderLabels(m_tableHeaders);
         m_pTableWdiget->setRowCount(m_payloadArea.size());
 
-        for(auto it=m_payloadArea.begin(); it!=m_payloadArea.end(); ++it)
+        for(auto it=m_pageCells.cells.begin(); it!=m_pageCells.cells.end(); ++it)
         {
-            int idx = it - m_payloadArea.begin();
-            vector<SQLite3Variant> vars;
-            m_pCurSQLite3DB->DecodeCell(pgno, idx, vars);
-            cellContentParentItem = setCellData(cellContentParentItem, *m_pCurSQLite3DB->m_pSqlite3Payload, *it, raw);
+            int idx = it - m_pageCells.cells.begin();
+            cellContentParentItem = setCellData(cellContentParentItem, m_pageCells, *it, raw);
 
-            //qDebug() << "m_pCurSQLite3DB->DecodeCell(pgno, idx, vars) [" << pgno << "," << idx << "," << vars.size() << "]";
-
-            i64 rowid = m_pCurSQLite3DB->m_pSqlite3Payload->GetRowid();
-            for(size_t i=0; i<vars.size(); i++)
+            i64 rowid = it->rowid;
+            for(int i=0; i<it->nVar; i++)
             {
-                SQLite3Variant& var = vars[i];
+                const SQLite3Variant& var = m_pageCells.vars[it->firstVar + i];
                 QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
-                QString val;
-                switch (var.type) {
-                case SQLITE_TYPE_INTEGER:
-                    val = QString("%1").arg(var.iVal);
-                    break;
-                case SQLITE_TYPE_FLOAT:
-                    val = QString("%1").arg(var.lfVal);
-                    break;
-                case SQLITE_TYPE_TEXT:
-                    val = QString::fromStdString(var.text);
-                    break;
-                case SQLITE_TYPE_NULL:
-                    val = "(null)";
-                    break;
-                case SQLITE_TYPE_BLOB:
-                    val = QString::fromStdString(var.text);
-                    break;
-                default:
-                    break;
-                }
+                QString val = variantText(var);
 
-                if(pkIdx.size() == 1 && pkIdx[0] == i && var.type == SQLITE_TYPE_NULL && StrUpper(pkType[0]) == "INTEGER")
+                // rowid别名在记录中存为NULL
+                if(i == ipk && var.type == SQLITE_TYPE_NULL)
                 {
                     val = QString("%1").arg(rowid);
                 }
@@ -750,18 +796,15 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
 
         m_pTableWdiget->setRowCount(m_payloadArea.size());
 
-        for(auto it=m_payloadArea.begin(); it!=m_payloadArea.end(); ++it)
+        for(auto it=m_pageCells.cells.begin(); it!=m_pageCells.cells.end(); ++it)
         {
-            int idx = it - m_payloadArea.begin();
-            vector<SQLite3Variant> vars;
-            m_pCurSQLite3DB->DecodeCell(pgno, idx, vars);
-            cellContentParentItem = setCellData(cellContentParentItem, *m_pCurSQLite3DB->m_pSqlite3Payload, *it, raw);
-            //qDebug() << "m_pCurSQLite3DB->DecodeCell(pgno, idx, vars) [" << pgno << "," << idx << "," << vars.size() << "]";
+            int idx = it - m_pageCells.cells.begin();
+            cellContentParentItem = setCellData(cellContentParentItem, m_pageCells, *it, raw);
 
             if(!setHeaders)
             {
                 headers.push_back("LeftChild");
-                for(size_t i=0; i<vars.size()-1; i++)
+                for(int i=0; i<it->nVar-1; i++)
                 {
                     headers.push_back(QString("%1").arg(i));
                 }
@@ -771,37 +814,16 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
                 setHeaders = true;
             }
 
-            int leftChild = m_pCurSQLite3DB->m_pSqlite3Payload->GetLeftChild();
+            int leftChild = it->leftChild;
             QTableWidgetItem *leftChildItem = new QTableWidgetItem();
             leftChildItem->setText(QString("%1").arg(leftChild));//设置内容
             m_pTableWdiget->setItem(idx,0,leftChildItem);
 
-            for(size_t i=0; i<vars.size(); i++)
+            for(int i=0; i<it->nVar; i++)
             {
-                SQLite3Variant& var = vars[i];
+                const SQLite3Variant& var = m_pageCells.vars[it->firstVar + i];
                 QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
-                QString val;
-                switch (var.type) {
-                case SQLITE_TYPE_INTEGER:
-                    val = QString("%1").arg(var.iVal);
-                    break;
-                case SQLITE_TYPE_FLOAT:
-                    val = QString("%1").arg(var.lfVal);
-                    break;
-                case SQLITE_TYPE_TEXT:
-                    val = QString::fromStdString(var.text);
-                    break;
-                case SQLITE_TYPE_NULL:
-                    val = "(null)";
-                    break;
-                case SQLITE_TYPE_BLOB:
-                    val = QString::fromStdString(var.text);
-                    break;
-                default:
-                    break;
-                }
-
-                name->setText(val);//设置内容
+                name->setText(variantText(var));//设置内容
                 m_pTableWdiget->setItem(idx,i+1,name);//把这个Item加到第一行第二列中
             }
         }
@@ -835,15 +857,13 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
 
         m_pTableWdiget->setRowCount(m_payloadArea.size());
 
-        for(auto it=m_payloadArea.begin(); it!=m_payloadArea.end(); ++it)
+        for(auto it=m_pageCells.cells.begin(); it!=m_pageCells.cells.end(); ++it)
         {
-            int idx = it - m_payloadArea.begin();
-            vector<SQLite3Variant> vars;
-            m_pCurSQLite3DB->DecodeCell(pgno, idx, vars);
-            cellContentParentItem = setCellData(cellContentParentItem, *m_pCurSQLite3DB->m_pSqlite3Payload, *it, raw);
+            int idx = it - m_pageCells.cells.begin();
+            cellContentParentItem = setCellData(cellContentParentItem, m_pageCells, *it, raw);
             if(!setHeaders)
             {
-                for(size_t i=0; i<vars.size()-1; i++)
+                for(int i=0; i<it->nVar-1; i++)
                 {
                     headers.push_back(QString("%1").arg(i));
                 }
@@ -853,33 +873,11 @@ void HexWindow::onPageIdSelect(int pgno, PageType type)
                 setHeaders = true;
             }
 
-            //qDebug() << "m_pCurSQLite3DB->DecodeCell(pgno, idx, vars) [" << pgno << "," << idx << "," << vars.size() << "]";
-            for(size_t i=0; i<vars.size(); i++)
+            for(int i=0; i<it->nVar; i++)
             {
-                SQLite3Variant& var = vars[i];
+                const SQLite3Variant& var = m_pageCells.vars[it->firstVar + i];
                 QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
-                QString val;
-                switch (var.type) {
-                case SQLITE_TYPE_INTEGER:
-                    val = QString("%1").arg(var.iVal);
-                    break;
-                case SQLITE_TYPE_FLOAT:
-                    val = QString("%1").arg(var.lfVal);
-                    break;
-                case SQLITE_TYPE_TEXT:
-                    val = QString::fromStdString(var.text);
-                    break;
-                case SQLITE_TYPE_NULL:
-                    val = "(null)";
-                    break;
-                case SQLITE_TYPE_BLOB:
-                    val = QString::fromStdString(var.text);
-                    break;
-                default:
-                    break;
-                }
-
-                name->setText(val);//设置内容
+                name->setText(variantText(var));//设置内容
                 m_pTableWdiget->setItem(idx,i,name);//把这个Item加到第一行第二列中
             }
         }
@@ -1086,3 +1084,334 @@ void HexWindow::setPushBtnStats()
         ui->pushButtonLast->setEnabled(true);
     }
 }
+
+void HexWindow::stopSearch()
+{
+    if(m_pSearchThread)
+    {
+        m_pSearchThread->disconnect(this);
+        m_pSearchThread->cancel();
+        m_pSearchThread->wait();
+        delete m_pSearchThread;
+        m_pSearchThread = NULL;
+    }
+    m_pSearchBtn->setText("Find");
+}
+
+void HexWindow::onSearchBtnClicked()
+{
+    if(m_pSearchThread)
+    {
+        stopSearch();
+        return;
+    }
+
+    if (m_pParent)
+    {
+        m_pCurSQLite3DB = m_pParent->GetCurSQLite3DB();
+    }
+    if(m_pCurSQLite3DB == NULL) return;
+
+    // 文本按数据库编码转换
+    int textEncoding = 1;
+    string enc = StrLower(m_pCurSQLite3DB->GetDatabaseInfo()["encoding"]);
+    if(enc == "utf-16le") textEncoding = 2;
+    else if(enc == "utf-16be") textEncoding = 3;
+
+    vector<string> patterns;
+    string err;
+    SearchMode mode = (SearchMode)m_pSearchMode->currentData().toInt();
+    if(!CSQLite3Search::BuildPatterns(mode, m_pSearchEdit->text().toStdString(), textEncoding, patterns, err))
+    {
+        m_pSearchResult->clear();
+        m_searchHitItems.clear();
+        m_pSearchResult->addItem(QString::fromStdString(err));
+        m_pSearchResult->setVisible(true);
+        return;
+    }
+
+    m_searchPatternLens.clear();
+    for(auto it=patterns.begin(); it!=patterns.end(); ++it)
+    {
+        m_searchPatternLens.push_back((int)it->size());
+    }
+
+    m_pSearchResult->clear();
+    m_searchHitItems.clear();
+    m_pSearchResult->setVisible(true);
+    m_pSearchBtn->setText("Stop");
+
+    m_pSearchThread = new SearchThread(m_pCurSQLite3DB->GetPath(), patterns, 10000);
+    connect(m_pSearchThread, SIGNAL(hitFound(int,int,qint64,int)), this, SLOT(onSearchHit(int,int,qint64,int)));
+    connect(m_pSearchThread, SIGNAL(ownerFound(int,QString,int)), this, SLOT(onSearchOwner(int,QString,int)));
+    connect(m_pSearchThread, SIGNAL(progress(int)), this, SLOT(onSearchProgress(int)));
+    connect(m_pSearchThread, SIGNAL(finished()), this, SLOT(onSearchFinished()));
+    m_pSearchThread->start();
+}
+
+void HexWindow::onSearchHit(int pgno, int offset, qint64 fileOffset, int pattern)
+{
+    QListWidgetItem* item = new QListWidgetItem(QString("%1 +%2 @0x%3")
+                                                .arg(pgno).arg(offset)
+                                                .arg(fileOffset, 0, 16));
+    item->setData(Qt::UserRole, pgno);
+    item->setData(Qt::UserRole+1, offset);
+    item->setData(Qt::UserRole+2, pattern);
+    item->setData(Qt::UserRole+3, (int)PAGE_TYPE_UNKNOWN);
+    item->setData(Qt::UserRole+4, fileOffset);
+    m_pSearchResult->addItem(item);
+    m_searchHitItems[pgno].push_back(item);
+}
+
+void HexWindow::onSearchOwner(int pgno, const QString &owner, int type)
+{
+    map<int, vector<QListWidgetItem*> >::iterator it = m_searchHitItems.find(pgno);
+    if(it == m_searchHitItems.end()) return;
+    QString name = owner.isEmpty() ? m_pageTypeName[(PageType)type] : owner;
+    for(size_t i=0; i<it->second.size(); ++i)
+    {
+        QListWidgetItem* item = it->second[i];
+        item->setText(QString("%1 +%2 [%3] @0x%4")
+                      .arg(pgno).arg(item->data(Qt::UserRole+1).toInt())
+                      .arg(name)
+                      .arg(item->data(Qt::UserRole+4).toLongLong(), 0, 16));
+        item->setData(Qt::UserRole+3, type);
+    }
+}
+
+void HexWindow::onSearchProgress(int percent)
+{
+    m_pSearchBtn->setText(QString("Stop %1%").arg(percent));
+}
+
+void HexWindow::onSearchFinished()
+{
+    if(m_pSearchThread == NULL) return;
+    if(m_pSearchResult->count() == 0)
+    {
+        m_pSearchResult->addItem("Not found");
+    }
+    m_pSearchThread->deleteLater();
+    m_pSearchThread = NULL;
+    m_pSearchBtn->setText("Find");
+}
+
+void HexWindow::onSearchResultActivated(QListWidgetItem *item)
+{
+    if(item == NULL || m_pCurSQLite3DB == NULL) return;
+    int pgno = item->data(Qt::UserRole).toInt();
+    int offset = item->data(Qt::UserRole+1).toInt();
+    int pattern = item->data(Qt::UserRole+2).toInt();
+    PageType type = (PageType)item->data(Qt::UserRole+3).toInt();
+    if(pgno <= 0) return;
+
+    showPage(pgno, type);
+
+    QHexDocument* document = m_pHexEdit->document();
+    if(document == NULL) return;
+    int len = (pattern >= 0 && pattern < (int)m_searchPatternLens.size()) ? m_searchPatternLens[pattern] : 1;
+    document->cursor()->setSelectionRange(offset, len);
+}
+
+void HexWindow::ShowPage(int pgno, PageType type)
+{
+    if (m_pParent)
+    {
+        m_pCurSQLite3DB = m_pParent->GetCurSQLite3DB();
+    }
+    if(m_pCurSQLite3DB == NULL) return;
+    showPage(pgno, type);
+}
+
+void HexWindow::showPage(int pgno, PageType type)
+{
+    // 当前页列表中有该页时通过下拉框切换，否则直接加载该页
+    QString prefix = QString("%1/").arg(pgno);
+    int idx = -1;
+    for(int i=0; i<ui->comboBox->count(); ++i)
+    {
+        if(ui->comboBox->itemText(i).startsWith(prefix))
+        {
+            idx = i;
+            break;
+        }
+    }
+    if(idx >= 0 && idx != ui->comboBox->currentIndex())
+    {
+        ui->comboBox->setCurrentIndex(idx);
+    }
+    else if(idx < 0 || (int)m_curPageNo != pgno)
+    {
+        onPageIdSelect(pgno, type);
+    }
+}
+
+void HexWindow::stopDiff()
+{
+    if(m_pDiffThread)
+    {
+        m_pDiffThread->disconnect(this);
+        m_pDiffThread->cancel();
+        m_pDiffThread->wait();
+        delete m_pDiffThread;
+        m_pDiffThread = NULL;
+    }
+    m_pDiffBtn->setText("Compare...");
+}
+
+void HexWindow::onDiffBtnClicked()
+{
+    if(m_pDiffThread)
+    {
+        stopDiff();
+        return;
+    }
+
+    if (m_pParent)
+    {
+        m_pCurSQLite3DB = m_pParent->GetCurSQLite3DB();
+    }
+    if(m_pCurSQLite3DB == NULL) return;
+
+    QString path = QFileDialog::getOpenFileName(this, "Compare with", "", "SQLite (*.*)");
+    if(path.isEmpty()) return;
+
+    // 选中的文件作为旧版本，当前数据库作为新版本
+    m_diffPath = path.toStdString();
+    m_diffPageTypes.clear();
+
+    m_pDiffResult->clear();
+    m_pDiffResult->setVisible(true);
+    QTreeWidgetItem* pages = new QTreeWidgetItem(m_pDiffResult, QStringList() << "Pages");
+    pages->setData(0, Qt::UserRole, 0);
+    m_pDiffBtn->setText("Stop");
+
+    m_pDiffThread = new DiffThread(m_diffPath, m_pCurSQLite3DB->GetPath(), 10000);
+    connect(m_pDiffThread, SIGNAL(pageChanged(int,QString,QString,int,int)), this, SLOT(onDiffPageChanged(int,QString,QString,int,int)));
+    connect(m_pDiffThread, SIGNAL(cellChanged(QString,int,qint64,QString,int,int)), this, SLOT(onDiffCellChanged(QString,int,qint64,QString,int,int)));
+    connect(m_pDiffThread, SIGNAL(progress(int,int)), this, SLOT(onDiffProgress(int,int)));
+    connect(m_pDiffThread, SIGNAL(finished()), this, SLOT(onDiffFinished()));
+    m_pDiffThread->start();
+}
+
+void HexWindow::onDiffPageChanged(int pgno, const QString &oldOwner, const QString &newOwner, int oldType, int newType)
+{
+    m_diffPageTypes[pgno] = (PageType)newType;
+    QTreeWidgetItem* pages = m_pDiffResult->topLevelItem(0);
+    if(pages == NULL) return;
+
+    // 页数太多时只计数，不再逐个列出
+    int n = pages->data(1, Qt::UserRole).toInt() + 1;
+    pages->setData(1, Qt::UserRole, n);
+    pages->setText(1, QString::number(n));
+    if(pages->childCount() >= 10000) return;
+
+    QString change = (oldOwner == newOwner && oldType == newType) ? "modified" : "reassigned";
+    QTreeWidgetItem* item = new QTreeWidgetItem(pages);
+    item->setText(0, newOwner.isEmpty() ? m_pageTypeName[(PageType)newType] : newOwner);
+    item->setText(1, change);
+    item->setText(2, oldOwner.isEmpty() ? m_pageTypeName[(PageType)oldType] : oldOwner);
+    item->setText(3, QString::number(pgno));
+    item->setText(4, QString::number(pgno));
+    item->setData(0, Qt::UserRole, pgno);
+}
+
+void HexWindow::onDiffCellChanged(const QString &table, int change, qint64 rowid, const QString &key, int oldPgno, int newPgno)
+{
+    QTreeWidgetItem* parent = NULL;
+    for(int i=1; i<m_pDiffResult->topLevelItemCount(); ++i)
+    {
+        if(m_pDiffResult->topLevelItem(i)->text(0) == table)
+        {
+            parent = m_pDiffResult->topLevelItem(i);
+            break;
+        }
+    }
+    if(parent == NULL)
+    {
+        parent = new QTreeWidgetItem(m_pDiffResult, QStringList() << table);
+        parent->setData(0, Qt::UserRole, 0);
+    }
+
+    static const char* changes[] = {"insert", "delete", "update"};
+    QTreeWidgetItem* item = new QTreeWidgetItem(parent);
+    item->setText(0, table);
+    item->setText(1, changes[change]);
+    item->setText(2, key.isEmpty() ? QString::number(rowid) : key);
+    item->setText(3, oldPgno ? QString::number(oldPgno) : QString());
+    item->setText(4, newPgno ? QString::number(newPgno) : QString());
+    item->setData(0, Qt::UserRole, newPgno ? newPgno : oldPgno);
+    parent->setText(1, QString::number(parent->childCount()));
+}
+
+void HexWindow::onDiffProgress(int done, int total)
+{
+    m_pDiffBtn->setText(QString("Stop %1/%2").arg(done).arg(total));
+}
+
+void HexWindow::onDiffFinished()
+{
+    if(m_pDiffThread == NULL) return;
+    QString err = m_pDiffThread->error();
+    if(!err.isEmpty())
+    {
+        new QTreeWidgetItem(m_pDiffResult, QStringList() << err);
+    }
+    m_pDiffThread->deleteLater();
+    m_pDiffThread = NULL;
+    m_pDiffBtn->setText("Compare...");
+}
+
+void HexWindow::onDiffResultActivated(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column);
+    if(item == NULL || m_pCurSQLite3DB == NULL) return;
+    int pgno = item->data(0, Qt::UserRole).toInt();
+    if(pgno > 0) showDiffPage(pgno);
+}
+
+void HexWindow::showDiffPage(int pgno)
+{
+    // 记录变化都在变化的页上，类型已随页的结果传来
+    map<int, PageType>::const_iterator it = m_diffPageTypes.find(pgno);
+    showPage(pgno, it != m_diffPageTypes.end() ? it->second : PAGE_TYPE_UNKNOWN);
+
+    int pagesize = m_pCurSQLite3DB->GetPageSize();
+    string cur = m_pCurSQLite3DB->LoadPage(pgno, false);
+    string other(pagesize, '\0');
+    CSQLite3File file;
+    if(file.Open(m_diffPath))
+    {
+        file.Read((int64_t)(pgno-1)*pagesize, &other[0], pagesize);
+    }
+
+    QByteArray ba = QByteArray::fromStdString(other);
+    QHexDocument* diffDocument = m_pDiffHexEdit->document();
+    if(diffDocument == NULL)
+    {
+        diffDocument = QHexDocument::fromMemory(ba);
+        m_pDiffHexEdit->setDocument(diffDocument);
+    }
+    else
+    {
+        diffDocument->replace(0, ba);
+    }
+    diffDocument->clearHighlighting();
+    diffDocument->clearMetadata();
+    diffDocument->setBaseAddress(ui->checkBox->checkState() == Qt::Checked ? (pgno-1)*pagesize : 0);
+    m_pDiffHexEdit->setVisible(true);
+
+    // 两边同时高亮不同的字节
+    QHexDocument* document = m_pHexEdit->document();
+    vector<pair<int, int> > ranges = CSQLite3Diff::DiffRanges(other, cur);
+    QColor color(0xFF, 0x80, 0x80);
+    diffDocument->beginMetadata();
+    if(document) document->beginMetadata();
+    for(auto it=ranges.begin(); it!=ranges.end(); ++it)
+    {
+        diffDocument->highlightBackRange(it->first, it->second, color);
+        if(document) document->highlightBackRange(it->first, it->second, color);
+    }
+    if(document) document->endMetadata();
+    diffDocument->endMetadata();
+}
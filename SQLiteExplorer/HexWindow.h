@@ -5,6 +5,11 @@
 #include <QTableWidget>
 #include <QTreeView>
 #include <QSplitter>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QListWidget>
+#include <QTreeWidget>
 #include <qstandarditemmodel.h>
 
 #include <QHexEdit/qhexedit.h>
@@ -19,6 +24,8 @@ class HexWindow;
 }
 
 class MainWindow;
+class SearchThread;
+class DiffThread;
 class HexWindow : public QWidget
 {
     Q_OBJECT
@@ -32,13 +39,16 @@ public:
     void SetPageNosAndType(const vector<pair<int, PageType>>& pgs);
     void SetTableName(const QString& name, const QString& tableName, const QString& type);
 
+    // 显示当前数据库的指定页，例如从页面热力图点击跳转过来
+    void ShowPage(int pgno, PageType type);
+
     void setPageHdrData(PageType type, ContentArea& pageHeaderArea, ContentArea& cellidxArea, ContentArea& unusedArea, int pgno, string raw);
     void setFreeListPageHdrData(ContentArea &sNextTrunkPageNo, int &nNextTrunkPageNo,
                                 ContentArea &sLeafPageCounts, int &nLeafPageCounts,
                                 vector<ContentArea> &sLeafPageNos, vector<int> &nLeafPageNos,
                                 ContentArea &sUnused, string raw);
 
-    QStandardItem *setCellData(QStandardItem *parentItem, CSQLite3Payload& payload, ContentArea area, string raw);
+    QStandardItem *setCellData(QStandardItem *parentItem, const SQLite3PageCells& cells, const SQLite3Cell& cell, const string& raw);
 
     QStandardItem* GetItem(int start, i64 len, QString txt);
 public slots:
@@ -53,9 +63,26 @@ public slots:
     void onCurrentAddressChanged(qint64 address);
     void onCheckBoxStatChanged(bool stat);
 
+    void onSearchBtnClicked();
+    void onSearchHit(int pgno, int offset, qint64 fileOffset, int pattern);
+    void onSearchOwner(int pgno, const QString& owner, int type);
+    void onSearchProgress(int percent);
+    void onSearchFinished();
+    void onSearchResultActivated(QListWidgetItem* item);
+
+    void onDiffBtnClicked();
+    void onDiffPageChanged(int pgno, const QString& oldOwner, const QString& newOwner, int oldType, int newType);
+    void onDiffCellChanged(const QString& table, int change, qint64 rowid, const QString& key, int oldPgno, int newPgno);
+    void onDiffProgress(int done, int total);
+    void onDiffFinished();
+    void onDiffResultActivated(QTreeWidgetItem* item, int column);
+
 private:
     void setPushBtnStats();
-
+    void stopSearch();
+    void stopDiff();
+    void showPage(int pgno, PageType type);
+    void showDiffPage(int pgno);
 
 private:
     Ui::HexWindow *ui;
@@ -68,6 +95,23 @@ private:
     QHexEdit*       m_pHexEdit;
     QTableWidget*   m_pTableWdiget;
 
+    // 全文件搜索
+    QComboBox*      m_pSearchMode;
+    QLineEdit*      m_pSearchEdit;
+    QPushButton*    m_pSearchBtn;
+    QListWidget*    m_pSearchResult;
+    SearchThread*   m_pSearchThread;
+    vector<int>     m_searchPatternLens;
+    map<int, vector<QListWidgetItem*> > m_searchHitItems;  // 每页的命中，搜索结束后补上页的归属
+
+    // 与另一个文件逐页比较
+    QPushButton*    m_pDiffBtn;
+    QTreeWidget*    m_pDiffResult;
+    QHexEdit*       m_pDiffHexEdit;
+    DiffThread*     m_pDiffThread;
+    string          m_diffPath;
+    map<int, PageType> m_diffPageTypes; // 变化的页在当前文件中的类型
+
     MainWindow*     m_pParent;
     CSQLite3DB*     m_pCurSQLite3DB;
 
@@ -76,6 +120,7 @@ private:
 
     QStringList m_tableHeaders;
     vector<ContentArea> m_payloadArea;
+    SQLite3PageCells m_pageCells;   // 当前页所有cell的解码结果
 
     QMap<PageType, QString> m_pageTypeName;
     QStringList m_pageNoAndTypes;
@@ -0,0 +1,24 @@
+#include "ImportThread.h"
+
+ImportThread::ImportThread(const QString &dbPath, const QString &srcPath, const ImportOptions &opts, QObject *parent)
+    : QThread(parent)
+    , m_dbPath(dbPath)
+    , m_srcPath(srcPath)
+    , m_opts(opts)
+    , m_ok(false)
+{
+
+}
+
+void ImportThread::cancel()
+{
+    m_import.Cancel();
+}
+
+void ImportThread::run()
+{
+    m_ok = m_import.Run(m_dbPath.toStdString(), m_srcPath.toStdString(), m_opts,
+        [&](int64_t rows, double rowsPerSec, int64_t bytes, int64_t total) {
+            emit progress((qint64)rows, rowsPerSec, (qint64)bytes, (qint64)total);
+        });
+}
@@ -0,0 +1,45 @@
+#ifndef IMPORTTHREAD_H
+#define IMPORTTHREAD_H
+
+#include <QThread>
+#include <QString>
+
+#include "SQLite3Import.h"
+
+/*
+** Run a CSQLite3Import in the background.  progress() comes from the
+** thread that inserted the round, this one or a worker of the pool; the
+** thread object lives in the GUI thread, so the connection is queued
+** either way.
+*/
+class ImportThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    ImportThread(const QString& dbPath, const QString& srcPath, const ImportOptions& opts, QObject* parent = 0);
+
+    // 停止导入，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_import.IsCancelled(); }
+    QString error() const { return QString::fromStdString(m_import.GetError()); }
+    qint64 rows() const { return m_import.GetRows(); }
+    double seconds() const { return m_import.GetSeconds(); }
+
+signals:
+    void progress(qint64 rows, double rowsPerSec, qint64 bytes, qint64 total);
+
+protected:
+    void run();
+
+private:
+    QString         m_dbPath;
+    QString         m_srcPath;
+    ImportOptions   m_opts;
+    bool            m_ok;
+    CSQLite3Import  m_import;
+};
+
+#endif // IMPORTTHREAD_H
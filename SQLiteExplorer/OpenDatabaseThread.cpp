@@ -0,0 +1,111 @@
+#include "OpenDatabaseThread.h"
+#include "SQLite3DB.h"
+#include "SQLite3File.h"
+
+#include <QElapsedTimer>
+#include <string.h>
+
+// 每批最多的行数和最长的间隔
+static const int OPEN_BATCH_ROWS = 256;
+static const int OPEN_BATCH_MS = 50;
+
+OpenDatabaseThread::OpenDatabaseThread(const QString &path, QObject *parent)
+    : QThread(parent)
+    , m_path(path)
+    , m_ok(false)
+    , m_pSqlite(NULL)
+    , m_cancel(false)
+{
+
+}
+
+OpenDatabaseThread::~OpenDatabaseThread()
+{
+    delete m_pSqlite;
+}
+
+void OpenDatabaseThread::cancel()
+{
+    m_cancel = true;
+}
+
+const char *OpenDatabaseThread::schemaSql()
+{
+    return "select type, name, tbl_name, rootpage from sqlite_master "
+           "union all select 'table', 'sqlite_master', 'sqlite_master', 1 "
+           "order by tbl_name, name";
+}
+
+CSQLite3DB *OpenDatabaseThread::takeDatabase()
+{
+    CSQLite3DB* pSqlite = m_pSqlite;
+    m_pSqlite = NULL;
+    return pSqlite;
+}
+
+void OpenDatabaseThread::run()
+{
+    string path = m_path.toStdString();
+
+    // 文件头
+    CSQLite3File file;
+    if (!file.Open(path))
+    {
+        m_err = tr("Cannot open %1").arg(m_path);
+        return;
+    }
+    unsigned char hdr[100];
+    file.Read(0, hdr, sizeof(hdr));
+    int64_t size = file.Size();
+    file.Close();
+    if (size > 0 && memcmp(hdr, "SQLite format 3", 16) != 0)
+    {
+        m_err = tr("%1 is not a SQLite database").arg(m_path);
+        return;
+    }
+    if (size > 0)
+    {
+        int pageSize = (hdr[16] << 8) | hdr[17];
+        if (pageSize == 1) pageSize = 65536;
+        static const char* encodings[] = { "", "UTF-8", "UTF-16le", "UTF-16be" };
+        unsigned int enc = decodeInt32(hdr+56);
+        emit headerParsed(pageSize, pageSize > 0 ? size / pageSize : 0,
+                          enc < 4 ? encodings[enc] : "");
+    }
+    if (m_cancel) return;
+
+    m_pSqlite = new CSQLite3DB(path);
+
+    QStringList types, names, tblNames;
+    QVector<int> roots;
+    QElapsedTimer timer;
+    timer.start();
+    try
+    {
+        CppSQLite3Query q = m_pSqlite->execQuery(schemaSql());
+        for (; !q.eof() && !m_cancel; q.nextRow())
+        {
+            types << QString::fromUtf8(q.getStringField(0));
+            names << QString::fromUtf8(q.getStringField(1));
+            tblNames << QString::fromUtf8(q.getStringField(2));
+            roots << q.getIntField(3);
+            if (types.size() >= OPEN_BATCH_ROWS || timer.elapsed() >= OPEN_BATCH_MS)
+            {
+                emit objectsLoaded(types, names, tblNames, roots);
+                types.clear();
+                names.clear();
+                tblNames.clear();
+                roots.clear();
+                timer.restart();
+            }
+        }
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        m_err = QString::fromUtf8(e.errorMessage());
+        return;
+    }
+    if (types.size())
+        emit objectsLoaded(types, names, tblNames, roots);
+    m_ok = !m_cancel;
+}
@@ -0,0 +1,56 @@
+#ifndef OPENDATABASETHREAD_H
+#define OPENDATABASETHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+class CSQLite3DB;
+
+/*
+** Open a database off the GUI thread.  The 100-byte header is read
+** first and reported at once, then CSQLite3DB is constructed and
+** sqlite_master is stepped, its rows handed over in small batches so
+** the tree can be filled while the rest is still being read.  The
+** CSQLite3DB belongs to the thread until takeDatabase().
+*/
+class OpenDatabaseThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    OpenDatabaseThread(const QString& path, QObject* parent = 0);
+    ~OpenDatabaseThread();
+
+    // 停止读取schema，不等待线程结束
+    void cancel();
+
+    // 按tbl_name, name排序列出sqlite_master，包括sqlite_master本身
+    static const char* schemaSql();
+
+    const QString& path() const { return m_path; }
+    bool succeeded() const { return m_ok; }
+    QString error() const { return m_err; }
+
+    // 取得打开的数据库，之后由调用者释放
+    CSQLite3DB* takeDatabase();
+
+signals:
+    void headerParsed(int pageSize, qint64 pages, const QString& encoding);
+    void objectsLoaded(const QStringList& types, const QStringList& names,
+                       const QStringList& tblNames, const QVector<int>& roots);
+
+protected:
+    void run();
+
+private:
+    QString             m_path;
+    bool                m_ok;
+    QString             m_err;
+    CSQLite3DB*         m_pSqlite;
+    std::atomic<bool>   m_cancel;
+};
+
+#endif // OPENDATABASETHREAD_H
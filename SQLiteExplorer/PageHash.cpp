@@ -0,0 +1,146 @@
+#include "PageHash.h"
+#include "SQLite3File.h"
+#include "Parallel.h"
+
+#include <string.h>
+#include <algorithm>
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+// 每个工作线程一次读取的字节数
+static const int64_t HASH_CHUNK_SIZE = 4*1024*1024;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v = 0;
+    for (int i=7; i>=0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t xxhMergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= xxhRound(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t XXHash64(const void *data, size_t len, uint64_t seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    uint64_t h;
+
+    if (len >= 32)
+    {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        do
+        {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p+8));
+            v3 = xxhRound(v3, read64(p+16));
+            v4 = xxhRound(v4, read64(p+24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxhMergeRound(h, v1);
+        h = xxhMergeRound(h, v2);
+        h = xxhMergeRound(h, v3);
+        h = xxhMergeRound(h, v4);
+    }
+    else
+    {
+        h = seed + PRIME64_5;
+    }
+
+    h += (uint64_t)len;
+
+    while (p + 8 <= end)
+    {
+        h ^= xxhRound(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+int64_t HashBufferBytes(int nThreads)
+{
+    if (nThreads <= 0) nThreads = ParallelThreadCount();
+    return nThreads * HASH_CHUNK_SIZE;
+}
+
+bool HashPages(const string &path, vector<uint64_t> &hashes, int *pPageSize,
+               const std::atomic<bool> *pCancel, int nThreads)
+{
+    hashes.clear();
+
+    CSQLite3File file;
+    if (!file.Open(path)) return false;
+    int64_t szFile = file.Size();
+    int pagesize = file.PageSize();
+    file.Close();
+    if (pagesize < 512) return false;
+    if (pPageSize) *pPageSize = pagesize;
+
+    int64_t nPage = (szFile + pagesize - 1) / pagesize;
+    hashes.resize(nPage);
+
+    // 每次读取多个页，减少系统调用
+    int64_t pagesPerChunk = std::max<int64_t>(1, HASH_CHUNK_SIZE / pagesize);
+    ParallelFor(nPage, pagesPerChunk, [&](int64_t begin, int64_t end) {
+        if (pCancel && *pCancel) return;
+        CSQLite3File f;
+        if (!f.Open(path)) return;
+        vector<unsigned char> buf((end - begin) * pagesize);
+        f.Read(begin * pagesize, &buf[0], (int)buf.size());
+        for (int64_t i=begin; i<end; ++i)
+        {
+            hashes[i] = XXHash64(&buf[(i - begin) * pagesize], pagesize);
+        }
+    }, nThreads);
+
+    return !(pCancel && *pCancel);
+}
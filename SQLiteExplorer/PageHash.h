@@ -0,0 +1,28 @@
+#ifndef PAGEHASH_H
+#define PAGEHASH_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+// 64位xxHash(XXH64)
+uint64_t XXHash64(const void* data, size_t len, uint64_t seed = 0);
+
+/*
+** Hash every page of the database file at path.  hashes[i] receives the
+** hash of page i+1.  The file is read in large page-aligned chunks by
+** worker threads, so memory use is 8 bytes per page plus one read buffer
+** per thread.  Returns false if the file cannot be read or if *pCancel
+** became true while hashing.
+*/
+bool HashPages(const string& path, vector<uint64_t>& hashes, int* pPageSize = NULL,
+               const std::atomic<bool>* pCancel = NULL, int nThreads = 0);
+
+// HashPages的读缓冲区最多占用的内存，不含哈希值本身
+int64_t HashBufferBytes(int nThreads = 0);
+
+#endif // PAGEHASH_H
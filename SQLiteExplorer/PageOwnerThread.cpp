@@ -0,0 +1,17 @@
+#include "PageOwnerThread.h"
+
+PageOwnerThread::PageOwnerThread(const QString &path, QObject *parent)
+    : QThread(parent)
+    , path(path)
+    , m_cancel(false)
+{
+
+}
+
+void PageOwnerThread::run()
+{
+    CSQLite3DB db(path.toStdString());
+    db.GetPageOwners(true, &m_cancel);
+    if (!m_cancel)
+        db.SetPageOwners(owners);
+}
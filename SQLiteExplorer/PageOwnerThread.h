@@ -0,0 +1,32 @@
+#ifndef PAGEOWNERTHREAD_H
+#define PAGEOWNERTHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <atomic>
+
+#include "SQLite3DB.h"
+
+// 在后台用自己的连接遍历所有b-tree，建立页归属表
+class PageOwnerThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    PageOwnerThread(const QString& path, QObject* parent = 0);
+
+    // 停止遍历，不等待线程结束
+    void cancel() { m_cancel = true; }
+    bool cancelled() const { return m_cancel; }
+
+    QString      path;
+    PageOwnerMap owners;    // 取消时为空
+
+protected:
+    void run();
+
+private:
+    std::atomic<bool> m_cancel;
+};
+
+#endif // PAGEOWNERTHREAD_H
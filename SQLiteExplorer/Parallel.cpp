@@ -0,0 +1,143 @@
+#include "Parallel.h"
+
+#include <atomic>
+#include <memory>
+
+int ParallelThreadCount()
+{
+    int n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 2;
+}
+
+static std::atomic<CWorkerPool*> s_instance(NULL);
+
+CWorkerPool &CWorkerPool::Instance()
+{
+    CWorkerPool* pool = s_instance;
+    if (pool) return *pool;
+    static CWorkerPool defaultPool(ParallelThreadCount());
+    return defaultPool;
+}
+
+void CWorkerPool::SetInstance(CWorkerPool *pool)
+{
+    s_instance = pool;
+}
+
+CWorkerPool::CWorkerPool(int nThreads)
+    : m_stop(false)
+{
+    for (int i=0; i<nThreads; ++i)
+    {
+        m_threads.push_back(std::thread(&CWorkerPool::Run, this));
+    }
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_tasks.clear();
+    }
+    m_cond.notify_all();
+    for (auto it=m_threads.begin(); it!=m_threads.end(); ++it)
+    {
+        it->join();
+    }
+}
+
+void CWorkerPool::Submit(const std::function<void ()> &task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(task);
+    }
+    m_cond.notify_one();
+}
+
+void CWorkerPool::Run()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_stop) return;
+            task = m_tasks.front();
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+// 一次ParallelFor的状态，池中的任务可能在调用者返回后才开始执行
+struct ParallelJob
+{
+    std::atomic<int64_t>    next;
+    int64_t                 nChunk;
+    int64_t                 grain;
+    int64_t                 n;
+    const std::function<void(int64_t, int64_t)>* func;
+
+    std::mutex              mutex;
+    std::condition_variable cond;
+    int64_t                 done;
+
+    // 领取并处理块，直到没有剩余
+    void Work()
+    {
+        for (;;)
+        {
+            int64_t chunk = next.fetch_add(1);
+            if (chunk >= nChunk) break;
+            int64_t begin = chunk * grain;
+            int64_t end = begin + grain < n ? begin + grain : n;
+            (*func)(begin, end);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (++done == nChunk) cond.notify_all();
+        }
+    }
+};
+
+/*
+** The caller works on the chunks too and only waits for the chunks that
+** helpers have already taken.  A helper that starts after all chunks are
+** gone returns without touching func, so the pool being busy (or this
+** being called from inside a pool task) delays the work but never
+** deadlocks it.
+*/
+void ParallelFor(int64_t n, int64_t grain,
+                 const std::function<void(int64_t, int64_t)>& func,
+                 int nThreads, CWorkerPool* pool)
+{
+    if (n <= 0) return;
+    if (grain <= 0) grain = 1;
+    if (nThreads <= 0) nThreads = ParallelThreadCount();
+
+    int64_t nChunk = (n + grain - 1) / grain;
+    if (nThreads > nChunk) nThreads = (int)nChunk;
+
+    std::shared_ptr<ParallelJob> job(new ParallelJob);
+    job->next = 0;
+    job->nChunk = nChunk;
+    job->grain = grain;
+    job->n = n;
+    job->func = &func;
+    job->done = 0;
+
+    if (nThreads > 1)
+    {
+        if (pool == NULL) pool = &CWorkerPool::Instance();
+        for (int i=1; i<nThreads && i<=pool->ThreadCount(); ++i)
+        {
+            pool->Submit([job]() { job->Work(); });
+        }
+    }
+    job->Work();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->cond.wait(lock, [&job]() { return job->done == job->nChunk; });
+}
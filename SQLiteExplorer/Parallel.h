@@ -0,0 +1,63 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "utils.h"
+
+// 工作线程数量，默认为CPU核数
+int ParallelThreadCount();
+
+/*
+** The worker threads of the process.  They are started on first use and
+** shared by every ParallelFor, so concurrent or nested callers queue
+** their chunks on the same threads instead of each starting a full set.
+** A task must not block waiting for another task: callers that need a
+** result take part in the work themselves (see ParallelFor).
+**
+** The owner of the application's threads (CWorkspace) creates its pool
+** and installs it with SetInstance; without one, Instance() starts a
+** pool of ParallelThreadCount() threads on first use.
+*/
+class CWorkerPool
+{
+public:
+    explicit CWorkerPool(int nThreads);
+    ~CWorkerPool();
+
+    static CWorkerPool& Instance();
+    // 设置Instance()返回的线程池，NULL恢复默认的线程池
+    static void SetInstance(CWorkerPool* pool);
+
+    int ThreadCount() const { return (int)m_threads.size(); }
+
+    void Submit(const std::function<void()>& task);
+
+private:
+    void Run();
+
+private:
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cond;
+    std::deque<std::function<void()> >  m_tasks;
+    std::vector<std::thread>            m_threads;
+    bool                                m_stop;
+};
+
+/*
+** Split [0, n) into chunks of at most grain items and hand them to worker
+** threads.  func(begin, end) is called once per chunk; chunks are handed
+** out dynamically so that uneven chunks do not stall the other workers.
+** At most nThreads threads work on it, the caller being one of them;
+** the helpers come from pool, CWorkerPool::Instance() when it is NULL.
+** Returns when every chunk has been processed.
+*/
+void ParallelFor(int64_t n, int64_t grain,
+                 const std::function<void(int64_t begin, int64_t end)>& func,
+                 int nThreads = 0, CWorkerPool* pool = NULL);
+
+#endif // PARALLEL_H
@@ -0,0 +1,121 @@
+#include "PlanView.h"
+
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QVBoxLayout>
+
+// 防止损坏的计划形成环
+static const int PLAN_MAX_LEVEL = 64;
+
+PlanView::PlanView(QWidget *parent)
+    : QWidget(parent)
+{
+    m_pSummary = new QLabel(tr("Press Query Plan to explain a statement"), this);
+    m_pSummary->setWordWrap(true);
+
+    m_pTree = new QTreeWidget(this);
+    m_pTree->setColumnCount(6);
+    m_pTree->setHeaderLabels(QStringList() << tr("Step") << tr("B-tree") << tr("Pages")
+                             << tr("Depth") << tr("Est. rows") << tr("Note"));
+    m_pTree->setAlternatingRowColors(true);
+    m_pTree->header()->setStretchLastSection(true);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setMargin(0);
+    layout->addWidget(m_pSummary);
+    layout->addWidget(m_pTree, 1);
+    setLayout(layout);
+
+    connect(m_pTree, SIGNAL(itemDoubleClicked(QTreeWidgetItem*,int)), this, SLOT(onItemDoubleClicked(QTreeWidgetItem*,int)));
+}
+
+void PlanView::clear()
+{
+    m_pTree->clear();
+    m_pSummary->clear();
+}
+
+void PlanView::SetPlan(const QueryPlan &plan)
+{
+    m_pTree->clear();
+    if (!plan.err.empty())
+    {
+        m_pSummary->setText(QString::fromStdString(plan.err));
+        return;
+    }
+
+    for (size_t i=0; i<plan.roots.size(); ++i)
+    {
+        addNode(plan, plan.roots[i], NULL, 0);
+    }
+    m_pTree->expandAll();
+    for (int c=0; c<m_pTree->columnCount()-1; ++c)
+    {
+        m_pTree->resizeColumnToContents(c);
+    }
+
+    int nFlagged = 0;
+    for (auto it=plan.nodes.begin(); it!=plan.nodes.end(); ++it)
+    {
+        if (it->flagged) nFlagged++;
+    }
+    QString summary = plan.legacy ? tr("%1 steps (selectid format)") : tr("%1 steps");
+    summary = summary.arg(plan.nodes.size());
+    if (nFlagged > 0)
+        summary += tr(", %1 to look at").arg(nFlagged);
+    m_pSummary->setText(summary + tr(". Double-click a step to open its root page."));
+}
+
+void PlanView::addNode(const QueryPlan &plan, int i, QTreeWidgetItem *parent, int level)
+{
+    if (level > PLAN_MAX_LEVEL) return;
+    const PlanNode& node = plan.nodes[i];
+
+    QTreeWidgetItem* item = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(m_pTree);
+    item->setText(0, QString::fromStdString(node.detail));
+    item->setToolTip(0, QString::fromStdString(node.detail));
+    if (node.root > 0)
+    {
+        // 抽样得到的页数前面加"~"
+        QString approx = node.stats.estimated ? "~" : "";
+        item->setText(1, QString("%1 (%2)").arg(QString::fromStdString(node.btree)).arg(node.root));
+        item->setText(2, approx + QString::number(node.stats.pages));
+        item->setText(3, QString::number(node.stats.depth));
+        item->setData(0, Qt::UserRole, node.root);
+        item->setData(0, Qt::UserRole + 1, node.stats.rootType);
+    }
+    if (node.estRows >= 0)
+    {
+        item->setText(4, QString::number((qint64)(node.estRows + 0.5)));
+        item->setToolTip(4, tr("from %1").arg(QString::fromStdString(node.rowsSource)));
+    }
+    item->setText(5, QString::fromStdString(node.note));
+    item->setToolTip(5, QString::fromStdString(node.note));
+    for (int c=2; c<5; ++c)
+    {
+        item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (node.flagged)
+    {
+        for (int c=0; c<m_pTree->columnCount(); ++c)
+        {
+            item->setForeground(c, Qt::red);
+        }
+    }
+
+    for (size_t c=0; c<node.children.size(); ++c)
+    {
+        addNode(plan, node.children[c], item, level + 1);
+    }
+}
+
+void PlanView::onItemDoubleClicked(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column);
+    int root = item->data(0, Qt::UserRole).toInt();
+    if (root > 0)
+    {
+        emit pageActivated(root, item->data(0, Qt::UserRole + 1).toInt());
+    }
+}
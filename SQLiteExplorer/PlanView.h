@@ -0,0 +1,44 @@
+#ifndef PLANVIEW_H
+#define PLANVIEW_H
+
+#include <QWidget>
+
+#include "SQLite3QueryPlan.h"
+
+class QTreeWidget;
+class QTreeWidgetItem;
+class QLabel;
+
+/*
+** Results of the SQL tab's Query Plan button: the EXPLAIN QUERY PLAN
+** tree with every SCAN and SEARCH annotated with the size of the b-tree
+** it reads.  Flagged steps are drawn in red; double-clicking a step
+** opens the root page of its b-tree in the hex view.
+*/
+class PlanView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PlanView(QWidget *parent = 0);
+
+    void SetPlan(const QueryPlan& plan);
+
+public slots:
+    void clear();
+
+signals:
+    void pageActivated(int pgno, int type);
+
+private slots:
+    void onItemDoubleClicked(QTreeWidgetItem* item, int column);
+
+private:
+    void addNode(const QueryPlan& plan, int i, QTreeWidgetItem* parent, int level);
+
+private:
+    QTreeWidget*    m_pTree;
+    QLabel*         m_pSummary;
+};
+
+#endif // PLANVIEW_H
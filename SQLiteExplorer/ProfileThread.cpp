@@ -0,0 +1,91 @@
+#include "ProfileThread.h"
+
+// 每执行多少条虚拟机指令调用一次进度回调
+static const int PROFILE_PROGRESS_OPS = 1000;
+// 两次报告进度的最小间隔(毫秒)
+static const int PROFILE_REPORT_MS = 200;
+// 保留的预览行数
+static const int PROFILE_KEEP_ROWS = 100;
+
+ProfileThread::ProfileThread(QObject *parent)
+    : QThread(parent)
+    , m_coldCache(false)
+    , m_cancel(false)
+    , m_pDb(NULL)
+    , m_lastReport(0)
+{
+
+}
+
+ProfileThread::~ProfileThread()
+{
+    closeDatabase();
+}
+
+void ProfileThread::setQuery(const QString &path, const QString &sql, bool coldCache)
+{
+    m_path = path;
+    m_sql = sql;
+    m_coldCache = coldCache;
+    m_cancel = false;
+}
+
+void ProfileThread::cancel()
+{
+    m_cancel = true;
+}
+
+void ProfileThread::closeDatabase()
+{
+    if (m_pDb)
+    {
+        sqlite3_close(m_pDb);
+        m_pDb = NULL;
+    }
+    m_dbPath.clear();
+}
+
+int ProfileThread::onProgress(void *arg)
+{
+    ProfileThread* self = (ProfileThread*)arg;
+    if (self->m_cancel) return 1;
+
+    qint64 now = self->m_timer.elapsed();
+    if (now - self->m_lastReport >= PROFILE_REPORT_MS)
+    {
+        self->m_lastReport = now;
+        emit self->progress(now / 1000.0);
+    }
+    return 0;
+}
+
+void ProfileThread::run()
+{
+    m_profile = QueryProfile();
+    m_timer.start();
+    m_lastReport = 0;
+
+    // 换了数据库时重新打开连接
+    if (m_pDb && m_dbPath != m_path)
+        closeDatabase();
+    if (m_pDb == NULL)
+    {
+        if (sqlite3_open_v2(m_path.toUtf8().constData(), &m_pDb, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+        {
+            m_profile.sql = m_sql.toStdString();
+            m_profile.when = time(NULL);
+            m_profile.err = sqlite3_errmsg(m_pDb);
+            closeDatabase();
+            return;
+        }
+        sqlite3_busy_timeout(m_pDb, 5000);
+        m_dbPath = m_path;
+    }
+
+    sqlite3_progress_handler(m_pDb, PROFILE_PROGRESS_OPS, &ProfileThread::onProgress, this);
+    CSQLite3Profiler::Run(m_pDb, m_sql.toStdString(), PROFILE_KEEP_ROWS, m_coldCache, m_profile);
+    sqlite3_progress_handler(m_pDb, 0, NULL, NULL);
+
+    if (m_cancel)
+        m_profile.err = tr("Cancelled").toStdString();
+}
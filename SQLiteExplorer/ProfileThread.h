@@ -0,0 +1,65 @@
+#ifndef PROFILETHREAD_H
+#define PROFILETHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+
+#include "SQLite3Profile.h"
+
+/*
+** Profile SQL text in a worker thread so a long query does not freeze
+** the GUI.  The statements run on a connection of the thread's own: the
+** thread CPU time and the page cache counters are then those of the
+** query alone.  The connection is kept open between runs on the same
+** database, so without "cold cache" the second run sees a warm cache,
+** as it would on the GUI connection.
+**
+** cancel() makes the progress handler abort the running statement.
+*/
+class ProfileThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    ProfileThread(QObject* parent = 0);
+    ~ProfileThread();
+
+    // 在start()之前设置，同时清除上一次的取消标志
+    void setQuery(const QString& path, const QString& sql, bool coldCache);
+
+    // 停止执行，不等待线程结束
+    void cancel();
+
+    // 关闭保留的连接，只能在线程没有运行时调用
+    void closeDatabase();
+
+    QString path() const { return m_path; }
+    bool cancelled() const { return m_cancel; }
+    const QueryProfile& profile() const { return m_profile; }
+
+signals:
+    // 已经执行的时间
+    void progress(double seconds);
+
+protected:
+    void run();
+
+private:
+    static int onProgress(void* arg);
+
+private:
+    QString             m_path;
+    QString             m_sql;
+    bool                m_coldCache;
+    std::atomic<bool>   m_cancel;
+    QueryProfile        m_profile;
+
+    sqlite3*            m_pDb;          // 保留的连接，打开的是m_dbPath
+    QString             m_dbPath;
+    QElapsedTimer       m_timer;
+    qint64              m_lastReport;
+};
+
+#endif // PROFILETHREAD_H
@@ -0,0 +1,163 @@
+#include "ProfileView.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+// 历史中SQL显示的最大长度
+static const int PROFILE_SQL_CHARS = 80;
+
+static QTableWidgetItem* numberItem(double val, int prec = 0)
+{
+    // 按数值排序
+    QTableWidgetItem* item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, prec > 0 ? QString::number(val, 'f', prec).toDouble() : val);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+ProfileView::ProfileView(QWidget *parent)
+    : QWidget(parent)
+{
+    m_pDetails = new QLabel(tr("Press Profile to run a statement and measure it"), this);
+    m_pDetails->setWordWrap(true);
+    m_pDetails->setTextFormat(Qt::RichText);
+    m_pDetails->setAlignment(Qt::AlignTop | Qt::AlignLeft);
+
+    m_pHistory = new QTableWidget(this);
+    m_pHistory->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pHistory->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_pHistory->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_pHistory->setColumnCount(13);
+    m_pHistory->setHorizontalHeaderLabels(QStringList() << tr("#") << tr("Time") << tr("SQL") << tr("Rows")
+                                          << tr("Wall ms") << tr("CPU ms") << tr("VM steps") << tr("Full scan")
+                                          << tr("Sorts") << tr("Autoindex") << tr("Cache hits")
+                                          << tr("Cache misses") << tr("Hit %"));
+    m_pHistory->verticalHeader()->hide();
+
+    QPushButton* clearBtn = new QPushButton(tr("Clear History"), this);
+    QHBoxLayout* bar = new QHBoxLayout;
+    bar->addWidget(new QLabel(tr("History (select a run to compare the latest with it):"), this), 1);
+    bar->addWidget(clearBtn);
+
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->setMargin(0);
+    layout->addWidget(m_pDetails);
+    layout->addLayout(bar);
+    layout->addWidget(m_pHistory, 1);
+    setLayout(layout);
+
+    connect(clearBtn, SIGNAL(clicked()), this, SLOT(clear()));
+    connect(m_pHistory, SIGNAL(itemSelectionChanged()), this, SLOT(onSelectionChanged()));
+}
+
+void ProfileView::AddProfile(const QueryProfile &profile)
+{
+    QueryProfile p = profile;
+    p.columns.clear();
+    p.preview.clear();
+    m_history.push_back(p);
+
+    QString sql = QString::fromStdString(p.sql).simplified();
+    if (sql.size() > PROFILE_SQL_CHARS) sql = sql.left(PROFILE_SQL_CHARS) + "...";
+
+    m_pHistory->setSortingEnabled(false);
+    int row = m_pHistory->rowCount();
+    m_pHistory->insertRow(row);
+    m_pHistory->setItem(row, 0, numberItem(m_history.size()));
+    m_pHistory->setItem(row, 1, new QTableWidgetItem(QDateTime::fromTime_t((uint)p.when).toString("HH:mm:ss")));
+    QTableWidgetItem* sqlItem = new QTableWidgetItem(p.err.empty() ? sql : sql + "  [" + QString::fromStdString(p.err) + "]");
+    sqlItem->setToolTip(QString::fromStdString(p.sql));
+    m_pHistory->setItem(row, 2, sqlItem);
+    m_pHistory->setItem(row, 3, numberItem((double)p.rows));
+    m_pHistory->setItem(row, 4, numberItem(p.wallSeconds * 1000, 2));
+    m_pHistory->setItem(row, 5, numberItem(p.cpuSeconds * 1000, 2));
+    m_pHistory->setItem(row, 6, numberItem((double)p.vmSteps));
+    m_pHistory->setItem(row, 7, numberItem((double)p.fullScanSteps));
+    m_pHistory->setItem(row, 8, numberItem((double)p.sorts));
+    m_pHistory->setItem(row, 9, numberItem((double)p.autoIndex));
+    m_pHistory->setItem(row, 10, numberItem((double)p.cacheHits));
+    m_pHistory->setItem(row, 11, numberItem((double)p.cacheMisses));
+    m_pHistory->setItem(row, 12, numberItem(p.HitRatio() * 100, 1));
+    m_pHistory->setSortingEnabled(true);
+    m_pHistory->clearSelection();
+    m_pHistory->scrollToItem(sqlItem);
+
+    showDetails();
+}
+
+void ProfileView::clear()
+{
+    m_history.clear();
+    m_pHistory->setRowCount(0);
+    m_pDetails->setText(QString());
+}
+
+void ProfileView::onSelectionChanged()
+{
+    showDetails();
+}
+
+// 相对基准的倍数
+static QString ratio(double now, double before)
+{
+    if (before <= 0) return now > 0 ? QString("(new)") : QString();
+    double r = now / before;
+    QString color = r > 1.1 ? "#c00000" : (r < 0.9 ? "#008000" : "#606060");
+    return QString("<font color='%1'>x%2</font>").arg(color).arg(r, 0, 'f', 2);
+}
+
+void ProfileView::showDetails()
+{
+    if (m_history.isEmpty()) return;
+    const QueryProfile& p = m_history.back();
+
+    // 选中的一行(不是最新一次)作为比较的基准
+    const QueryProfile* base = NULL;
+    QList<QTableWidgetItem*> sel = m_pHistory->selectedItems();
+    if (sel.size())
+    {
+        int n = m_pHistory->item(sel[0]->row(), 0)->data(Qt::DisplayRole).toInt();
+        if (n >= 1 && n < m_history.size()) base = &m_history.at(n-1);
+    }
+
+    struct Line { QString name; double now, before; int prec; };
+    Line lines[] = {
+        { tr("Wall time (ms)"), p.wallSeconds * 1000, base ? base->wallSeconds * 1000 : 0, 2 },
+        { tr("CPU time (ms)"), p.cpuSeconds * 1000, base ? base->cpuSeconds * 1000 : 0, 2 },
+        { tr("Rows returned"), (double)p.rows, base ? (double)base->rows : 0, 0 },
+        { tr("Rows changed"), (double)p.changes, base ? (double)base->changes : 0, 0 },
+        { tr("VM steps"), (double)p.vmSteps, base ? (double)base->vmSteps : 0, 0 },
+        { tr("Full scan steps"), (double)p.fullScanSteps, base ? (double)base->fullScanSteps : 0, 0 },
+        { tr("Sorts"), (double)p.sorts, base ? (double)base->sorts : 0, 0 },
+        { tr("Autoindex rows"), (double)p.autoIndex, base ? (double)base->autoIndex : 0, 0 },
+        { tr("Cache hits"), (double)p.cacheHits, base ? (double)base->cacheHits : 0, 0 },
+        { tr("Cache misses"), (double)p.cacheMisses, base ? (double)base->cacheMisses : 0, 0 },
+        { tr("Cache writes"), (double)p.cacheWrites, base ? (double)base->cacheWrites : 0, 0 },
+    };
+
+    QString html = tr("<b>Run #%1</b>, %2 statement(s)").arg(m_history.size()).arg(p.statements);
+    if (base)
+        html += tr(" compared with run #%1").arg(base - m_history.constData() + 1);
+    if (p.err.size())
+        html += QString("<br><font color='#c00000'>%1</font>").arg(QString::fromStdString(p.err).toHtmlEscaped());
+    html += "<table cellspacing='0' cellpadding='1'>";
+    for (size_t i=0; i<sizeof(lines)/sizeof(lines[0]); ++i)
+    {
+        html += QString("<tr><td>%1</td><td align='right'>&nbsp;%2</td>").arg(lines[i].name)
+                .arg(QString::number(lines[i].now, 'f', lines[i].prec));
+        if (base)
+            html += QString("<td align='right'>&nbsp;%1</td><td>&nbsp;%2</td>")
+                    .arg(QString::number(lines[i].before, 'f', lines[i].prec))
+                    .arg(ratio(lines[i].now, lines[i].before));
+        html += "</tr>";
+    }
+    html += "</table>";
+    if (p.fullScanSteps > 0 || p.autoIndex > 0)
+        html += tr("<font color='#c00000'>Full table scans or automatic indexes were used; an index may be missing.</font>");
+    m_pDetails->setText(html);
+}
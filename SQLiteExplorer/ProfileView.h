@@ -0,0 +1,42 @@
+#ifndef PROFILEVIEW_H
+#define PROFILEVIEW_H
+
+#include <QWidget>
+#include <QVector>
+
+#include "SQLite3Profile.h"
+
+class QTableWidget;
+class QLabel;
+
+/*
+** Results of the SQL tab's Profile button.  The latest run is described
+** in full; every run is appended to a history table, and selecting an
+** older run compares the latest one against it, so the effect of an
+** index or a rewritten query shows as before/after ratios.
+*/
+class ProfileView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ProfileView(QWidget *parent = 0);
+
+    void AddProfile(const QueryProfile& profile);
+
+public slots:
+    void clear();
+
+private slots:
+    void onSelectionChanged();
+
+private:
+    void showDetails();
+
+private:
+    QVector<QueryProfile>   m_history;      // 不含结果行
+    QTableWidget*           m_pHistory;
+    QLabel*                 m_pDetails;
+};
+
+#endif // PROFILEVIEW_H
@@ -0,0 +1,105 @@
+#include "RawScanThread.h"
+
+#include <QByteArray>
+
+#include "sqlite3.h"
+
+// 预览中BLOB最多显示的字节数
+static const int RAWSCAN_BLOB_PREVIEW = 32;
+
+RawScanThread::RawScanThread(const QString &path, int pageSize, const RawTable &table, const RawScanOptions &opts,
+                             bool benchmark, int previewRows, QObject *parent)
+    : QThread(parent)
+    , m_path(path)
+    , m_pageSize(pageSize)
+    , m_table(table)
+    , m_opts(opts)
+    , m_benchmark(benchmark)
+    , m_previewRows(previewRows)
+    , m_ok(false)
+{
+
+}
+
+void RawScanThread::cancel()
+{
+    m_scan.Cancel();
+}
+
+void RawScanThread::keepPreview(const RawBatch &batch)
+{
+    const ExportBatch& data = batch.data;
+    if (m_preview.size() >= m_previewRows) return;
+
+    size_t nCol = data.columns.size();
+    vector<size_t> ints(nCol, 0), reals(nCol, 0), lens(nCol, 0), bytes(nCol, 0);
+    for (int r=0; r<data.rows && m_preview.size() < m_previewRows; ++r)
+    {
+        QStringList row;
+        for (size_t c=0; c<nCol; ++c)
+        {
+            const ExportBatch::Column& col = data.columns[c];
+            switch (col.types[r])
+            {
+            case SQLITE_INTEGER:
+                row << QString::number(col.ints[ints[c]++]);
+                break;
+            case SQLITE_FLOAT:
+                row << QString::number(col.reals[reals[c]++], 'g', 17);
+                break;
+            case SQLITE_TEXT:
+            case SQLITE_BLOB:
+            {
+                uint32_t len = col.lens[lens[c]++];
+                const char* p = col.bytes.data() + bytes[c];
+                bytes[c] += len;
+                if (col.types[r] == SQLITE_TEXT)
+                {
+                    row << QString::fromUtf8(p, len);
+                }
+                else
+                {
+                    QByteArray hex = QByteArray(p, qMin<int>(len, RAWSCAN_BLOB_PREVIEW)).toHex();
+                    row << QString("x'%1'%2").arg(QString(hex)).arg(len > (uint32_t)RAWSCAN_BLOB_PREVIEW ? "..." : "");
+                }
+                break;
+            }
+            default:
+                row << QString("NULL");
+                break;
+            }
+        }
+        m_preview << row;
+        m_previewRowids << (qint64)batch.rowids[r];
+    }
+}
+
+void RawScanThread::run()
+{
+    if (!m_scan.Open(m_path.toStdString(), m_pageSize))
+    {
+        m_err = QString::fromStdString(m_scan.GetError());
+        return;
+    }
+
+    m_ok = m_scan.Scan(m_table.root, m_opts,
+        [&](const RawBatch& batch) {
+            keepPreview(batch);
+        },
+        [&](int done, int total) {
+            emit progress(done, total);
+        });
+    m_rawStats = m_scan.GetStats();
+    if (!m_ok)
+    {
+        m_err = QString::fromStdString(m_scan.GetError());
+        return;
+    }
+
+    if (m_benchmark && m_table.name.size())
+    {
+        string err;
+        if (!CSQLite3RawScan::ScanSql(m_path.toStdString(), m_table.name, 4096, nullptr, m_sqlStats, err))
+            m_sqlErr = QString::fromStdString(err);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef RAWSCANTHREAD_H
+#define RAWSCANTHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+#include "SQLite3RawScan.h"
+
+/*
+** Run a CSQLite3RawScan in the background.  The batches are counted and
+** only the first rows are kept for display; in benchmark mode the same
+** table is then read again through sqlite so the two paths can be
+** compared.
+*/
+class RawScanThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    RawScanThread(const QString& path, int pageSize, const RawTable& table, const RawScanOptions& opts,
+                  bool benchmark, int previewRows, QObject* parent = 0);
+
+    // 停止扫描，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_scan.IsCancelled(); }
+    QString error() const { return m_err; }
+
+    const RawScanStats& rawStats() const { return m_rawStats; }
+    // 基准测试时sqlite读同一张表的结果，sqlError非空表示sqlite无法读取
+    const RawScanStats& sqlStats() const { return m_sqlStats; }
+    QString sqlError() const { return m_sqlErr; }
+
+    // 前previewRows行，每个值已转换为文本
+    const QList<QStringList>& preview() const { return m_preview; }
+    const QList<qint64>& previewRowids() const { return m_previewRowids; }
+
+signals:
+    void progress(int done, int total);
+
+protected:
+    void run();
+
+private:
+    void keepPreview(const RawBatch& batch);
+
+private:
+    QString             m_path;
+    int                 m_pageSize;
+    RawTable            m_table;
+    RawScanOptions      m_opts;
+    bool                m_benchmark;
+    int                 m_previewRows;
+
+    bool                m_ok;
+    QString             m_err;
+    RawScanStats        m_rawStats;
+    RawScanStats        m_sqlStats;
+    QString             m_sqlErr;
+    QList<QStringList>  m_preview;
+    QList<qint64>       m_previewRowids;
+    CSQLite3RawScan     m_scan;
+};
+
+#endif // RAWSCANTHREAD_H
@@ -3,8 +3,16 @@
 #include "mainwindow.h"
 #include "qsqlitetableview.h"
 #include "highlighter.h"
+#include "DialogExport.h"
+#include "ProfileView.h"
+#include "PlanView.h"
+#include "ProfileThread.h"
 
 #include <QLayout>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QTabWidget>
+#include <QMessageBox>
 #include <QVBoxLayout>
 
 #include <QTextEdit>
@@ -26,11 +34,48 @@ QSQLiteQueryWindow::QSQLiteQueryWindow(QWidget *parent) :
     connect(ui->pushButton, SIGNAL(clicked(bool)), this, SLOT(onExecuteBtnClicked()));
     connect(ui->pushButton_2, SIGNAL(clicked(bool)), this, SLOT(onExplainBtnClicked()));
 
+    // 把查询结果直接流式写到文件，不经过表格
+    QPushButton* exportBtn = new QPushButton(tr("Export..."), ui->widget);
+    ui->horizontalLayout->insertWidget(ui->horizontalLayout->indexOf(ui->pushButton_2) + 1, exportBtn);
+    connect(exportBtn, SIGNAL(clicked(bool)), this, SLOT(onExportBtnClicked()));
+
+    // 执行到结束并统计，结果显示在表格右边
+    // 在单独的线程和连接上执行，执行中按钮变为Stop
+    m_pProfileBtn = new QPushButton(tr("Profile"), ui->widget);
+    m_pProfileBtn->setToolTip(tr("Run the statement to completion and measure time, VM steps and page cache use"));
+    m_pColdCache = new QCheckBox(tr("Cold cache"), ui->widget);
+    m_pColdCache->setToolTip(tr("Release the profiling connection's page cache before profiling"));
+    ui->horizontalLayout->insertWidget(ui->horizontalLayout->indexOf(exportBtn) + 1, m_pProfileBtn);
+    ui->horizontalLayout->insertWidget(ui->horizontalLayout->indexOf(m_pProfileBtn) + 1, m_pColdCache);
+    connect(m_pProfileBtn, SIGNAL(clicked(bool)), this, SLOT(onProfileBtnClicked()));
+
+    m_pProfileThread = new ProfileThread(this);
+    connect(m_pProfileThread, SIGNAL(progress(double)), this, SLOT(onProfileProgress(double)));
+    connect(m_pProfileThread, SIGNAL(finished()), this, SLOT(onProfileFinished()));
+
+    // EXPLAIN QUERY PLAN的树，标注每一步读的b-tree的大小
+    QPushButton* planBtn = new QPushButton(tr("Query Plan"), ui->widget);
+    planBtn->setToolTip(tr("Show the query plan with the pages, depth and rows of every b-tree it reads"));
+    ui->horizontalLayout->insertWidget(ui->horizontalLayout->indexOf(m_pColdCache) + 1, planBtn);
+    connect(planBtn, SIGNAL(clicked(bool)), this, SLOT(onPlanBtnClicked()));
+
+    m_pProfile = new ProfileView(this);
+    m_pPlan = new PlanView(this);
+    connect(m_pPlan, SIGNAL(pageActivated(int,int)), this, SIGNAL(pageActivated(int,int)));
+    m_pSideTabs = new QTabWidget(this);
+    m_pSideTabs->addTab(m_pProfile, tr("Profile"));
+    m_pSideTabs->addTab(m_pPlan, tr("Query Plan"));
+    m_pResultSplitter = new QSplitter(Qt::Horizontal);
+    m_pResultSplitter->addWidget(m_pTableView);
+    m_pResultSplitter->addWidget(m_pSideTabs);
+    m_pResultSplitter->setStretchFactor(0, 3);
+    m_pResultSplitter->setStretchFactor(1, 2);
+
     // Init Splitter
     m_pSplitter = new QSplitter(Qt::Vertical);
     m_pSplitter->addWidget(ui->textEdit);
     m_pSplitter->addWidget(ui->widget);
-    m_pSplitter->addWidget(m_pTableView);
+    m_pSplitter->addWidget(m_pResultSplitter);
     m_pSplitter->addWidget(ui->widget_2);
 
     m_pSplitter->setStretchFactor(0, 4);
@@ -55,9 +100,23 @@ QSQLiteQueryWindow::QSQLiteQueryWindow(QWidget *parent) :
 
 QSQLiteQueryWindow::~QSQLiteQueryWindow()
 {
+    m_pProfileThread->disconnect(this);
+    m_pProfileThread->cancel();
+    m_pProfileThread->wait();
     delete ui;
 }
 
+void QSQLiteQueryWindow::StopProfile(const QString &path)
+{
+    if (m_pProfileThread->path() != path) return;
+    if (m_pProfileThread->isRunning())
+    {
+        m_pProfileThread->cancel();
+        m_pProfileThread->wait();
+    }
+    m_pProfileThread->closeDatabase();
+}
+
 void QSQLiteQueryWindow::onExecuteBtnClicked()
 {
     QTextCursor cursor = ui->textEdit->textCursor();
@@ -89,6 +148,92 @@ void QSQLiteQueryWindow::onExplainBtnClicked()
     emit signalSQLiteQuery(sql);
 }
 
+void QSQLiteQueryWindow::onExportBtnClicked()
+{
+    QTextCursor cursor = ui->textEdit->textCursor();
+    QString sql = cursor.selectedText();
+    if (sql.size() == 0)
+    {
+        sql = ui->textEdit->toPlainText();
+    }
+
+    CSQLite3DB* pSqlite = m_pParent->GetCurSQLite3DB();
+    if (pSqlite == NULL || sql.trimmed().isEmpty()) return;
+    DialogExport dlg(pSqlite, sql, this);
+    dlg.exec();
+}
+
+QString QSQLiteQueryWindow::currentSql()
+{
+    QString sql = ui->textEdit->textCursor().selectedText();
+    if (sql.size() == 0)
+    {
+        sql = ui->textEdit->toPlainText();
+    }
+    // 选中文本中的换行是U+2029
+    return sql.replace(QChar::ParagraphSeparator, '\n');
+}
+
+void QSQLiteQueryWindow::onProfileBtnClicked()
+{
+    if (m_pProfileThread->isRunning())
+    {
+        m_pProfileThread->cancel();
+        m_pProfileBtn->setEnabled(false);
+        return;
+    }
+
+    QString sql = currentSql();
+    CSQLite3DB* pSqlite = m_pParent->GetCurSQLite3DB();
+    if (pSqlite == NULL || sql.trimmed().isEmpty()) return;
+
+    m_pProfileThread->setQuery(QString::fromStdString(pSqlite->GetPath()), sql, m_pColdCache->isChecked());
+    m_pProfileThread->start();
+    m_pProfileBtn->setText(tr("Stop"));
+    ui->label->setText(tr("Profiling..."));
+}
+
+void QSQLiteQueryWindow::onProfileProgress(double seconds)
+{
+    if (m_pProfileThread->isRunning() && !m_pProfileThread->cancelled())
+        ui->label->setText(tr("Profiling... %1 s").arg(seconds, 0, 'f', 1));
+}
+
+void QSQLiteQueryWindow::onProfileFinished()
+{
+    m_pProfileBtn->setText(tr("Profile"));
+    m_pProfileBtn->setEnabled(true);
+
+    const QueryProfile& profile = m_pProfileThread->profile();
+    m_pTableView->ShowRows(profile.columns, profile.preview);
+    m_pProfile->AddProfile(profile);
+    m_pSideTabs->setCurrentWidget(m_pProfile);
+    if (profile.err.size())
+    {
+        ui->label->setText(QString::fromStdString(profile.err));
+        if (m_pProfileThread->cancelled()) return;
+        QMessageBox::information(this, tr("SQLiteExplorer"), QString::fromStdString(profile.err));
+        return;
+    }
+    ui->label->setText(tr("Profiled: %1 rows in %2 ms, showing the first %3")
+                       .arg((qint64)profile.rows).arg(profile.wallSeconds * 1000, 0, 'f', 2)
+                       .arg(profile.preview.size()));
+}
+
+void QSQLiteQueryWindow::onPlanBtnClicked()
+{
+    QString sql = currentSql();
+    CSQLite3DB* pSqlite = m_pParent->GetCurSQLite3DB();
+    if (pSqlite == NULL || sql.trimmed().isEmpty()) return;
+
+    QueryPlan plan;
+    pSqlite->ExplainQueryPlan(sql.toStdString(), PlanOptions(), plan);
+    m_pPlan->SetPlan(plan);
+    m_pSideTabs->setCurrentWidget(m_pPlan);
+    ui->label->setText(plan.err.empty() ? tr("Query plan of %1 steps").arg(plan.nodes.size())
+                                        : QString::fromStdString(plan.err));
+}
+
 void QSQLiteQueryWindow::onDataLoaded(const QString &msg)
 {
     ui->label->setText(msg);
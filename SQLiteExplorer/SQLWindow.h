@@ -11,6 +11,12 @@ class QSQLiteQueryWindow;
 
 class QSQLiteTableView;
 class MainWindow;
+class ProfileView;
+class PlanView;
+class QCheckBox;
+class QTabWidget;
+class QPushButton;
+class ProfileThread;
 
 class QSQLiteQueryWindow : public QWidget
 {
@@ -20,20 +26,43 @@ public:
     explicit QSQLiteQueryWindow(QWidget *parent = 0);
     ~QSQLiteQueryWindow();
 
+    // 数据库关闭前调用，停止正在进行的性能分析并关闭分析用的连接
+    void StopProfile(const QString& path);
+
 signals:
     void signalSQLiteQuery(const QString& sql);
+    // 双击查询计划中的一步，打开它的b-tree的根页
+    void pageActivated(int pgno, int type);
 
 private slots:
     void onExecuteBtnClicked();
     void onExplainBtnClicked();
+    void onExportBtnClicked();
+    void onProfileBtnClicked();
+    void onProfileProgress(double seconds);
+    void onProfileFinished();
+    void onPlanBtnClicked();
     void onDataLoaded(const QString& msg);
+private:
+    // 选中的文本，没有选中时为全部
+    QString currentSql();
+
 private:
     Ui::QSQLiteQueryWindow *ui;
 
     QSQLiteTableView* m_pTableView;
 
+    // 结果表格右边的性能分析和查询计划
+    QTabWidget*  m_pSideTabs;
+    ProfileView* m_pProfile;
+    PlanView*    m_pPlan;
+    QCheckBox*   m_pColdCache;
+    QPushButton* m_pProfileBtn;
+    ProfileThread* m_pProfileThread;
+
     // QSplitter
     QSplitter* m_pSplitter;
+    QSplitter* m_pResultSplitter;
 
     MainWindow* m_pParent;
     Highlighter* m_pHighLighter;
@@ -0,0 +1,1123 @@
+#include "SQLite3Advisor.h"
+#include "SQLite3File.h"
+#include "Parallel.h"
+
+#include <set>
+#include <random>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <unordered_map>
+
+// 没有统计时自动索引每次探测匹配的行数，与sqlite的默认值相同
+static const double ADVISOR_AUTO_INDEX_ROWS = 10;
+// 候选索引页的填充率
+static const double ADVISOR_FILL = 0.9;
+// 嵌套循环的倍数上限，防止溢出
+static const double ADVISOR_MAX_LOOPS = 1e15;
+// 计划树的最大深度
+static const int ADVISOR_MAX_LEVEL = 64;
+
+enum AdvisorTokenType
+{
+    TK_ID = 0,      // 标识符或关键字
+    TK_LITERAL,     // 字符串、数字、blob和参数
+    TK_OP           // 运算符和标点
+};
+
+struct AdvisorToken
+{
+    int     type;
+    string  text;       // 标识符去掉了引号
+    string  upper;
+};
+
+static string quoteLiteral(const string& text)
+{
+    string s = "'";
+    for (size_t i=0; i<text.size(); ++i)
+    {
+        if (text[i] == '\'') s += '\'';
+        s += text[i];
+    }
+    return s + "'";
+}
+
+static bool isIdChar(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '$' || (unsigned char)c >= 0x80;
+}
+
+static vector<AdvisorToken> tokenize(const string& sql)
+{
+    vector<AdvisorToken> tokens;
+    size_t i = 0, n = sql.size();
+    while (i < n)
+    {
+        char c = sql[i];
+        AdvisorToken tk;
+        size_t end = i + 1;
+        if (isspace((unsigned char)c))
+        {
+            ++i;
+            continue;
+        }
+        else if (c == '-' && i+1 < n && sql[i+1] == '-')
+        {
+            end = sql.find('\n', i);
+            i = end == string::npos ? n : end + 1;
+            continue;
+        }
+        else if (c == '/' && i+1 < n && sql[i+1] == '*')
+        {
+            end = sql.find("*/", i+2);
+            i = end == string::npos ? n : end + 2;
+            continue;
+        }
+        else if (c == '\'' || ((c == 'x' || c == 'X') && i+1 < n && sql[i+1] == '\''))
+        {
+            // 字符串中的''是一个引号
+            end = sql.find('\'', c == '\'' ? i+1 : i+2);
+            while (end != string::npos && end+1 < n && sql[end+1] == '\'')
+                end = sql.find('\'', end+2);
+            end = end == string::npos ? n : end + 1;
+            tk.type = TK_LITERAL;
+        }
+        else if (c == '"' || c == '`' || c == '[')
+        {
+            char close = c == '[' ? ']' : c;
+            end = sql.find(close, i+1);
+            if (end == string::npos) end = n;
+            tk.type = TK_ID;
+            tk.text = sql.substr(i+1, end-i-1);
+            end = std::min(end + 1, n);
+        }
+        else if (isdigit((unsigned char)c) || (c == '.' && i+1 < n && isdigit((unsigned char)sql[i+1])))
+        {
+            while (end < n && (isalnum((unsigned char)sql[end]) || sql[end] == '.'
+                               || ((sql[end] == '+' || sql[end] == '-') && (sql[end-1] == 'e' || sql[end-1] == 'E'))))
+                ++end;
+            tk.type = TK_LITERAL;
+        }
+        else if (c == '?' || c == ':' || c == '@' || (c == '$' && i+1 < n && isIdChar(sql[i+1])))
+        {
+            while (end < n && isIdChar(sql[end])) ++end;
+            tk.type = TK_LITERAL;
+        }
+        else if (isIdChar(c))
+        {
+            while (end < n && isIdChar(sql[end])) ++end;
+            tk.type = TK_ID;
+        }
+        else
+        {
+            static const char* ops[] = { "==", "!=", "<>", "<=", ">=", "||", "<<", ">>", NULL };
+            for (int k=0; ops[k]; ++k)
+            {
+                if (sql.compare(i, 2, ops[k]) == 0) end = i + 2;
+            }
+            tk.type = TK_OP;
+        }
+        if (tk.text.empty()) tk.text = sql.substr(i, end-i);
+        tk.upper = tk.type == TK_ID ? StrUpper(tk.text) : tk.text;
+        tokens.push_back(tk);
+        i = end;
+    }
+    return tokens;
+}
+
+// 不能作为别名的关键字
+static bool isClauseKeyword(const string& up)
+{
+    static const char* words[] = {
+        "WHERE", "JOIN", "ON", "LEFT", "RIGHT", "FULL", "INNER", "OUTER", "CROSS", "NATURAL",
+        "USING", "GROUP", "ORDER", "LIMIT", "UNION", "INTERSECT", "EXCEPT", "SET", "INDEXED",
+        "NOT", "WINDOW", "HAVING", "VALUES", "SELECT", "DEFAULT", "RETURNING", "AND", "OR",
+        "AS", "FROM", "DO", NULL
+    };
+    for (int i=0; words[i]; ++i)
+    {
+        if (up == words[i]) return true;
+    }
+    return false;
+}
+
+CSQLite3Advisor::CSQLite3Advisor()
+    : m_cancel(false)
+{
+}
+
+void CSQLite3Advisor::Cancel()
+{
+    m_cancel = true;
+    m_scan.Cancel();
+}
+
+bool CSQLite3Advisor::ReadFile(const string &path, string &text, string &err)
+{
+    FILE* fp = CSQLite3File::OpenFile(path, "rb");
+    if (fp == NULL)
+    {
+        err = "cannot open " + path;
+        return false;
+    }
+    text.clear();
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        text.append(buf, n);
+    }
+    fclose(fp);
+    // UTF-8的BOM
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3);
+    return true;
+}
+
+vector<string> CSQLite3Advisor::SplitStatements(const string &text)
+{
+    vector<string> stmts;
+    size_t start = 0;
+    for (size_t i=0; i<=text.size(); ++i)
+    {
+        if (i < text.size() && text[i] != ';') continue;
+        string sql = text.substr(start, i < text.size() ? i+1-start : i-start);
+        // 分号在字符串、注释或触发器中时继续
+        if (i < text.size() && !sqlite3_complete(sql.c_str())) continue;
+        start = i + 1;
+
+        vector<AdvisorToken> tokens = tokenize(sql);
+        bool empty = true;
+        for (auto it=tokens.begin(); it!=tokens.end(); ++it)
+        {
+            if (it->text != ";") empty = false;
+        }
+        if (empty) continue;
+        // 去掉前面的空白和注释
+        size_t b = 0;
+        for (;;)
+        {
+            b = sql.find_first_not_of(" \t\r\n", b);
+            if (sql.compare(b, 2, "--") == 0)
+                b = sql.find('\n', b);
+            else if (sql.compare(b, 2, "/*") == 0)
+                b = sql.find("*/", b) + 2;
+            else
+                break;
+        }
+        size_t e = sql.find_last_not_of(" \t\r\n;");
+        stmts.push_back(sql.substr(b, e == string::npos || e < b ? string::npos : e-b+1));
+    }
+    return stmts;
+}
+
+string CSQLite3Advisor::Normalize(const string &sql)
+{
+    vector<AdvisorToken> tokens = tokenize(sql);
+    vector<string> out;
+    for (auto it=tokens.begin(); it!=tokens.end(); ++it)
+    {
+        if (it->text == ";") continue;
+        if (it->type == TK_LITERAL)
+        {
+            // IN列表的长度不同也算相同的语句
+            if (out.size() >= 2 && out.back() == "," && out[out.size()-2] == "?")
+            {
+                out.pop_back();
+                continue;
+            }
+            out.push_back("?");
+            continue;
+        }
+        out.push_back(it->upper);
+    }
+    string s;
+    for (size_t i=0; i<out.size(); ++i)
+    {
+        if (i > 0) s += ' ';
+        s += out[i];
+    }
+    return s;
+}
+
+/*
+** Find what a statement would like indexed.  Tables are bound to their
+** aliases from the FROM clauses; a column in a WHERE, ON or HAVING
+** clause next to =, ==, IS or IN is an equality column, next to <, >,
+** <=, >= or BETWEEN a range column, and the columns of ORDER BY or
+** GROUP BY are kept when they all belong to one table.  This is token
+** matching, not parsing, so it can miss columns but never invents
+** ones the table does not have.
+*/
+void CSQLite3Advisor::ParseStatement(const CSQLite3Schema &schema, const AdvisorOptions &opts,
+                                     const string &sql, StatementInfo &info) const
+{
+    vector<AdvisorToken> tk = tokenize(sql);
+    int n = (int)tk.size();
+    if (n == 0) return;
+
+    // 别名(小写) -> 表
+    std::map<string, const SchemaObject*> aliases;
+    vector<const SchemaObject*> tables;
+    for (int i=0; i<n; ++i)
+    {
+        if (tk[i].type != TK_ID) continue;
+        if (i > 0 && tk[i-1].text == "." && !(i > 1 && tk[i-2].upper == "MAIN")) continue;
+        if (i+1 < n && tk[i+1].text == ".") continue;
+        const SchemaObject* obj = schema.Find(tk[i].text);
+        if (obj == NULL || obj->type != "table" || obj->rootpage <= 0) continue;
+        if (std::find(tables.begin(), tables.end(), obj) == tables.end())
+            tables.push_back(obj);
+        aliases[StrLower(tk[i].text)] = obj;
+        int j = i + 1;
+        if (j < n && tk[j].upper == "AS") ++j;
+        if (j < n && tk[j].type == TK_ID && !isClauseKeyword(tk[j].upper))
+            aliases[StrLower(tk[j].text)] = obj;
+    }
+
+    // 写入的表
+    const string& first = tk[0].upper;
+    if (first == "INSERT" || first == "REPLACE" || first == "UPDATE" || first == "DELETE")
+    {
+        for (int i=1; i<n; ++i)
+        {
+            const SchemaObject* obj = tk[i].type == TK_ID ? schema.Find(tk[i].text) : NULL;
+            if (obj == NULL || obj->type != "table") continue;
+            info.writeTable = obj->name;
+            info.insert = first != "UPDATE" && first != "DELETE";
+            break;
+        }
+        if (first == "UPDATE")
+        {
+            int depth = 0;
+            bool inSet = false;
+            for (int i=1; i<n; ++i)
+            {
+                if (tk[i].text == "(") depth++;
+                else if (tk[i].text == ")") depth--;
+                else if (depth == 0 && tk[i].upper == "SET") inSet = true;
+                else if (depth == 0 && (tk[i].upper == "WHERE" || tk[i].upper == "FROM" || tk[i].upper == "RETURNING")) inSet = false;
+                else if (inSet && depth == 0 && tk[i].type == TK_ID && i+1 < n && tk[i+1].text == "=")
+                    info.setColumns.push_back(StrLower(tk[i].text));
+            }
+        }
+    }
+
+    // 每张表的等值列、范围列和排序列
+    std::map<const SchemaObject*, vector<string> > eqCols, rangeCols, orderCols;
+    enum { CLAUSE_OTHER, CLAUSE_FILTER, CLAUSE_ORDER } clause = CLAUSE_OTHER;
+    for (int i=0; i<n; ++i)
+    {
+        const string& up = tk[i].upper;
+        if (tk[i].type == TK_ID)
+        {
+            if (up == "WHERE" || up == "ON" || up == "HAVING") { clause = CLAUSE_FILTER; continue; }
+            if ((up == "ORDER" || up == "GROUP") && i+1 < n && tk[i+1].upper == "BY") { clause = CLAUSE_ORDER; ++i; continue; }
+            if (up == "SELECT" || up == "FROM" || up == "LIMIT" || up == "SET" || up == "UNION"
+                || up == "VALUES" || up == "JOIN" || up == "WINDOW" || up == "RETURNING")
+            {
+                clause = CLAUSE_OTHER;
+                continue;
+            }
+        }
+        if (clause == CLAUSE_OTHER || tk[i].type != TK_ID) continue;
+        if (i+1 < n && tk[i+1].text == "(") continue;     // 函数
+
+        // [限定名.]列名
+        const SchemaObject* obj = NULL;
+        string col;
+        int end = i + 1;
+        if (i+2 < n && tk[i+1].text == "." && tk[i+2].type == TK_ID)
+        {
+            auto a = aliases.find(StrLower(tk[i].text));
+            if (a != aliases.end()) obj = a->second;
+            col = tk[i+2].text;
+            end = i + 3;
+        }
+        else
+        {
+            col = tk[i].text;
+            for (auto t=tables.begin(); t!=tables.end() && obj == NULL; ++t)
+            {
+                for (auto c=(*t)->columns.begin(); c!=(*t)->columns.end(); ++c)
+                {
+                    if (StrLower(c->name) == StrLower(col)) { obj = *t; break; }
+                }
+            }
+        }
+        int prev = i - 1;
+        i = end - 1;
+        if (obj == NULL) continue;
+
+        const SchemaColumn* found = NULL;
+        for (auto c=obj->columns.begin(); c!=obj->columns.end(); ++c)
+        {
+            if (StrLower(c->name) == StrLower(col)) found = &*c;
+        }
+        // rowid别名不需要索引
+        const SchemaColumn* ipk = obj->Field(obj->ipk);
+        if (found == NULL || found == ipk) continue;
+        string name = found->name;
+
+        if (clause == CLAUSE_ORDER)
+        {
+            orderCols[obj].push_back(name);
+            continue;
+        }
+        string next = end < n ? tk[end].upper : string();
+        string before = prev >= 0 ? tk[prev].upper : string();
+        bool notNext = end+1 < n && tk[end+1].upper == "NOT";
+        if (next == "=" || next == "==" || next == "IN" || (next == "IS" && !notNext)
+            || before == "=" || before == "==")
+            eqCols[obj].push_back(name);
+        else if (next == "<" || next == ">" || next == "<=" || next == ">=" || next == "BETWEEN"
+                 || before == "<" || before == ">" || before == "<=" || before == ">=")
+            rangeCols[obj].push_back(name);
+    }
+
+    // 只有一张表的ORDER BY可以用索引
+    if (orderCols.size() > 1) orderCols.clear();
+
+    for (auto t=tables.begin(); t!=tables.end(); ++t)
+    {
+        vector<string> eq;
+        for (auto c=eqCols[*t].begin(); c!=eqCols[*t].end(); ++c)
+        {
+            if (std::find(eq.begin(), eq.end(), *c) == eq.end() && (int)eq.size() < opts.maxColumns)
+                eq.push_back(*c);
+        }
+        vector<vector<string> > wanted;
+        if (!eq.empty()) wanted.push_back(eq);
+        for (auto c=rangeCols[*t].begin(); c!=rangeCols[*t].end(); ++c)
+        {
+            if (std::find(eq.begin(), eq.end(), *c) != eq.end() || (int)eq.size() >= opts.maxColumns) continue;
+            vector<string> cols = eq;
+            cols.push_back(*c);
+            wanted.push_back(cols);
+        }
+        if (!orderCols[*t].empty())
+        {
+            vector<string> cols = eq;
+            for (auto c=orderCols[*t].begin(); c!=orderCols[*t].end(); ++c)
+            {
+                if (std::find(cols.begin(), cols.end(), *c) == cols.end() && (int)cols.size() < opts.maxColumns)
+                    cols.push_back(*c);
+            }
+            if (cols.size() > eq.size()) wanted.push_back(cols);
+        }
+        for (auto w=wanted.begin(); w!=wanted.end(); ++w)
+        {
+            info.wanted.push_back(std::make_pair((*t)->name, *w));
+        }
+    }
+}
+
+/*
+** Page count, depth and entries of every b-tree from the page decoder,
+** small trees walked exactly and large ones estimated, and the
+** database's own sqlite_stat1 rows.
+*/
+void CSQLite3Advisor::MeasureBtrees(const CSQLite3Schema &schema)
+{
+    const vector<SchemaObject>& objects = schema.Objects();
+    vector<BtreeInfo> infos(objects.size());
+    ParallelFor((int64_t)objects.size(), 1, [&](int64_t begin, int64_t end) {
+        for (int64_t i=begin; i<end && !m_cancel; ++i)
+        {
+            if (objects[i].rootpage <= 1) continue;
+            RawBtreeStats stats;
+            m_scan.Estimate(objects[i].rootpage, 16, stats);
+            if (stats.pages <= 5000) m_scan.Analyze(objects[i].rootpage, stats);
+            infos[i].pages = stats.pages;
+            infos[i].leaves = stats.leaves;
+            infos[i].entries = stats.entries;
+            infos[i].depth = stats.depth;
+        }
+    });
+    for (size_t i=0; i<objects.size(); ++i)
+    {
+        if (objects[i].rootpage > 1) m_btrees[StrLower(objects[i].name)] = infos[i];
+    }
+
+    sqlite3* db = NULL;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_open_v2(m_path.c_str(), &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK
+        && sqlite3_prepare_v2(db, "SELECT idx, stat FROM sqlite_stat1 WHERE idx IS NOT NULL", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char* idx = (const char*)sqlite3_column_text(stmt, 0);
+            const char* stat = (const char*)sqlite3_column_text(stmt, 1);
+            auto it = m_btrees.find(StrLower(idx ? idx : ""));
+            if (it == m_btrees.end() || stat == NULL) continue;
+            char* p = (char*)stat;
+            while (isdigit((unsigned char)*p))
+            {
+                it->second.stat1.push_back(strtod(p, &p));
+                while (*p == ' ') ++p;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
+
+void CSQLite3Advisor::GenerateCandidates(const CSQLite3Schema &schema, const AdvisorOptions &opts)
+{
+    // 现有索引的键列，候选是其前缀时没有意义
+    std::map<string, vector<vector<string> > > existing;
+    const vector<SchemaObject>& objects = schema.Objects();
+    for (auto it=objects.begin(); it!=objects.end(); ++it)
+    {
+        vector<string> cols;
+        if (it->type == "index")
+        {
+            for (auto c=it->columns.begin(); c!=it->columns.end(); ++c)
+            {
+                if (c->key) cols.push_back(StrLower(c->name));
+            }
+        }
+        else if (it->type == "table" && it->withoutRowid)
+        {
+            for (auto f=it->fields.begin(); f!=it->fields.end(); ++f)
+            {
+                if (it->columns[*f].pk > 0) cols.push_back(StrLower(it->columns[*f].name));
+            }
+        }
+        if (!cols.empty()) existing[StrLower(it->tblName)].push_back(cols);
+    }
+
+    std::set<string> names;
+    for (size_t s=0; s<m_statements.size(); ++s)
+    {
+        ParseStatement(schema, opts, m_statements[s].sql, m_infos[s]);
+        for (auto w=m_infos[s].wanted.begin(); w!=m_infos[s].wanted.end(); ++w)
+        {
+            vector<string> key;
+            for (auto c=w->second.begin(); c!=w->second.end(); ++c)
+                key.push_back(StrLower(*c));
+
+            bool covered = false;
+            const vector<vector<string> >& have = existing[StrLower(w->first)];
+            for (auto h=have.begin(); h!=have.end() && !covered; ++h)
+            {
+                covered = h->size() >= key.size() && std::equal(key.begin(), key.end(), h->begin());
+            }
+            for (auto c=m_candidates.begin(); c!=m_candidates.end() && !covered; ++c)
+            {
+                if (StrLower(c->table) != StrLower(w->first) || c->columns.size() != key.size()) continue;
+                covered = true;
+                for (size_t k=0; k<key.size(); ++k)
+                    if (StrLower(c->columns[k]) != key[k]) covered = false;
+            }
+            if (covered) continue;
+
+            IndexCandidate cand;
+            cand.table = w->first;
+            cand.columns = w->second;
+            for (int n=(int)m_candidates.size()+1; ; ++n)
+            {
+                cand.name = w->first + "_idx_" + std::to_string(n);
+                if (schema.Find(cand.name) == NULL && names.count(StrLower(cand.name)) == 0) break;
+            }
+            names.insert(StrLower(cand.name));
+            cand.ddl = "CREATE INDEX " + QuoteName(cand.name) + " ON " + QuoteName(cand.table) + "(";
+            for (size_t k=0; k<cand.columns.size(); ++k)
+                cand.ddl += (k > 0 ? ", " : "") + QuoteName(cand.columns[k]);
+            cand.ddl += ")";
+            m_candidates.push_back(cand);
+        }
+    }
+}
+
+// 一个值在sample中的键和在记录中大致的字节数
+static string sampleValue(sqlite3_stmt* stmt, int i, double& bytes)
+{
+    switch (sqlite3_column_type(stmt, i))
+    {
+    case SQLITE_NULL:
+        bytes = 0;
+        return "n";
+    case SQLITE_INTEGER:
+    {
+        int64_t v = sqlite3_column_int64(stmt, i);
+        uint64_t a = v < 0 ? ~(uint64_t)v : (uint64_t)v;
+        bytes = a < 0x80 ? 1 : a < 0x8000 ? 2 : a < 0x800000 ? 3 : a < 0x80000000ULL ? 4 : a < 0x800000000000ULL ? 6 : 8;
+        return "i" + std::to_string(v);
+    }
+    case SQLITE_FLOAT:
+        bytes = 8;
+        return "r" + string((const char*)sqlite3_column_text(stmt, i));
+    default:
+    {
+        const char* p = (const char*)sqlite3_column_blob(stmt, i);
+        int len = sqlite3_column_bytes(stmt, i);
+        bytes = len;
+        return "t" + string(p ? p : "", len);
+    }
+    }
+}
+
+/*
+** sqlite_stat1 numbers for an index on the sampled columns: the row
+** count, then the average number of rows per distinct value of each
+** prefix.  The distinct count of a prefix is scaled from the sample with
+** the GEE estimator, sqrt(N/n)*f1 + (d - f1), where f1 is the number of
+** values seen once.
+*/
+static vector<double> sampleStat(const vector<vector<string> >& rows, const vector<int>& cols, int64_t nRow)
+{
+    vector<double> stat;
+    double N = (double)std::max<int64_t>(nRow, 1);
+    double n = (double)rows.size();
+    stat.push_back(N);
+    for (size_t k=1; k<=cols.size(); ++k)
+    {
+        std::unordered_map<string, int> freq;
+        for (auto r=rows.begin(); r!=rows.end(); ++r)
+        {
+            string key;
+            for (size_t j=0; j<k; ++j)
+            {
+                key += (*r)[cols[j]];
+                key += '\x1f';
+            }
+            freq[key]++;
+        }
+        double d = (double)freq.size(), f1 = 0;
+        for (auto f=freq.begin(); f!=freq.end(); ++f)
+        {
+            if (f->second == 1) f1++;
+        }
+        double D = n >= N || n == 0 ? d : std::sqrt(N / n) * f1 + (d - f1);
+        stat.push_back(std::max(1.0, std::ceil(N / std::max(D, 1.0))));
+    }
+    return stat;
+}
+
+/*
+** Sample the tables that have candidates, reading only the columns the
+** candidates and the unanalysed existing indexes need.  A rowid table is
+** sampled by seeking to random rowids between its smallest and largest
+** one, which costs a root-to-leaf descent per row; a WITHOUT ROWID table
+** by its first rows.  The sample gives the stat1 numbers and the key
+** size from which the size of a candidate is estimated.
+*/
+void CSQLite3Advisor::SampleTables(const CSQLite3Schema &schema, const AdvisorOptions &opts,
+                                   const std::function<void()> &tick)
+{
+    vector<string> tables;
+    for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+    {
+        if (std::find(tables.begin(), tables.end(), c->table) == tables.end())
+            tables.push_back(c->table);
+    }
+
+    // 要读的列：候选的列和没有stat1的现有索引的列
+    vector<vector<string> > columns(tables.size());
+    vector<vector<const SchemaObject*> > analyse(tables.size());
+    vector<BtreeInfo> tableInfos(tables.size());
+    const vector<SchemaObject>& objects = schema.Objects();
+    for (size_t t=0; t<tables.size(); ++t)
+    {
+        vector<string>& cols = columns[t];
+        tableInfos[t] = m_btrees[StrLower(tables[t])];
+        for (auto it=objects.begin(); it!=objects.end(); ++it)
+        {
+            if (it->type != "index" || StrLower(it->tblName) != StrLower(tables[t])) continue;
+            auto b = m_btrees.find(StrLower(it->name));
+            if (b != m_btrees.end() && !b->second.stat1.empty()) continue;
+            bool named = true;
+            for (auto c=it->columns.begin(); c!=it->columns.end(); ++c)
+                if (c->key && c->name.empty()) named = false;
+            if (!named) continue;
+            analyse[t].push_back(&*it);
+            for (auto c=it->columns.begin(); c!=it->columns.end(); ++c)
+                if (c->key && std::find(cols.begin(), cols.end(), c->name) == cols.end()) cols.push_back(c->name);
+        }
+        for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+        {
+            if (c->table != tables[t]) continue;
+            for (auto k=c->columns.begin(); k!=c->columns.end(); ++k)
+                if (std::find(cols.begin(), cols.end(), *k) == cols.end()) cols.push_back(*k);
+        }
+    }
+
+    std::mutex mutex;
+    int usable = std::max(512, m_scan.PageSize());
+    ParallelFor((int64_t)tables.size(), 1, [&](int64_t begin, int64_t end) {
+        sqlite3* db = NULL;
+        if (sqlite3_open_v2(m_path.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+        {
+            sqlite3_close(db);
+            return;
+        }
+        for (int64_t t=begin; t<end && !m_cancel; ++t)
+        {
+            const SchemaObject* table = schema.Find(tables[t]);
+            if (table == NULL) continue;
+            const BtreeInfo& tableInfo = tableInfos[t];
+            const vector<string>& cols = columns[t];
+            const vector<const SchemaObject*>& indexes = analyse[t];
+
+            string list;
+            for (size_t i=0; i<cols.size(); ++i)
+                list += (i > 0 ? ", " : "") + QuoteName(cols[i]);
+            string from = " FROM " + QuoteName(table->name);
+
+            bool seek = !table->withoutRowid && tableInfo.entries > opts.sampleRows;
+            int64_t lo = 0, hi = 0;
+            sqlite3_stmt* stmt = NULL;
+            if (seek && sqlite3_prepare_v2(db, ("SELECT min(rowid), max(rowid)" + from).c_str(), -1, &stmt, NULL) == SQLITE_OK
+                && sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                lo = sqlite3_column_int64(stmt, 0);
+                hi = sqlite3_column_int64(stmt, 1);
+            }
+            sqlite3_finalize(stmt);
+            stmt = NULL;
+            string sql = "SELECT " + list + from;
+            if (seek)
+                sql += " WHERE rowid >= ?1 LIMIT 1";
+            else
+                sql += " LIMIT " + std::to_string(opts.sampleRows);
+
+            vector<vector<string> > rows;
+            vector<double> bytes(cols.size(), 0);
+            if (!cols.empty() && sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK)
+            {
+                std::mt19937_64 rng(std::hash<string>()(table->name));
+                for (int r=0; r<(seek ? opts.sampleRows : 1) && !m_cancel; ++r)
+                {
+                    if (seek)
+                    {
+                        uint64_t span = (uint64_t)(hi - lo) + 1;
+                        sqlite3_bind_int64(stmt, 1, lo + (int64_t)(span ? rng() % span : rng()));
+                    }
+                    while (sqlite3_step(stmt) == SQLITE_ROW)
+                    {
+                        vector<string> row(cols.size());
+                        for (size_t i=0; i<cols.size(); ++i)
+                        {
+                            double b;
+                            row[i] = sampleValue(stmt, (int)i, b);
+                            bytes[i] += b;
+                        }
+                        rows.push_back(row);
+                    }
+                    sqlite3_reset(stmt);
+                }
+            }
+            sqlite3_finalize(stmt);
+            for (size_t i=0; i<bytes.size(); ++i)
+                bytes[i] = rows.empty() ? 8 : bytes[i] / rows.size();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it=indexes.begin(); it!=indexes.end(); ++it)
+            {
+                vector<int> pos;
+                for (auto c=(*it)->columns.begin(); c!=(*it)->columns.end(); ++c)
+                    if (c->key) pos.push_back((int)(std::find(cols.begin(), cols.end(), c->name) - cols.begin()));
+                if (!rows.empty()) m_btrees[StrLower((*it)->name)].stat1 = sampleStat(rows, pos, tableInfo.entries);
+            }
+            for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+            {
+                if (c->table != table->name) continue;
+                vector<int> pos;
+                double keyBytes = 4 + 1 + c->columns.size();
+                for (auto k=c->columns.begin(); k!=c->columns.end(); ++k)
+                {
+                    int p = (int)(std::find(cols.begin(), cols.end(), *k) - cols.begin());
+                    pos.push_back(p);
+                    keyBytes += bytes[p];
+                }
+
+                // 按键的大小估计叶子数和层数
+                BtreeInfo info;
+                info.entries = tableInfo.entries;
+                info.leaves = std::max<int64_t>(1, (int64_t)std::ceil(info.entries * (keyBytes + 3) / (usable * ADVISOR_FILL)));
+                double fanout = std::max(2.0, usable / (keyBytes + 6));
+                info.pages = info.leaves;
+                info.depth = 1;
+                for (double level=(double)info.leaves; level > 1; ++info.depth)
+                {
+                    level = std::ceil(level / fanout);
+                    info.pages += (int64_t)level;
+                }
+                if (!rows.empty()) info.stat1 = sampleStat(rows, pos, tableInfo.entries);
+                m_btrees[StrLower(c->name)] = info;
+                c->estPages = info.pages;
+            }
+            tick();
+        }
+        sqlite3_close(db);
+    }, opts.nThreads);
+}
+
+/*
+** An in-memory database with the schema of the real one, the candidates
+** if asked for, and sqlite_stat1 rows describing the real data, loaded
+** with ANALYZE sqlite_master.  Objects the copy cannot create (virtual
+** tables of modules it lacks) are left out.
+*/
+bool CSQLite3Advisor::BuildCopy(CppSQLite3DB &db, bool withCandidates, const CSQLite3Schema &schema,
+                                CSQLite3Schema &copy) const
+{
+    try
+    {
+        db.open(":memory:");
+    }
+    catch (CppSQLite3Exception&)
+    {
+        return false;
+    }
+
+    vector<string> ddl = m_schemaDdl;
+    if (withCandidates)
+    {
+        for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+            ddl.push_back(c->ddl);
+    }
+    ddl.push_back("ANALYZE");
+    ddl.insert(ddl.end(), m_statDml.begin(), m_statDml.end());
+    ddl.push_back("ANALYZE sqlite_master");
+    for (auto it=ddl.begin(); it!=ddl.end(); ++it)
+    {
+        try
+        {
+            db.execDML(it->c_str());
+        }
+        catch (CppSQLite3Exception&)
+        {
+        }
+    }
+
+    // 副本中的根页号与原库不同，按名称取原库的WITHOUT ROWID
+    std::map<int, int> types;
+    try
+    {
+        CppSQLite3Query q = db.execQuery("SELECT name, rootpage FROM sqlite_master WHERE type='table'");
+        while (!q.eof())
+        {
+            const SchemaObject* obj = schema.Find(q.getStringField(0));
+            types[q.getIntField(1)] = obj != NULL && obj->withoutRowid ? 2 : 13;
+            q.nextRow();
+        }
+    }
+    catch (CppSQLite3Exception&)
+    {
+        return false;
+    }
+    return copy.Load(db, [&](int pgno) {
+        auto it = types.find(pgno);
+        return it == types.end() ? 0 : it->second;
+    });
+}
+
+// 把副本中的b-tree换成原库或候选索引的统计，再估计行数
+void CSQLite3Advisor::Annotate(const CSQLite3Schema &copy, QueryPlan &plan) const
+{
+    for (auto it=plan.nodes.begin(); it!=plan.nodes.end(); ++it)
+    {
+        if (it->btree.empty()) continue;
+        auto b = m_btrees.find(StrLower(it->btree));
+        if (b == m_btrees.end()) continue;
+        it->stats.pages = b->second.pages;
+        it->stats.leaves = b->second.leaves;
+        it->stats.entries = b->second.entries;
+        it->stats.depth = b->second.depth;
+        CSQLite3QueryPlan::EstimateRows(b->second.stat1.empty() ? NULL : &b->second.stat1,
+                                        copy.Find(it->btree), *it);
+    }
+}
+
+/*
+** Pages one run of a step reads: a scan reads the whole b-tree, a
+** search descends once and reads the leaves holding its rows, and an
+** index that does not cover the query adds a descent of the table per
+** row.
+*/
+double CSQLite3Advisor::StepCost(const PlanNode &node) const
+{
+    auto b = m_btrees.find(StrLower(node.btree));
+    if (b == m_btrees.end()) return 0;
+    const BtreeInfo& info = b->second;
+    double rows = std::max(node.estRows, 0.0);
+    double perLeaf = info.leaves > 0 ? std::max(1.0, (double)info.entries / info.leaves) : 1;
+
+    double cost = node.op == "SCAN" ? (double)info.pages : info.depth + rows / perLeaf;
+    if (!node.index.empty() && !node.covering)
+    {
+        auto t = m_btrees.find(StrLower(node.table));
+        cost += rows * (t == m_btrees.end() ? 1 : t->second.depth);
+    }
+    return cost;
+}
+
+/*
+** Steps at the same level are nested loops, outermost first, so each
+** step runs once per row of the steps before it.  Subqueries run once,
+** or once per outer row when correlated; an automatic index costs a scan
+** of its table to build, once.
+*/
+double CSQLite3Advisor::PlanCost(const QueryPlan &plan, const vector<int> &ids, double loops, int level) const
+{
+    if (level > ADVISOR_MAX_LEVEL) return 0;
+    double total = 0, mult = loops;
+    for (auto it=ids.begin(); it!=ids.end(); ++it)
+    {
+        const PlanNode& node = plan.nodes[*it];
+        if (node.automaticIndex)
+        {
+            auto t = m_btrees.find(StrLower(node.table));
+            total += t == m_btrees.end() ? 0 : (double)t->second.pages;
+            total += mult;
+            mult = std::min(mult * ADVISOR_AUTO_INDEX_ROWS, ADVISOR_MAX_LOOPS);
+        }
+        else if (node.root > 0 && (node.op == "SCAN" || node.op == "SEARCH"))
+        {
+            total += mult * StepCost(node);
+            mult = std::min(mult * std::max(node.estRows, 1.0), ADVISOR_MAX_LOOPS);
+        }
+        else
+        {
+            bool correlated = node.detail.find("CORRELATED") != string::npos;
+            total += PlanCost(plan, node.children, correlated ? mult : loops, level + 1);
+        }
+    }
+    return total;
+}
+
+static string planText(const QueryPlan& plan, const vector<int>& ids, int level)
+{
+    string text;
+    if (level > ADVISOR_MAX_LEVEL) return text;
+    for (auto it=ids.begin(); it!=ids.end(); ++it)
+    {
+        text += string(level * 2, ' ') + plan.nodes[*it].detail + "\n";
+        text += planText(plan, plan.nodes[*it].children, level + 1);
+    }
+    return text;
+}
+
+// 可以取得连接句柄的CppSQLite3DB
+class CAdvisorCopy : public CppSQLite3DB
+{
+public:
+    sqlite3* Handle() { return mpDB; }
+};
+
+void CSQLite3Advisor::Evaluate(const CSQLite3Schema &schema, const AdvisorOptions &opts,
+                               const std::function<void()> &tick)
+{
+    int nThreads = opts.nThreads > 0 ? opts.nThreads : ParallelThreadCount();
+    int64_t n = (int64_t)m_statements.size();
+    int64_t grain = std::max<int64_t>(1, n / (nThreads * 4));
+    std::set<string> candidateNames;
+    for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+        candidateNames.insert(StrLower(c->name));
+
+    ParallelFor(n, grain, [&](int64_t begin, int64_t end) {
+        CAdvisorCopy base, what;
+        CSQLite3Schema baseSchema, whatSchema;
+        bool ok = BuildCopy(base, false, schema, baseSchema) && BuildCopy(what, true, schema, whatSchema);
+        PlanOptions po;
+        po.annotate = false;
+        for (int64_t i=begin; i<end && !m_cancel; ++i)
+        {
+            AdvisorStatement& st = m_statements[i];
+            QueryPlan before, after;
+            if (!ok)
+            {
+                st.err = "cannot build the in-memory copy of the schema";
+            }
+            else if (!CSQLite3QueryPlan::Explain(base.Handle(), baseSchema, string(), st.sql, po, before))
+            {
+                st.err = before.err;
+            }
+            else if (!CSQLite3QueryPlan::Explain(what.Handle(), whatSchema, string(), st.sql, po, after))
+            {
+                st.err = after.err;
+            }
+            else
+            {
+                Annotate(baseSchema, before);
+                Annotate(whatSchema, after);
+                st.baseCost = PlanCost(before, before.roots, 1, 0);
+                st.newCost = PlanCost(after, after.roots, 1, 0);
+                st.basePlan = planText(before, before.roots, 0);
+                st.newPlan = planText(after, after.roots, 0);
+                for (auto it=after.nodes.begin(); it!=after.nodes.end(); ++it)
+                {
+                    if (candidateNames.count(StrLower(it->index))
+                        && std::find(st.indexes.begin(), st.indexes.end(), it->index) == st.indexes.end())
+                        st.indexes.push_back(it->index);
+                }
+                // 修改的行数取第一步
+                for (auto it=before.nodes.begin(); it!=before.nodes.end(); ++it)
+                {
+                    if (it->estRows < 0) continue;
+                    m_infos[i].writeRows = m_infos[i].insert ? 1 : std::max(1.0, it->estRows);
+                    break;
+                }
+            }
+            tick();
+        }
+    }, nThreads);
+}
+
+/*
+** Credit each candidate with the pages saved by the statements whose new
+** plan uses it (shared evenly when a plan uses several), and charge it a
+** descent and a leaf write per row for every write of its table in the
+** workload, per UPDATE only when its columns are set.
+*/
+void CSQLite3Advisor::Rank()
+{
+    std::map<string, IndexCandidate*> byName;
+    for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+        byName[StrLower(c->name)] = &*c;
+
+    for (size_t s=0; s<m_statements.size(); ++s)
+    {
+        const AdvisorStatement& st = m_statements[s];
+        if (!st.err.empty()) continue;
+        if (!st.indexes.empty() && st.Saved() > 0)
+        {
+            for (auto it=st.indexes.begin(); it!=st.indexes.end(); ++it)
+            {
+                IndexCandidate* c = byName[StrLower(*it)];
+                c->saved += st.Saved() / st.indexes.size();
+                c->statements++;
+            }
+        }
+
+        const StatementInfo& info = m_infos[s];
+        if (info.writeTable.empty()) continue;
+        for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+        {
+            if (StrLower(c->table) != StrLower(info.writeTable)) continue;
+            bool touched = info.insert || info.setColumns.empty();
+            for (auto k=c->columns.begin(); k!=c->columns.end() && !touched; ++k)
+                touched = std::find(info.setColumns.begin(), info.setColumns.end(), StrLower(*k)) != info.setColumns.end();
+            if (!touched) continue;
+            auto b = m_btrees.find(StrLower(c->name));
+            int depth = b == m_btrees.end() ? 1 : b->second.depth;
+            c->maintenance += st.count * info.writeRows * (depth + 1);
+        }
+    }
+
+    m_recommended.clear();
+    for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+    {
+        if (c->statements > 0 && c->Net() > 0) m_recommended.push_back(*c);
+    }
+    std::stable_sort(m_recommended.begin(), m_recommended.end(), [](const IndexCandidate& a, const IndexCandidate& b) {
+        return a.Net() > b.Net();
+    });
+}
+
+bool CSQLite3Advisor::Run(const string &path, const CSQLite3Schema &schema, const string &workload,
+                          const AdvisorOptions &opts, const std::function<void (int, int)> &onProgress)
+{
+    m_path = path;
+    m_err.clear();
+    m_statements.clear();
+    m_infos.clear();
+    m_candidates.clear();
+    m_recommended.clear();
+    m_btrees.clear();
+    m_schemaDdl.clear();
+    m_statDml.clear();
+    if (!m_scan.Open(path))
+    {
+        m_err = m_scan.GetError();
+        return false;
+    }
+
+    // 合并相同的语句
+    std::map<string, int> seen;
+    vector<string> stmts = SplitStatements(workload);
+    for (auto it=stmts.begin(); it!=stmts.end(); ++it)
+    {
+        string key = Normalize(*it);
+        auto s = seen.find(key);
+        if (s == seen.end())
+        {
+            s = seen.insert(std::make_pair(key, (int)m_statements.size())).first;
+            AdvisorStatement st;
+            st.sql = *it;
+            m_statements.push_back(st);
+        }
+        m_statements[s->second].count++;
+    }
+    m_infos.resize(m_statements.size());
+    if (m_statements.empty())
+    {
+        m_err = "the workload has no statements";
+        return false;
+    }
+
+    MeasureBtrees(schema);
+    GenerateCandidates(schema, opts);
+
+    std::set<string> sampled;
+    for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+        sampled.insert(c->table);
+    std::atomic<int> done(0);
+    int total = (int)sampled.size() + (int)m_statements.size();
+    std::function<void()> tick = [&]() {
+        int d = ++done;
+        if (onProgress) onProgress(d, total);
+    };
+    SampleTables(schema, opts, tick);
+
+    // 副本：表先于索引和视图，不要触发器和虚拟表
+    const vector<SchemaObject>& objects = schema.Objects();
+    const char* order[] = { "table", "index", "view" };
+    for (int k=0; k<3; ++k)
+    {
+        for (auto it=objects.begin(); it!=objects.end(); ++it)
+        {
+            if (it->type != order[k] || it->sql.empty() || it->name.compare(0, 7, "sqlite_") == 0) continue;
+            if (StrUpper(it->sql).compare(0, 14, "CREATE VIRTUAL") == 0) continue;
+            m_schemaDdl.push_back(it->sql);
+        }
+    }
+    for (auto it=objects.begin(); it!=objects.end(); ++it)
+    {
+        if (it->type != "table" || it->name.compare(0, 7, "sqlite_") == 0) continue;
+        auto b = m_btrees.find(StrLower(it->name));
+        if (b == m_btrees.end()) continue;
+        m_statDml.push_back("INSERT INTO sqlite_stat1 VALUES(" + quoteLiteral(it->name) + ", NULL, '"
+                            + std::to_string(std::max<int64_t>(b->second.entries, 1)) + "')");
+    }
+    vector<pair<string, string> > indexes;
+    for (auto it=objects.begin(); it!=objects.end(); ++it)
+    {
+        if (it->type == "index") indexes.push_back(std::make_pair(it->tblName, it->name));
+    }
+    for (auto c=m_candidates.begin(); c!=m_candidates.end(); ++c)
+    {
+        indexes.push_back(std::make_pair(c->table, c->name));
+    }
+    for (auto it=indexes.begin(); it!=indexes.end(); ++it)
+    {
+        auto b = m_btrees.find(StrLower(it->second));
+        if (b == m_btrees.end() || b->second.stat1.empty()) continue;
+        string stat;
+        for (size_t i=0; i<b->second.stat1.size(); ++i)
+            stat += (i > 0 ? " " : "") + std::to_string((int64_t)b->second.stat1[i]);
+        m_statDml.push_back("INSERT INTO sqlite_stat1 VALUES(" + quoteLiteral(it->first) + ", "
+                            + quoteLiteral(it->second) + ", '" + stat + "')");
+    }
+
+    Evaluate(schema, opts, tick);
+    if (m_cancel)
+    {
+        m_err = "cancelled";
+        return false;
+    }
+    Rank();
+    return true;
+}
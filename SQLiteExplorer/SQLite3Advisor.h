@@ -0,0 +1,161 @@
+#ifndef SQLITE3ADVISOR_H
+#define SQLITE3ADVISOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <functional>
+#include "SQLite3Schema.h"
+#include "SQLite3RawScan.h"
+#include "SQLite3QueryPlan.h"
+
+using std::string;
+using std::vector;
+
+// 工作负载中的一条语句，相同的语句(忽略常量)合并
+struct AdvisorStatement
+{
+    string  sql;            // 第一次出现的原文
+    int     count;          // 出现次数
+    string  err;
+    double  baseCost;       // 现有索引下估计读的页数
+    double  newCost;        // 加上候选索引后
+    string  basePlan;       // 计划的detail，每步一行
+    string  newPlan;
+    vector<string> indexes; // 新计划用到的候选索引
+
+    AdvisorStatement() : count(0), baseCost(0), newCost(0) {}
+
+    double Saved() const { return (baseCost - newCost) * count; }
+};
+
+// 一个候选索引
+struct IndexCandidate
+{
+    string  name;
+    string  table;
+    vector<string> columns;
+    string  ddl;            // CREATE INDEX语句
+    int64_t estPages;       // 估计的大小
+    double  saved;          // 用到它的语句省下的页读取，乘以次数
+    double  maintenance;    // 工作负载中的写语句维护它的页读写
+    int     statements;     // 用到它的语句数
+
+    IndexCandidate() : estPages(0), saved(0), maintenance(0), statements(0) {}
+
+    double Net() const { return saved - maintenance; }
+};
+
+struct AdvisorOptions
+{
+    int     sampleRows;     // 每张表抽样的行数，用于估计候选索引的sqlite_stat1
+    int     maxColumns;     // 候选索引最多的列数
+    int     nThreads;       // 0为CPU核数
+
+    AdvisorOptions() : sampleRows(2000), maxColumns(4), nThreads(0) {}
+};
+
+/*
+** Index suggestions for a workload, in the manner of sqlite3_expert.
+**
+** Every statement of the workload is tokenised to find the columns it
+** compares with = or IN, with a range, and orders or groups by; from
+** them each table gets candidate indexes (equality columns first, then
+** one range column or the ORDER BY).  All candidates are created at once
+** in an in-memory copy of the schema and the planner picks the ones it
+** likes: a statement is explained there and in a copy without them.
+**
+** Both copies get a sqlite_stat1 describing the real data: the database's
+** own rows where it has them, otherwise numbers from a sample of each
+** table read by random rowid seeks (distinct counts scaled up with the
+** GEE estimator), and table sizes and b-tree depths from the page
+** decoder.  Each plan is then costed in pages read, nested loops
+** multiplying the inner steps, and a candidate is credited with what the
+** statements that use it save, times their frequency, less the cost of
+** maintaining it for the writes in the workload.
+**
+** The statements are explained in parallel, each worker building its
+** own pair of in-memory connections; the samples are read in parallel
+** on read-only connections.  The database itself is never written.
+*/
+class CSQLite3Advisor
+{
+public:
+    CSQLite3Advisor();
+
+    bool Run(const string& path, const CSQLite3Schema& schema, const string& workload,
+             const AdvisorOptions& opts,
+             const std::function<void(int done, int total)>& onProgress = nullptr);
+
+    void Cancel();
+    // 同时清除内部扫描的标志
+    void ClearCancel() { m_cancel = false; m_scan.ClearCancel(); }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    const vector<AdvisorStatement>& Statements() const { return m_statements; }
+    // 按Net()从大到小，只含有收益的候选
+    const vector<IndexCandidate>& Recommendations() const { return m_recommended; }
+
+    // 把SQL文本分成完整的语句
+    static vector<string> SplitStatements(const string& text);
+    // 常量替换成?并压缩空白，用于合并相同的语句
+    static string Normalize(const string& sql);
+    static bool ReadFile(const string& path, string& text, string& err);
+
+private:
+    struct BtreeInfo
+    {
+        int64_t pages;
+        int64_t leaves;
+        int64_t entries;
+        int     depth;
+        vector<double> stat1;   // sqlite_stat1的数字，空表示没有
+
+        BtreeInfo() : pages(0), leaves(0), entries(0), depth(0) {}
+    };
+
+    // 从一条语句中找到的列和写入的表
+    struct StatementInfo
+    {
+        vector<pair<string, vector<string> > > wanted;  // 每项是一个候选索引(表, 列)
+        string          writeTable;     // INSERT/UPDATE/DELETE的表
+        bool            insert;
+        vector<string>  setColumns;     // UPDATE修改的列
+        double          writeRows;      // 估计每次修改的行数
+
+        StatementInfo() : insert(false), writeRows(1) {}
+    };
+
+    void ParseStatement(const CSQLite3Schema& schema, const AdvisorOptions& opts,
+                        const string& sql, StatementInfo& info) const;
+    void MeasureBtrees(const CSQLite3Schema& schema);
+    void GenerateCandidates(const CSQLite3Schema& schema, const AdvisorOptions& opts);
+    void SampleTables(const CSQLite3Schema& schema, const AdvisorOptions& opts,
+                      const std::function<void()>& tick);
+    void Evaluate(const CSQLite3Schema& schema, const AdvisorOptions& opts,
+                  const std::function<void()>& tick);
+    bool BuildCopy(CppSQLite3DB& db, bool withCandidates, const CSQLite3Schema& schema,
+                   CSQLite3Schema& copy) const;
+    void Annotate(const CSQLite3Schema& copy, QueryPlan& plan) const;
+    double PlanCost(const QueryPlan& plan, const vector<int>& ids, double loops, int level) const;
+    double StepCost(const PlanNode& node) const;
+    void Rank();
+
+private:
+    string                          m_path;
+    string                          m_err;
+    std::atomic<bool>               m_cancel;
+    CSQLite3RawScan                 m_scan;
+
+    vector<AdvisorStatement>        m_statements;
+    vector<StatementInfo>           m_infos;        // 与m_statements对应
+    vector<IndexCandidate>          m_candidates;
+    vector<IndexCandidate>          m_recommended;
+    std::map<string, BtreeInfo>     m_btrees;       // 小写名称，含候选索引
+    vector<string>                  m_schemaDdl;    // 副本中的表、索引和视图
+    vector<string>                  m_statDml;      // 写入副本的sqlite_stat1
+};
+
+#endif // SQLITE3ADVISOR_H
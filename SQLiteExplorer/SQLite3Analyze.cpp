@@ -0,0 +1,1018 @@
+#include "SQLite3Analyze.h"
+#include "SQLite3File.h"
+#include "Parallel.h"
+#include "sqlite3.h"
+#include <map>
+#include <set>
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// 防止损坏的b-tree形成环
+static const int ANALYZE_MAX_DEPTH = 64;
+// 每个并行任务解码的叶子数
+static const int ANALYZE_UNITS_PER_CHUNK = 16;
+// 保存level的字节能表示的最多比较列数
+static const int ANALYZE_MAX_LEVEL = 255;
+
+// 列的排序规则
+enum
+{
+    COLL_BINARY,
+    COLL_NOCASE,
+    COLL_RTRIM,
+};
+
+static int putVarint(unsigned char* p, uint64_t v)
+{
+    if (v > 0x00ffffffffffffffULL)
+    {
+        p[8] = (unsigned char)v;
+        v >>= 8;
+        for (int i=7; i>=0; --i)
+        {
+            p[i] = (unsigned char)((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        return 9;
+    }
+    unsigned char buf[10];
+    int n = 0;
+    do
+    {
+        buf[n++] = (unsigned char)((v & 0x7f) | 0x80);
+        v >>= 7;
+    } while (v != 0);
+    buf[0] &= 0x7f;
+    for (int i=0; i<n; ++i) p[i] = buf[n-1-i];
+    return n;
+}
+
+// 小写的排序规则名，其他排序规则按BINARY比较
+static int collationOf(const string& coll)
+{
+    if (coll == "nocase") return COLL_NOCASE;
+    if (coll == "rtrim") return COLL_RTRIM;
+    return COLL_BINARY;
+}
+
+static bool knownCollation(const string& coll)
+{
+    return coll.empty() || coll == "binary" || coll == "nocase" || coll == "rtrim";
+}
+
+static int64_t serialSize(int64_t st)
+{
+    static const int sizes[] = { 0, 1, 2, 3, 4, 6, 8, 8, 0, 0, 0, 0 };
+    return st < 12 ? sizes[st] : (st - 12) / 2;
+}
+
+// 记录中的一个字段，内容指向记录
+struct RecordField
+{
+    int64_t              st;
+    const unsigned char* p;
+    int64_t              n;
+};
+
+// 解析记录的前nField个字段，返回解析到的个数，记录损坏时返回-1
+static int parseRecord(const string& rec, int nField, vector<RecordField>& fields)
+{
+    const unsigned char* base = (const unsigned char*)rec.data();
+    const unsigned char* end = base + rec.size();
+    int64_t hdrSize;
+    int k = getVarint(base, end, &hdrSize);
+    if (k == 0 || hdrSize < k || hdrSize > (int64_t)rec.size()) return -1;
+    const unsigned char* t = base + k;
+    const unsigned char* tEnd = base + hdrSize;
+    const unsigned char* v = tEnd;
+    int n = 0;
+    fields.resize(nField);
+    while (t < tEnd && n < nField)
+    {
+        int64_t st;
+        int m = getVarint(t, tEnd, &st);
+        if (m == 0) return -1;
+        t += m;
+        int64_t len = serialSize(st);
+        if (v + len > end) return -1;
+        fields[n].st = st;
+        fields[n].p = v;
+        fields[n].n = len;
+        v += len;
+        n++;
+    }
+    // 字段较少的记录后面视为NULL
+    for (int i=n; i<nField; ++i)
+    {
+        fields[i].st = 0;
+        fields[i].p = v;
+        fields[i].n = 0;
+    }
+    return n;
+}
+
+static bool fieldIsNumber(int64_t st) { return st >= 1 && st <= 9; }
+
+static double fieldNumber(const RecordField& f, int64_t* pInt)
+{
+    if (f.st == 8 || f.st == 9)
+    {
+        *pInt = f.st - 8;
+        return (double)*pInt;
+    }
+    uint64_t x = (f.st != 7 && (f.p[0] & 0x80)) ? ~0ULL : 0;
+    for (int64_t i=0; i<f.n; ++i) x = (x << 8) | f.p[i];
+    if (f.st == 7)
+    {
+        double d;
+        memcpy(&d, &x, 8);
+        return d;
+    }
+    *pInt = (int64_t)x;
+    return (double)*pInt;
+}
+
+// 文本的第i个编码单元
+static inline unsigned unitAt(const unsigned char* p, int64_t i, int enc)
+{
+    if (enc == 1) return p[i];
+    return enc == 2 ? (p[2*i] | (p[2*i+1] << 8)) : ((p[2*i] << 8) | p[2*i+1]);
+}
+
+static bool textEqual(const RecordField& a, const RecordField& b, int coll, int enc)
+{
+    int w = enc == 1 ? 1 : 2;
+    int64_t na = a.n / w, nb = b.n / w;
+    if (coll == COLL_RTRIM)
+    {
+        while (na > 0 && unitAt(a.p, na-1, enc) == ' ') --na;
+        while (nb > 0 && unitAt(b.p, nb-1, enc) == ' ') --nb;
+    }
+    if (na != nb) return false;
+    if (coll != COLL_NOCASE) return memcmp(a.p, b.p, (size_t)(na * w)) == 0;
+    // NOCASE只折叠ASCII
+    for (int64_t i=0; i<na; ++i)
+    {
+        unsigned x = unitAt(a.p, i, enc), y = unitAt(b.p, i, enc);
+        if (x < 0x80) x = tolower(x);
+        if (y < 0x80) y = tolower(y);
+        if (x != y) return false;
+    }
+    return true;
+}
+
+// ANALYZE比较相邻的键时NULL与NULL相等
+static bool fieldEqual(const RecordField& a, const RecordField& b, int coll, int enc)
+{
+    bool nullA = a.st == 0 || a.st == 10 || a.st == 11;
+    bool nullB = b.st == 0 || b.st == 10 || b.st == 11;
+    if (nullA || nullB) return nullA && nullB;
+    if (fieldIsNumber(a.st) || fieldIsNumber(b.st))
+    {
+        if (!fieldIsNumber(a.st) || !fieldIsNumber(b.st)) return false;
+        int64_t ia = 0, ib = 0;
+        double da = fieldNumber(a, &ia), db = fieldNumber(b, &ib);
+        if (a.st != 7 && b.st != 7) return ia == ib;
+        return da == db;
+    }
+    if ((a.st & 1) != (b.st & 1)) return false;
+    if ((a.st & 1) == 0) return a.n == b.n && memcmp(a.p, b.p, (size_t)a.n) == 0;
+    return textEqual(a, b, coll, enc);
+}
+
+// 只保留记录的前nField个字段
+static string truncateRecord(const string& rec, int nField)
+{
+    vector<RecordField> fields;
+    int n = parseRecord(rec, nField, fields);
+    if (n <= 0) return rec;
+    fields.resize(n);
+
+    string types;
+    unsigned char buf[9];
+    int64_t bodyLen = 0;
+    for (int i=0; i<n; ++i)
+    {
+        types.append((const char*)buf, putVarint(buf, (uint64_t)fields[i].st));
+        bodyLen += fields[i].n;
+    }
+    // 头的长度包括它自己的varint
+    int64_t hdrSize = (int64_t)types.size() + 1;
+    if (putVarint(buf, (uint64_t)hdrSize) > 1) hdrSize++;
+    string out((const char*)buf, putVarint(buf, (uint64_t)hdrSize));
+    out += types;
+    out.append((const char*)fields[0].p, (size_t)bodyLen);
+    return out;
+}
+
+static vector<double> parseNumbers(const string& s)
+{
+    vector<double> out;
+    const char* p = s.c_str();
+    while (*p)
+    {
+        while (*p == ' ') ++p;
+        if (!isdigit((unsigned char)*p)) break;
+        char* end;
+        out.push_back(strtod(p, &end));
+        p = end;
+    }
+    return out;
+}
+
+// 索引的CREATE语句在列的括号之后有WHERE
+static bool isPartialIndex(const string& sql)
+{
+    string s = StrLower(sql);
+    size_t i = s.find('(');
+    int depth = 0;
+    char quote = 0;
+    for (; i<s.size(); ++i)
+    {
+        char ch = s[i];
+        if (quote)
+        {
+            if (ch == quote) quote = 0;
+        }
+        else if (ch == '\'' || ch == '"' || ch == '`' || ch == '[')
+        {
+            quote = ch == '[' ? ']' : ch;
+        }
+        else if (ch == '(')
+        {
+            depth++;
+        }
+        else if (ch == ')' && --depth == 0)
+        {
+            break;
+        }
+    }
+    for (size_t w=s.find("where", i); w!=string::npos; w=s.find("where", w+5))
+    {
+        bool start = w == 0 || !isalnum((unsigned char)s[w-1]);
+        bool end = w+5 >= s.size() || !isalnum((unsigned char)s[w+5]);
+        if (start && end) return true;
+    }
+    return false;
+}
+
+string Stat4Row::Join(const vector<int64_t> &nums)
+{
+    string out;
+    char buf[32];
+    for (size_t i=0; i<nums.size(); ++i)
+    {
+        snprintf(buf, sizeof(buf), i ? " %lld" : "%lld", (long long)nums[i]);
+        out += buf;
+    }
+    return out;
+}
+
+// 要遍历的一棵b-tree
+struct CSQLite3Analyze::Btree
+{
+    string      tbl;
+    string      idx;            // 空表示只数表的行数
+    int         root;
+    bool        index;          // 索引b-tree，否则是表b-tree
+    bool        partial;
+    int         nKey;           // sqlite_stat1中的列数
+    int         nCmp;           // 比较的列数，生成样本时包括rowid
+    vector<int> colls;          // 每个比较列的排序规则
+    string      note;
+    int         badPages;
+    int64_t     badCells;
+
+    Btree() : root(0), index(true), partial(false), nKey(0), nCmp(0), badPages(0), badCells(0) {}
+};
+
+// 按键的顺序遍历的一段：一个叶子，或内部页中位于两个子树之间的键
+struct CSQLite3Analyze::Unit
+{
+    int                     pgno;       // 0表示record中的内部页键
+    string                  record;
+    int64_t                 n;          // 条目数
+    vector<int64_t>         counts;     // 各level的条目数，不含第一个条目
+    string                  first;
+    string                  last;
+    vector<unsigned char>   levels;     // 生成样本时每个条目的level
+    int                     pages;      // 读过的页数，含溢出页
+    int64_t                 badCells;
+
+    Unit() : pgno(0), n(0), pages(0), badCells(0) {}
+};
+
+CSQLite3Analyze::CSQLite3Analyze()
+    : m_cancel(false)
+    , m_pageSize(0)
+    , m_usable(0)
+    , m_nPage(0)
+    , m_encoding(1)
+    , m_hasStat1(false)
+    , m_hasStat4(false)
+    , m_withStat4(false)
+{
+
+}
+
+/*
+** The record of one index cell, with its overflow chain.  Index cells
+** keep less of the payload on the page than table leaves: at most
+** (U-12)*64/255-23 bytes.
+*/
+bool CSQLite3Analyze::ReadCell(CSQLite3File &file, const unsigned char *page, int pgno, int cell,
+                               bool interior, string &record, int &pages) const
+{
+    const unsigned char* hdr = page + (pgno == 1 ? 100 : 0);
+    int ncell = get2(hdr+3);
+    int cellPtrs = (int)(hdr - page) + (interior ? 12 : 8);
+    if (cell >= ncell || cellPtrs + ncell*2 > m_usable) return false;
+    int ofst = get2(page + cellPtrs + cell*2) + (interior ? 4 : 0);
+    if (ofst < cellPtrs + ncell*2 || ofst >= m_usable) return false;
+
+    const unsigned char* pageEnd = page + m_usable;
+    const unsigned char* p = page + ofst;
+    int64_t nPayload;
+    int n = getVarint(p, pageEnd, &nPayload);
+    if (n == 0 || nPayload < 0 || nPayload > 0x7fffffff) return false;
+    p += n;
+
+    int64_t maxLocal = (int64_t)(m_usable - 12) * 64 / 255 - 23;
+    int64_t minLocal = (int64_t)(m_usable - 12) * 32 / 255 - 23;
+    int64_t nLocal = nPayload;
+    if (nPayload > maxLocal)
+    {
+        int64_t surplus = minLocal + (nPayload - minLocal) % (m_usable - 4);
+        nLocal = surplus <= maxLocal ? surplus : minLocal;
+    }
+    if (p + nLocal + (nLocal < nPayload ? 4 : 0) > pageEnd) return false;
+    record.assign((const char*)p, (size_t)nLocal);
+    if (nLocal == nPayload) return true;
+
+    unsigned int ovfl = get4(p + nLocal);
+    int ovflSize = m_usable - 4;
+    int64_t maxPages = (nPayload - nLocal + ovflSize - 1) / ovflSize;
+    vector<unsigned char> buf(m_pageSize);
+    for (int64_t k=0; (int64_t)record.size() < nPayload; ++k)
+    {
+        if (ovfl < 1 || (int)ovfl > m_nPage || k >= maxPages) return false;
+        file.Read((int64_t)(ovfl-1) * m_pageSize, &buf[0], m_pageSize);
+        pages++;
+        int64_t take = std::min<int64_t>(ovflSize, nPayload - record.size());
+        record.append((const char*)&buf[4], (size_t)take);
+        ovfl = get4(&buf[0]);
+    }
+    return true;
+}
+
+/*
+** The leaves of a b-tree in key order, and for an index the keys of the
+** interior cells in between: an interior page yields its first child,
+** the key of its first cell, the second child, and so on to the right
+** child.  Each page is visited at most once.
+*/
+void CSQLite3Analyze::CollectUnits(Btree &tree, vector<Unit> &units)
+{
+    CSQLite3File file;
+    if (!file.Open(m_path)) return;
+
+    vector<char> visited(m_nPage + 1, 0);
+    vector<unsigned char> page(m_pageSize);
+    vector<string> keys;
+    // 栈中为(页号, 深度)，页号<0表示keys[-页号-1]
+    vector<std::pair<int, int> > stack;
+    stack.push_back(std::make_pair(tree.root, 0));
+    while (!stack.empty() && !m_cancel)
+    {
+        int pgno = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+        if (pgno < 0)
+        {
+            units.push_back(Unit());
+            units.back().record.swap(keys[-pgno-1]);
+            continue;
+        }
+        if (pgno < 1 || pgno > m_nPage || visited[pgno] || depth > ANALYZE_MAX_DEPTH)
+        {
+            tree.badPages++;
+            continue;
+        }
+        visited[pgno] = 1;
+
+        file.Read((int64_t)(pgno-1) * m_pageSize, &page[0], m_pageSize);
+        const unsigned char* hdr = &page[pgno == 1 ? 100 : 0];
+        int leafType = tree.index ? 10 : 13;
+        int interiorType = tree.index ? 2 : 5;
+        if (hdr[0] == leafType)
+        {
+            units.push_back(Unit());
+            units.back().pgno = pgno;
+            continue;
+        }
+        if (hdr[0] != interiorType)
+        {
+            tree.badPages++;
+            continue;
+        }
+
+        units.push_back(Unit());    // 内部页只计页数
+        units.back().pages = 1;
+        units.back().pgno = -1;
+        int ncell = get2(hdr+3);
+        int cellPtrs = (int)(hdr - &page[0]) + 12;
+        if (cellPtrs + ncell*2 > m_usable)
+        {
+            tree.badPages++;
+            ncell = (m_usable - cellPtrs) / 2;
+        }
+        stack.push_back(std::make_pair((int)get4(hdr+8), depth+1));
+        for (int i=ncell-1; i>=0; --i)
+        {
+            int ofst = get2(&page[cellPtrs + i*2]);
+            if (ofst < cellPtrs || ofst + 4 > m_usable)
+            {
+                tree.badCells++;
+                continue;
+            }
+            if (tree.index)
+            {
+                string record;
+                if (ReadCell(file, &page[0], pgno, i, true, record, units.back().pages))
+                {
+                    keys.push_back(string());
+                    keys.back().swap(record);
+                    stack.push_back(std::make_pair(-(int)keys.size(), depth));
+                }
+                else
+                {
+                    tree.badCells++;
+                }
+            }
+            stack.push_back(std::make_pair((int)get4(&page[ofst]), depth+1));
+        }
+    }
+}
+
+/*
+** Samples for sqlite_stat4 from the levels of all entries.  Half of them
+** are spread evenly over the index, the rest start the longest runs of
+** equal first columns.  One pass over the levels then gives every sample
+** the size of its run (neq), the entries before the run (nlt) and the
+** runs before it (ndlt) for each prefix, and the sample records are read
+** back from their leaves.
+*/
+void CSQLite3Analyze::ChooseSamples(const Btree &tree, const vector<Unit> &units, int64_t nEntry,
+                                    const AnalyzeOptions &opts, AnalyzeEntry &entry)
+{
+    int nCol = tree.nCmp;
+    std::set<int64_t> picked;
+    if (nEntry <= opts.samples)
+    {
+        for (int64_t p=0; p<nEntry; ++p) picked.insert(p);
+    }
+    else
+    {
+        int nPeriodic = std::max(1, opts.samples / 2);
+        for (int i=0; i<nPeriodic; ++i)
+            picked.insert((2*(int64_t)i + 1) * nEntry / (2*nPeriodic));
+
+        // 最长的第一列相同的段，堆顶为其中最短的
+        typedef std::pair<int64_t, int64_t> Run;   // (-长度, 起点)
+        std::priority_queue<Run> best;
+        size_t nBest = (size_t)(opts.samples - nPeriodic);
+        int64_t p = 0, start = 0;
+        for (auto u=units.begin(); u!=units.end(); ++u)
+        {
+            for (size_t j=0; j<u->levels.size(); ++j, ++p)
+            {
+                if (u->levels[j] != 0 || p == 0) continue;
+                best.push(Run(-(p - start), start));
+                if (best.size() > nBest) best.pop();
+                start = p;
+            }
+        }
+        best.push(Run(-(nEntry - start), start));
+        if (best.size() > nBest) best.pop();
+        for (; !best.empty(); best.pop()) picked.insert(best.top().second);
+    }
+
+    vector<int64_t> positions(picked.begin(), picked.end());
+    vector<Stat4Row>& rows = entry.samples;
+    rows.assign(positions.size(), Stat4Row());
+    vector<vector<char> > pending(positions.size(), vector<char>(nCol, 0));
+    for (size_t s=0; s<rows.size(); ++s)
+    {
+        rows[s].neq.assign(nCol, 0);
+        rows[s].nlt.assign(nCol, 0);
+        rows[s].ndlt.assign(nCol, 0);
+    }
+
+    vector<int64_t> runStart(nCol, 0), runs(nCol, 0);
+    vector<int> nPending(nCol, 0);
+    vector<std::pair<size_t, size_t> > where(positions.size());    // (unit, 条目)
+    size_t next = 0;
+    int64_t p = 0;
+    for (size_t u=0; u<units.size(); ++u)
+    {
+        for (size_t j=0; j<units[u].levels.size(); ++j, ++p)
+        {
+            // 前k+1列从这里开始新的一段
+            for (int k=units[u].levels[j]; k<nCol; ++k)
+            {
+                if (nPending[k] > 0)
+                {
+                    for (size_t s=0; s<next; ++s)
+                    {
+                        if (!pending[s][k]) continue;
+                        rows[s].neq[k] = p - rows[s].nlt[k];
+                        pending[s][k] = 0;
+                        nPending[k]--;
+                    }
+                }
+                runStart[k] = p;
+                runs[k]++;
+            }
+            if (next < positions.size() && positions[next] == p)
+            {
+                for (int k=0; k<nCol; ++k)
+                {
+                    rows[next].nlt[k] = runStart[k];
+                    rows[next].ndlt[k] = runs[k] - 1;
+                    pending[next][k] = 1;
+                    nPending[k]++;
+                }
+                where[next] = std::make_pair(u, j);
+                next++;
+            }
+        }
+    }
+    for (size_t s=0; s<next; ++s)
+    {
+        for (int k=0; k<nCol; ++k)
+        {
+            if (pending[s][k]) rows[s].neq[k] = nEntry - rows[s].nlt[k];
+        }
+    }
+    rows.resize(next);
+
+    // 读回样本的记录
+    CSQLite3File file;
+    if (!file.Open(m_path)) return;
+    vector<unsigned char> page(m_pageSize);
+    int pages = 0;
+    for (size_t s=0; s<rows.size(); ++s)
+    {
+        const Unit& unit = units[where[s].first];
+        string record;
+        if (unit.pgno == 0)
+        {
+            record = unit.record;
+        }
+        else
+        {
+            // 叶子中损坏的cell被跳过，按好的cell计数
+            file.Read((int64_t)(unit.pgno-1) * m_pageSize, &page[0], m_pageSize);
+            int ncell = get2(&page[unit.pgno == 1 ? 103 : 3]);
+            size_t good = 0;
+            for (int i=0; i<ncell; ++i)
+            {
+                if (!ReadCell(file, &page[0], unit.pgno, i, false, record, pages)) continue;
+                if (good++ == where[s].second) break;
+            }
+        }
+        rows[s].sample = truncateRecord(record, nCol);
+    }
+}
+
+/*
+** Decode the leaves of one b-tree in parallel and merge the levels in
+** key order.  The first entry of each unit is compared with the last
+** entry of the unit before it during the merge.
+*/
+bool CSQLite3Analyze::WalkBtree(Btree &tree, const AnalyzeOptions &opts, AnalyzeEntry &entry)
+{
+    vector<Unit> units;
+    CollectUnits(tree, units);
+    if (m_cancel) return false;
+
+    int nCmp = tree.nCmp;
+    ParallelFor((int64_t)units.size(), ANALYZE_UNITS_PER_CHUNK, [&](int64_t begin, int64_t end) {
+        CSQLite3File file;
+        if (!file.Open(m_path)) return;
+        vector<unsigned char> page(m_pageSize);
+        // 当前和上一个条目轮流使用两组缓冲，字段指向记录
+        vector<RecordField> fields[2];
+        string recs[2];
+        for (int64_t u=begin; u<end && !m_cancel; ++u)
+        {
+            Unit& unit = units[u];
+            unit.counts.assign(nCmp + 1, 0);
+            if (unit.pgno < 0) continue;
+            if (unit.pgno == 0)
+            {
+                unit.n = 1;
+                unit.first = unit.last = unit.record;
+                if (opts.stat4) unit.levels.assign(1, 0);
+                continue;
+            }
+
+            file.Read((int64_t)(unit.pgno-1) * m_pageSize, &page[0], m_pageSize);
+            unit.pages++;
+            int ncell = get2(&page[unit.pgno == 1 ? 103 : 3]);
+            if (!tree.index)
+            {
+                unit.n = ncell;
+                continue;
+            }
+            int c = 0;
+            for (int i=0; i<ncell; ++i)
+            {
+                if (!ReadCell(file, &page[0], unit.pgno, i, false, recs[c], unit.pages)
+                    || parseRecord(recs[c], nCmp, fields[c]) < 0)
+                {
+                    unit.badCells++;
+                    continue;
+                }
+                int level = 0;
+                if (unit.n == 0)
+                {
+                    unit.first = recs[c];
+                }
+                else
+                {
+                    const vector<RecordField>& prev = fields[1-c];
+                    while (level < nCmp && fieldEqual(prev[level], fields[c][level], tree.colls[level], m_encoding))
+                        level++;
+                    unit.counts[level]++;
+                }
+                if (opts.stat4) unit.levels.push_back((unsigned char)std::min(level, ANALYZE_MAX_LEVEL));
+                unit.n++;
+                c = 1 - c;
+            }
+            if (unit.n > 0) unit.last = recs[1-c];
+        }
+    }, opts.nThreads);
+    if (m_cancel) return false;
+
+    // 合并：各段内的level加上段与段之间的
+    int64_t nEntry = 0;
+    vector<int64_t> counts(nCmp + 1, 0);
+    const Unit* prevUnit = NULL;
+    vector<RecordField> a, b;
+    for (auto u=units.begin(); u!=units.end(); ++u)
+    {
+        entry.pages += u->pages;
+        tree.badCells += u->badCells;
+        if (u->n == 0) continue;
+        nEntry += u->n;
+        for (int k=0; k<=nCmp; ++k) counts[k] += u->counts[k];
+        if (!tree.index) continue;
+
+        int level = 0;
+        if (prevUnit)
+        {
+            parseRecord(prevUnit->last, nCmp, a);
+            parseRecord(u->first, nCmp, b);
+            while (level < nCmp && fieldEqual(a[level], b[level], tree.colls[level], m_encoding))
+                level++;
+        }
+        counts[level]++;
+        if (opts.stat4) u->levels[0] = (unsigned char)std::min(level, ANALYZE_MAX_LEVEL);
+        prevUnit = &*u;
+    }
+
+    // 与analyze.c的statGet相同
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lld", (long long)nEntry);
+    entry.stat = buf;
+    int64_t distinct = 0;
+    for (int k=0; k<tree.nKey && tree.index; ++k)
+    {
+        distinct += counts[k];
+        int64_t val = 0;
+        if (distinct > 0)
+        {
+            val = (nEntry + distinct - 1) / distinct;
+            if (val == 2 && nEntry * 10 <= distinct * 11) val = 1;
+        }
+        snprintf(buf, sizeof(buf), " %lld", (long long)val);
+        entry.stat += buf;
+    }
+    // 空的索引只有部分索引写0，空表不写
+    if (nEntry == 0 && !tree.partial) entry.stat.clear();
+
+    if (tree.badPages + tree.badCells > 0)
+    {
+        snprintf(buf, sizeof(buf), "%d", tree.badPages);
+        string bad = string(buf) + " bad pages, ";
+        snprintf(buf, sizeof(buf), "%lld", (long long)tree.badCells);
+        bad += string(buf) + " bad cells skipped";
+        entry.note += (entry.note.empty() ? "" : "; ") + bad;
+    }
+
+    if (opts.stat4 && tree.index && nEntry > 0) ChooseSamples(tree, units, nEntry, opts, entry);
+    return true;
+}
+
+bool CSQLite3Analyze::Run(const string &path, const CSQLite3Schema &schema, const AnalyzeOptions &opts,
+                          const std::function<void (int, int)> &onProgress)
+{
+    m_err.clear();
+    m_entries.clear();
+    m_path = path;
+    m_withStat4 = opts.stat4;
+
+    CSQLite3File file;
+    unsigned char hdr[100];
+    if (!file.Open(path) || file.Read(0, hdr, 100) != 100 || memcmp(hdr, "SQLite format 3", 16) != 0)
+    {
+        m_err = "cannot read the header of " + path;
+        return false;
+    }
+    m_pageSize = get2(hdr+16) == 1 ? 65536 : get2(hdr+16);
+    m_usable = m_pageSize - hdr[20];
+    m_nPage = (int)std::min<int64_t>(file.Size() / std::max(m_pageSize, 1), 0x7fffffff);
+    m_encoding = (int)get4(hdr+56);
+    if (m_encoding < 1 || m_encoding > 3) m_encoding = 1;
+    if (m_pageSize < 512 || (m_pageSize & (m_pageSize-1)) != 0 || m_usable < 480)
+    {
+        m_err = "bad page size in the header of " + path;
+        return false;
+    }
+
+    // 要遍历的b-tree，顺序与sqlite_master相同
+    vector<Btree> trees;
+    const vector<SchemaObject>& objects = schema.Objects();
+    for (auto t=objects.begin(); t!=objects.end(); ++t)
+    {
+        if (t->type != "table" || t->rootpage <= 1 || StrLower(t->name).compare(0, 7, "sqlite_") == 0)
+            continue;
+        bool needTableCnt = !t->withoutRowid;
+        if (t->withoutRowid)
+        {
+            // 主键b-tree的统计以表名为索引名，排序规则取自主键的自动索引
+            Btree tree;
+            tree.tbl = tree.idx = t->name;
+            tree.root = t->rootpage;
+            vector<string> pkColls;
+            for (auto c=t->columns.begin(); c!=t->columns.end(); ++c)
+            {
+                if (c->pk <= 0) continue;
+                tree.nKey++;
+                if ((int)pkColls.size() < c->pk) pkColls.resize(c->pk);
+                pkColls[c->pk-1] = c->collation;
+            }
+            tree.nKey = std::max(tree.nKey, 1);
+            tree.nCmp = tree.nKey;
+            for (int k=0; k<tree.nCmp; ++k)
+            {
+                string coll = k < (int)pkColls.size() ? StrLower(pkColls[k]) : "";
+                tree.colls.push_back(collationOf(coll));
+                if (!knownCollation(coll))
+                    tree.note = "collation " + pkColls[k] + " compared as BINARY";
+            }
+            trees.push_back(tree);
+        }
+        for (auto i=objects.begin(); i!=objects.end(); ++i)
+        {
+            if (i->type != "index" || i->rootpage <= 1 || StrLower(i->tblName) != StrLower(t->name)) continue;
+            Btree tree;
+            tree.tbl = t->name;
+            tree.idx = i->name;
+            tree.root = i->rootpage;
+            tree.partial = isPartialIndex(i->sql);
+            tree.nKey = std::max(i->nKey, 1);
+            tree.nCmp = opts.stat4 ? (int)i->columns.size() : tree.nKey;
+            if (tree.nCmp > ANALYZE_MAX_LEVEL - 1)
+            {
+                tree.nCmp = tree.nKey;
+                tree.note = "too many columns for samples";
+            }
+            for (int k=0; k<tree.nCmp; ++k)
+            {
+                string coll = k < (int)i->columns.size() ? StrLower(i->columns[k].collation) : "";
+                tree.colls.push_back(collationOf(coll));
+                if (!knownCollation(coll))
+                    tree.note = "collation " + i->columns[k].collation + " compared as BINARY";
+            }
+            if (!tree.partial) needTableCnt = false;
+            trees.push_back(tree);
+        }
+        if (needTableCnt)
+        {
+            Btree tree;
+            tree.tbl = t->name;
+            tree.root = t->rootpage;
+            tree.index = false;
+            trees.push_back(tree);
+        }
+    }
+
+    for (size_t i=0; i<trees.size() && !m_cancel; ++i)
+    {
+        if (onProgress) onProgress((int)i, (int)trees.size());
+        AnalyzeEntry entry;
+        entry.tbl = trees[i].tbl;
+        entry.idx = trees[i].idx;
+        entry.root = trees[i].root;
+        entry.note = trees[i].note;
+        if (!WalkBtree(trees[i], opts, entry)) break;
+        m_entries.push_back(entry);
+    }
+    if (m_cancel)
+    {
+        m_err = "cancelled";
+        return false;
+    }
+    if (onProgress) onProgress((int)trees.size(), (int)trees.size());
+
+    ReadCurrent(path);
+    return true;
+}
+
+/*
+** Put the rows now in sqlite_stat1 and the sample counts of sqlite_stat4
+** next to the new ones.  Rows of walked tables that would not be written
+** again are kept as REMOVED entries, as are rows of tables that no longer
+** exist.
+*/
+void CSQLite3Analyze::ReadCurrent(const string &path)
+{
+    m_hasStat1 = m_hasStat4 = false;
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        return;
+    }
+
+    std::map<string, size_t> byKey;     // 小写的"表\t索引"
+    for (size_t i=0; i<m_entries.size(); ++i)
+    {
+        byKey[StrLower(m_entries[i].tbl + "\t" + m_entries[i].idx)] = i;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT tbl, idx, stat FROM sqlite_stat1", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        m_hasStat1 = true;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char* tbl = (const char*)sqlite3_column_text(stmt, 0);
+            const char* idx = (const char*)sqlite3_column_text(stmt, 1);
+            const char* stat = (const char*)sqlite3_column_text(stmt, 2);
+            string key = StrLower(string(tbl ? tbl : "") + "\t" + (idx ? idx : ""));
+            auto it = byKey.find(key);
+            if (it == byKey.end())
+            {
+                AnalyzeEntry entry;
+                entry.tbl = tbl ? tbl : "";
+                entry.idx = idx ? idx : "";
+                entry.oldStat = stat ? stat : "";
+                m_entries.push_back(entry);
+                it = byKey.insert(std::make_pair(key, m_entries.size() - 1)).first;
+            }
+            else
+            {
+                m_entries[it->second].oldStat = stat ? stat : "";
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+    stmt = NULL;
+
+    if (sqlite3_prepare_v2(db, "SELECT tbl, idx, count(*) FROM sqlite_stat4 GROUP BY tbl, idx", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        m_hasStat4 = true;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char* tbl = (const char*)sqlite3_column_text(stmt, 0);
+            const char* idx = (const char*)sqlite3_column_text(stmt, 1);
+            auto it = byKey.find(StrLower(string(tbl ? tbl : "") + "\t" + (idx ? idx : "")));
+            if (it != byKey.end()) m_entries[it->second].oldSamples = sqlite3_column_int(stmt, 2);
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    for (auto e=m_entries.begin(); e!=m_entries.end(); ++e)
+    {
+        if (e->stat.empty())
+        {
+            e->change = e->oldStat.empty() ? ANALYZE_UNCHANGED : ANALYZE_REMOVED;
+            continue;
+        }
+        if (e->oldStat.empty())
+        {
+            e->change = ANALYZE_ADDED;
+            continue;
+        }
+        vector<double> a = parseNumbers(e->oldStat), b = parseNumbers(e->stat);
+        e->change = a == b ? ANALYZE_UNCHANGED : ANALYZE_CHANGED;
+        e->maxChange = a.size() == b.size() ? 0 : 1;
+        for (size_t k=0; k<a.size() && k<b.size(); ++k)
+        {
+            e->maxChange = std::max(e->maxChange, std::fabs(b[k] - a[k]) / std::max(a[k], 1.0));
+        }
+    }
+    // 不需要写入、也没有旧行的b-tree(空表)不列出
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const AnalyzeEntry& e) {
+        return e.stat.empty() && e.oldStat.empty();
+    }), m_entries.end());
+}
+
+static bool execSql(sqlite3* db, const char* sql, string& err)
+{
+    char* msg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &msg) == SQLITE_OK) return true;
+    err = msg ? msg : sqlite3_errmsg(db);
+    sqlite3_free(msg);
+    return false;
+}
+
+bool CSQLite3Analyze::Write(const string &path, string &err) const
+{
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+    {
+        err = db ? sqlite3_errmsg(db) : "cannot open " + path;
+        sqlite3_close(db);
+        return false;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    // sqlite_stat1不能用CREATE TABLE创建，分析sqlite_master会创建它
+    bool ok = m_hasStat1 || execSql(db, "ANALYZE sqlite_master", err);
+    ok = ok && execSql(db, "BEGIN IMMEDIATE", err);
+    if (!ok)
+    {
+        sqlite3_close(db);
+        return false;
+    }
+
+    sqlite3_stmt* del1 = NULL;
+    sqlite3_stmt* del4 = NULL;
+    sqlite3_stmt* ins1 = NULL;
+    sqlite3_stmt* ins4 = NULL;
+    bool stat4 = m_withStat4 && m_hasStat4;
+    ok = sqlite3_prepare_v2(db, "DELETE FROM sqlite_stat1 WHERE tbl = ?1", -1, &del1, NULL) == SQLITE_OK
+         && sqlite3_prepare_v2(db, "INSERT INTO sqlite_stat1(tbl, idx, stat) VALUES(?1, ?2, ?3)", -1, &ins1, NULL) == SQLITE_OK
+         && (!m_hasStat4 || sqlite3_prepare_v2(db, "DELETE FROM sqlite_stat4 WHERE tbl = ?1", -1, &del4, NULL) == SQLITE_OK)
+         && (!stat4 || sqlite3_prepare_v2(db, "INSERT INTO sqlite_stat4(tbl, idx, neq, nlt, ndlt, sample) "
+                                              "VALUES(?1, ?2, ?3, ?4, ?5, ?6)", -1, &ins4, NULL) == SQLITE_OK);
+
+    // 先删除被统计的表的所有行，与ANALYZE相同；没有生成样本时旧的stat4样本也要删除，
+    // 否则它们与新的stat1不一致
+    std::set<string> done;
+    for (auto e=m_entries.begin(); ok && e!=m_entries.end(); ++e)
+    {
+        if (!done.insert(StrLower(e->tbl)).second) continue;
+        sqlite3_bind_text(del1, 1, e->tbl.c_str(), -1, SQLITE_TRANSIENT);
+        ok = sqlite3_step(del1) == SQLITE_DONE;
+        sqlite3_reset(del1);
+        if (ok && m_hasStat4)
+        {
+            sqlite3_bind_text(del4, 1, e->tbl.c_str(), -1, SQLITE_TRANSIENT);
+            ok = sqlite3_step(del4) == SQLITE_DONE;
+            sqlite3_reset(del4);
+        }
+    }
+    for (auto e=m_entries.begin(); ok && e!=m_entries.end(); ++e)
+    {
+        if (e->stat.empty()) continue;
+        sqlite3_bind_text(ins1, 1, e->tbl.c_str(), -1, SQLITE_TRANSIENT);
+        if (e->idx.empty()) sqlite3_bind_null(ins1, 2);
+        else sqlite3_bind_text(ins1, 2, e->idx.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(ins1, 3, e->stat.c_str(), -1, SQLITE_TRANSIENT);
+        ok = sqlite3_step(ins1) == SQLITE_DONE;
+        sqlite3_reset(ins1);
+
+        for (auto s=e->samples.begin(); ok && stat4 && s!=e->samples.end(); ++s)
+        {
+            sqlite3_bind_text(ins4, 1, e->tbl.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins4, 2, e->idx.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins4, 3, Stat4Row::Join(s->neq).c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins4, 4, Stat4Row::Join(s->nlt).c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(ins4, 5, Stat4Row::Join(s->ndlt).c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_blob(ins4, 6, s->sample.data(), (int)s->sample.size(), SQLITE_TRANSIENT);
+            ok = sqlite3_step(ins4) == SQLITE_DONE;
+            sqlite3_reset(ins4);
+        }
+    }
+    if (!ok) err = sqlite3_errmsg(db);
+    sqlite3_finalize(del1);
+    sqlite3_finalize(del4);
+    sqlite3_finalize(ins1);
+    sqlite3_finalize(ins4);
+
+    ok = ok && execSql(db, "COMMIT", err);
+    if (!ok) sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+    sqlite3_close(db);
+    return ok;
+}
@@ -0,0 +1,136 @@
+#ifndef SQLITE3ANALYZE_H
+#define SQLITE3ANALYZE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "SQLite3Schema.h"
+
+using std::string;
+using std::vector;
+
+class CSQLite3File;
+
+// sqlite_stat4的一行
+struct Stat4Row
+{
+    vector<int64_t> neq;    // 与样本前k+1列相同的行数
+    vector<int64_t> nlt;    // 前k+1列小于样本的行数
+    vector<int64_t> ndlt;   // 前k+1列小于样本的不同值个数
+    string          sample; // 样本的索引记录
+
+    // 空格分隔的数字，与sqlite_stat4中的格式相同
+    static string Join(const vector<int64_t>& nums);
+};
+
+// 与现有统计的比较结果
+enum AnalyzeChange
+{
+    ANALYZE_UNCHANGED,
+    ANALYZE_CHANGED,
+    ANALYZE_ADDED,      // 现在没有这一行
+    ANALYZE_REMOVED,    // 对象已不存在或不再需要这一行，写入时删除
+};
+
+// sqlite_stat1的一行，新算出的和现有的
+struct AnalyzeEntry
+{
+    string  tbl;
+    string  idx;            // 空表示idx为NULL的表行数
+    int     root;
+    string  stat;           // 新的stat，REMOVED时为空
+    string  oldStat;        // 现有的stat，没有时为空
+    AnalyzeChange change;
+    double  maxChange;      // 各个数字的最大相对变化
+    int     oldSamples;     // 现有的sqlite_stat4样本数
+    vector<Stat4Row> samples;
+    string  note;           // 如不认识的排序规则
+    int     pages;          // 读过的页数
+
+    AnalyzeEntry()
+        : root(0), change(ANALYZE_UNCHANGED), maxChange(0), oldSamples(0), pages(0)
+    {}
+};
+
+struct AnalyzeOptions
+{
+    bool    stat4;          // 同时生成sqlite_stat4的样本
+    int     samples;        // 每个索引的样本数(SQLITE_STAT4_SAMPLES)
+    int     nThreads;       // 0为CPU核数
+
+    AnalyzeOptions() : stat4(false), samples(24), nThreads(0) {}
+};
+
+/*
+** What ANALYZE would write, computed from the file without a write lock.
+**
+** Every index b-tree (and the b-tree of every WITHOUT ROWID table) is
+** walked in key order by the page decoder: the interior pages once, to
+** list the leaves and the keys held between them, then the leaves in
+** parallel.  For each entry only the level of its first difference from
+** the previous entry is kept, compared under the column's collation
+** (BINARY, NOCASE and RTRIM; others fall back to BINARY) with NULLs
+** equal, as ANALYZE does.  The distinct count of every prefix follows
+** from the levels, and the sqlite_stat1 numbers from the same formula as
+** analyze.c.  Tables with no index, or only partial ones, get their row
+** count from the table leaves.
+**
+** With stat4 the levels of all entries are kept (one byte each) and a
+** second, serial pass over them picks the samples: half spread evenly
+** over the index and half at the start of the longest runs of the first
+** column, which is close to what sqlite chooses.  Their records are read
+** back from the leaves.
+**
+** Only committed pages in the main file are read; with WAL the last
+** transactions may be missing.  Write() replaces the rows of the walked
+** tables in one short IMMEDIATE transaction.
+*/
+class CSQLite3Analyze
+{
+public:
+    CSQLite3Analyze();
+
+    bool Run(const string& path, const CSQLite3Schema& schema, const AnalyzeOptions& opts,
+             const std::function<void(int done, int total)>& onProgress = nullptr);
+
+    void Cancel() { m_cancel = true; }
+    // 在启动工作线程之前调用
+    void ClearCancel() { m_cancel = false; }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    const vector<AnalyzeEntry>& Entries() const { return m_entries; }
+    // 数据库中是否有sqlite_stat4，没有时样本无法写入
+    bool HasStat4Table() const { return m_hasStat4; }
+
+    // 在一个事务中替换被统计的表在sqlite_stat1(和sqlite_stat4)中的行
+    bool Write(const string& path, string& err) const;
+
+private:
+    struct Btree;
+    struct Unit;
+
+    bool WalkBtree(Btree& tree, const AnalyzeOptions& opts, AnalyzeEntry& entry);
+    void CollectUnits(Btree& tree, vector<Unit>& units);
+    void ChooseSamples(const Btree& tree, const vector<Unit>& units, int64_t nEntry,
+                       const AnalyzeOptions& opts, AnalyzeEntry& entry);
+    bool ReadCell(CSQLite3File& file, const unsigned char* page, int pgno, int cell,
+                  bool interior, string& record, int& pages) const;
+    void ReadCurrent(const string& path);
+
+private:
+    string              m_path;
+    string              m_err;
+    std::atomic<bool>   m_cancel;
+    int                 m_pageSize;
+    int                 m_usable;
+    int                 m_nPage;
+    int                 m_encoding;     // 1 UTF-8，2 UTF-16le，3 UTF-16be
+    bool                m_hasStat1;
+    bool                m_hasStat4;
+    bool                m_withStat4;    // Run时生成了样本
+    vector<AnalyzeEntry> m_entries;
+};
+
+#endif // SQLITE3ANALYZE_H
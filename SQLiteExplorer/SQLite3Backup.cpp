@@ -0,0 +1,233 @@
+#include "SQLite3Backup.h"
+#include "SQLite3File.h"
+#include "PageHash.h"
+#include "CppSQLite3.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+using std::vector;
+
+// 两次报告进度的最小间隔(毫秒)
+static const int BACKUP_REPORT_MS = 200;
+
+static double elapsedMs(const std::chrono::steady_clock::time_point& t)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+static int pragmaInt(sqlite3* db, const char* sql)
+{
+    int val = 0;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+        val = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return val;
+}
+
+static string pragmaText(sqlite3* db, const char* sql)
+{
+    string val;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const char* text = (const char*)sqlite3_column_text(stmt, 0);
+        if (text) val = text;
+    }
+    sqlite3_finalize(stmt);
+    return val;
+}
+
+CSQLite3Backup::CSQLite3Backup()
+    : m_cancel(false)
+{
+}
+
+bool CSQLite3Backup::Run(const string &srcPath, const string &dstPath, const BackupOptions &opts,
+                         const std::function<void (int, int, double)> &onProgress)
+{
+    m_err.clear();
+    m_result = BackupResult();
+    auto start = std::chrono::steady_clock::now();
+
+    sqlite3* src = NULL;
+    sqlite3* dst = NULL;
+    if (sqlite3_open_v2(srcPath.c_str(), &src, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        m_err = sqlite3_errmsg(src);
+        sqlite3_close(src);
+        return false;
+    }
+    CSQLite3File::RemoveFile(dstPath);
+    if (sqlite3_open_v2(dstPath.c_str(), &dst, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK)
+    {
+        m_err = sqlite3_errmsg(dst);
+        sqlite3_close(dst);
+        sqlite3_close(src);
+        return false;
+    }
+    sqlite3_busy_timeout(src, 5000);
+
+    sqlite3_backup* backup = sqlite3_backup_init(dst, "main", src, "main");
+    if (backup == NULL)
+    {
+        m_err = sqlite3_errmsg(dst);
+        sqlite3_close(dst);
+        sqlite3_close(src);
+        return false;
+    }
+
+    CSQLite3File file;
+    if (file.Open(srcPath)) m_result.pageSize = file.PageSize();
+    file.Close();
+
+    int nStep = opts.pagesPerStep > 0 ? opts.pagesPerStep : -1;
+    int rc = SQLITE_OK;
+    int prevDone = 0;
+    int lastDone = 0;
+    double lastReport = 0;
+    // 最后一步开始前源文件的版本，副本就是这一步读到的快照，
+    // 校验时版本不同说明这之后有提交(在finish和校验之间提交的也算)
+    int dataVersion = 0;
+    while (!m_cancel)
+    {
+        if (opts.verify) dataVersion = pragmaInt(src, "PRAGMA data_version");
+        rc = sqlite3_backup_step(backup, nStep);
+        m_result.steps++;
+        if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) break;
+
+        int total = sqlite3_backup_pagecount(backup);
+        int remaining = sqlite3_backup_remaining(backup);
+        int done = total - remaining;
+        if (done < prevDone)
+        {
+            // 源文件被其他连接修改，从头开始
+            m_result.restarts++;
+            lastDone = 0;
+        }
+        prevDone = done;
+
+        // 速度按上次报告之后复制的页数计算
+        double now = elapsedMs(start);
+        if (onProgress && now - lastReport >= BACKUP_REPORT_MS)
+        {
+            double mbps = (double)(done - lastDone) * m_result.pageSize / (1024.0*1024.0) * 1000.0 / (now - lastReport);
+            onProgress(done, total, mbps);
+            lastDone = done;
+            lastReport = now;
+        }
+
+        if (opts.sleepMs > 0) sqlite3_sleep(opts.sleepMs);
+    }
+    m_result.pages = sqlite3_backup_pagecount(backup);
+    sqlite3_backup_finish(backup);
+
+    bool ok = rc == SQLITE_DONE && !m_cancel;
+    if (!ok && !m_cancel)
+    {
+        m_err = sqlite3_errmsg(dst);
+    }
+    sqlite3_close(dst);
+
+    if (ok && opts.verify)
+    {
+        ok = Verify(srcPath, dstPath, src, dataVersion);
+    }
+    sqlite3_close(src);
+
+    if (!ok) CSQLite3File::RemoveFile(dstPath);
+    m_result.seconds = elapsedMs(start) / 1000.0;
+    if (onProgress && ok) onProgress(m_result.pages, m_result.pages,
+        m_result.seconds > 0 ? (double)m_result.pages * m_result.pageSize / (1024.0*1024.0) / m_result.seconds : 0);
+    return ok;
+}
+
+/*
+** Compare the copy with the source page by page.  Both files are hashed
+** in parallel while the source connection holds a read transaction, so
+** no writer can commit in between.  A WAL database keeps committed pages
+** outside the main file and cannot be compared this way; the copy then
+** gets a quick_check instead.
+*/
+bool CSQLite3Backup::Verify(const string &srcPath, const string &dstPath, sqlite3 *src, int dataVersion)
+{
+    m_result.verified = true;
+    m_result.mismatches = 0;
+
+    if (sqlite3_exec(src, "BEGIN; SELECT count(*) FROM sqlite_master;", NULL, NULL, NULL) != SQLITE_OK)
+    {
+        m_err = sqlite3_errmsg(src);
+        return false;
+    }
+
+    string mode = pragmaText(src, "PRAGMA journal_mode");
+    bool changed = pragmaInt(src, "PRAGMA data_version") != dataVersion;
+    if (mode == "wal" || changed)
+    {
+        sqlite3_exec(src, "COMMIT", NULL, NULL, NULL);
+        m_result.verifyNote = changed ? "the source was written after the snapshot"
+                                      : "the source is in WAL mode";
+        m_result.verifyNote += ", ran quick_check on the copy instead";
+
+        sqlite3* dst = NULL;
+        string res = "failed to open the copy";
+        if (sqlite3_open_v2(dstPath.c_str(), &dst, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK)
+        {
+            res = pragmaText(dst, "PRAGMA quick_check");
+        }
+        sqlite3_close(dst);
+        if (res != "ok")
+        {
+            m_err = "quick_check on the copy: " + res;
+            return false;
+        }
+        return true;
+    }
+
+    vector<uint64_t> srcHashes, dstHashes;
+    bool ok = HashPages(srcPath, srcHashes, NULL, &m_cancel)
+           && HashPages(dstPath, dstHashes, NULL, &m_cancel);
+    string page1[2];
+    if (ok)
+    {
+        // 页1中sqlite会在副本上重写的字段不参与比较
+        const string* paths[2] = { &srcPath, &dstPath };
+        for (int i=0; i<2; ++i)
+        {
+            CSQLite3File file;
+            page1[i].assign(m_result.pageSize, 0);
+            if (file.Open(*paths[i])) file.Read(0, &page1[i][0], m_result.pageSize);
+            memset(&page1[i][24], 0, 4);
+            memset(&page1[i][40], 0, 4);
+            memset(&page1[i][92], 0, 8);
+        }
+    }
+    sqlite3_exec(src, "COMMIT", NULL, NULL, NULL);
+    if (!ok)
+    {
+        if (!m_cancel) m_err = "failed to read database file";
+        return false;
+    }
+
+    int n = m_result.pages;
+    if ((int)srcHashes.size() < n || (int)dstHashes.size() < n)
+    {
+        m_err = "the copy is shorter than the snapshot";
+        return false;
+    }
+    if (page1[0] != page1[1]) m_result.mismatches++;
+    for (int i=1; i<n; ++i)
+    {
+        if (srcHashes[i] != dstHashes[i]) m_result.mismatches++;
+    }
+    if (m_result.mismatches > 0)
+    {
+        m_err = "the copy differs from the source";
+        return false;
+    }
+    return true;
+}
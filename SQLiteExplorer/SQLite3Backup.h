@@ -0,0 +1,75 @@
+#ifndef SQLITE3BACKUP_H
+#define SQLITE3BACKUP_H
+
+#include <string>
+#include <atomic>
+#include <functional>
+#include "utils.h"
+
+struct sqlite3;
+
+using std::string;
+
+struct BackupOptions
+{
+    int     pagesPerStep;   // 每步复制的页数，<=0表示一次复制全部
+    int     sleepMs;        // 每步之后让出的时间，留给其他连接写入
+    bool    verify;         // 复制完成后比较页哈希
+
+    BackupOptions() : pagesPerStep(256), sleepMs(10), verify(false) {}
+};
+
+struct BackupResult
+{
+    int     pageSize;
+    int     pages;          // 快照的页数
+    int     steps;
+    int     restarts;       // 源文件被其他连接修改导致重新开始的次数
+    double  seconds;
+
+    bool    verified;       // 是否做了校验
+    int     mismatches;     // 校验时内容不同的页数
+    string  verifyNote;     // 无法按页比较时的说明
+
+    BackupResult() : pageSize(0), pages(0), steps(0), restarts(0), seconds(0),
+                     verified(false), mismatches(0) {}
+};
+
+/*
+** Consistent copy of a live database with the online backup API.
+**
+** sqlite3_backup_step() copies a few pages at a time and only holds the
+** source read lock while it runs, so writers get the sleep between steps
+** to commit.  If another connection writes to the source the copy
+** restarts from the first page; a write through the same connection is
+** applied to the copy instead.
+**
+** The copy can be checked against the source with the parallel page
+** hash: the source is held in a read transaction while both files are
+** hashed, and the header fields that sqlite rewrites on the copy (change
+** counter, schema cookie, version-valid-for) are ignored.
+*/
+class CSQLite3Backup
+{
+public:
+    CSQLite3Backup();
+
+    bool Run(const string& srcPath, const string& dstPath, const BackupOptions& opts,
+             const std::function<void(int done, int total, double mbPerSec)>& onProgress = nullptr);
+
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    const BackupResult& GetResult() const { return m_result; }
+
+private:
+    bool Verify(const string& srcPath, const string& dstPath, sqlite3* src, int dataVersion);
+
+private:
+    std::atomic<bool> m_cancel;
+    string            m_err;
+    BackupResult      m_result;
+};
+
+#endif // SQLITE3BACKUP_H
@@ -0,0 +1,601 @@
+#include "SQLite3ColumnStats.h"
+#include "SQLite3File.h"
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// HyperLogLog的寄存器个数为2^COLSTATS_HLL_BITS，标准误差约0.8%
+static const int COLSTATS_HLL_BITS = 14;
+// 频率表最多的不同值个数，超过后丢弃出现最少的
+static const size_t COLSTATS_MAX_FREQ = 65536;
+// 更长的TEXT/BLOB在频率表和样本中只保留前面的字节
+static const size_t COLSTATS_KEY_BYTES = 64;
+
+int StatValue::Compare(const StatValue &other) const
+{
+    // 存储类的顺序：NULL、数字、TEXT、BLOB
+    static const int rank[] = { 0, 1, 1, 2, 3, 0 };
+    int r1 = rank[type], r2 = rank[other.type];
+    if (r1 != r2) return r1 < r2 ? -1 : 1;
+    if (r1 == 0) return 0;
+    if (r1 == 1)
+    {
+        if (type == SQLITE_INTEGER && other.type == SQLITE_INTEGER)
+            return i < other.i ? -1 : i > other.i ? 1 : 0;
+        double a = type == SQLITE_INTEGER ? (double)i : r;
+        double b = other.type == SQLITE_INTEGER ? (double)other.i : other.r;
+        return a < b ? -1 : a > b ? 1 : 0;
+    }
+    int c = memcmp(s.data(), other.s.data(), std::min(s.size(), other.s.size()));
+    if (c != 0) return c;
+    return s.size() < other.s.size() ? -1 : s.size() > other.s.size() ? 1 : 0;
+}
+
+string StatValue::ToString(int maxChars) const
+{
+    char buf[64];
+    switch (type)
+    {
+    case SQLITE_INTEGER:
+        snprintf(buf, sizeof(buf), "%lld", (long long)i);
+        return buf;
+    case SQLITE_FLOAT:
+        snprintf(buf, sizeof(buf), "%.15g", r);
+        return buf;
+    case SQLITE_TEXT:
+    {
+        if ((int)s.size() <= maxChars) return s;
+        // 不截断在UTF-8字符中间
+        size_t n = maxChars;
+        while (n > 0 && ((unsigned char)s[n] & 0xC0) == 0x80) --n;
+        return s.substr(0, n) + "...";
+    }
+    case SQLITE_BLOB:
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        string out = "x'";
+        for (size_t k=0; k<s.size() && (int)out.size() < maxChars; ++k)
+        {
+            out += hex[(unsigned char)s[k] >> 4];
+            out += hex[(unsigned char)s[k] & 15];
+        }
+        out += (int)out.size() >= maxChars ? "...'" : "'";
+        return out;
+    }
+    default:
+        return "NULL";
+    }
+}
+
+static inline uint64_t mix64(uint64_t h)
+{
+    // splitmix64的结尾，让FNV的高位也均匀
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static uint64_t hashBytes(const char* p, size_t n)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t k=0; k<n; ++k)
+    {
+        h ^= (unsigned char)p[k];
+        h *= 1099511628211ULL;
+    }
+    return mix64(h);
+}
+
+/*
+** One column's accumulator.  Values arrive as a frequency-table key:
+** 'i' or 'r' and the 8 bytes of the number, 't' or 'b' and the content,
+** or 'T'/'B', the 8-byte hash of the content and its first bytes when it
+** is longer than COLSTATS_KEY_BYTES.
+*/
+struct ColumnAccumulator
+{
+    ColumnStat*                         stat;
+    vector<unsigned char>               hll;
+    std::unordered_map<string, int64_t> freq;
+    int64_t                             dropped;    // 丢弃的计数上限之和
+    vector<StatValue>                   reservoir;
+    int64_t                             seen;       // 进入样本的非NULL值个数
+    std::mt19937                        rng;
+    int                                 capacity;
+
+    ColumnAccumulator(ColumnStat* s, int reservoirSize, unsigned seed)
+        : stat(s), hll((size_t)1 << COLSTATS_HLL_BITS), dropped(0), seen(0), rng(seed)
+        , capacity(reservoirSize)
+    {}
+
+    void Add(const string& key, uint64_t hash, const StatValue& value);
+    void Prune();
+    double HllEstimate() const;
+};
+
+static StatValue keyToValue(const string& key)
+{
+    StatValue v;
+    switch (key[0])
+    {
+    case 'i': v.type = SQLITE_INTEGER; memcpy(&v.i, key.data() + 1, 8); break;
+    case 'r': v.type = SQLITE_FLOAT; memcpy(&v.r, key.data() + 1, 8); break;
+    case 't': v.type = SQLITE_TEXT; v.s = key.substr(1); break;
+    case 'b': v.type = SQLITE_BLOB; v.s = key.substr(1); break;
+    case 'T': v.type = SQLITE_TEXT; v.s = key.substr(9); break;
+    case 'B': v.type = SQLITE_BLOB; v.s = key.substr(9); break;
+    }
+    return v;
+}
+
+// 值的频率表键和哈希，整数值的实数按整数计
+static void makeKey(StatValue& v, string& key, uint64_t& hash)
+{
+    if (v.type == SQLITE_FLOAT && v.r == std::floor(v.r) && std::fabs(v.r) < 9.2e18)
+    {
+        v.type = SQLITE_INTEGER;
+        v.i = (int64_t)v.r;
+    }
+    if (v.type == SQLITE_INTEGER || v.type == SQLITE_FLOAT)
+    {
+        key.assign(1, v.type == SQLITE_INTEGER ? 'i' : 'r');
+        key.append(v.type == SQLITE_INTEGER ? (const char*)&v.i : (const char*)&v.r, 8);
+        hash = hashBytes(key.data(), key.size());
+        return;
+    }
+    bool text = v.type == SQLITE_TEXT;
+    if (v.s.size() <= COLSTATS_KEY_BYTES)
+    {
+        key.assign(1, text ? 't' : 'b');
+        key.append(v.s);
+        hash = hashBytes(key.data(), key.size());
+        return;
+    }
+    uint64_t h = hashBytes(v.s.data(), v.s.size()) ^ (text ? 0 : 0x9e3779b97f4a7c15ULL);
+    key.assign(1, text ? 'T' : 'B');
+    key.append((const char*)&h, 8);
+    key.append(v.s, 0, COLSTATS_KEY_BYTES);
+    hash = mix64(h);
+    v.s.resize(COLSTATS_KEY_BYTES);
+}
+
+void ColumnAccumulator::Add(const string &key, uint64_t hash, const StatValue &value)
+{
+    // 高位选寄存器，其余位的前导零个数加1
+    size_t reg = (size_t)(hash >> (64 - COLSTATS_HLL_BITS));
+    uint64_t rest = hash << COLSTATS_HLL_BITS;
+    unsigned char rank = 1;
+    while (rank <= 64 - COLSTATS_HLL_BITS && (rest & 0x8000000000000000ULL) == 0)
+    {
+        rest <<= 1;
+        rank++;
+    }
+    if (rank > hll[reg]) hll[reg] = rank;
+
+    freq[key]++;
+    if (freq.size() > COLSTATS_MAX_FREQ) Prune();
+
+    if (stat->minValue.IsNull() || value < stat->minValue) stat->minValue = value;
+    if (stat->maxValue.IsNull() || stat->maxValue < value) stat->maxValue = value;
+
+    // 蓄水池抽样
+    seen++;
+    if ((int64_t)reservoir.size() < capacity)
+    {
+        reservoir.push_back(value);
+    }
+    else
+    {
+        std::uniform_int_distribution<int64_t> pick(0, seen - 1);
+        int64_t j = pick(rng);
+        if (j < capacity) reservoir[j] = value;
+    }
+}
+
+void ColumnAccumulator::Prune()
+{
+    // 丢弃计数不超过中位数的值，保留的计数最多少算了dropped
+    vector<int64_t> counts;
+    counts.reserve(freq.size());
+    for (auto it=freq.begin(); it!=freq.end(); ++it) counts.push_back(it->second);
+    std::nth_element(counts.begin(), counts.begin() + counts.size() / 2, counts.end());
+    int64_t threshold = counts[counts.size() / 2];
+    for (auto it=freq.begin(); it!=freq.end(); )
+    {
+        if (it->second <= threshold) it = freq.erase(it);
+        else ++it;
+    }
+    dropped += threshold;
+    stat->topApprox = true;
+}
+
+double ColumnAccumulator::HllEstimate() const
+{
+    double m = (double)hll.size();
+    double sum = 0;
+    int zeros = 0;
+    for (size_t k=0; k<hll.size(); ++k)
+    {
+        sum += std::ldexp(1.0, -hll[k]);
+        if (hll[k] == 0) zeros++;
+    }
+    double est = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // 小基数时用线性计数
+    if (est <= 2.5 * m && zeros > 0) est = m * std::log(m / zeros);
+    return est;
+}
+
+CSQLite3ColumnStats::CSQLite3ColumnStats()
+    : m_cancel(false)
+    , m_estRows(0)
+    , m_exact(false)
+{
+
+}
+
+void CSQLite3ColumnStats::Cancel()
+{
+    m_cancel = true;
+    m_scan.Cancel();
+}
+
+bool CSQLite3ColumnStats::Run(const string &path, const CSQLite3Schema &schema, const string &table,
+                              const ColumnStatsOptions &opts,
+                              const std::function<void (int, int)> &onProgress)
+{
+    m_err.clear();
+    m_columns.clear();
+    m_estRows = 0;
+    m_exact = false;
+
+    const SchemaObject* obj = schema.Find(table);
+    if (obj == NULL || obj->type != "table" || obj->rootpage <= 1)
+    {
+        m_err = "no such table: " + table;
+        return false;
+    }
+    if (obj->withoutRowid)
+    {
+        m_err = table + " is a WITHOUT ROWID table, only rowid tables are read";
+        return false;
+    }
+    if (!m_scan.Open(path))
+    {
+        m_err = m_scan.GetError();
+        return false;
+    }
+
+    // 记录中的字段对应的列，VIRTUAL生成列不存储
+    int nField = obj->fields.empty() ? (int)obj->columns.size() : (int)obj->fields.size();
+    if (nField == 0)
+    {
+        m_err = "no columns known for " + table;
+        return false;
+    }
+    m_columns.resize(nField);
+    vector<ColumnAccumulator*> accs(nField);
+    for (int f=0; f<nField; ++f)
+    {
+        const SchemaColumn* col = obj->fields.empty() ? &obj->columns[f] : obj->Field(f);
+        m_columns[f].name = col->name;
+        m_columns[f].declType = col->type;
+        accs[f] = new ColumnAccumulator(&m_columns[f], std::max(opts.reservoir, 1), 1 + f);
+    }
+
+    RawScanOptions scanOpts;
+    scanOpts.ipkColumn = obj->ipk;
+    scanOpts.nThreads = opts.nThreads;
+    scanOpts.sampleLeaves = opts.sampleLeaves;
+    scanOpts.seed = (unsigned)obj->rootpage;
+
+    // 累加与批的顺序无关，每个工作线程在扫描的锁外累加自己解码的批；
+    // 各列有自己的锁，从不同的列开始，减少线程间的等待
+    scanOpts.unordered = true;
+    vector<std::mutex> locks(nField);
+    bool ok = m_scan.Scan(obj->rootpage, scanOpts, [&](const RawBatch& batch) {
+        const ExportBatch& data = batch.data;
+        string key;
+        for (int k=0; k<nField; ++k)
+        {
+            int f = (int)((batch.seq + k) % nField);
+            std::lock_guard<std::mutex> lock(locks[f]);
+            ColumnStat& stat = m_columns[f];
+            if (f >= (int)data.columns.size())
+            {
+                stat.nulls += data.rows;
+                continue;
+            }
+            const ExportBatch::Column& col = data.columns[f];
+            size_t iInt = 0, iReal = 0, iLen = 0, ofst = 0;
+            for (int r=0; r<data.rows; ++r)
+            {
+                StatValue v;
+                v.type = col.types[r];
+                switch (v.type)
+                {
+                case SQLITE_INTEGER: v.i = col.ints[iInt++]; stat.ints++; break;
+                case SQLITE_FLOAT: v.r = col.reals[iReal++]; stat.reals++; break;
+                case SQLITE_TEXT:
+                case SQLITE_BLOB:
+                {
+                    uint32_t len = col.lens[iLen++];
+                    v.s.assign(col.bytes, ofst, len);
+                    ofst += len;
+                    stat.bytes += len;
+                    if (v.type == SQLITE_TEXT) stat.texts++;
+                    else stat.blobs++;
+                    break;
+                }
+                default:
+                    stat.nulls++;
+                    continue;
+                }
+                uint64_t hash;
+                makeKey(v, key, hash);
+                accs[f]->Add(key, hash, v);
+            }
+        }
+    }, onProgress);
+
+    const RawScanStats& stats = m_scan.GetStats();
+    if (ok && !m_cancel)
+    {
+        m_exact = stats.leaves >= stats.totalLeaves;
+        double scale = stats.leaves > 0 ? (double)stats.totalLeaves / stats.leaves : 1;
+        m_estRows = stats.rows * scale;
+
+        for (int f=0; f<nField; ++f)
+        {
+            ColumnStat& stat = m_columns[f];
+            ColumnAccumulator& acc = *accs[f];
+            double n = (double)stat.Values();
+            double N = n * scale;
+
+            // 不同值个数
+            int64_t f1 = 0, repeated = 0;
+            for (auto it=acc.freq.begin(); it!=acc.freq.end(); ++it)
+            {
+                if (it->second == 1) f1++;
+                else repeated++;
+            }
+            double d = (double)acc.freq.size();
+            double ones = (double)f1;
+            if (acc.dropped > 0)
+            {
+                // 频率表不完整：不在表中的值当作只出现一次
+                d = std::min(acc.HllEstimate(), n);
+                ones = std::max(0.0, d - repeated);
+            }
+            stat.distinctExact = m_exact && acc.dropped == 0;
+            if (m_exact || n == 0)
+                stat.distinct = d;
+            else
+                stat.distinct = std::min(n * d / (n - ones + ones * n / N), N);
+
+            // 最常见的值
+            vector<std::pair<int64_t, const string*> > top;
+            for (auto it=acc.freq.begin(); it!=acc.freq.end(); ++it)
+            {
+                // 只出现一次的值不算常见
+                if (it->second > 1) top.push_back(std::make_pair(it->second, &it->first));
+            }
+            size_t k = std::min(top.size(), (size_t)std::max(opts.topK, 0));
+            std::partial_sort(top.begin(), top.begin() + k, top.end(),
+                              [](const std::pair<int64_t, const string*>& a, const std::pair<int64_t, const string*>& b) {
+                return a.first != b.first ? a.first > b.first : *a.second < *b.second;
+            });
+            for (size_t j=0; j<k; ++j)
+            {
+                StatTopValue tv;
+                tv.value = keyToValue(*top[j].second);
+                tv.rows = top[j].first * scale;
+                stat.topK.push_back(tv);
+            }
+
+            // 等深直方图，相同的值不跨桶
+            vector<StatValue>& res = acc.reservoir;
+            std::sort(res.begin(), res.end());
+            size_t nRes = res.size();
+            size_t per = std::max<size_t>(1, (nRes + opts.buckets - 1) / std::max(opts.buckets, 1));
+            for (size_t start=0; start<nRes; )
+            {
+                size_t end = std::min(nRes, start + per);
+                while (end < nRes && res[end] == res[end-1]) ++end;
+                StatBucket b;
+                b.upper = res[end-1];
+                b.rows = N * (end - start) / nRes;
+                b.distinct = 1;
+                for (size_t j=start+1; j<end; ++j)
+                {
+                    if (!(res[j] == res[j-1])) b.distinct++;
+                }
+                stat.histogram.push_back(b);
+                start = end;
+            }
+        }
+        CompareWithStat(path, schema, *obj);
+    }
+
+    for (size_t f=0; f<accs.size(); ++f) delete accs[f];
+    if (m_cancel)
+    {
+        m_err = "cancelled";
+        return false;
+    }
+    if (!ok)
+    {
+        m_err = m_scan.GetError();
+        return false;
+    }
+    return true;
+}
+
+bool CSQLite3ColumnStats::DecodeFirstField(const unsigned char *rec, int n, StatValue &value)
+{
+    const unsigned char* end = rec + n;
+    int64_t hdrSize, st;
+    int k = getVarint(rec, end, &hdrSize);
+    if (k == 0 || hdrSize <= k || hdrSize > n) return false;
+    if (getVarint(rec + k, rec + hdrSize, &st) == 0) return false;
+    const unsigned char* v = rec + hdrSize;
+
+    value = StatValue();
+    if (st == 0 || st == 10 || st == 11) return true;
+    if (st == 8 || st == 9)
+    {
+        value.type = SQLITE_INTEGER;
+        value.i = st - 8;
+        return true;
+    }
+    if (st <= 7)
+    {
+        static const int sizes[] = { 0, 1, 2, 3, 4, 6, 8, 8 };
+        if (v + sizes[st] > end) return false;
+        uint64_t x = (st == 7 || (v[0] & 0x80) == 0) ? 0 : ~0ULL;
+        for (int j=0; j<sizes[st]; ++j) x = (x << 8) | v[j];
+        if (st == 7)
+        {
+            value.type = SQLITE_FLOAT;
+            memcpy(&value.r, &x, 8);
+        }
+        else
+        {
+            value.type = SQLITE_INTEGER;
+            value.i = (int64_t)x;
+        }
+        return true;
+    }
+    int64_t len = (st - 12) / 2;
+    if (v + len > end) return false;
+    value.type = (st & 1) ? SQLITE_TEXT : SQLITE_BLOB;
+    value.s.assign((const char*)v, (size_t)len);
+    return true;
+}
+
+static vector<double> parseNumbers(const char* p)
+{
+    vector<double> out;
+    if (p == NULL) return out;
+    char* q = (char*)p;
+    while (isdigit((unsigned char)*q))
+    {
+        out.push_back(strtod(q, &q));
+        while (*q == ' ') ++q;
+    }
+    return out;
+}
+
+/*
+** For each column that starts an index with statistics: the index's
+** sqlite_stat1 gives N/a1 distinct values (NULL counting as one), and
+** every sqlite_stat4 sample is set against the rows we would expect equal
+** to and below its first column, from the top values (or N/distinct for
+** the others) and the histogram.
+*/
+void CSQLite3ColumnStats::CompareWithStat(const string &path, const CSQLite3Schema &schema,
+                                          const SchemaObject &table)
+{
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        return;
+    }
+
+    double scale = ScanStats().leaves > 0 ? (double)ScanStats().totalLeaves / ScanStats().leaves : 1;
+    const vector<SchemaObject>& objects = schema.Objects();
+    for (auto it=objects.begin(); it!=objects.end(); ++it)
+    {
+        if (it->type != "index" || it->columns.empty() || it->columns[0].cid < 0) continue;
+        if (sqlite3_stricmp(it->tblName.c_str(), table.name.c_str()) != 0) continue;
+
+        // 索引第一列对应的字段
+        int f = -1;
+        for (size_t k=0; k<m_columns.size(); ++k)
+        {
+            const SchemaColumn* col = table.fields.empty() ? &table.columns[k] : table.Field((int)k);
+            if (col && col->cid == it->columns[0].cid) f = (int)k;
+        }
+        if (f < 0 || !m_columns[f].statIndex.empty()) continue;
+        ColumnStat& stat = m_columns[f];
+
+        sqlite3_stmt* stmt = NULL;
+        if (sqlite3_prepare_v2(db, "SELECT stat FROM sqlite_stat1 WHERE idx = ?1 COLLATE NOCASE",
+                               -1, &stmt, NULL) == SQLITE_OK)
+        {
+            sqlite3_bind_text(stmt, 1, it->name.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                vector<double> nums = parseNumbers((const char*)sqlite3_column_text(stmt, 0));
+                if (nums.size() >= 2 && nums[1] > 0)
+                {
+                    stat.statIndex = it->name;
+                    stat.stat1Distinct = nums[0] / nums[1];
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+        stmt = NULL;
+
+        if (sqlite3_prepare_v2(db, "SELECT neq, nlt, sample FROM sqlite_stat4 WHERE idx = ?1 COLLATE NOCASE",
+                               -1, &stmt, NULL) == SQLITE_OK)
+        {
+            sqlite3_bind_text(stmt, 1, it->name.c_str(), -1, SQLITE_TRANSIENT);
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                vector<double> neq = parseNumbers((const char*)sqlite3_column_text(stmt, 0));
+                vector<double> nlt = parseNumbers((const char*)sqlite3_column_text(stmt, 1));
+                Stat4Check check;
+                if (neq.empty() || nlt.empty()
+                    || !DecodeFirstField((const unsigned char*)sqlite3_column_blob(stmt, 2),
+                                         sqlite3_column_bytes(stmt, 2), check.value))
+                    continue;
+                check.neq = neq[0];
+                check.nlt = nlt[0];
+                stat.statIndex = it->name;
+                stat.stat4.push_back(check);
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+
+    // 我们对每个样本值的估计
+    for (auto c=m_columns.begin(); c!=m_columns.end(); ++c)
+    {
+        if (c->stat4.empty()) continue;
+        double nulls = c->nulls * scale;
+        double values = c->Values() * scale;
+        for (auto s=c->stat4.begin(); s!=c->stat4.end(); ++s)
+        {
+            s->estEq = nulls;
+            s->estLt = 0;
+            if (s->value.IsNull()) continue;
+            s->estEq = c->distinct > 0 ? values / c->distinct : 0;
+            for (auto t=c->topK.begin(); t!=c->topK.end(); ++t)
+            {
+                if (t->value == s->value) s->estEq = t->rows;
+            }
+            // 直方图桶内按线性插值
+            s->estLt = nulls;
+            for (auto b=c->histogram.begin(); b!=c->histogram.end(); ++b)
+            {
+                if (b->upper < s->value)
+                {
+                    s->estLt += b->rows;
+                    continue;
+                }
+                if (!(b->upper == s->value)) s->estLt += b->rows / 2;
+                else s->estLt += std::max(0.0, b->rows - s->estEq);
+                break;
+            }
+        }
+    }
+}
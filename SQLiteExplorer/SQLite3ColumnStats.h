@@ -0,0 +1,164 @@
+#ifndef SQLITE3COLUMNSTATS_H
+#define SQLITE3COLUMNSTATS_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "sqlite3.h"
+#include "SQLite3Schema.h"
+#include "SQLite3RawScan.h"
+
+using std::string;
+using std::vector;
+
+// 统计中的一个值，按sqlite的顺序比较：NULL < 数字 < TEXT < BLOB
+struct StatValue
+{
+    int     type;       // SQLITE_NULL/INTEGER/FLOAT/TEXT/BLOB
+    int64_t i;
+    double  r;
+    string  s;          // TEXT/BLOB的内容，TEXT为数据库编码
+
+    StatValue() : type(SQLITE_NULL), i(0), r(0) {}
+
+    bool IsNull() const { return type == SQLITE_NULL; }
+    bool operator<(const StatValue& other) const { return Compare(other) < 0; }
+    bool operator==(const StatValue& other) const { return Compare(other) == 0; }
+    int Compare(const StatValue& other) const;
+    // 显示用，最长maxChars个字符
+    string ToString(int maxChars = 64) const;
+};
+
+// 等深直方图的一个桶，包含上一个桶的上界之后到upper的值
+struct StatBucket
+{
+    StatValue   upper;
+    double      rows;       // 估计的行数
+    int         distinct;   // 样本中不同值的个数
+};
+
+// 出现最多的值
+struct StatTopValue
+{
+    StatValue   value;
+    double      rows;       // 估计的行数
+};
+
+// sqlite_stat4的一个样本和我们的估计
+struct Stat4Check
+{
+    StatValue   value;      // 样本中第一列的值
+    double      neq;        // stat4中等于该值的行数
+    double      nlt;        // stat4中小于该值的行数
+    double      estEq;      // 我们估计的等于该值的行数
+    double      estLt;
+};
+
+// 一列的统计，计数都是被扫描的行中的
+struct ColumnStat
+{
+    string  name;
+    string  declType;
+    int64_t nulls;
+    int64_t ints;
+    int64_t reals;
+    int64_t texts;
+    int64_t blobs;
+    int64_t bytes;          // TEXT/BLOB的总字节数
+
+    double  distinct;       // 估计整张表中不同的非NULL值个数
+    bool    distinctExact;  // 完整扫描并且没有超出精确计数的上限
+    bool    topApprox;      // topK的行数是下界
+    StatValue minValue;     // 被扫描的行中的最小值和最大值，都是NULL表示没有值
+    StatValue maxValue;
+    vector<StatTopValue> topK;
+    vector<StatBucket>   histogram;
+
+    // 与以该列开头的索引的sqlite_stat1/stat4比较
+    string  statIndex;      // 索引名，空表示没有统计
+    double  stat1Distinct;  // stat1的N/a1，包括NULL，<0表示没有
+    vector<Stat4Check> stat4;
+
+    ColumnStat()
+        : nulls(0), ints(0), reals(0), texts(0), blobs(0), bytes(0)
+        , distinct(0), distinctExact(false), topApprox(false), stat1Distinct(-1)
+    {}
+
+    int64_t Values() const { return ints + reals + texts + blobs; }
+    double NullFraction() const { int64_t n = nulls + Values(); return n > 0 ? (double)nulls / n : 0; }
+    double AvgBytes() const { return texts + blobs > 0 ? (double)bytes / (texts + blobs) : 0; }
+};
+
+struct ColumnStatsOptions
+{
+    int     sampleLeaves;   // 抽取的叶子页数，0表示扫描全部
+    int     topK;           // 保留的最常见值个数
+    int     buckets;        // 直方图的桶数
+    int     reservoir;      // 用于直方图的每列样本数
+    int     nThreads;       // 0为CPU核数
+
+    ColumnStatsOptions() : sampleLeaves(200), topK(10), buckets(16), reservoir(20000), nThreads(0) {}
+};
+
+/*
+** Per-column statistics of a table read through the page decoder.
+**
+** A uniform random sample of the table's leaf pages (or every leaf, for
+** exact numbers) is decoded by CSQLite3RawScan and each value is folded
+** into the column's accumulator: counts per storage class, min and max,
+** a HyperLogLog sketch of the distinct values, a frequency table for
+** the most common values and a reservoir sample for the equi-depth
+** histogram.  Integral reals count as the integer they equal, as sqlite
+** compares them.  The frequency table is exact up to 65536 distinct
+** values; past that the rarest entries are dropped (lossy counting) and
+** the top values become lower bounds.
+**
+** From a sample the row count is scaled by the leaves not read, and the
+** distinct count comes from the Haas-Stokes Duj1 estimator that
+** PostgreSQL's ANALYZE uses, n*d / (n - f1 + f1*n/N), where f1 values were
+** seen once; once the frequency table has overflowed d is taken from the
+** sketch and the values it no longer holds count as seen once.  Pages
+** are sampled whole, so clustered values (a timestamp in rowid order)
+** are under-counted; the exact mode has no such bias.
+**
+** The result is put next to sqlite_stat1 and sqlite_stat4 of any index
+** whose first column is the column.  Only rowid tables are read.
+*/
+class CSQLite3ColumnStats
+{
+public:
+    CSQLite3ColumnStats();
+
+    bool Run(const string& path, const CSQLite3Schema& schema, const string& table,
+             const ColumnStatsOptions& opts,
+             const std::function<void(int done, int total)>& onProgress = nullptr);
+
+    void Cancel();
+    // 同时清除内部扫描的标志
+    void ClearCancel() { m_cancel = false; m_scan.ClearCancel(); }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    const vector<ColumnStat>& Columns() const { return m_columns; }
+    double EstimatedRows() const { return m_estRows; }
+    bool Exact() const { return m_exact; }
+    const RawScanStats& ScanStats() const { return m_scan.GetStats(); }
+
+    // 解码记录中的第一个字段，sqlite_stat4的sample列用
+    static bool DecodeFirstField(const unsigned char* rec, int n, StatValue& value);
+
+private:
+    // 读出表上的索引的sqlite_stat1和stat4，填写statIndex、stat1Distinct和stat4
+    void CompareWithStat(const string& path, const CSQLite3Schema& schema, const SchemaObject& table);
+
+private:
+    string              m_err;
+    std::atomic<bool>   m_cancel;
+    CSQLite3RawScan     m_scan;
+    vector<ColumnStat>  m_columns;
+    double              m_estRows;
+    bool                m_exact;
+};
+
+#endif // SQLITE3COLUMNSTATS_H
@@ -0,0 +1,336 @@
+#include "SQLite3Compare.h"
+#include "SQLite3File.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <map>
+#include <cmath>
+
+// 至少有这么多个值时才判断异常
+static const int COMPARE_MIN_GROUP = 3;
+
+CSQLite3Compare::CSQLite3Compare()
+    : m_cancel(false)
+{
+}
+
+void CSQLite3Compare::Cancel()
+{
+    m_cancel = true;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it=m_scans.begin(); it!=m_scans.end(); ++it)
+    {
+        (*it)->Cancel();
+    }
+}
+
+// FNV-1a
+static void hashBytes(uint64_t& h, const string& s)
+{
+    for (size_t i=0; i<s.size(); ++i)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    // 分隔符，使("ab","c")与("a","bc")不同
+    h ^= 0xff;
+    h *= 1099511628211ULL;
+}
+
+void CSQLite3Compare::AnalyzeFile(int index, vector<CompareObject> &objects)
+{
+    CompareFile& file = m_files[index];
+    CSQLite3RawScan rs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_cancel) return;
+        m_scans.push_back(&rs);
+    }
+
+    if (!rs.Open(file.path))
+    {
+        file.err = rs.GetError();
+    }
+    else if (rs.PageCount() == 0)
+    {
+        file.err = "not a database file";
+    }
+    else
+    {
+        file.pageSize = rs.PageSize();
+        file.pages = rs.PageCount();
+        file.freelist = rs.FreelistCount();
+
+        vector<RawTable> tables;
+        rs.ListTables(tables);
+        RawTable master;
+        master.type = "table";
+        master.name = "sqlite_master";
+        master.root = 1;
+        tables.push_back(master);
+        std::sort(tables.begin(), tables.end(), [](const RawTable& a, const RawTable& b) {
+            return StrLower(a.name) < StrLower(b.name);
+        });
+
+        file.schemaHash = 14695981039346656037ULL;
+        for (auto it=tables.begin(); it!=tables.end() && !m_cancel; ++it)
+        {
+            hashBytes(file.schemaHash, it->type);
+            hashBytes(file.schemaHash, it->name);
+            hashBytes(file.schemaHash, it->sql);
+            if (it->root <= 0) continue;
+
+            CompareObject obj;
+            obj.file = index;
+            obj.type = it->type;
+            obj.name = it->name;
+            rs.Analyze(it->root, obj.stats);
+            objects.push_back(obj);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scans.erase(std::find(m_scans.begin(), m_scans.end(), &rs));
+}
+
+bool CSQLite3Compare::Run(const vector<string> &paths, const CompareOptions &opts,
+                          const std::function<void (int, int)> &onProgress)
+{
+    m_files.assign(paths.size(), CompareFile());
+    m_objects.clear();
+    for (size_t i=0; i<paths.size(); ++i)
+    {
+        m_files[i].path = paths[i];
+    }
+
+    // 每个文件一个任务，同时运行的任务数即同时读取的文件数
+    int n = (int)paths.size();
+    vector<vector<CompareObject> > perFile(n);
+    std::atomic<int> done(0);
+    ParallelFor(n, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t i=begin; i<end && !m_cancel; ++i)
+        {
+            AnalyzeFile((int)i, perFile[i]);
+            int d = ++done;
+            if (onProgress) onProgress(d, n);
+        }
+    }, std::max(1, opts.ioConcurrency));
+
+    for (int i=0; i<n; ++i)
+    {
+        m_objects.insert(m_objects.end(), perFile[i].begin(), perFile[i].end());
+    }
+    FindOutliers(opts.threshold);
+    return !m_cancel;
+}
+
+static double median(vector<double> v)
+{
+    if (v.empty()) return 0;
+    size_t mid = v.size() / 2;
+    std::nth_element(v.begin(), v.begin() + mid, v.end());
+    double m = v[mid];
+    if (v.size() % 2 == 0)
+        m = (m + *std::max_element(v.begin(), v.begin() + mid)) / 2;
+    return m;
+}
+
+/*
+** Robust z-scores.  When more than half of the values are equal the MAD
+** is 0; the mean absolute deviation (scaled to match the MAD of a normal
+** distribution) is used instead, so a single differing shard among many
+** identical ones is still caught.
+*/
+static void flagOutliers(const vector<double>& xs, double threshold, vector<bool>& out)
+{
+    out.assign(xs.size(), false);
+    if ((int)xs.size() < COMPARE_MIN_GROUP) return;
+
+    double m = median(xs);
+    vector<double> dev(xs.size());
+    double sumDev = 0;
+    for (size_t i=0; i<xs.size(); ++i)
+    {
+        dev[i] = std::fabs(xs[i] - m);
+        sumDev += dev[i];
+    }
+    double scale = median(dev) / 0.6745;
+    if (scale <= 0) scale = sumDev / xs.size() * 1.2533;
+    if (scale <= 0) return;
+    for (size_t i=0; i<xs.size(); ++i)
+    {
+        out[i] = dev[i] / scale > threshold;
+    }
+}
+
+void CSQLite3Compare::FindOutliers(double threshold)
+{
+    m_objects.erase(std::remove_if(m_objects.begin(), m_objects.end(),
+                                   [](const CompareObject& o) { return o.missing; }),
+                    m_objects.end());
+    vector<int> readable;
+    for (size_t i=0; i<m_files.size(); ++i)
+    {
+        m_files[i].outliers = 0;
+        if (m_files[i].err.empty()) readable.push_back((int)i);
+    }
+    int nReadable = (int)readable.size();
+
+    // 文件：页数、自由页数、schema
+    vector<double> pages, freelist;
+    std::map<uint64_t, int> hashes;
+    for (auto it=readable.begin(); it!=readable.end(); ++it)
+    {
+        pages.push_back((double)m_files[*it].pages);
+        freelist.push_back((double)m_files[*it].freelist);
+        hashes[m_files[*it].schemaHash]++;
+    }
+    vector<bool> flags;
+    flagOutliers(pages, threshold, flags);
+    for (int i=0; i<nReadable; ++i)
+    {
+        if (flags[i]) m_files[readable[i]].outliers |= COMPARE_FILE_PAGES;
+    }
+    flagOutliers(freelist, threshold, flags);
+    for (int i=0; i<nReadable; ++i)
+    {
+        if (flags[i]) m_files[readable[i]].outliers |= COMPARE_FREELIST;
+    }
+    uint64_t common = 0;
+    int commonCount = 0;
+    for (auto it=hashes.begin(); it!=hashes.end(); ++it)
+    {
+        if (it->second > commonCount)
+        {
+            common = it->first;
+            commonCount = it->second;
+        }
+    }
+    if (commonCount * 2 > nReadable)
+    {
+        for (auto it=readable.begin(); it!=readable.end(); ++it)
+        {
+            if (m_files[*it].schemaHash != common) m_files[*it].outliers |= COMPARE_SCHEMA;
+        }
+    }
+
+    // 对象：按名称分组
+    std::map<string, vector<int> > groups;
+    for (size_t i=0; i<m_objects.size(); ++i)
+    {
+        groups[StrLower(m_objects[i].name)].push_back((int)i);
+    }
+    vector<CompareObject> missing;
+    for (auto g=groups.begin(); g!=groups.end(); ++g)
+    {
+        const vector<int>& idx = g->second;
+        vector<double> rows, size, fill;
+        vector<char> present(m_files.size(), 0);
+        for (auto it=idx.begin(); it!=idx.end(); ++it)
+        {
+            const CompareObject& o = m_objects[*it];
+            rows.push_back((double)o.stats.entries);
+            size.push_back((double)(o.stats.pages + o.stats.overflow));
+            fill.push_back(o.stats.Fill());
+            present[o.file] = 1;
+        }
+        unsigned bits[3] = { COMPARE_ROWS, COMPARE_PAGES, COMPARE_FILL };
+        const vector<double>* values[3] = { &rows, &size, &fill };
+        for (int k=0; k<3; ++k)
+        {
+            flagOutliers(*values[k], threshold, flags);
+            for (size_t i=0; i<idx.size(); ++i)
+            {
+                if (flags[i]) m_objects[idx[i]].outliers |= bits[k];
+                else m_objects[idx[i]].outliers &= ~bits[k];
+            }
+        }
+
+        if ((int)idx.size() * 2 <= nReadable) continue;
+        for (auto it=readable.begin(); it!=readable.end(); ++it)
+        {
+            if (present[*it]) continue;
+            CompareObject o = m_objects[idx[0]];
+            o.file = *it;
+            o.stats = RawBtreeStats();
+            o.outliers = COMPARE_MISSING;
+            o.missing = true;
+            missing.push_back(o);
+        }
+    }
+    m_objects.insert(m_objects.end(), missing.begin(), missing.end());
+    std::stable_sort(m_objects.begin(), m_objects.end(), [](const CompareObject& a, const CompareObject& b) {
+        return a.file < b.file;
+    });
+}
+
+string CSQLite3Compare::OutlierNames(unsigned outliers)
+{
+    static const struct { unsigned bit; const char* name; } names[] = {
+        { COMPARE_ROWS, "rows" },
+        { COMPARE_PAGES, "pages" },
+        { COMPARE_FILL, "fill" },
+        { COMPARE_MISSING, "missing" },
+        { COMPARE_FILE_PAGES, "file_pages" },
+        { COMPARE_FREELIST, "freelist" },
+        { COMPARE_SCHEMA, "schema" },
+    };
+    string s;
+    for (size_t i=0; i<sizeof(names)/sizeof(names[0]); ++i)
+    {
+        if (outliers & names[i].bit)
+        {
+            if (s.size()) s += ";";
+            s += names[i].name;
+        }
+    }
+    return s;
+}
+
+static string csvField(const string& s)
+{
+    if (s.find_first_of(",\"\r\n") == string::npos) return s;
+    string q = "\"";
+    for (size_t i=0; i<s.size(); ++i)
+    {
+        if (s[i] == '"') q += '"';
+        q += s[i];
+    }
+    return q + "\"";
+}
+
+bool CSQLite3Compare::WriteCsv(const string &path, string &err) const
+{
+    FILE* fp = path.empty() ? stdout : CSQLite3File::OpenFile(path, "wb");
+    if (fp == NULL)
+    {
+        err = "cannot create " + path;
+        return false;
+    }
+
+    fprintf(fp, "file,object,type,rows,pages,overflow_pages,fill,file_pages,page_size,freelist_pages,outliers,error\r\n");
+    size_t k = 0;
+    for (size_t f=0; f<m_files.size(); ++f)
+    {
+        const CompareFile& file = m_files[f];
+        if (file.err.size())
+        {
+            fprintf(fp, "%s,,,,,,,,,,,%s\r\n", csvField(file.path).c_str(), csvField(file.err).c_str());
+        }
+        for (; k<m_objects.size() && m_objects[k].file == (int)f; ++k)
+        {
+            const CompareObject& o = m_objects[k];
+            fprintf(fp, "%s,%s,%s,%lld,%lld,%lld,%.4f,%lld,%d,%lld,%s,\r\n",
+                    csvField(file.path).c_str(), csvField(o.name).c_str(), o.type.c_str(),
+                    (long long)o.stats.entries, (long long)o.stats.pages, (long long)o.stats.overflow,
+                    o.stats.Fill(), (long long)file.pages, file.pageSize, (long long)file.freelist,
+                    OutlierNames(o.outliers | file.outliers).c_str());
+        }
+    }
+
+    bool ok = !ferror(fp);
+    if (fp != stdout) ok = fclose(fp) == 0 && ok;
+    else fflush(fp);
+    if (!ok) err = "cannot write " + path;
+    return ok;
+}
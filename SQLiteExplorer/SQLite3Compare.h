@@ -0,0 +1,116 @@
+#ifndef SQLITE3COMPARE_H
+#define SQLITE3COMPARE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "SQLite3RawScan.h"
+
+using std::string;
+using std::vector;
+
+// 比较的指标，也是outliers中的位
+enum CompareMetric
+{
+    COMPARE_ROWS        = 1 << 0,
+    COMPARE_PAGES       = 1 << 1,   // b-tree页加溢出页
+    COMPARE_FILL        = 1 << 2,
+    COMPARE_MISSING     = 1 << 3,   // 多数文件中有而该文件中没有
+    COMPARE_FILE_PAGES  = 1 << 4,
+    COMPARE_FREELIST    = 1 << 5,
+    COMPARE_SCHEMA      = 1 << 6,   // schema与多数文件不同
+};
+
+// 一个数据库文件
+struct CompareFile
+{
+    string   path;
+    string   err;           // 非空表示无法读取
+    int      pageSize;
+    int64_t  pages;
+    int64_t  freelist;      // 自由页数
+    uint64_t schemaHash;
+    unsigned outliers;      // CompareMetric的组合
+
+    CompareFile() : pageSize(0), pages(0), freelist(0), schemaHash(0), outliers(0) {}
+};
+
+// 一个文件中的一张表或一个索引
+struct CompareObject
+{
+    int           file;     // Files()中的下标
+    string        type;
+    string        name;
+    RawBtreeStats stats;
+    unsigned      outliers;
+    bool          missing;  // 文件中没有该对象，只用于标记
+
+    CompareObject() : file(0), outliers(0), missing(false) {}
+};
+
+struct CompareOptions
+{
+    int     ioConcurrency;  // 同时读取的文件数
+    double  threshold;      // 稳健z值超过它视为异常
+
+    CompareOptions() : ioConcurrency(4), threshold(3.5) {}
+};
+
+/*
+** Statistics of the same schema across many database files (shards),
+** and the values that stand out.
+**
+** Each file is handled by one worker of the shared pool, and at most
+** ioConcurrency files are read at once, so a batch of hundreds of files
+** on one disk does not turn into random I/O.  The files are read raw
+** with CSQLite3RawScan: every b-tree is walked once for its page count,
+** row count (cells on table leaves; all cells of an index) and fill
+** factor, overflow pages are counted from the payload sizes, and the
+** freelist size is taken from the header.
+**
+** A value is an outlier when its robust z-score, 0.6745*(x-median)/MAD
+** over the same object in all files, exceeds the threshold.  Objects
+** that most files have and a file lacks, and files whose schema differs
+** from the most common one, are flagged as well.
+*/
+class CSQLite3Compare
+{
+public:
+    CSQLite3Compare();
+
+    bool Run(const vector<string>& paths, const CompareOptions& opts,
+             const std::function<void(int done, int total)>& onProgress = nullptr);
+
+    // 用新的阈值重新标记异常值
+    void FindOutliers(double threshold);
+
+    void Cancel();
+    // 在启动工作线程之前调用
+    void ClearCancel() { m_cancel = false; }
+    bool IsCancelled() const { return m_cancel; }
+
+    const vector<CompareFile>& Files() const { return m_files; }
+    const vector<CompareObject>& Objects() const { return m_objects; }
+
+    // 每个对象一行，文件级的列在每行中重复；无法读取的文件单独一行
+    bool WriteCsv(const string& path, string& err) const;
+
+    // outliers的文字说明，例如"rows;fill"
+    static string OutlierNames(unsigned outliers);
+
+private:
+    void AnalyzeFile(int index, vector<CompareObject>& objects);
+
+private:
+    vector<CompareFile>         m_files;
+    vector<CompareObject>       m_objects;
+    std::atomic<bool>           m_cancel;
+
+    // 正在读取的文件，取消时通知它们
+    std::mutex                  m_mutex;
+    vector<CSQLite3RawScan*>    m_scans;
+};
+
+#endif // SQLITE3COMPARE_H
@@ -22,6 +22,7 @@
 
 #include "SQLite3DB.h"
 #include <algorithm>
+#include <set>
 #include <QDebug>
 #include "utils.h"
 
@@ -69,6 +70,8 @@ CSQLite3DB::CSQLite3DB(const string& path)
 , m_pFd(0)
 , m_path(path)
 , m_bTableInfoHasLoad(false)
+, m_changeCounter(0)
+, m_pCancel(NULL)
 , m_pSqlite3Page(NULL)
 , m_pSqlite3Payload(NULL)
 {
@@ -112,6 +115,38 @@ vector<string> CSQLite3DB::GetAllTableNames()
     return names;
 }
 
+vector<string> CSQLite3DB::GetAllBtreeNames()
+{
+    vector<string> names;
+    LoadSqliteMaster();
+
+    for (map<string, TableSchema>::iterator it=m_mapTableSchema.begin(); it!=m_mapTableSchema.end(); ++it)
+    {
+        if (it->second.rootpage > 0)
+        {
+            names.push_back(it->second.name);
+        }
+    }
+
+    return names;
+}
+
+vector<PageUsageInfo> CSQLite3DB::GetBtreePageUsage(const string &cname)
+{
+    LoadSqliteMaster();
+
+    vector<PageUsageInfo> infos;
+    map<string, TableSchema>::iterator it = m_mapTableSchema.find(StrLower(cname));
+    if (it == m_mapTableSchema.end() || it->second.rootpage == 0)
+        return infos;
+
+    // PageUsageBtree会修改m_pageUsageInfo，先保存当前内容
+    infos.swap(m_pageUsageInfo);
+    PageUsageBtree((int)it->second.rootpage, 0, 0, it->second.name.c_str());
+    infos.swap(m_pageUsageInfo);
+    return infos;
+}
+
 vector<pair<int, PageType> > CSQLite3DB::GetAllPageIdsAndType(const string &cname)
 {
     LoadSqliteMaster();
@@ -195,49 +230,95 @@ string CSQLite3DB::ExecuteCmd(const string& sql, table_content& table , cell_con
     return errmsg;
 }
 
+bool CSQLite3DB::ProfileQuery(const string &sql, int keepRows, bool coldCache, QueryProfile &profile)
+{
+    return CSQLite3Profiler::Run(mpDB, sql, keepRows, coldCache, profile);
+}
+
+bool CSQLite3DB::ExplainQueryPlan(const string &sql, const PlanOptions &opts, QueryPlan &plan)
+{
+    return CSQLite3QueryPlan::Explain(mpDB, GetSchema(), m_path, sql, opts, plan);
+}
+
 bool CSQLite3DB::GetTablePrimaryKey(const string& tableName, vector<string> &pkFieldName, vector<string> &pkType, vector<int> &pkIdx, bool& withoutRowid)
 {
-    bool bGetPkIsOk = false;
-    if(tableName.empty())
+    withoutRowid = false;
+    const SchemaObject* obj = GetSchema().Find(tableName);
+    if(obj == NULL || obj->type != "table")
     {
-        return bGetPkIsOk;
+        return false;
     }
 
-    bGetPkIsOk = true;
-    table_content tb;
-    if(GetTableInfo(tableName, tb))
+    // 按主键中的顺序
+    vector<int> pk;
+    for(size_t i=0; i<obj->fields.size(); ++i)
     {
-        while(!tb.empty())
-        {
-            cell_content cc = tb.front();
-            tb.pop_front();
-            if(cc[5] == "1") // pk
-            {
-                pkIdx.push_back(StrToInt(cc[0].c_str()));
-                pkFieldName.push_back(cc[1]);
-                pkType.push_back(cc[2]);
-            }
-        }
+        if(obj->Field((int)i)->pk > 0) pk.push_back((int)i);
+    }
+    std::sort(pk.begin(), pk.end(), [obj](int a, int b) {
+        return obj->Field(a)->pk < obj->Field(b)->pk;
+    });
+    for(auto it=pk.begin(); it!=pk.end(); ++it)
+    {
+        pkIdx.push_back(*it);
+        pkFieldName.push_back(obj->Field(*it)->name);
+        pkType.push_back(obj->Field(*it)->type);
     }
 
-    withoutRowid = false;
-    string sql = "SELECT sql FROM sqlite_master WHERE type='table' AND tbl_name='" + tableName + "'";
-    CppSQLite3Query q = execQuery(sql.c_str());
-    if(!q.eof())
+    withoutRowid = obj->withoutRowid;
+    return true;
+}
+
+int64_t CSQLite3DB::MemoryUsed()
+{
+    int64_t used = 0;
+    int cur = 0, hi = 0;
+    if (mpDB && sqlite3_db_status(mpDB, SQLITE_DBSTATUS_CACHE_USED, &cur, &hi, 0) == SQLITE_OK)
+        used += cur;
+
+    used += m_pageOwners.owner.capacity() * sizeof(int);
+    used += m_pageOwners.type.capacity() * sizeof(PageType);
+    used += m_pageOwners.fill.capacity();
+    used += m_pageOwners.cellPage.capacity() * sizeof(int);
+    for (auto it=m_pageOwners.names.begin(); it!=m_pageOwners.names.end(); ++it)
     {
-        string txt = q.getStringField(0);
-        txt = txt.substr(txt.find(')'));
-        if(txt.size() > 0)
-        {
-            txt = StrUpper(txt);
-            if(txt.find("WITHOUT") != string::npos && txt.find("ROWID") != string::npos)
-            {
-                withoutRowid = true;
-            }
-        }
+        used += sizeof(string) + it->capacity();
+    }
+    used += m_pageUsageInfo.capacity() * sizeof(PageUsageInfo);
+    for (auto it=m_pageUsageInfo.begin(); it!=m_pageUsageInfo.end(); ++it)
+    {
+        used += it->desc.capacity();
     }
+    for (auto it=m_pragmaInfos.begin(); it!=m_pragmaInfos.end(); ++it)
+    {
+        used += it->first.capacity() + it->second.capacity();
+    }
+    return used;
+}
+
+/*
+** Drop everything that GetPageOwners, GetPageUsageInfos and the pragma
+** cache rebuild on demand, and return the unused pages of the SQLite
+** page cache to the heap.  The schema stays: the tree view needs it and
+** it is small next to the per-page arrays.
+*/
+void CSQLite3DB::ReleaseMemory()
+{
+    PageOwnerMap owners;
+    m_pageOwners.Swap(owners);
+    vector<PageUsageInfo>().swap(m_pageUsageInfo);
+    m_pragmaInfos.clear();
+    if (mpDB) sqlite3_db_release_memory(mpDB);
+}
 
-    return bGetPkIsOk;
+void CSQLite3DB::SetCacheSize(int64_t bytes)
+{
+    if (mpDB == NULL) return;
+    // 负数表示以KiB为单位
+    int64_t kib = bytes / 1024 > 64 ? bytes / 1024 : 64;
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA cache_size=-%lld", (long long)kib);
+    sqlite3_exec(mpDB, sql, 0, 0, 0);
 }
 
 bool CSQLite3DB::GetTableInfo(const string &tableName, table_content &tb)
@@ -254,6 +335,164 @@ vector<PageUsageInfo> CSQLite3DB::GetPageUsageInfos(bool freelist)
     return m_pageUsageInfo;
 }
 
+const PageOwnerMap& CSQLite3DB::GetPageOwners(bool useCache, const std::atomic<bool>* cancel)
+{
+    if (useCache && !m_pageOwners.owner.empty())
+        return m_pageOwners;
+
+    LoadSqliteMaster();
+    m_pageOwners.Clear();
+    m_pageOwners.owner.assign(m_mxPage+1, -1);
+    m_pageOwners.type.assign(m_mxPage+1, PAGE_TYPE_UNKNOWN);
+    m_pageOwners.fill.assign(m_mxPage+1, 0);
+    m_pageOwners.cellPage.assign(m_mxPage+1, 0);
+
+    // m_mapTableSchema中已包含sqlite_master(根页为1)
+    for (map<string, TableSchema>::iterator it=m_mapTableSchema.begin();
+        it != m_mapTableSchema.end();
+        ++it)
+    {
+        if (it->second.rootpage > 0)
+        {
+            m_pageOwners.names.push_back(it->second.name);
+            m_pCancel = cancel;
+            WalkPageOwners((int)m_pageOwners.names.size()-1, (int)it->second.rootpage);
+            m_pCancel = NULL;
+            if (cancel && *cancel) break;
+        }
+    }
+    if (cancel && *cancel)
+    {
+        m_pageOwners.Clear();
+        return m_pageOwners;
+    }
+    WalkFreeListOwners();
+
+    return m_pageOwners;
+}
+
+bool CSQLite3DB::Reload(const vector<int> &changedPages, vector<string> &changedObjects)
+{
+    changedObjects.clear();
+    m_pragmaInfos.clear();
+    m_changeCounter++;
+    // 单页缓存中可能是变化前的内容
+    m_pSqlite3Page->Clear();
+
+    int64_t szFile = FileGetsize();
+    m_mxPage = (int)((szFile+m_pagesize-1)/m_pagesize);
+
+    // schema变化时所有缓存都失效
+    if (m_bTableInfoHasLoad && Pragma("schema_version") != m_schemaVersion)
+    {
+        m_mapTableSchema.clear();
+        m_schema.Clear();
+        m_bTableInfoHasLoad = false;
+        m_pageOwners.Clear();
+        return true;
+    }
+    if (m_pageOwners.owner.empty())
+    {
+        return false;
+    }
+
+    // 变化的页原来所属的b-tree需要重新遍历
+    set<int> owners;
+    bool freelistChanged = false;
+    for (size_t i=0; i<changedPages.size(); ++i)
+    {
+        int pgno = changedPages[i];
+        if (pgno > 0 && pgno < (int)m_pageOwners.owner.size() && m_pageOwners.owner[pgno] >= 0)
+            owners.insert(m_pageOwners.owner[pgno]);
+        else
+            freelistChanged = true;
+    }
+
+    m_pageOwners.owner.resize(m_mxPage+1, -1);
+    m_pageOwners.type.resize(m_mxPage+1, PAGE_TYPE_UNKNOWN);
+    m_pageOwners.fill.resize(m_mxPage+1, 0);
+    m_pageOwners.cellPage.resize(m_mxPage+1, 0);
+    for (set<int>::iterator it=owners.begin(); it!=owners.end(); ++it)
+    {
+        for (size_t pgno=0; pgno<m_pageOwners.owner.size(); ++pgno)
+        {
+            if (m_pageOwners.owner[pgno] == *it)
+            {
+                m_pageOwners.owner[pgno] = -1;
+                m_pageOwners.type[pgno] = PAGE_TYPE_UNKNOWN;
+                m_pageOwners.fill[pgno] = 0;
+                m_pageOwners.cellPage[pgno] = 0;
+            }
+        }
+
+        map<string, TableSchema>::iterator schema = m_mapTableSchema.find(StrLower(m_pageOwners.names[*it]));
+        if (schema != m_mapTableSchema.end())
+            WalkPageOwners(*it, (int)schema->second.rootpage);
+        changedObjects.push_back(m_pageOwners.names[*it]);
+    }
+
+    // 自由页链表只遍历trunk页，代价很小，每次都重新遍历
+    for (size_t pgno=0; pgno<m_pageOwners.owner.size(); ++pgno)
+    {
+        if (m_pageOwners.owner[pgno] < 0)
+            m_pageOwners.type[pgno] = PAGE_TYPE_UNKNOWN;
+    }
+    WalkFreeListOwners();
+
+    for (size_t i=0; i<changedPages.size(); ++i)
+    {
+        int pgno = changedPages[i];
+        if (pgno > 0 && pgno < (int)m_pageOwners.owner.size() && m_pageOwners.owner[pgno] < 0)
+            freelistChanged = true;
+    }
+    if (freelistChanged)
+        changedObjects.push_back("freelist");
+
+    return false;
+}
+
+void CSQLite3DB::WalkPageOwners(int idx, int root)
+{
+    // PageUsageBtree会修改m_pageUsageInfo，先保存当前内容
+    vector<PageUsageInfo> saved;
+    saved.swap(m_pageUsageInfo);
+
+    PageUsageBtree(root, 0, 0, m_pageOwners.names[idx].c_str());
+    for (size_t k=0; k<m_pageUsageInfo.size(); ++k)
+    {
+        int pgno = m_pageUsageInfo[k].pgno;
+        if (pgno <= 0 || pgno > (int)m_mxPage) continue;
+        m_pageOwners.owner[pgno] = idx;
+        m_pageOwners.type[pgno] = m_pageUsageInfo[k].type;
+        // 溢出页除链尾外都是满的，按满页计算
+        if (m_pageUsageInfo[k].type == PAGE_TYPE_OVERFLOW)
+        {
+            m_pageOwners.fill[pgno] = 255;
+            m_pageOwners.cellPage[pgno] = m_pageUsageInfo[k].parent;
+        }
+        else if (m_pagesize > 0)
+            m_pageOwners.fill[pgno] = (unsigned char)(255 * (m_pagesize - m_pageUsageInfo[k].nfree) / m_pagesize);
+    }
+
+    m_pageUsageInfo.swap(saved);
+}
+
+void CSQLite3DB::WalkFreeListOwners()
+{
+    vector<PageUsageInfo> saved;
+    saved.swap(m_pageUsageInfo);
+
+    GetFreeList();
+    for (size_t k=0; k<m_pageUsageInfo.size(); ++k)
+    {
+        int pgno = m_pageUsageInfo[k].pgno;
+        if (pgno <= 0 || pgno > (int)m_mxPage) continue;
+        m_pageOwners.type[pgno] = m_pageUsageInfo[k].type;
+    }
+
+    m_pageUsageInfo.swap(saved);
+}
+
 map<string, string> CSQLite3DB::GetDatabaseInfo()
 {
     if(m_pragmaInfos.size())
@@ -429,10 +668,25 @@ void CSQLite3DB::LoadSqliteMaster()
         tableInfo.rootpage = 1;
         tableInfo.sql = "CREATE TABLE IF NOT EXISTS sqlite_master (type TEXT, name TEXT, tbl_name TEXT, rootpage INTEGER, sql TEXT)";
 
+        m_schemaVersion = Pragma("schema_version");
         m_bTableInfoHasLoad = true;
+
+        m_schema.Load(*this, [this](int pgno) {
+            int hdr = pgno == 1 ? 100 : 0;
+            unsigned char* a = FileRead((int64_t)(pgno-1)*m_pagesize + hdr, 1);
+            int type = a ? a[0] : 0;
+            sqlite3_free(a);
+            return type;
+        });
     }
 }
 
+const CSQLite3Schema &CSQLite3DB::GetSchema()
+{
+    LoadSqliteMaster();
+    return m_schema;
+}
+
 bool CSQLite3DB::OpenDatabase()
 {
     try
@@ -552,9 +806,10 @@ void CSQLite3DB::PageUsageBtree( int pgno, /* Page to describe */
     int i;
     int hdr = pgno==1 ? 100 : 0;
     PageUsageInfo info;
-    static char zDesc[1000] = {0};
+    char zDesc[1000] = {0};
 
     if( pgno<=0 || pgno>m_mxPage ) return;
+    if( m_pCancel && *m_pCancel ) return;
     a = FileRead((pgno-1)*m_pagesize, m_pagesize);
     switch( a[hdr] )
     {
@@ -585,6 +840,19 @@ void CSQLite3DB::PageUsageBtree( int pgno, /* Page to describe */
     info.desc = zDesc;
     nCell = a[hdr+3]*256 + a[hdr+4];
     info.ncell = nCell;
+    if( a[hdr]==2 || a[hdr]==5 || a[hdr]==10 || a[hdr]==13 ){
+        int iPtrEnd = hdr + 8 + 4*(a[hdr]<=5) + 2*nCell;
+        int iContent = a[hdr+5]*256 + a[hdr+6];
+        int iFree = a[hdr+1]*256 + a[hdr+2];
+        int cnt = 0;
+        if( iContent==0 ) iContent = 65536;
+        info.nfree = iContent - iPtrEnd + a[hdr+7];
+        while( iFree>0 && iFree+4<=m_pagesize && (cnt++)<m_pagesize/4 ){
+            info.nfree += a[iFree+2]*256 + a[iFree+3];
+            iFree = a[iFree]*256 + a[iFree+1];
+        }
+        if( info.nfree<0 || info.nfree>m_pagesize ) info.nfree = 0;
+    }
     m_pageUsageInfo.push_back(info);
 
     if( a[hdr]==2 || a[hdr]==5 ){
@@ -620,7 +888,7 @@ void CSQLite3DB::PageUsageCell( unsigned char cType, /* Page type */ unsigned ch
     i64 nPayload;
     i64 rowid;
     i64 nLocal;
-    static char zDesc[1000] = {0};
+    char zDesc[1000] = {0};
 
     i = 0;
     if( cType<=5 ){
@@ -723,70 +991,42 @@ bool CSQLite3DB::DecodeCell(int pgno, int idx, vector<SQLite3Variant>& var)
     return m_pSqlite3Page->DecodeCell(pgno, idx, var);
 }
 
+bool CSQLite3DB::DecodePageCells(int pgno, SQLite3PageCells& cells)
+{
+    return m_pSqlite3Page->DecodeCells(pgno, cells);
+}
+
 bool CSQLite3DB::GetColumnNames(const string& tableName, vector<string>& colNames)
 {
-    bool bGetColNamesIsOk = false;
-    if(tableName.empty())
+    const SchemaObject* obj = GetSchema().Find(tableName);
+    if(obj == NULL || obj->type != "table")
     {
-        return bGetColNamesIsOk;
+        return false;
     }
 
-    table_content tb;
-    if(GetTableInfo(tableName, tb))
+    // 按记录中的顺序，VIRTUAL生成列不在记录中
+    for(size_t i=0; i<obj->fields.size(); ++i)
     {
-        while(!tb.empty())
-        {
-            cell_content cc = tb.front();
-            tb.pop_front();
-
-            if (cc.size() > 0)
-            {
-                colNames.push_back(cc[1]);
-            }
-        }
-
-        bGetColNamesIsOk = true;
+        colNames.push_back(obj->Field((int)i)->name);
     }
-    return bGetColNamesIsOk;
+    return true;
 }
 
 bool CSQLite3DB::GetIndexNames(const string &name, const string &tableName, vector<string> &colNames)
 {
-    bool bGetColNamesIsOk = false;
-    if(tableName.empty())
+    const SchemaObject* obj = GetSchema().Find(name);
+    if(obj == NULL || obj->type != "index" || StrLower(obj->tblName) != StrLower(tableName))
     {
-        return bGetColNamesIsOk;
+        return false;
     }
 
-    string sql = "SELECT type,sql,rootpage FROM sqlite_master WHERE name='" + name + "' AND tbl_name='" + tableName + "'";
-    try
-    {
-        CppSQLite3Query q = execQuery(sql.c_str());
-        if(!q.eof())
-        {
-            string type = q.getStringField(0);
-            string s = q.getStringField(1);
-            int rootpage = q.getIntField(2);
-            size_t start = s.find('(');
-            size_t end = s.find(')');
-            string sub = s.substr(start+1, end-start-1);
-            string find = ",";
-            vector<string> vs = StrSplit(sub, find);
-            for(auto it=vs.begin(); it!=vs.end(); it++)
-            {
-                string col = *it;
-                col = Trim(col, " ");
-                colNames.push_back(col);
-            }
-            bGetColNamesIsOk = true;
-        }
-    }
-    catch(CppSQLite3Exception& e)
+    for(size_t i=0; i<obj->fields.size(); ++i)
     {
-
+        const SchemaColumn* col = obj->Field((int)i);
+        if(!col->key) break;
+        colNames.push_back(col->cid == -2 ? "<expr>" : col->name);
     }
-
-    return bGetColNamesIsOk;
+    return true;
 }
 
 
@@ -991,12 +1231,56 @@ int CSQLite3Page::GetPageType(int pgno)
 
 bool CSQLite3Page::DecodeCell(int pgno, int idx, vector<SQLite3Variant>& vars)
 {
-    bool res = true;
     LoadPage(pgno);
-   
-    m_pParent->m_pSqlite3Payload->DescribeCell(m_cType, (unsigned char*)LoadCell(pgno, idx).c_str());
+    if (idx >= m_cellCounts || idx >= (int)m_payloadArea.size())
+    {
+        return false;
+    }
+
+    // 直接在页数据上解码，不再拷贝cell之后的整页剩余内容
+    m_pParent->m_pSqlite3Payload->DescribeCell(m_cType, (unsigned char*)&m_pageRawContent[m_payloadArea[idx].m_startAddr]);
     vars = m_pParent->m_pSqlite3Payload->m_datas;
-    return res;
+    return true;
+}
+
+bool CSQLite3Page::DecodeCells(int pgno, SQLite3PageCells& cells)
+{
+    cells.Clear();
+    LoadPage(pgno);
+    if (m_pgno != pgno)
+    {
+        return false;
+    }
+
+    cells.pgno = pgno;
+    cells.cType = m_cType;
+    if (m_cType != 2 && m_cType != 5 && m_cType != 10 && m_cType != 13)
+    {
+        return false;
+    }
+
+    const unsigned char* a = (const unsigned char*)m_pageRawContent.data();
+    i64 pagesize = m_pageRawContent.size();
+    cells.cells.resize(m_payloadArea.size());
+    for (size_t i=0; i<m_payloadArea.size(); ++i)
+    {
+        const ContentArea& area = m_payloadArea[i];
+        SQLite3Cell& cell = cells.cells[i];
+        cell.area = area;
+        if (area.m_startAddr <= 0 || area.m_startAddr >= pagesize)
+        {
+            // 损坏的cell指针
+            cell.contentOfst = cells.arena.size();
+            cell.contentLen = 0;
+            cell.firstVar = cells.vars.size();
+            cell.nVar = 0;
+            continue;
+        }
+        m_pParent->m_pSqlite3Payload->DecodeCell(m_cType, a + area.m_startAddr, pagesize - area.m_startAddr,
+                                                 cell, cells.arena, cells.vars);
+    }
+
+    return true;
 }
 
 
@@ -1091,21 +1375,107 @@ bool CSQLite3Payload::DescribeContent()
 {
     //qDebug() << "m_ctype =" << m_cType << " DescribeContent =" << m_rawContent.c_str();
     i64 offset = m_cellContent.size() - m_payloadContent.size();
+    m_cellHeaderSizeStartAddr = offset;
+    return DecodeRecord((const unsigned char*)m_payloadContent.c_str(), m_payloadContent.size(), offset,
+                        m_datas, &m_cellHeaderSize, &m_cellHeaderSizeLen);
+}
+
+void CSQLite3Payload::DecodeCell(unsigned char cType, /* Page type */
+                                 const unsigned char *a, /* Cell content */
+                                 i64 nAvail, /* Bytes available at a on the page */
+                                 SQLite3Cell& cell,
+                                 string& arena,
+                                 vector<SQLite3Variant>& vars)
+{
+    int i;
+    int n = 0;
+    const unsigned char* pStart = a;
+
+    cell.leftChild = 0;
+    cell.rowid = cell.nPayload = cell.nLocal = cell.cellHeaderSize = 0;
+    cell.leftChildLen = cell.nPayloadLen = cell.rowidLen = cell.cellHeaderSizeLen = 0;
+    cell.leftChildStartAddr = cell.nPayloadStartAddr = cell.rowidStartAddr = cell.cellHeaderSizeStartAddr = 0;
+    cell.contentOfst = arena.size();
+    cell.contentLen = 0;
+    cell.firstVar = vars.size();
+    cell.nVar = 0;
+
+    if( cType<=5 ){
+        cell.leftChild = decodeInt32(a);
+        cell.leftChildStartAddr = n;
+        cell.leftChildLen = 4;
+        a += 4;
+        n += 4;
+    }
+    if( cType!=5 ){
+        i = decodeVarint(a, &cell.nPayload);
+        cell.nPayloadStartAddr = n;
+        cell.nPayloadLen = i;
+        a += i;
+        n += i;
+        cell.nLocal = m_pParent->LocalPayload(cell.nPayload, cType);
+    }
+    if( cType==5 || cType==13 ){
+        i = decodeVarint(a, &cell.rowid);
+        cell.rowidStartAddr = n;
+        cell.rowidLen = i;
+        a += i;
+        n += i;
+    }
+
+    // 页上剩余的字节不够时按损坏处理，只取页内部分
+    i64 nLocal = cell.nLocal;
+    if( n+nLocal > nAvail ){
+        nLocal = nAvail>n ? nAvail-n : 0;
+    }
+
+    arena.append((const char*)pStart, n);
+    arena.append((const char*)a, nLocal);
+    if( cell.nLocal<cell.nPayload && n+nLocal+4<=nAvail ){
+        int ovfl = decodeInt32(a + nLocal);
+        int cnt = 0;
+        CSQLite3DB* pDb = m_pParent->m_pParent;
+        int pagesize = pDb->m_pagesize;
+        i64 nRemain = cell.nPayload - nLocal;
+        while (ovfl>0 && ovfl<=(int)pDb->m_mxPage && nRemain>0 && (cnt++)<(int)pDb->m_mxPage)
+        {
+            unsigned char* b = pDb->FileRead((i64)(ovfl-1)*pagesize, pagesize);
+            i64 nCopy = nRemain < pagesize-4 ? nRemain : pagesize-4;
+            ovfl = decodeInt32(b);
+            arena.append((const char*)b+4, nCopy);
+            nRemain -= nCopy;
+            sqlite3_free(b);
+        }
+    }
+    cell.contentLen = arena.size() - cell.contentOfst;
+
+    if( cType!=5 ){
+        cell.cellHeaderSizeStartAddr = n;
+        DecodeRecord((const unsigned char*)arena.data() + cell.contentOfst + n, cell.contentLen - n, n,
+                     vars, &cell.cellHeaderSize, &cell.cellHeaderSizeLen);
+    }
+    cell.nVar = vars.size() - cell.firstVar;
+}
+
+bool CSQLite3Payload::DecodeRecord(const unsigned char *a, i64 nLocal, i64 offset,
+                                   vector<SQLite3Variant>& vars,
+                                   i64* pHeaderSize, i64* pHeaderSizeLen)
+{
     int n;
     i64 i, x, v;
     const unsigned char *pData;
     const unsigned char *pLimit;
-    unsigned char* a = (unsigned char*)m_payloadContent.c_str();
     const unsigned char* pStart = a;
-    i64 nLocal = m_payloadContent.size();
+
+    *pHeaderSize = *pHeaderSizeLen = 0;
+    if( nLocal<=0 ) return false;
 
     pLimit = &a[nLocal];
     n = decodeVarint(a, &x);
-    m_cellHeaderSize = x;
-    m_cellHeaderSizeStartAddr = offset;
-    m_cellHeaderSizeLen = n;
+    *pHeaderSize = x;
+    *pHeaderSizeLen = n;
+    if( x>nLocal ) return false;
 
-    qDebug() << x << offset << n;
     pData = &a[x];
     a += n;
     i = x - n;
@@ -1119,14 +1489,12 @@ bool CSQLite3Payload::DescribeContent()
 
         a += n;
         i -= n;
-        nLocal -= n;
         if (x == 0)
         {
             var.type = SQLITE_TYPE_NULL;
         }
         else if( x>=1 && x<=6 )
         {
-            v = (signed char)pData[0];
             var.valStartAddr = offset + pData - pStart;
             switch( x )
             {
@@ -1137,7 +1505,9 @@ bool CSQLite3Payload::DescribeContent()
             case 2:  var.valLen = 2; break; // Value is a big-endian 26-bit twos-complement integer
             case 1:  var.valLen = 1; break; // Value is an 8-bit twos-complement integer
             }
+            if( pData+var.valLen>pLimit ) break;
 
+            v = (signed char)pData[0];
             pData++;
             switch( x )
             {
@@ -1149,13 +1519,12 @@ bool CSQLite3Payload::DescribeContent()
             }
             var.type = SQLITE_TYPE_INTEGER;
             var.iVal = v;
-            //sprintf(zDesc, "%lld", v);
         }else if( x==7 )
         {
             var.valStartAddr = offset + pData - pStart;
             var.valLen = 8;
+            if( pData+var.valLen>pLimit ) break;
 
-            //sprintf(zDesc, "real");
             var.type = SQLITE_TYPE_FLOAT;
             memcpy((void*)&var.lfVal, (void*)pData, 8); // FIX
             pData += 8;
@@ -1163,36 +1532,35 @@ bool CSQLite3Payload::DescribeContent()
         {
             var.type = SQLITE_TYPE_INTEGER;
             var.iVal = 0;
-            //sprintf(zDesc, "0");
         }else if( x==9 )
         {
             var.type = SQLITE_TYPE_INTEGER;
             var.iVal = 1;
-            //sprintf(zDesc, "1");
         }else if( x>=12 )
         {
             i64 size = (x-12)/2;
             var.valStartAddr = offset + pData - pStart;
             var.valLen = size;
+            if( pData+size>pLimit ) break;
 
             if( (x&1)==0 )
             {
                 var.type = SQLITE_TYPE_BLOB;
                 var.blob.assign((const char*)pData, size);
-                //sprintf(zDesc, "blob(%lld)", size);
             }
             else
             {
                 var.type = SQLITE_TYPE_TEXT;
                 var.text.assign((const char*)pData, size);
-                //sprintf(zDesc, "txt(%lld)", size);
             }
             pData += size;
         }
-        //j = (int)strlen(zDesc);
-        //zDesc += j;
-        //nDesc += j;
-        m_datas.push_back(var);
+        else
+        {
+            // 10,11保留类型
+            var.type = SQLITE_TYPE_NULL;
+        }
+        vars.push_back(var);
     }
 
     return true;
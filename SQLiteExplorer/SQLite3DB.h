@@ -3,11 +3,15 @@
 #include <vector>
 #include <deque>
 #include <map>
+#include <atomic>
 using namespace std;
 
 #include "sqlite3.h"
 #include "utils.h"
 #include "CppSQLite3.h"
+#include "SQLite3Schema.h"
+#include "SQLite3Profile.h"
+#include "SQLite3QueryPlan.h"
 
 typedef deque<string> cell_content;
 typedef deque<cell_content> table_content;
@@ -73,6 +77,57 @@ public:
     }
 };
 
+// 单个cell的解码结果，各StartAddr都是相对于cell起点
+struct SQLite3Cell
+{
+    ContentArea area;           // cell在当前页中的区域
+
+    int leftChild;
+    int leftChildStartAddr;
+    i64 leftChildLen;
+    i64 nPayload;
+    int nPayloadStartAddr;
+    i64 nPayloadLen;
+    i64 nLocal;
+    i64 rowid;
+    int rowidStartAddr;
+    i64 rowidLen;
+    i64 cellHeaderSize;
+    int cellHeaderSizeStartAddr;
+    i64 cellHeaderSizeLen;
+
+    size_t contentOfst;         // cell内容(含溢出页部分)在arena中的偏移
+    size_t contentLen;
+    int firstVar;               // 在SQLite3PageCells::vars中的起始下标
+    int nVar;
+};
+
+// 整页cell的批量解码结果，重复使用同一个对象可以复用已分配的内存
+struct SQLite3PageCells
+{
+    int pgno;
+    unsigned char cType;
+    vector<SQLite3Cell> cells;
+    vector<SQLite3Variant> vars;
+    string arena;
+
+    SQLite3PageCells() : pgno(0), cType(0) {}
+
+    void Clear()
+    {
+        pgno = 0;
+        cType = 0;
+        cells.clear();
+        vars.clear();
+        arena.clear();
+    }
+
+    const char* CellContent(const SQLite3Cell& cell) const
+    {
+        return arena.data() + cell.contentOfst;
+    }
+};
+
 enum PageType
 {
     PAGE_TYPE_UNKNOWN        = 0x00,
@@ -92,13 +147,14 @@ struct PageUsageInfo
     int parent;     // 父页页号
     PageType type;  // 当前页类型
     int ncell;      // 当前页cell数量
+    int nfree;      // b-tree页中空闲的字节数(未分配区域+自由块+碎片)
 
     int overflow_page_idx;
     int overflow_cell_idx;
     string desc;
 
     PageUsageInfo()
-        : pgno(0), parent(0), type(PAGE_TYPE_UNKNOWN), ncell(0)
+        : pgno(0), parent(0), type(PAGE_TYPE_UNKNOWN), ncell(0), nfree(0)
         , overflow_page_idx(0), overflow_cell_idx(0)
     {}
 
@@ -107,6 +163,40 @@ struct PageUsageInfo
     }
 };
 
+// 每一页的归属信息，下标为页号
+struct PageOwnerMap
+{
+    vector<string>   names;     // 表/索引名称
+    vector<int>      owner;     // names中的下标，-1表示自由页或未被引用的页
+    vector<PageType> type;      // 页类型
+    vector<unsigned char> fill; // b-tree页的填充率，0~255
+    vector<int>      cellPage;  // 溢出页的链所属的cell所在的b-tree页，其他页为0
+
+    void Clear()
+    {
+        names.clear();
+        owner.clear();
+        type.clear();
+        fill.clear();
+        cellPage.clear();
+    }
+
+    void Swap(PageOwnerMap& other)
+    {
+        names.swap(other.names);
+        owner.swap(other.owner);
+        type.swap(other.type);
+        fill.swap(other.fill);
+        cellPage.swap(other.cellPage);
+    }
+
+    const string& OwnerName(int pgno) const
+    {
+        static const string empty;
+        if (pgno <= 0 || pgno >= (int)owner.size() || owner[pgno] < 0) return empty;
+        return names[owner[pgno]];
+    }
+};
 
 class CSQLite3Page;
 class CSQLite3Payload;
@@ -135,6 +225,12 @@ public:
     // 获取所有表名称
     vector<string> GetAllTableNames();
 
+    // 获取所有b-tree(表、索引和sqlite_master)的名称
+    vector<string> GetAllBtreeNames();
+
+    // 获取指定b-tree的所有页，不影响GetPageUsageInfos的结果
+    vector<PageUsageInfo> GetBtreePageUsage(const string& name);
+
     // 获取所有叶子页id
     vector<pair<int, PageType> > GetAllPageIdsAndType(const string &name);
 
@@ -150,18 +246,34 @@ public:
     // 解码指定页，指定索引的数据
     bool DecodeCell(int pgno, int idx, vector<SQLite3Variant>& var);
 
+    // 一次性解码指定页的所有cell
+    bool DecodePageCells(int pgno, SQLite3PageCells& cells);
+
     // 获取页大小
     int GetPageSize();
 
+    // 获取数据库文件路径
+    const string& GetPath() const { return m_path; }
+
     // 获取指定表的列名称
     bool GetColumnNames(const string& tableName, vector<string>& colNames);
 
+    // 获取索引的键列名称，表达式列为"<expr>"
     bool GetIndexNames(const string& name, const string& tableName, vector<string>& colNames);
 
+    // 表和索引的列信息，schema变化后重新加载
+    const CSQLite3Schema& GetSchema();
+
     // 执行sql查询,返回错误信息
     string ExecuteCmd(const string& sql, table_content& table, cell_content& headers);
 
-    // 获取指定表的主键相关信息
+    // 执行sql并统计耗时、VM步数和页缓存命中，保留前keepRows行结果
+    bool ProfileQuery(const string& sql, int keepRows, bool coldCache, QueryProfile& profile);
+
+    // EXPLAIN QUERY PLAN，并用文件中b-tree的页数、层数和行数标注每一步
+    bool ExplainQueryPlan(const string& sql, const PlanOptions& opts, QueryPlan& plan);
+
+    // 获取指定表的主键相关信息，pkIdx为主键列在记录中的下标
     bool GetTablePrimaryKey(const string& tableName, vector<string>& pkFieldName, vector<string>& pkType, vector<int>& pkIdx, bool& withoutRowid);
 
     // 获取表字段信息
@@ -170,6 +282,36 @@ public:
     // 获取Page信息
     vector<PageUsageInfo> GetPageUsageInfos(bool freelist);
 
+    // 获取每一页所属的表/索引；cancel被置位时停止遍历，返回空表
+    const PageOwnerMap& GetPageOwners(bool useCache = true, const std::atomic<bool>* cancel = NULL);
+
+    // 已经建立的页归属表，不遍历b-tree，没有建立时为空
+    const PageOwnerMap& CachedPageOwners() const { return m_pageOwners; }
+
+    // 换入在别的连接上(如工作线程中)为同一文件建立的页归属表，之后由Reload增量更新
+    void SetPageOwners(PageOwnerMap& owners) { m_pageOwners.Swap(owners); }
+
+    /*
+    ** The file was modified by another process.  Refresh cached state and
+    ** re-walk only the b-trees that owned one of changedPages.  The names
+    ** of those b-trees ("freelist" for free pages) are returned in
+    ** changedObjects.  Returns true if the schema changed, in which case
+    ** every cache has been dropped and callers should rebuild their views.
+    */
+    bool Reload(const vector<int>& changedPages, vector<string>& changedObjects);
+
+    // Reload的次数，缓存的结果以它区分新旧(WAL模式下文件头的change counter不变)
+    int GetChangeCounter() const { return m_changeCounter; }
+
+    // 缓存占用的内存(分析结果和SQLite页缓存)，字节
+    int64_t MemoryUsed();
+
+    // 释放可以重新计算的缓存，用于不活跃的数据库
+    void ReleaseMemory();
+
+    // 设置SQLite页缓存的上限，字节
+    void SetCacheSize(int64_t bytes);
+
     // 获取数据库信息
     map<string, string> GetDatabaseInfo();
 
@@ -194,6 +336,11 @@ private:
     int64_t FileGetsize(void);
 
     void LoadSqliteMaster();
+
+    // 遍历根页为root的b-tree，把其中的页归属到m_pageOwners.names[idx]
+    void WalkPageOwners(int idx, int root);
+    // 遍历自由页链表，更新m_pageOwners中的页类型
+    void WalkFreeListOwners();
     /*
     ** Describe the usages of a b-tree page
     */
@@ -233,9 +380,14 @@ private:
 
     map<string, TableSchema> m_mapTableSchema;
     bool m_bTableInfoHasLoad;
+    CSQLite3Schema m_schema;
 
     vector<PageUsageInfo> m_pageUsageInfo;
     map<string, string> m_pragmaInfos;
+    PageOwnerMap m_pageOwners;
+    string m_schemaVersion;
+    int m_changeCounter;
+    const std::atomic<bool>* m_pCancel;   // GetPageOwners的取消标志
 
 public:
     CSQLite3Page* m_pSqlite3Page;
@@ -246,6 +398,7 @@ public:
 
 class CSQLite3Page
 {
+    friend class CSQLite3DB;
     friend class CSQLite3Payload;
 public:
     CSQLite3Page(CSQLite3DB* parent);
@@ -266,6 +419,9 @@ public:
     // 解码指定页，指定索引的数据
     bool DecodeCell(int pgno, int idx, vector<SQLite3Variant>& var);
 
+    // 一次性解码指定页的所有cell
+    bool DecodeCells(int pgno, SQLite3PageCells& cells);
+
 private:
     void DecodePage();
 
@@ -330,6 +486,30 @@ public:
     */
     bool DescribeContent();
 
+    /*
+    ** Decode a single cell into a SQLite3Cell.  The cell header and the
+    ** whole payload (including the overflow part) are appended to arena,
+    ** the decoded record values are appended to vars.
+    */
+    void DecodeCell(
+        unsigned char cType,        /* Page type */
+        const unsigned char *a,     /* Cell content */
+        i64 nAvail,                 /* Bytes available at a on the page */
+        SQLite3Cell& cell,
+        string& arena,
+        vector<SQLite3Variant>& vars
+        );
+
+    /*
+    ** Decode a record of n bytes.  offset is added to every address
+    ** stored in vars.
+    */
+    static bool DecodeRecord(
+        const unsigned char *a, i64 n, i64 offset,
+        vector<SQLite3Variant>& vars,
+        i64* pHeaderSize, i64* pHeaderSizeLen
+        );
+
     int GetLeftChild(){return m_leftChild;}
     i64 GetRowid(){return m_rowid;}
 
@@ -0,0 +1,282 @@
+#include "SQLite3Diff.h"
+#include "PageHash.h"
+
+#include <stdio.h>
+#include <map>
+#include <algorithm>
+
+// 记录内容摘要的最大长度
+static const size_t DIFF_KEY_MAX_LEN = 80;
+
+// 把一条记录转换成可读的摘要
+static string recordKey(const SQLite3PageCells& cells, const SQLite3Cell& cell)
+{
+    string key = "(";
+    char buf[64];
+    for (int i=0; i<cell.nVar && key.size() < DIFF_KEY_MAX_LEN; ++i)
+    {
+        const SQLite3Variant& var = cells.vars[cell.firstVar + i];
+        if (i > 0) key += ", ";
+        switch (var.type)
+        {
+        case SQLITE_TYPE_INTEGER:
+            sprintf(buf, "%lld", (long long)var.iVal);
+            key += buf;
+            break;
+        case SQLITE_TYPE_FLOAT:
+            sprintf(buf, "%g", var.lfVal);
+            key += buf;
+            break;
+        case SQLITE_TYPE_TEXT:
+            key += "'" + var.text + "'";
+            break;
+        case SQLITE_TYPE_BLOB:
+            sprintf(buf, "blob(%d)", (int)var.blob.size());
+            key += buf;
+            break;
+        default:
+            key += "NULL";
+            break;
+        }
+    }
+    if (key.size() > DIFF_KEY_MAX_LEN)
+    {
+        key.resize(DIFF_KEY_MAX_LEN);
+        key += "...";
+    }
+    key += ")";
+    return key;
+}
+
+// 表的页以rowid为key
+static bool isTablePage(unsigned char cType)
+{
+    return cType == PAGE_TYPE_TABLE_LEAF || cType == PAGE_TYPE_TABLE_INTERIOR;
+}
+
+// cell中的记录部分，不含左子页指针、payload长度和rowid，
+// 页分裂只移动子页指针，不应算作记录的变化
+static string cellRecord(const SQLite3PageCells& cells, const SQLite3Cell& cell)
+{
+    if (cells.cType == PAGE_TYPE_TABLE_INTERIOR) return string();
+    size_t ofst = std::min((size_t)cell.cellHeaderSizeStartAddr, cell.contentLen);
+    return string(cells.CellContent(cell) + ofst, cell.contentLen - ofst);
+}
+
+static uint64_t cellHash(const SQLite3PageCells& cells, const SQLite3Cell& cell)
+{
+    string rec = cellRecord(cells, cell);
+    return XXHash64(rec.data(), rec.size());
+}
+
+static bool hasCells(PageType type)
+{
+    return type == PAGE_TYPE_TABLE_LEAF || type == PAGE_TYPE_INDEX_LEAF
+        || type == PAGE_TYPE_INDEX_INTERIOR;
+}
+
+// 溢出页变化时，记录的变化要到持有溢出链的cell所在页去比较
+static int cellPageOf(const PageOwnerMap& owners, int pgno, PageType type)
+{
+    if (type != PAGE_TYPE_OVERFLOW || pgno >= (int)owners.cellPage.size()) return 0;
+    int leaf = owners.cellPage[pgno];
+    if (leaf <= 0 || leaf >= (int)owners.type.size() || !hasCells(owners.type[leaf])) return 0;
+    return leaf;
+}
+
+CSQLite3Diff::CSQLite3Diff()
+: m_cancel(false)
+{
+
+}
+
+bool CSQLite3Diff::Run(const string &oldPath, const string &newPath,
+                       const std::function<void (const PageDiff &)> &onPage,
+                       const std::function<void (const CellDiff &)> &onCell,
+                       const std::function<void (int, int)> &onProgress)
+{
+    m_err.clear();
+
+    // 1. 并行计算两个文件的页哈希
+    vector<uint64_t> oldHashes, newHashes;
+    int oldPagesize = 0, newPagesize = 0;
+    if (!HashPages(oldPath, oldHashes, &oldPagesize, &m_cancel)
+        || !HashPages(newPath, newHashes, &newPagesize, &m_cancel))
+    {
+        if (!m_cancel) m_err = "failed to read database file";
+        return false;
+    }
+    if (oldPagesize != newPagesize)
+    {
+        m_err = "page sizes differ, pages can not be compared";
+        return false;
+    }
+
+    CSQLite3DB oldDB(oldPath);
+    CSQLite3DB newDB(newPath);
+    const PageOwnerMap& oldOwners = oldDB.GetPageOwners();
+    const PageOwnerMap& newOwners = newDB.GetPageOwners();
+
+    // 2. 找出变化的页，并按所属b-tree分组
+    map<string, pair<vector<int>, vector<int> > > btrees;
+    int nPage = (int)std::max(oldHashes.size(), newHashes.size());
+    for (int pgno=1; pgno<=nPage && !m_cancel; ++pgno)
+    {
+        bool inOld = pgno <= (int)oldHashes.size();
+        bool inNew = pgno <= (int)newHashes.size();
+        PageDiff diff;
+        diff.pgno = pgno;
+        diff.oldOwner = inOld ? oldOwners.OwnerName(pgno) : string();
+        diff.newOwner = inNew ? newOwners.OwnerName(pgno) : string();
+        diff.oldType = inOld && pgno < (int)oldOwners.type.size() ? oldOwners.type[pgno] : PAGE_TYPE_UNKNOWN;
+        diff.newType = inNew && pgno < (int)newOwners.type.size() ? newOwners.type[pgno] : PAGE_TYPE_UNKNOWN;
+
+        if (inOld && inNew && oldHashes[pgno-1] == newHashes[pgno-1]
+            && diff.oldOwner == diff.newOwner && diff.oldType == diff.newType)
+        {
+            continue;
+        }
+        if (onPage) onPage(diff);
+
+        if (inOld && hasCells(diff.oldType) && !diff.oldOwner.empty())
+            btrees[diff.oldOwner].first.push_back(pgno);
+        if (inNew && hasCells(diff.newType) && !diff.newOwner.empty())
+            btrees[diff.newOwner].second.push_back(pgno);
+
+        int oldLeaf = inOld ? cellPageOf(oldOwners, pgno, diff.oldType) : 0;
+        if (oldLeaf > 0 && !diff.oldOwner.empty())
+            btrees[diff.oldOwner].first.push_back(oldLeaf);
+        int newLeaf = inNew ? cellPageOf(newOwners, pgno, diff.newType) : 0;
+        if (newLeaf > 0 && !diff.newOwner.empty())
+            btrees[diff.newOwner].second.push_back(newLeaf);
+    }
+
+    // 同一页可能既变化了又被溢出页引用，重复解码会把记录当作插入
+    for (auto it=btrees.begin(); it!=btrees.end(); ++it)
+    {
+        vector<int>* lists[2] = { &it->second.first, &it->second.second };
+        for (int i=0; i<2; ++i)
+        {
+            std::sort(lists[i]->begin(), lists[i]->end());
+            lists[i]->erase(std::unique(lists[i]->begin(), lists[i]->end()), lists[i]->end());
+        }
+    }
+
+    // 3. 逐个b-tree解码变化的页，比较记录
+    int done = 0;
+    int total = (int)btrees.size();
+    for (auto it=btrees.begin(); it!=btrees.end() && !m_cancel; ++it)
+    {
+        DiffBtree(it->first, oldDB, it->second.first, newDB, it->second.second, onCell);
+        if (onProgress) onProgress(++done, total);
+    }
+
+    return !m_cancel;
+}
+
+void CSQLite3Diff::DiffBtree(const string &name,
+                             CSQLite3DB &oldDB, const vector<int> &oldPages,
+                             CSQLite3DB &newDB, const vector<int> &newPages,
+                             const std::function<void (const CellDiff &)> &onCell)
+{
+    struct Entry
+    {
+        uint64_t hash;
+        int      pgno;
+        i64      rowid;
+        string   desc;
+    };
+
+    // rowid表以rowid为key，其他b-tree以整条记录为key
+    map<string, Entry> oldRows;
+    SQLite3PageCells cells;
+
+    auto keyOf = [&cells](const SQLite3Cell& cell) -> string {
+        if (isTablePage(cells.cType))
+            return string((const char*)&cell.rowid, sizeof(cell.rowid));
+        return cellRecord(cells, cell);
+    };
+
+    for (auto pg=oldPages.begin(); pg!=oldPages.end() && !m_cancel; ++pg)
+    {
+        if (!oldDB.DecodePageCells(*pg, cells)) continue;
+        for (auto it=cells.cells.begin(); it!=cells.cells.end(); ++it)
+        {
+            Entry e;
+            e.hash = cellHash(cells, *it);
+            e.pgno = *pg;
+            e.rowid = isTablePage(cells.cType) ? it->rowid : 0;
+            if (!isTablePage(cells.cType)) e.desc = recordKey(cells, *it);
+            oldRows[keyOf(*it)] = e;
+        }
+    }
+
+    CellDiff diff;
+    diff.table = name;
+    for (auto pg=newPages.begin(); pg!=newPages.end() && !m_cancel; ++pg)
+    {
+        if (!newDB.DecodePageCells(*pg, cells)) continue;
+        for (auto it=cells.cells.begin(); it!=cells.cells.end(); ++it)
+        {
+            string key = keyOf(*it);
+            bool rowidTable = isTablePage(cells.cType);
+            diff.rowid = rowidTable ? it->rowid : 0;
+            diff.newPgno = *pg;
+
+            auto old = oldRows.find(key);
+            if (old == oldRows.end())
+            {
+                diff.change = DIFF_INSERT;
+                diff.oldPgno = 0;
+                diff.key = rowidTable ? string() : recordKey(cells, *it);
+                if (onCell) onCell(diff);
+                continue;
+            }
+
+            // 只是被移动到了其他页的记录不算变化
+            if (old->second.hash != cellHash(cells, *it))
+            {
+                diff.change = DIFF_UPDATE;
+                diff.oldPgno = old->second.pgno;
+                diff.key = rowidTable ? string() : recordKey(cells, *it);
+                if (onCell) onCell(diff);
+            }
+            oldRows.erase(old);
+        }
+    }
+
+    for (auto it=oldRows.begin(); it!=oldRows.end() && !m_cancel; ++it)
+    {
+        diff.change = DIFF_DELETE;
+        diff.rowid = it->second.rowid;
+        diff.oldPgno = it->second.pgno;
+        diff.newPgno = 0;
+        diff.key = it->second.desc;
+        if (onCell) onCell(diff);
+    }
+}
+
+vector<pair<int, int> > CSQLite3Diff::DiffRanges(const string &a, const string &b)
+{
+    vector<pair<int, int> > ranges;
+    int n = (int)std::max(a.size(), b.size());
+    int start = -1;
+    for (int i=0; i<n; ++i)
+    {
+        bool same = i < (int)a.size() && i < (int)b.size() && a[i] == b[i];
+        if (!same && start < 0)
+        {
+            start = i;
+        }
+        else if (same && start >= 0)
+        {
+            ranges.push_back(make_pair(start, i - start));
+            start = -1;
+        }
+    }
+    if (start >= 0)
+    {
+        ranges.push_back(make_pair(start, n - start));
+    }
+    return ranges;
+}
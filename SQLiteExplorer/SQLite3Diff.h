@@ -0,0 +1,83 @@
+#ifndef SQLITE3DIFF_H
+#define SQLITE3DIFF_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "SQLite3DB.h"
+
+using std::string;
+using std::vector;
+
+enum DiffChange
+{
+    DIFF_INSERT = 0,
+    DIFF_DELETE,
+    DIFF_UPDATE
+};
+
+// 一个内容或归属发生变化的页
+struct PageDiff
+{
+    int      pgno;
+    string   oldOwner;  // 旧文件中所属表/索引，超出文件或未被引用时为空
+    string   newOwner;
+    PageType oldType;
+    PageType newType;
+};
+
+// 一条记录的变化
+struct CellDiff
+{
+    string     table;   // 表/索引名称
+    DiffChange change;
+    i64        rowid;   // rowid表的rowid，其他b-tree为0
+    string     key;     // 没有rowid时记录的内容摘要
+    int        oldPgno; // 旧文件中所在页，插入时为0
+    int        newPgno; // 新文件中所在页，删除时为0
+};
+
+/*
+** Compare two database files (or two snapshots of the same file).
+**
+** Both files are hashed page by page in parallel; only pages whose hash,
+** owner or type differ are decoded.  Cells on those pages are matched by
+** rowid (table b-trees) or by full record (index and WITHOUT ROWID
+** b-trees), one b-tree at a time, so memory is bounded by the changed
+** pages of a single b-tree.  A changed overflow page brings in the page
+** holding the cell that owns the chain, so a row whose change lies only in
+** its overflow content is still reported.  Results are handed to the
+** callbacks as they are produced.
+*/
+class CSQLite3Diff
+{
+public:
+    CSQLite3Diff();
+
+    bool Run(const string& oldPath, const string& newPath,
+             const std::function<void(const PageDiff&)>& onPage,
+             const std::function<void(const CellDiff&)>& onCell,
+             const std::function<void(int done, int total)>& onProgress = nullptr);
+
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+
+    // 获取最近一次的错误信息
+    const string& GetError() const { return m_err; }
+
+    // 比较两页原始内容，返回不同的字节区间(起点, 长度)
+    static vector<pair<int, int> > DiffRanges(const string& a, const string& b);
+
+private:
+    void DiffBtree(const string& name,
+                   CSQLite3DB& oldDB, const vector<int>& oldPages,
+                   CSQLite3DB& newDB, const vector<int>& newPages,
+                   const std::function<void(const CellDiff&)>& onCell);
+
+private:
+    std::atomic<bool> m_cancel;
+    string m_err;
+};
+
+#endif // SQLITE3DIFF_H
@@ -0,0 +1,546 @@
+#include "SQLite3Export.h"
+#include "Parallel.h"
+#include "CppSQLite3.h"
+#include "SQLite3File.h"
+
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+// 两次报告进度的最小间隔(毫秒)
+static const int EXPORT_REPORT_MS = 200;
+// 输出文件的缓冲区大小
+static const int EXPORT_FILE_BUFFER = 1 << 20;
+
+void ExportBatch::Clear()
+{
+    for (auto it=columns.begin(); it!=columns.end(); ++it)
+    {
+        it->types.clear();
+        it->ints.clear();
+        it->reals.clear();
+        it->lens.clear();
+        it->bytes.clear();
+    }
+    rows = 0;
+}
+
+void ExportBatch::Append(sqlite3_stmt *stmt)
+{
+    int n = sqlite3_column_count(stmt);
+    if (columns.size() != (size_t)n)
+    {
+        names.clear();
+        for (int i=0; i<n; ++i)
+        {
+            const char* name = sqlite3_column_name(stmt, i);
+            names.push_back(name ? name : "");
+        }
+        columns.resize(n);
+    }
+
+    for (int i=0; i<n; ++i)
+    {
+        Column& col = columns[i];
+        int type = sqlite3_column_type(stmt, i);
+        col.types.push_back((unsigned char)type);
+        switch (type)
+        {
+        case SQLITE_INTEGER:
+            col.ints.push_back(sqlite3_column_int64(stmt, i));
+            break;
+        case SQLITE_FLOAT:
+            col.reals.push_back(sqlite3_column_double(stmt, i));
+            break;
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+        {
+            const char* p = type == SQLITE_TEXT ? (const char*)sqlite3_column_text(stmt, i)
+                                                : (const char*)sqlite3_column_blob(stmt, i);
+            int len = sqlite3_column_bytes(stmt, i);
+            col.lens.push_back(len);
+            if (len > 0) col.bytes.append(p, len);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    rows++;
+}
+
+/*
+** Output side of an export.  Begin() gets the column names, Write() is
+** called once per full (or final) batch, Finish() flushes and closes.
+*/
+class ExportWriter
+{
+public:
+    ExportWriter() : m_fp(NULL), m_bytes(0) {}
+    virtual ~ExportWriter() { if (m_fp) fclose(m_fp); }
+
+    bool Open(const string& path)
+    {
+        m_fp = CSQLite3File::OpenFile(path, "wb");
+        if (m_fp) setvbuf(m_fp, NULL, _IOFBF, EXPORT_FILE_BUFFER);
+        return m_fp != NULL;
+    }
+
+    virtual bool Begin(const vector<string>& names) = 0;
+    virtual bool Write(const ExportBatch& batch) = 0;
+    virtual bool Finish()
+    {
+        bool ok = fflush(m_fp) == 0 && !ferror(m_fp);
+        ok = fclose(m_fp) == 0 && ok;
+        m_fp = NULL;
+        return ok;
+    }
+
+    int64_t Bytes() const { return m_bytes; }
+
+protected:
+    void Put(const void* p, size_t n)
+    {
+        fwrite(p, 1, n, m_fp);
+        m_bytes += n;
+    }
+    void Put(const string& s) { Put(s.data(), s.size()); }
+    template <class T> void PutValue(T v) { Put(&v, sizeof(v)); }
+    bool Failed() const { return ferror(m_fp) != 0; }
+
+    // 逐行访问批中的值时每列当前的读位置
+    struct Cursor
+    {
+        size_t ints, reals, lens, bytes;
+        Cursor() : ints(0), reals(0), lens(0), bytes(0) {}
+    };
+
+    static void FormatReal(double v, string& out)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", v);
+        out += buf;
+    }
+
+    static void FormatHex(const char* p, uint32_t len, string& out)
+    {
+        static const char digits[] = "0123456789ABCDEF";
+        for (uint32_t i=0; i<len; ++i)
+        {
+            out += digits[(unsigned char)p[i] >> 4];
+            out += digits[(unsigned char)p[i] & 15];
+        }
+    }
+
+protected:
+    FILE*   m_fp;
+    int64_t m_bytes;
+};
+
+class CsvWriter : public ExportWriter
+{
+public:
+    bool Begin(const vector<string>& names)
+    {
+        string line;
+        for (size_t i=0; i<names.size(); ++i)
+        {
+            if (i) line += ',';
+            Quote(names[i].data(), (uint32_t)names[i].size(), line);
+        }
+        line += "\r\n";
+        Put(line);
+        return !Failed();
+    }
+
+    bool Write(const ExportBatch& batch)
+    {
+        vector<Cursor> cur(batch.columns.size());
+        string line;
+        for (int r=0; r<batch.rows; ++r)
+        {
+            line.clear();
+            for (size_t c=0; c<batch.columns.size(); ++c)
+            {
+                const ExportBatch::Column& col = batch.columns[c];
+                Cursor& k = cur[c];
+                if (c) line += ',';
+                switch (col.types[r])
+                {
+                case SQLITE_INTEGER:
+                    line += std::to_string((long long)col.ints[k.ints++]);
+                    break;
+                case SQLITE_FLOAT:
+                    FormatReal(col.reals[k.reals++], line);
+                    break;
+                case SQLITE_TEXT:
+                    Quote(col.bytes.data() + k.bytes, col.lens[k.lens], line);
+                    k.bytes += col.lens[k.lens++];
+                    break;
+                case SQLITE_BLOB:
+                    // BLOB写成X'...'形式的十六进制
+                    line += "X'";
+                    FormatHex(col.bytes.data() + k.bytes, col.lens[k.lens], line);
+                    line += '\'';
+                    k.bytes += col.lens[k.lens++];
+                    break;
+                default:
+                    break;
+                }
+            }
+            line += "\r\n";
+            Put(line);
+        }
+        return !Failed();
+    }
+
+private:
+    // RFC 4180: 含有逗号、引号或换行的字段加引号，引号写两遍
+    static void Quote(const char* p, uint32_t len, string& out)
+    {
+        bool need = false;
+        for (uint32_t i=0; i<len && !need; ++i)
+        {
+            need = p[i] == ',' || p[i] == '"' || p[i] == '\r' || p[i] == '\n';
+        }
+        if (!need)
+        {
+            out.append(p, len);
+            return;
+        }
+        out += '"';
+        for (uint32_t i=0; i<len; ++i)
+        {
+            if (p[i] == '"') out += '"';
+            out += p[i];
+        }
+        out += '"';
+    }
+};
+
+class JsonlWriter : public ExportWriter
+{
+public:
+    bool Begin(const vector<string>& names)
+    {
+        m_keys.clear();
+        for (size_t i=0; i<names.size(); ++i)
+        {
+            string key;
+            Quote(names[i].data(), (uint32_t)names[i].size(), key);
+            m_keys.push_back(key + ':');
+        }
+        return true;
+    }
+
+    bool Write(const ExportBatch& batch)
+    {
+        vector<Cursor> cur(batch.columns.size());
+        string line;
+        for (int r=0; r<batch.rows; ++r)
+        {
+            line = "{";
+            for (size_t c=0; c<batch.columns.size(); ++c)
+            {
+                const ExportBatch::Column& col = batch.columns[c];
+                Cursor& k = cur[c];
+                if (c) line += ',';
+                line += m_keys[c];
+                switch (col.types[r])
+                {
+                case SQLITE_INTEGER:
+                    line += std::to_string((long long)col.ints[k.ints++]);
+                    break;
+                case SQLITE_FLOAT:
+                {
+                    // JSON中没有NaN和无穷大
+                    double v = col.reals[k.reals++];
+                    if (v - v != 0) line += "null";
+                    else FormatReal(v, line);
+                    break;
+                }
+                case SQLITE_TEXT:
+                    Quote(col.bytes.data() + k.bytes, col.lens[k.lens], line);
+                    k.bytes += col.lens[k.lens++];
+                    break;
+                case SQLITE_BLOB:
+                    line += '"';
+                    FormatHex(col.bytes.data() + k.bytes, col.lens[k.lens], line);
+                    line += '"';
+                    k.bytes += col.lens[k.lens++];
+                    break;
+                default:
+                    line += "null";
+                    break;
+                }
+            }
+            line += "}\n";
+            Put(line);
+        }
+        return !Failed();
+    }
+
+private:
+    static void Quote(const char* p, uint32_t len, string& out)
+    {
+        out += '"';
+        for (uint32_t i=0; i<len; ++i)
+        {
+            unsigned char ch = (unsigned char)p[i];
+            switch (ch)
+            {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (ch < 0x20)
+                {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                    out += buf;
+                }
+                else
+                {
+                    out += (char)ch;
+                }
+            }
+        }
+        out += '"';
+    }
+
+private:
+    vector<string> m_keys;
+};
+
+class ColumnarWriter : public ExportWriter
+{
+public:
+    ColumnarWriter() : m_rows(0) {}
+
+    bool Begin(const vector<string>& names)
+    {
+        Put("SQLXCOL1", 8);
+        PutValue<uint32_t>((uint32_t)names.size());
+        for (auto it=names.begin(); it!=names.end(); ++it)
+        {
+            PutValue<uint32_t>((uint32_t)it->size());
+            Put(*it);
+        }
+        return !Failed();
+    }
+
+    bool Write(const ExportBatch& batch)
+    {
+        m_offsets.push_back((uint64_t)m_bytes);
+        m_rows += batch.rows;
+        Put("BTCH", 4);
+        PutValue<uint32_t>((uint32_t)batch.rows);
+        for (auto it=batch.columns.begin(); it!=batch.columns.end(); ++it)
+        {
+            if (!it->types.empty()) Put(&it->types[0], it->types.size());
+            if (!it->ints.empty()) Put(&it->ints[0], it->ints.size()*sizeof(int64_t));
+            if (!it->reals.empty()) Put(&it->reals[0], it->reals.size()*sizeof(double));
+            if (!it->lens.empty()) Put(&it->lens[0], it->lens.size()*sizeof(uint32_t));
+            Put(it->bytes);
+        }
+        return !Failed();
+    }
+
+    bool Finish()
+    {
+        uint64_t footer = (uint64_t)m_bytes;
+        Put("SQLXIDX1", 8);
+        PutValue<uint32_t>((uint32_t)m_offsets.size());
+        if (!m_offsets.empty()) Put(&m_offsets[0], m_offsets.size()*sizeof(uint64_t));
+        PutValue<uint64_t>(m_rows);
+        PutValue<uint64_t>(footer);
+        Put("SQLXEND1", 8);
+        return ExportWriter::Finish();
+    }
+
+private:
+    vector<uint64_t> m_offsets;
+    uint64_t         m_rows;
+};
+
+CSQLite3Export::CSQLite3Export()
+    : m_cancel(false)
+    , m_rows(0)
+    , m_lastReport(0)
+    , m_lastRows(0)
+    , m_start(0)
+{
+}
+
+const char *CSQLite3Export::Extension(ExportFormat format)
+{
+    switch (format)
+    {
+    case EXPORT_JSONL:    return "jsonl";
+    case EXPORT_COLUMNAR: return "sqlx";
+    default:              return "csv";
+    }
+}
+
+void CSQLite3Export::AddRows(int64_t rows)
+{
+    int64_t total = m_rows += rows;
+    if (!m_onProgress) return;
+
+    // 多个工作线程中只有一个会报告
+    int64_t now = NowMs();
+    int64_t last = m_lastReport;
+    if (now - last < EXPORT_REPORT_MS || !m_lastReport.compare_exchange_strong(last, now)) return;
+    int64_t prevRows = m_lastRows.exchange(total);
+    m_onProgress(total, (total - prevRows) * 1000.0 / (now - last));
+}
+
+bool CSQLite3Export::ExportQuery(sqlite3 *db, const ExportJob &job, const ExportOptions &opts, ExportStats &stats)
+{
+    int64_t start = NowMs();
+    stats.name = job.name;
+    stats.rows = 0;
+
+    ExportWriter* writer = NULL;
+    switch (opts.format)
+    {
+    case EXPORT_JSONL:    writer = new JsonlWriter; break;
+    case EXPORT_COLUMNAR: writer = new ColumnarWriter; break;
+    default:              writer = new CsvWriter; break;
+    }
+    if (!writer->Open(job.path))
+    {
+        stats.err = "cannot create " + job.path;
+        delete writer;
+        return false;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, job.sql.c_str(), -1, &stmt, NULL) != SQLITE_OK || stmt == NULL)
+    {
+        stats.err = sqlite3_errmsg(db);
+        delete writer;
+        CSQLite3File::RemoveFile(job.path);
+        return false;
+    }
+
+    ExportBatch batch;
+    int batchRows = opts.batchRows > 0 ? opts.batchRows : 4096;
+    bool ok = true;
+    int rc = SQLITE_DONE;
+    while (!m_cancel && (rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (stats.rows == 0 && batch.rows == 0)
+        {
+            batch.Append(stmt);
+            ok = writer->Begin(batch.names);
+        }
+        else
+        {
+            batch.Append(stmt);
+        }
+        if (batch.rows >= batchRows)
+        {
+            ok = ok && writer->Write(batch);
+            stats.rows += batch.rows;
+            AddRows(batch.rows);
+            batch.Clear();
+        }
+        if (!ok) break;
+    }
+    if (!m_cancel && ok && rc != SQLITE_DONE && rc != SQLITE_ROW)
+    {
+        stats.err = sqlite3_errmsg(db);
+        ok = false;
+    }
+    if (ok && !m_cancel)
+    {
+        // 没有结果行时也写出列名
+        if (stats.rows == 0 && batch.rows == 0)
+        {
+            for (int i=0; i<sqlite3_column_count(stmt); ++i)
+            {
+                const char* name = sqlite3_column_name(stmt, i);
+                batch.names.push_back(name ? name : "");
+            }
+            ok = writer->Begin(batch.names);
+        }
+        if (batch.rows > 0)
+        {
+            ok = ok && writer->Write(batch);
+            stats.rows += batch.rows;
+            AddRows(batch.rows);
+        }
+        ok = writer->Finish() && ok;
+        if (!ok && stats.err.empty()) stats.err = "failed to write " + job.path;
+    }
+    sqlite3_finalize(stmt);
+
+    stats.bytes = writer->Bytes();
+    delete writer;
+    stats.seconds = (NowMs() - start) / 1000.0;
+    if (!ok || m_cancel)
+    {
+        CSQLite3File::RemoveFile(job.path);
+        if (m_cancel && stats.err.empty()) stats.err = "cancelled";
+        return false;
+    }
+    return true;
+}
+
+bool CSQLite3Export::Run(const string &dbPath, const vector<ExportJob> &jobs, const ExportOptions &opts,
+                         const std::function<void (int64_t, double)> &onProgress,
+                         const std::function<void (const ExportStats &)> &onJobDone)
+{
+    m_err.clear();
+    m_rows = 0;
+    m_lastRows = 0;
+    m_start = NowMs();
+    m_lastReport = m_start;
+    m_onProgress = onProgress;
+    m_stats.assign(jobs.size(), ExportStats());
+
+    // 每个任务一个块，动态分配给工作线程，每个线程用自己的连接
+    std::mutex doneMutex;
+    ParallelFor((int64_t)jobs.size(), 1, [&](int64_t begin, int64_t end) {
+        for (int64_t i=begin; i<end && !m_cancel; ++i)
+        {
+            ExportStats& stats = m_stats[i];
+            stats.name = jobs[i].name;
+            sqlite3* db = NULL;
+            if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+            {
+                stats.err = sqlite3_errmsg(db);
+            }
+            else
+            {
+                sqlite3_busy_timeout(db, 5000);
+                ExportQuery(db, jobs[i], opts, stats);
+            }
+            sqlite3_close(db);
+
+            if (onJobDone)
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                onJobDone(stats);
+            }
+        }
+    }, opts.nThreads);
+
+    int64_t total = m_rows;
+    double seconds = (NowMs() - m_start) / 1000.0;
+    if (m_onProgress) m_onProgress(total, seconds > 0 ? total / seconds : 0);
+    m_onProgress = nullptr;
+
+    for (auto it=m_stats.begin(); it!=m_stats.end(); ++it)
+    {
+        if (!it->err.empty())
+        {
+            m_err = it->name + ": " + it->err;
+            return false;
+        }
+    }
+    return !m_cancel;
+}
@@ -0,0 +1,134 @@
+#ifndef SQLITE3EXPORT_H
+#define SQLITE3EXPORT_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+enum ExportFormat
+{
+    EXPORT_CSV = 0,
+    EXPORT_JSONL,
+    EXPORT_COLUMNAR
+};
+
+// 一个导出任务：一条查询写到一个文件
+struct ExportJob
+{
+    string  name;   // 表名或查询的名称，用于报告
+    string  sql;
+    string  path;
+};
+
+struct ExportStats
+{
+    string  name;
+    int64_t rows;
+    int64_t bytes;
+    double  seconds;
+    string  err;
+
+    ExportStats() : rows(0), bytes(0), seconds(0) {}
+};
+
+/*
+** Rows of one result set stored column by column.  A batch holds at most
+** ExportOptions::batchRows rows and is reused for the next rows, so the
+** memory of an export does not depend on the size of the table.
+*/
+struct ExportBatch
+{
+    struct Column
+    {
+        vector<unsigned char> types;    // 每行的SQLITE_INTEGER/FLOAT/TEXT/BLOB/NULL
+        vector<int64_t>       ints;     // 整数值，按出现顺序
+        vector<double>        reals;
+        vector<uint32_t>      lens;     // TEXT/BLOB的长度
+        string                bytes;    // TEXT/BLOB的内容
+    };
+
+    vector<string>  names;
+    vector<Column>  columns;
+    int             rows;
+
+    ExportBatch() : rows(0) {}
+    void Clear();
+    void Append(sqlite3_stmt* stmt);
+};
+
+struct ExportOptions
+{
+    ExportFormat format;
+    int          batchRows;     // 每批的行数
+    int          nThreads;      // 同时导出的表数，0为CPU核数
+
+    ExportOptions() : format(EXPORT_CSV), batchRows(4096), nThreads(0) {}
+};
+
+/*
+** Stream query results to CSV, JSON Lines or a columnar binary file.
+**
+** Rows are stepped from a prepared statement into an ExportBatch and the
+** batch is handed to the writer every batchRows rows, so nothing like
+** the table_content of CSQLite3DB::ExecuteCmd is ever built.  Several
+** jobs (one per table) are exported at the same time, each on its own
+** read-only connection.
+**
+** The columnar file is, in host byte order (little-endian on every
+** supported target):
+**
+**     "SQLXCOL1" u32 ncol { u32 len, name }*
+**     batch*:  "BTCH" u32 nrow
+**              per column: u8 type[nrow], i64 ints[], f64 reals[],
+**                          u32 len[], bytes[]
+**     footer:  "SQLXIDX1" u32 nbatch u64 offset[nbatch] u64 nrow
+**     u64 footer offset, "SQLXEND1"
+**
+** where ints, reals and len/bytes only hold the rows of that type.
+*/
+class CSQLite3Export
+{
+public:
+    CSQLite3Export();
+
+    // 导出所有任务，onProgress(已导出总行数, 当前行/秒)可能在任意工作线程中调用
+    bool Run(const string& dbPath, const vector<ExportJob>& jobs, const ExportOptions& opts,
+             const std::function<void(int64_t rows, double rowsPerSec)>& onProgress = nullptr,
+             const std::function<void(const ExportStats&)>& onJobDone = nullptr);
+
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    const vector<ExportStats>& GetStats() const { return m_stats; }
+
+    // 在已打开的连接上导出一条查询
+    bool ExportQuery(sqlite3* db, const ExportJob& job, const ExportOptions& opts, ExportStats& stats);
+
+    // 默认的扩展名
+    static const char* Extension(ExportFormat format);
+
+private:
+    void AddRows(int64_t rows);
+
+private:
+    std::atomic<bool>    m_cancel;
+    std::atomic<int64_t> m_rows;
+    std::atomic<int64_t> m_lastReport;  // 上次报告的时间(毫秒)
+    std::atomic<int64_t> m_lastRows;
+    int64_t              m_start;
+    std::function<void(int64_t, double)> m_onProgress;
+
+    string               m_err;
+    vector<ExportStats>  m_stats;
+};
+
+#endif // SQLITE3EXPORT_H
@@ -0,0 +1,90 @@
+#include "SQLite3File.h"
+#include <string.h>
+
+#if defined(_WIN32)
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+CSQLite3File::CSQLite3File()
+: m_fp(NULL)
+{
+
+}
+
+CSQLite3File::~CSQLite3File()
+{
+    Close();
+}
+
+bool CSQLite3File::Open(const string &path)
+{
+    Close();
+#if defined(_WIN32)
+    // 路径是UTF8编码，Windows下需要用宽字符接口打开
+    m_fp = _wfopen(utf8_to_wide(path.c_str()).c_str(), L"rb");
+#else
+    m_fp = fopen(path.c_str(), "rb");
+#endif
+    return m_fp != NULL;
+}
+
+void CSQLite3File::Close()
+{
+    if (m_fp)
+    {
+        fclose(m_fp);
+        m_fp = NULL;
+    }
+}
+
+int64_t CSQLite3File::Size()
+{
+    if (m_fp == NULL) return 0;
+    if (fseek64(m_fp, 0, SEEK_END) != 0) return 0;
+    return (int64_t)ftell64(m_fp);
+}
+
+int CSQLite3File::Read(int64_t ofst, void *buf, int nByte)
+{
+    int got = 0;
+    if (m_fp && fseek64(m_fp, ofst, SEEK_SET) == 0)
+    {
+        got = (int)fread(buf, 1, nByte, m_fp);
+    }
+    if (got < nByte)
+    {
+        memset((char*)buf + got, 0, nByte - got);
+    }
+    return got;
+}
+
+int CSQLite3File::PageSize()
+{
+    unsigned char a[2];
+    if (Read(16, a, 2) != 2) return 0;
+    int pagesize = a[0]*256 + a[1];
+    if (pagesize == 1) pagesize = 65536;
+    return pagesize;
+}
+
+FILE *CSQLite3File::OpenFile(const string &path, const char *mode)
+{
+#if defined(_WIN32)
+    return _wfopen(utf8_to_wide(path.c_str()).c_str(), utf8_to_wide(mode).c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+bool CSQLite3File::RemoveFile(const string &path)
+{
+#if defined(_WIN32)
+    return _wremove(utf8_to_wide(path.c_str()).c_str()) == 0;
+#else
+    return remove(path.c_str()) == 0;
+#endif
+}
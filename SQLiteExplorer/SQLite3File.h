@@ -0,0 +1,82 @@
+#ifndef SQLITE3FILE_H
+#define SQLITE3FILE_H
+
+#include <stdio.h>
+#include <string>
+#include "utils.h"
+
+using std::string;
+
+/*
+** Read-only access to the raw database file.  Every worker thread opens
+** its own instance so that large sequential reads never share a file
+** position with the sqlite3 connection or with other threads.
+*/
+class CSQLite3File
+{
+public:
+    CSQLite3File();
+    ~CSQLite3File();
+
+    bool Open(const string& path);
+    void Close();
+    bool IsOpen() const { return m_fp != NULL; }
+
+    // 获取文件大小
+    int64_t Size();
+
+    // 读取[ofst, ofst+nByte)，不足部分补0，返回实际读到的字节数
+    int Read(int64_t ofst, void* buf, int nByte);
+
+    // 获取数据库页大小，读取失败时返回0
+    int PageSize();
+
+    // 按UTF8路径打开/删除任意文件
+    static FILE* OpenFile(const string& path, const char* mode);
+    static bool RemoveFile(const string& path);
+
+private:
+    CSQLite3File(const CSQLite3File&);
+    CSQLite3File& operator=(const CSQLite3File&);
+
+    FILE* m_fp;
+};
+
+// 页中的大端整数
+static inline int get2(const unsigned char* p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline unsigned int get4(const unsigned char* p)
+{
+    return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/*
+** Varint decoder that never reads past end, for pages read straight
+** from the file.  Returns the number of bytes used, 0 if the varint is
+** truncated.
+*/
+static inline int getVarint(const unsigned char* p, const unsigned char* end, int64_t* pVal)
+{
+    uint64_t v = 0;
+    for (int i=0; i<9; ++i)
+    {
+        if (p + i >= end) return 0;
+        if (i == 8)
+        {
+            *pVal = (int64_t)((v << 8) | p[i]);
+            return 9;
+        }
+        v = (v << 7) | (p[i] & 0x7f);
+        if ((p[i] & 0x80) == 0)
+        {
+            *pVal = (int64_t)v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+#endif // SQLITE3FILE_H
@@ -0,0 +1,683 @@
+#include "SQLite3Import.h"
+#include "Parallel.h"
+#include "SQLite3File.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// 两次报告进度的最小间隔(毫秒)
+static const int IMPORT_REPORT_MS = 200;
+// 每轮每个解析线程分到的块数
+static const int IMPORT_CHUNKS_PER_THREAD = 1;
+// 解析结果与原始数据大小之比，短字段的CSV约为14
+static const int IMPORT_PARSED_RATIO = 16;
+// 按内存预算缩小块时的下限
+static const int IMPORT_MIN_CHUNK = 256 << 10;
+// 用来推断新建表列类型的行数
+static const int IMPORT_TYPE_SAMPLE = 1000;
+
+// CppSQLite3DB::tableExists不能处理带引号的表名
+static bool tableExists(CppSQLite3DB& db, const string& table)
+{
+    CppSQLite3Statement stmt = db.compileStatement("select count(*) from sqlite_master where type='table' and lower(name)=lower(?)");
+    stmt.bind(1, table.c_str());
+    CppSQLite3Query q = stmt.execQuery();
+    return !q.eof() && q.getIntField(0) > 0;
+}
+
+// 一块未解析的原始数据
+struct ImportChunk
+{
+    int64_t seq;
+    string  data;
+};
+
+/*
+** Type of an unquoted CSV field: integers without leading zeros become
+** INTEGER, other decimal numbers FLOAT, the empty field NULL and
+** everything else TEXT.
+*/
+static void setField(const char* p, size_t n, bool quoted, ImportValue& v)
+{
+    v.type = SQLITE_TEXT;
+    v.text.assign(p, n);
+    if (quoted) return;
+    if (n == 0)
+    {
+        v.type = SQLITE_NULL;
+        return;
+    }
+
+    size_t i = 0;
+    if (p[i] == '-' || p[i] == '+') i++;
+    size_t digits = i;
+    while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+    if (i == digits) { if (i >= n || p[i] != '.') return; }
+
+    char buf[64];
+    if (n >= sizeof(buf)) return;
+    memcpy(buf, p, n);
+    buf[n] = 0;
+    char* end = NULL;
+    if (i == n)
+    {
+        // "007"这样的值保持为文本
+        if (i - digits > 1 && p[digits] == '0') return;
+        errno = 0;
+        long long val = strtoll(buf, &end, 10);
+        if (errno == 0 && end == buf + n)
+        {
+            v.type = SQLITE_INTEGER;
+            v.i = val;
+            v.text.clear();
+        }
+        return;
+    }
+    double val = strtod(buf, &end);
+    if (end == buf + n)
+    {
+        v.type = SQLITE_FLOAT;
+        v.r = val;
+        v.text.clear();
+    }
+}
+
+void CSQLite3Import::ParseCsv(const char *p, size_t n, bool first, const ImportOptions &opts, ImportBatch &batch)
+{
+    const char delim = opts.delimiter;
+    const char* end = p + n;
+    bool wantHeader = first && opts.header;
+    string field;
+
+    while (p < end)
+    {
+        size_t rowBegin = batch.values.size();
+        for (;;)
+        {
+            // 一个字段
+            bool quoted = false;
+            field.clear();
+            const char* start = p;
+            if (p < end && *p == '"')
+            {
+                quoted = true;
+                p++;
+                while (p < end)
+                {
+                    if (*p == '"')
+                    {
+                        if (p+1 < end && p[1] == '"') { field += '"'; p += 2; continue; }
+                        p++;
+                        break;
+                    }
+                    field += *p++;
+                }
+                // 引号后面到分隔符之间的内容也算在字段里
+                while (p < end && *p != delim && *p != '\n' && *p != '\r') field += *p++;
+            }
+            else
+            {
+                while (p < end && *p != delim && *p != '\n' && *p != '\r') p++;
+            }
+
+            batch.values.push_back(ImportValue());
+            if (quoted) setField(field.data(), field.size(), true, batch.values.back());
+            else setField(start, p - start, false, batch.values.back());
+
+            if (p < end && *p == delim) { p++; continue; }
+            if (p < end && *p == '\r') p++;
+            if (p < end && *p == '\n') p++;
+            break;
+        }
+
+        // 空行不算记录
+        if (batch.values.size() == rowBegin + 1 && batch.values.back().type == SQLITE_NULL)
+        {
+            batch.values.pop_back();
+            continue;
+        }
+        if (wantHeader)
+        {
+            for (size_t i=rowBegin; i<batch.values.size(); ++i)
+            {
+                const ImportValue& v = batch.values[i];
+                batch.header.push_back(v.type == SQLITE_TEXT ? v.text
+                    : v.type == SQLITE_INTEGER ? std::to_string((long long)v.i) : string());
+            }
+            batch.values.resize(rowBegin);
+            wantHeader = false;
+            continue;
+        }
+        batch.rowStart.push_back((int)rowBegin);
+    }
+    if (!batch.rowStart.empty() || !batch.values.empty())
+        batch.rowStart.push_back((int)batch.values.size());
+}
+
+// 最小的JSON解析器，只处理每行一个对象的情况
+class JsonLineParser
+{
+public:
+    JsonLineParser(const char* p, const char* end) : m_p(p), m_end(end) {}
+
+    bool ParseObject(ImportBatch& batch)
+    {
+        Skip();
+        if (!Eat('{')) return Fail("expected '{'");
+        Skip();
+        if (Eat('}')) return true;
+        for (;;)
+        {
+            Skip();
+            string key;
+            if (!ParseString(key)) return false;
+            Skip();
+            if (!Eat(':')) return Fail("expected ':'");
+            Skip();
+            ImportValue v;
+            if (!ParseValue(v)) return false;
+            batch.keys.push_back(key);
+            batch.values.push_back(ImportValue());
+            batch.values.back().type = v.type;
+            batch.values.back().i = v.i;
+            batch.values.back().r = v.r;
+            batch.values.back().text.swap(v.text);
+            Skip();
+            if (Eat(',')) continue;
+            if (Eat('}')) break;
+            return Fail("expected ',' or '}'");
+        }
+        Skip();
+        if (m_p != m_end) return Fail("trailing characters");
+        return true;
+    }
+
+    const string& Error() const { return m_err; }
+
+private:
+    void Skip() { while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n')) m_p++; }
+    bool Eat(char ch) { if (m_p < m_end && *m_p == ch) { m_p++; return true; } return false; }
+    bool Fail(const char* msg) { m_err = msg; return false; }
+
+    static void PutUtf8(unsigned int cp, string& out)
+    {
+        if (cp < 0x80) out += (char)cp;
+        else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+        else if (cp < 0x10000) { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+        else { out += (char)(0xF0 | (cp >> 18)); out += (char)(0x80 | ((cp >> 12) & 0x3F)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+    }
+
+    bool Hex4(unsigned int& cp)
+    {
+        if (m_end - m_p < 4) return false;
+        cp = 0;
+        for (int i=0; i<4; ++i)
+        {
+            char ch = *m_p++;
+            cp <<= 4;
+            if (ch >= '0' && ch <= '9') cp |= ch - '0';
+            else if (ch >= 'a' && ch <= 'f') cp |= ch - 'a' + 10;
+            else if (ch >= 'A' && ch <= 'F') cp |= ch - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool ParseString(string& out)
+    {
+        if (!Eat('"')) return Fail("expected string");
+        while (m_p < m_end && *m_p != '"')
+        {
+            if (*m_p != '\\') { out += *m_p++; continue; }
+            if (++m_p >= m_end) break;
+            char ch = *m_p++;
+            switch (ch)
+            {
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+            {
+                unsigned int cp;
+                if (!Hex4(cp)) return Fail("bad \\u escape");
+                // 代理对
+                if (cp >= 0xD800 && cp < 0xDC00 && m_end - m_p >= 6 && m_p[0] == '\\' && m_p[1] == 'u')
+                {
+                    m_p += 2;
+                    unsigned int lo;
+                    if (!Hex4(lo)) return Fail("bad \\u escape");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                PutUtf8(cp, out);
+                break;
+            }
+            default: out += ch; break;
+            }
+        }
+        if (!Eat('"')) return Fail("unterminated string");
+        return true;
+    }
+
+    bool ParseValue(ImportValue& v)
+    {
+        if (m_p >= m_end) return Fail("expected value");
+        char ch = *m_p;
+        if (ch == '"')
+        {
+            v.type = SQLITE_TEXT;
+            return ParseString(v.text);
+        }
+        if (ch == '{' || ch == '[')
+        {
+            // 嵌套的对象和数组按原文保存为文本
+            const char* start = m_p;
+            int depth = 0;
+            bool inStr = false;
+            for (; m_p < m_end; ++m_p)
+            {
+                if (inStr)
+                {
+                    if (*m_p == '\\') m_p++;
+                    else if (*m_p == '"') inStr = false;
+                    continue;
+                }
+                if (*m_p == '"') inStr = true;
+                else if (*m_p == '{' || *m_p == '[') depth++;
+                else if ((*m_p == '}' || *m_p == ']') && --depth == 0) { m_p++; break; }
+            }
+            if (depth != 0) return Fail("unterminated object");
+            v.type = SQLITE_TEXT;
+            v.text.assign(start, m_p - start);
+            return true;
+        }
+        if (m_end - m_p >= 4 && memcmp(m_p, "null", 4) == 0) { m_p += 4; v.type = SQLITE_NULL; return true; }
+        if (m_end - m_p >= 4 && memcmp(m_p, "true", 4) == 0) { m_p += 4; v.type = SQLITE_INTEGER; v.i = 1; return true; }
+        if (m_end - m_p >= 5 && memcmp(m_p, "false", 5) == 0) { m_p += 5; v.type = SQLITE_INTEGER; v.i = 0; return true; }
+
+        const char* start = m_p;
+        while (m_p < m_end && strchr("+-0123456789.eE", *m_p)) m_p++;
+        if (m_p == start) return Fail("unexpected character");
+        setField(start, m_p - start, false, v);
+        if (v.type != SQLITE_INTEGER && v.type != SQLITE_FLOAT) return Fail("bad number");
+        return true;
+    }
+
+private:
+    const char* m_p;
+    const char* m_end;
+    string      m_err;
+};
+
+void CSQLite3Import::ParseJsonl(const char *p, size_t n, ImportBatch &batch)
+{
+    const char* end = p + n;
+    while (p < end)
+    {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        if (eol == NULL) eol = end;
+        const char* q = p;
+        while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+        if (q < eol)
+        {
+            size_t rowBegin = batch.values.size();
+            JsonLineParser parser(q, eol);
+            if (!parser.ParseObject(batch))
+            {
+                batch.values.resize(rowBegin);
+                batch.keys.resize(rowBegin);
+                batch.err = parser.Error() + ": " + string(q, std::min<size_t>(eol - q, 80));
+                break;
+            }
+            batch.rowStart.push_back((int)rowBegin);
+        }
+        p = eol + 1;
+    }
+    if (!batch.rowStart.empty())
+        batch.rowStart.push_back((int)batch.values.size());
+}
+
+// 读取和解析中的两轮原始数据，解析和插入中的两轮解析结果
+int64_t CSQLite3Import::WorkerMemory(int chunkBytes)
+{
+    if (chunkBytes <= 0) chunkBytes = 4 << 20;
+    return (int64_t)IMPORT_CHUNKS_PER_THREAD * chunkBytes * (2 + 2 * IMPORT_PARSED_RATIO);
+}
+
+int CSQLite3Import::ChunkBytes(int64_t memory, int nThreads)
+{
+    int64_t perChunk = (int64_t)IMPORT_CHUNKS_PER_THREAD * (2 + 2 * IMPORT_PARSED_RATIO) * std::max(nThreads, 1);
+    return (int)std::max<int64_t>(IMPORT_MIN_CHUNK, std::min<int64_t>(4 << 20, memory / perChunk));
+}
+
+CSQLite3Import::CSQLite3Import()
+    : m_cancel(false)
+    , m_rows(0)
+    , m_seconds(0)
+    , m_created(false)
+{
+}
+
+/*
+** Cut point of a CSV buffer: the end of the last complete record, found
+** by tracking whether each newline is inside a quoted field.  The
+** buffer always starts on a record boundary.
+*/
+static size_t lastRecordEnd(const string& buf, ImportFormat format)
+{
+    size_t cut = 0;
+    bool inQuote = false;
+    const char* p = buf.data();
+    for (size_t i=0, n=buf.size(); i<n; ++i)
+    {
+        if (p[i] == '"' && format == IMPORT_CSV) inQuote = !inQuote;
+        else if (p[i] == '\n' && !inQuote) cut = i + 1;
+    }
+    return cut;
+}
+
+bool CSQLite3Import::Run(const string &dbPath, const string &srcPath, const ImportOptions &opts,
+                         const std::function<void (int64_t, double, int64_t, int64_t)> &onProgress)
+{
+    m_err.clear();
+    m_rows = 0;
+    m_seconds = 0;
+    m_created = false;
+    int64_t start = NowMs();
+
+    if (opts.table.empty())
+    {
+        m_err = "no table name";
+        return false;
+    }
+    CSQLite3File src;
+    FILE* fp = CSQLite3File::OpenFile(srcPath, "rb");
+    if (fp == NULL || !src.Open(srcPath))
+    {
+        if (fp) fclose(fp);
+        m_err = "cannot open " + srcPath;
+        return false;
+    }
+    int64_t fileSize = src.Size();
+    src.Close();
+
+    int nThreads = opts.nThreads > 0 ? opts.nThreads : ParallelThreadCount();
+    int chunkBytes = opts.chunkBytes > 0 ? opts.chunkBytes : (4 << 20);
+    int roundChunks = IMPORT_CHUNKS_PER_THREAD * nThreads;
+
+    // 读取：按记录边界切出一轮的块
+    string pending;
+    vector<char> block(chunkBytes);
+    int64_t seq = 0;
+    bool firstRead = true;
+    bool eof = false;
+    auto readRound = [&](vector<ImportChunk>& round) {
+        round.clear();
+        while (!eof && !m_cancel && (int)round.size() < roundChunks)
+        {
+            size_t got = fread(&block[0], 1, block.size(), fp);
+            if (got > 0)
+            {
+                pending.append(&block[0], got);
+                // 跳过UTF-8 BOM
+                if (firstRead && pending.size() >= 3 && memcmp(pending.data(), "\xEF\xBB\xBF", 3) == 0) pending.erase(0, 3);
+                firstRead = false;
+            }
+            else
+            {
+                eof = true;
+            }
+            size_t cut = got > 0 ? lastRecordEnd(pending, opts.format) : pending.size();
+            // 一条记录比块还大时继续读
+            if (cut == 0) continue;
+            round.push_back(ImportChunk());
+            round.back().seq = seq++;
+            round.back().data.assign(pending, 0, cut);
+            pending.erase(0, cut);
+        }
+    };
+
+    // 解析：一轮的块并行解析
+    auto parseRound = [&](const vector<ImportChunk>& round, vector<ImportBatch>& out) {
+        out.clear();
+        out.resize(round.size());
+        ParallelFor((int64_t)round.size(), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t i=begin; i<end && !m_cancel; ++i)
+            {
+                const ImportChunk& chunk = round[i];
+                ImportBatch& batch = out[i];
+                batch.bytes = (int64_t)chunk.data.size();
+                if (opts.format == IMPORT_JSONL)
+                    ParseJsonl(chunk.data.data(), chunk.data.size(), batch);
+                else
+                    ParseCsv(chunk.data.data(), chunk.data.size(), chunk.seq == 0, opts, batch);
+            }
+        }, nThreads, opts.pool);
+    };
+
+    // 写入：按文件顺序插入
+    CppSQLite3DB db;
+    CppSQLite3Statement stmt;
+    vector<string> columns;
+    std::unordered_map<string, int> columnIndex;
+    int nBind = 0;
+    bool prepared = false;
+    bool inTxn = false;
+    int64_t bytesDone = 0;
+    int64_t txnRows = 0;
+    int64_t lastReport = start;
+    int64_t lastRows = 0;
+    vector<int> slots;
+
+    auto insertBatch = [&](ImportBatch& batch) {
+        if (!batch.err.empty()) throw CppSQLite3Exception(SQLITE_ERROR, (char*)batch.err.c_str(), false);
+
+        if (!prepared)
+        {
+            if (batch.Rows() == 0 && batch.header.empty())
+            {
+                bytesDone += batch.bytes;
+                return;
+            }
+
+            // 列名：CSV的表头、JSONL第一块中出现过的键，或者c1..cN
+            if (opts.format == IMPORT_JSONL)
+            {
+                for (auto it=batch.keys.begin(); it!=batch.keys.end(); ++it)
+                {
+                    if (columnIndex.count(*it)) continue;
+                    columnIndex[*it] = (int)columns.size();
+                    columns.push_back(*it);
+                }
+            }
+            else if (opts.header)
+            {
+                columns = batch.header;
+            }
+
+            string table = QuoteName(opts.table);
+            if (!tableExists(db, opts.table))
+            {
+                if (columns.empty())
+                {
+                    int n = batch.Rows() ? batch.rowStart[1] - batch.rowStart[0] : 0;
+                    for (int i=0; i<n; ++i) columns.push_back("c" + std::to_string(i+1));
+                }
+
+                // 按前几行的值推断列类型
+                vector<int> kinds(columns.size(), 0);   // 1整数 2实数 3文本
+                int sample = std::min(batch.Rows(), IMPORT_TYPE_SAMPLE);
+                for (int r=0; r<sample; ++r)
+                {
+                    for (int k=batch.rowStart[r]; k<batch.rowStart[r+1]; ++k)
+                    {
+                        int col = opts.format == IMPORT_JSONL ? columnIndex[batch.keys[k]] : k - batch.rowStart[r];
+                        if (col >= (int)kinds.size()) continue;
+                        int t = batch.values[k].type;
+                        int kind = t == SQLITE_INTEGER ? 1 : t == SQLITE_FLOAT ? 2 : t == SQLITE_TEXT ? 3 : 0;
+                        kinds[col] = std::max(kinds[col], kind);
+                    }
+                }
+                string sql = "CREATE TABLE " + table + "(";
+                for (size_t i=0; i<columns.size(); ++i)
+                {
+                    static const char* names[] = { "", " INTEGER", " REAL", " TEXT" };
+                    if (i) sql += ", ";
+                    sql += QuoteName(columns[i].empty() ? "c" + std::to_string(i+1) : columns[i]) + names[kinds[i]];
+                }
+                sql += ")";
+                db.execDML(sql.c_str());
+                m_created = true;
+            }
+
+            string sql = "INSERT INTO " + table;
+            if (columns.empty())
+            {
+                // 没有列名时按位置插入表的所有列
+                CppSQLite3Query q = db.execQuery(("PRAGMA table_info(" + table + ")").c_str());
+                for (; !q.eof(); q.nextRow()) nBind++;
+            }
+            else
+            {
+                sql += "(";
+                for (size_t i=0; i<columns.size(); ++i)
+                {
+                    if (i) sql += ", ";
+                    sql += QuoteName(columns[i]);
+                }
+                sql += ")";
+                nBind = (int)columns.size();
+            }
+            sql += " VALUES(";
+            for (int i=0; i<nBind; ++i) sql += i ? ", ?" : "?";
+            sql += ")";
+            stmt = db.compileStatement(sql.c_str());
+            slots.assign(nBind, -1);
+            prepared = true;
+        }
+
+        if (!inTxn)
+        {
+            db.execDML("BEGIN");
+            inTxn = true;
+        }
+        for (int r=0; r<batch.Rows() && !m_cancel; ++r)
+        {
+            int begin = batch.rowStart[r];
+            int end = batch.rowStart[r+1];
+            std::fill(slots.begin(), slots.end(), -1);
+            for (int k=begin; k<end; ++k)
+            {
+                int col = k - begin;
+                if (opts.format == IMPORT_JSONL)
+                {
+                    auto it = columnIndex.find(batch.keys[k]);
+                    col = it == columnIndex.end() ? -1 : it->second;
+                }
+                if (col >= 0 && col < nBind) slots[col] = k;
+            }
+            for (int i=0; i<nBind; ++i)
+            {
+                const ImportValue* v = slots[i] >= 0 ? &batch.values[slots[i]] : NULL;
+                if (v == NULL || v->type == SQLITE_NULL) stmt.bindNull(i+1);
+                else if (v->type == SQLITE_INTEGER) stmt.bind(i+1, (sqlite_int64)v->i);
+                else if (v->type == SQLITE_FLOAT) stmt.bind(i+1, v->r);
+                else stmt.bind(i+1, v->text.c_str());
+            }
+            stmt.execDML();
+            m_rows++;
+
+            if (opts.commitRows > 0 && ++txnRows >= opts.commitRows)
+            {
+                db.execDML("COMMIT");
+                db.execDML("BEGIN");
+                txnRows = 0;
+            }
+        }
+        bytesDone += batch.bytes;
+
+        int64_t now = NowMs();
+        if (onProgress && now - lastReport >= IMPORT_REPORT_MS)
+        {
+            onProgress(m_rows, (m_rows - lastRows) * 1000.0 / (now - lastReport), bytesDone, fileSize);
+            lastReport = now;
+            lastRows = m_rows;
+        }
+    };
+
+    // 插入阶段在池中的线程上执行，异常不能抛出ParallelFor
+    auto insertRound = [&](vector<ImportBatch>& round) {
+        try
+        {
+            for (auto it=round.begin(); it!=round.end() && !m_cancel; ++it)
+            {
+                insertBatch(*it);
+                // 插入完的块立即释放
+                *it = ImportBatch();
+            }
+        }
+        catch (CppSQLite3Exception& e)
+        {
+            m_err = e.errorMessage();
+            m_cancel = true;
+        }
+    };
+
+    try
+    {
+        db.open(dbPath.c_str());
+        if (opts.unsafeFast)
+        {
+            db.execDML("PRAGMA journal_mode=OFF");
+            db.execDML("PRAGMA synchronous=OFF");
+        }
+
+        // 三级流水线：插入第n轮、解析第n+1轮、读取第n+2轮同时进行
+        vector<ImportChunk> reading, parsing;
+        vector<ImportBatch> parsed, inserting;
+        readRound(parsing);
+        while (!m_cancel && !(parsing.empty() && inserting.empty()))
+        {
+            ParallelFor(3, 1, [&](int64_t begin, int64_t end) {
+                for (int64_t stage=begin; stage<end; ++stage)
+                {
+                    if (stage == 0) insertRound(inserting);
+                    else if (stage == 1) parseRound(parsing, parsed);
+                    else readRound(reading);
+                }
+            }, 3, opts.pool);
+            inserting.swap(parsed);
+            parsing.swap(reading);
+        }
+        // 插入阶段出错时m_err已经设置
+        if (m_err.empty())
+        {
+            if (m_cancel) throw CppSQLite3Exception(SQLITE_INTERRUPT, (char*)"cancelled", false);
+            stmt.finalize();
+            if (inTxn) db.execDML("COMMIT");
+            inTxn = false;
+            if (onProgress)
+            {
+                double seconds = (NowMs() - start) / 1000.0;
+                onProgress(m_rows, seconds > 0 ? m_rows / seconds : 0, fileSize, fileSize);
+            }
+        }
+    }
+    catch (CppSQLite3Exception& e)
+    {
+        m_err = e.errorMessage();
+    }
+    if (!m_err.empty() && inTxn)
+    {
+        try { db.execDML("ROLLBACK"); } catch (CppSQLite3Exception&) {}
+    }
+    fclose(fp);
+
+    m_seconds = (NowMs() - start) / 1000.0;
+    return m_err.empty();
+}
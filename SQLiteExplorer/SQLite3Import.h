@@ -0,0 +1,112 @@
+#ifndef SQLITE3IMPORT_H
+#define SQLITE3IMPORT_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "utils.h"
+#include "CppSQLite3.h"
+
+using std::string;
+using std::vector;
+
+class CWorkerPool;
+
+enum ImportFormat
+{
+    IMPORT_CSV = 0,
+    IMPORT_JSONL
+};
+
+struct ImportOptions
+{
+    ImportFormat format;
+    string       table;         // 目标表，不存在时按第一批数据创建
+    bool         header;        // CSV第一行是列名
+    char         delimiter;     // CSV分隔符
+    int          chunkBytes;    // 每块交给解析线程的字节数
+    int          commitRows;    // 每个事务的行数，<=0表示整个导入一个事务
+    int          nThreads;      // 解析线程数，0为CPU核数
+    bool         unsafeFast;    // journal_mode=OFF和synchronous=OFF，只用于临时数据
+    CWorkerPool* pool;          // 执行流水线的线程池，NULL为CWorkerPool::Instance()
+
+    ImportOptions() : format(IMPORT_CSV), header(true), delimiter(','), chunkBytes(4 << 20),
+                      commitRows(100000), nThreads(0), unsafeFast(false), pool(NULL) {}
+};
+
+struct ImportValue
+{
+    int     type;       // SQLITE_INTEGER/FLOAT/TEXT/NULL
+    int64_t i;
+    double  r;
+    string  text;
+
+    ImportValue() : type(SQLITE_NULL), i(0), r(0) {}
+};
+
+// 解析线程输出的一块记录
+struct ImportBatch
+{
+    vector<string>      header;     // CSV的列名(只在第一块中)
+    vector<ImportValue> values;
+    vector<int>         rowStart;   // 每行第一个值在values中的下标，最后多一个结束位置
+    vector<string>      keys;       // JSONL每个值对应的键，CSV为空
+    int64_t             bytes;      // 这块的原始字节数
+    string              err;
+
+    ImportBatch() : bytes(0) {}
+    int Rows() const { return rowStart.empty() ? 0 : (int)rowStart.size() - 1; }
+};
+
+/*
+** Load a CSV or JSON Lines file into a table.
+**
+** The file is cut into chunks on record boundaries (a quote-parity scan
+** for CSV, newlines for JSONL) and handled in rounds of one chunk per
+** parser, as a three-stage pipeline on the shared CWorkerPool: while one
+** round is inserted in file order, the next is parsed into typed values
+** by a ParallelFor and the one after it is read.  The inserts go through
+** one prepared statement, bound and reset per row, committing every
+** commitRows rows.  At most three rounds are in memory, so memory does
+** not grow with the file; WorkerMemory() is what one parser adds, and
+** ChunkBytes() picks the chunk size that fits a given budget.
+**
+** On error or cancel the open transaction is rolled back; transactions
+** that were already committed stay.
+*/
+class CSQLite3Import
+{
+public:
+    CSQLite3Import();
+
+    // onProgress(已插入行数, 当前行/秒, 已读字节, 文件大小)
+    bool Run(const string& dbPath, const string& srcPath, const ImportOptions& opts,
+             const std::function<void(int64_t rows, double rowsPerSec, int64_t bytes, int64_t total)>& onProgress = nullptr);
+
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    int64_t GetRows() const { return m_rows; }
+    double GetSeconds() const { return m_seconds; }
+    bool TableCreated() const { return m_created; }
+
+    // 每个解析线程在流水线中占用的内存，不含写入连接的页缓存
+    static int64_t WorkerMemory(int chunkBytes);
+    // nThreads个解析线程共用memory内存时的块大小，在256KB和4MB之间
+    static int ChunkBytes(int64_t memory, int nThreads);
+
+    // 解析一块数据，first为文件的第一块
+    static void ParseCsv(const char* p, size_t n, bool first, const ImportOptions& opts, ImportBatch& batch);
+    static void ParseJsonl(const char* p, size_t n, ImportBatch& batch);
+
+private:
+    std::atomic<bool> m_cancel;
+    string            m_err;
+    int64_t           m_rows;
+    double            m_seconds;
+    bool              m_created;
+};
+
+#endif // SQLITE3IMPORT_H
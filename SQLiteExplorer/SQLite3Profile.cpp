@@ -0,0 +1,120 @@
+#include "SQLite3Profile.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+double CSQLite3Profiler::ThreadCpuSeconds()
+{
+#ifdef _WIN32
+    FILETIME create, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &create, &exited, &kernel, &user)) return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    // 单位为100ns
+    return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+// 读取并清零连接的统计
+static int64_t dbStatus(sqlite3* db, int op)
+{
+    int cur = 0, hi = 0;
+    sqlite3_db_status(db, op, &cur, &hi, 1);
+    return cur;
+}
+
+static void addStmtStatus(sqlite3_stmt* stmt, QueryProfile& profile)
+{
+    profile.vmSteps += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0);
+    profile.fullScanSteps += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+    profile.sorts += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 0);
+    profile.autoIndex += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 0);
+#ifdef SQLITE_STMTSTATUS_REPREPARE
+    profile.reprepares += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0);
+#endif
+}
+
+bool CSQLite3Profiler::Run(sqlite3 *db, const string &sql, int keepRows, bool coldCache, QueryProfile &profile)
+{
+    profile = QueryProfile();
+    profile.sql = sql;
+    profile.when = time(NULL);
+    if (db == NULL)
+    {
+        profile.err = "no database";
+        return false;
+    }
+
+    if (coldCache) sqlite3_db_release_memory(db);
+    dbStatus(db, SQLITE_DBSTATUS_CACHE_HIT);
+    dbStatus(db, SQLITE_DBSTATUS_CACHE_MISS);
+    dbStatus(db, SQLITE_DBSTATUS_CACHE_WRITE);
+    int totalChanges = sqlite3_total_changes(db);
+
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = ThreadCpuSeconds();
+
+    const char* tail = sql.c_str();
+    while (*tail)
+    {
+        sqlite3_stmt* stmt = NULL;
+        if (sqlite3_prepare_v2(db, tail, -1, &stmt, &tail) != SQLITE_OK)
+        {
+            profile.err = sqlite3_errmsg(db);
+            break;
+        }
+        // 空白或注释
+        if (stmt == NULL) continue;
+        profile.statements++;
+
+        // 有结果列的语句替换之前语句的结果
+        int nCol = sqlite3_column_count(stmt);
+        if (nCol > 0)
+        {
+            profile.columns.clear();
+            profile.preview.clear();
+            for (int i=0; i<nCol; ++i)
+            {
+                const char* name = sqlite3_column_name(stmt, i);
+                profile.columns.push_back(name ? name : "");
+            }
+        }
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            profile.rows++;
+            if ((int)profile.preview.size() < keepRows)
+            {
+                vector<string> row(nCol);
+                for (int i=0; i<nCol; ++i)
+                {
+                    const unsigned char* text = sqlite3_column_text(stmt, i);
+                    if (text) row[i].assign((const char*)text, sqlite3_column_bytes(stmt, i));
+                }
+                profile.preview.push_back(row);
+            }
+        }
+        if (rc != SQLITE_DONE) profile.err = sqlite3_errmsg(db);
+        addStmtStatus(stmt, profile);
+        sqlite3_finalize(stmt);
+        if (profile.err.size()) break;
+    }
+
+    profile.cpuSeconds = ThreadCpuSeconds() - cpuStart;
+    profile.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    profile.changes = sqlite3_total_changes(db) - totalChanges;
+    profile.cacheHits = dbStatus(db, SQLITE_DBSTATUS_CACHE_HIT);
+    profile.cacheMisses = dbStatus(db, SQLITE_DBSTATUS_CACHE_MISS);
+    profile.cacheWrites = dbStatus(db, SQLITE_DBSTATUS_CACHE_WRITE);
+    return profile.err.empty();
+}
@@ -0,0 +1,75 @@
+#ifndef SQLITE3PROFILE_H
+#define SQLITE3PROFILE_H
+
+#include <string>
+#include <vector>
+#include <time.h>
+#include "sqlite3.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+// 一次执行的统计，多条语句时为总和
+struct QueryProfile
+{
+    string  sql;
+    string  err;            // 非空表示执行失败，统计到出错为止
+    time_t  when;
+    int     statements;
+    int64_t rows;           // 返回的行数
+    int64_t changes;        // 修改的行数
+    double  wallSeconds;
+    double  cpuSeconds;     // 执行线程的CPU时间
+
+    // sqlite3_stmt_status
+    int64_t vmSteps;
+    int64_t fullScanSteps;  // 全表扫描时前进的次数
+    int64_t sorts;
+    int64_t autoIndex;      // 自动索引插入的行数
+    int64_t reprepares;
+
+    // sqlite3_db_status，执行期间的增量
+    int64_t cacheHits;
+    int64_t cacheMisses;
+    int64_t cacheWrites;
+
+    // 最后一条返回结果的语句的列和前若干行
+    vector<string>          columns;
+    vector<vector<string> > preview;
+
+    QueryProfile()
+        : when(0), statements(0), rows(0), changes(0), wallSeconds(0), cpuSeconds(0)
+        , vmSteps(0), fullScanSteps(0), sorts(0), autoIndex(0), reprepares(0)
+        , cacheHits(0), cacheMisses(0), cacheWrites(0)
+    {}
+
+    double HitRatio() const
+    {
+        int64_t n = cacheHits + cacheMisses;
+        return n > 0 ? (double)cacheHits / n : 0;
+    }
+};
+
+/*
+** Run SQL text statement by statement to completion on a connection and
+** measure it: wall and thread CPU time, the counters sqlite keeps per
+** prepared statement, and the page cache hits and misses of the
+** connection while it ran.  Every row is stepped through, since
+** stopping early would make the counters meaningless, but only the
+** first keepRows are kept for display.
+**
+** With coldCache the unused pages of the connection's cache are
+** released first, so the misses show what the query reads from disk
+** (the OS cache is not touched).
+*/
+class CSQLite3Profiler
+{
+public:
+    static bool Run(sqlite3* db, const string& sql, int keepRows, bool coldCache, QueryProfile& profile);
+
+    // 当前线程已使用的CPU时间，秒
+    static double ThreadCpuSeconds();
+};
+
+#endif // SQLITE3PROFILE_H
@@ -0,0 +1,446 @@
+#include "SQLite3QueryPlan.h"
+
+#include <map>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+
+// 没有sqlite_stat1时假定每个键前缀匹配的行数，与sqlite的默认值相同
+static const double PLAN_DEFAULT_EQ_ROWS = 10;
+// 每个范围条件保留的比例
+static const double PLAN_RANGE_FACTOR = 4;
+
+static vector<string> splitWords(const string& s)
+{
+    vector<string> words;
+    std::istringstream in(s);
+    string w;
+    while (in >> w) words.push_back(w);
+    return words;
+}
+
+static bool isNumber(const string& s)
+{
+    if (s.empty()) return false;
+    for (size_t i=0; i<s.size(); ++i)
+        if (!isdigit((unsigned char)s[i])) return false;
+    return true;
+}
+
+// detail中"SUBQUERY n"或"SUBQUERIES a AND b"是否提到子查询sid
+static bool mentionsSubquery(const string& detail, int sid)
+{
+    vector<string> words = splitWords(detail);
+    for (size_t i=0; i+1<words.size(); ++i)
+    {
+        if (words[i] == "SUBQUERY" && isNumber(words[i+1]) && atoi(words[i+1].c_str()) == sid)
+            return true;
+        if (words[i] == "SUBQUERIES")
+        {
+            for (size_t j=i+1; j<words.size() && j<i+4; ++j)
+                if (isNumber(words[j]) && atoi(words[j].c_str()) == sid) return true;
+        }
+    }
+    return false;
+}
+
+// "a=? AND b>?"中的列名，"a, b"
+static string constraintColumns(const string& constraint)
+{
+    string cols;
+    vector<string> words = splitWords(constraint);
+    for (size_t i=0; i<words.size(); ++i)
+    {
+        if (words[i] == "AND") continue;
+        size_t op = words[i].find_first_of("=<>");
+        if (!cols.empty()) cols += ", ";
+        cols += words[i].substr(0, op);
+    }
+    return cols;
+}
+
+// SQL中的标识符，去掉引号，其他字符都是分隔符
+static vector<string> identifiers(const string& sql)
+{
+    vector<string> ids;
+    size_t i = 0;
+    while (i < sql.size())
+    {
+        char c = sql[i];
+        if (c == '"' || c == '`' || c == '[')
+        {
+            char close = c == '[' ? ']' : c;
+            size_t end = sql.find(close, i+1);
+            if (end == string::npos) end = sql.size();
+            ids.push_back(sql.substr(i+1, end-i-1));
+            i = end + 1;
+        }
+        else if (c == '\'')
+        {
+            size_t end = sql.find('\'', i+1);
+            i = end == string::npos ? sql.size() : end + 1;
+        }
+        else if (isalnum((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80)
+        {
+            size_t end = i;
+            while (end < sql.size() && (isalnum((unsigned char)sql[end]) || sql[end] == '_' || (unsigned char)sql[end] >= 0x80))
+                ++end;
+            ids.push_back(sql.substr(i, end-i));
+            i = end;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return ids;
+}
+
+// 在FROM中找"表 [AS] 别名"，返回表名
+static string aliasTable(const CSQLite3Schema& schema, const string& sql, const string& alias)
+{
+    vector<string> ids = identifiers(sql);
+    string a = StrLower(alias);
+    for (size_t i=0; i+1<ids.size(); ++i)
+    {
+        const SchemaObject* obj = schema.Find(ids[i]);
+        if (obj == NULL || obj->type != "table") continue;
+        size_t j = i + 1;
+        if (StrLower(ids[j]) == "as" && j+1 < ids.size()) ++j;
+        if (StrLower(ids[j]) == a) return obj->name;
+    }
+    return string();
+}
+
+void CSQLite3QueryPlan::ParseDetail(PlanNode &node)
+{
+    string head = node.detail;
+
+    // 很旧的版本在最后给出估计的行数"(~N rows)"
+    size_t est = head.rfind("(~");
+    if (est != string::npos && head.find(" rows)", est) != string::npos)
+    {
+        node.estRows = atof(head.c_str() + est + 2);
+        node.rowsSource = "sqlite";
+        head = head.substr(0, est);
+    }
+
+    size_t paren = head.find(" (");
+    if (paren != string::npos)
+    {
+        size_t close = head.rfind(')');
+        if (close != string::npos && close > paren)
+            node.constraint = head.substr(paren+2, close-paren-2);
+        head = head.substr(0, paren);
+    }
+
+    vector<string> words = splitWords(head);
+    if (words.empty()) return;
+    if (words[0] != "SCAN" && words[0] != "SEARCH")
+    {
+        if (head.compare(0, 15, "USE TEMP B-TREE") == 0)
+        {
+            node.op = "USE TEMP B-TREE";
+            node.tempBtree = true;
+            node.note = head.size() > 16 ? head.substr(16) : string();
+        }
+        else
+        {
+            node.op = head;
+        }
+        return;
+    }
+
+    node.op = words[0];
+    size_t i = 1;
+    if (i < words.size() && words[i] == "TABLE") ++i;
+    if (i >= words.size() || words[i] == "SUBQUERY" || words[i] == "CONSTANT") return;
+
+    node.object = words[i++];
+    if (i+1 < words.size() && words[i] == "AS")
+    {
+        node.table = node.object;
+        node.object = words[i+1];
+        i += 2;
+    }
+
+    bool virt = false;
+    if (i < words.size() && words[i] == "VIRTUAL")
+    {
+        virt = true;
+        node.note = "virtual table";
+    }
+    else if (i < words.size() && words[i] == "USING")
+    {
+        for (size_t k=i+1; k<words.size(); ++k)
+        {
+            if (words[k] == "AUTOMATIC") node.automaticIndex = true;
+            else if (words[k] == "COVERING") node.covering = true;
+            else if (words[k] == "INDEX" && !node.automaticIndex && k+1 < words.size())
+            {
+                node.index = words[k+1];
+                break;
+            }
+        }
+    }
+    node.fullScan = node.op == "SCAN" && !virt;
+}
+
+void CSQLite3QueryPlan::Resolve(const CSQLite3Schema &schema, const string &sql, PlanNode &node)
+{
+    if (node.object.empty()) return;
+    if (node.table.empty())
+    {
+        const SchemaObject* obj = schema.Find(node.object);
+        if (obj != NULL && obj->type == "table")
+            node.table = obj->name;
+        else
+            node.table = aliasTable(schema, sql, node.object);
+    }
+    if (node.automaticIndex || node.note == "virtual table") return;
+
+    const SchemaObject* obj = schema.Find(node.index.empty() ? node.table : node.index);
+    if (obj == NULL || obj->rootpage <= 0)
+    {
+        node.note = "not in the main schema";
+        return;
+    }
+    node.btree = obj->name;
+    node.root = obj->rootpage;
+}
+
+/*
+** Rows a step visits.  A scan visits every entry of its b-tree.  A
+** search on k equality terms visits the k-th number of the stat1 row
+** of its index, or one row when the terms cover a unique key, or the
+** default of 10 that sqlite itself assumes without statistics; each
+** range term keeps a quarter of them.
+*/
+void CSQLite3QueryPlan::EstimateRows(const vector<double> *stat1, const SchemaObject *key, PlanNode &node)
+{
+    if (!node.rowsSource.empty() || node.root == 0) return;
+
+    double rows = (double)node.stats.entries;
+    node.rowsSource = "b-tree";
+    if (node.op != "SEARCH")
+    {
+        node.estRows = rows;
+        return;
+    }
+
+    int nEq = 0, nRange = 0;
+    string c = node.constraint;
+    size_t pos = 0;
+    while (pos <= c.size())
+    {
+        size_t end = c.find(" AND ", pos);
+        if (end == string::npos) end = c.size();
+        string term = c.substr(pos, end-pos);
+        if (term.find('<') != string::npos || term.find('>') != string::npos)
+            nRange++;
+        else if (term.size() > 2 && term.compare(term.size()-2, 2, "=?") == 0 && nRange == 0)
+            nEq++;
+        pos = end + 5;
+    }
+
+    if (nEq > 0)
+    {
+        int nKey = 1;
+        bool unique = true;
+        if (key != NULL && key->type == "index")
+        {
+            nKey = key->nKey;
+            unique = StrLower(key->sql).compare(0, 13, "create unique") == 0
+                  || key->name.compare(0, 17, "sqlite_autoindex_") == 0;
+        }
+        else if (key != NULL && key->withoutRowid)
+        {
+            nKey = 0;
+            for (size_t i=0; i<key->columns.size(); ++i)
+                if (key->columns[i].pk > 0) nKey++;
+        }
+
+        if (unique && nEq >= nKey)
+        {
+            rows = 1;
+            node.rowsSource = "key";
+        }
+        else if (stat1 != NULL && (int)stat1->size() > nEq)
+        {
+            rows = (*stat1)[nEq];
+            node.rowsSource = "stat1";
+        }
+        else
+        {
+            rows = std::min(rows, PLAN_DEFAULT_EQ_ROWS);
+            node.rowsSource = "default";
+        }
+    }
+    for (int i=0; i<nRange; ++i)
+        rows /= PLAN_RANGE_FACTOR;
+    node.estRows = std::max(rows, 1.0);
+}
+
+bool CSQLite3QueryPlan::ReadRows(sqlite3 *db, const string &sql, QueryPlan &plan)
+{
+    sqlite3_stmt* stmt = NULL;
+    string eqp = "EXPLAIN QUERY PLAN " + sql;
+    if (sqlite3_prepare_v2(db, eqp.c_str(), -1, &stmt, NULL) != SQLITE_OK || stmt == NULL)
+    {
+        plan.err = sqlite3_errmsg(db);
+        sqlite3_finalize(stmt);
+        return false;
+    }
+
+    const char* first = sqlite3_column_name(stmt, 0);
+    plan.legacy = first != NULL && StrLower(first) == "selectid";
+
+    std::map<int, int> byId;        // 新格式的id到下标
+    vector<int> selectIds;          // 旧格式每行的selectid
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        PlanNode node;
+        const char* detail = (const char*)sqlite3_column_text(stmt, 3);
+        node.detail = detail ? detail : "";
+        if (plan.legacy)
+        {
+            node.id = (int)plan.nodes.size() + 1;
+            selectIds.push_back(sqlite3_column_int(stmt, 0));
+        }
+        else
+        {
+            node.id = sqlite3_column_int(stmt, 0);
+            auto it = byId.find(sqlite3_column_int(stmt, 1));
+            node.parent = it == byId.end() ? -1 : it->second;
+            byId[node.id] = (int)plan.nodes.size();
+        }
+        plan.nodes.push_back(node);
+    }
+    if (rc != SQLITE_DONE) plan.err = sqlite3_errmsg(db);
+    sqlite3_finalize(stmt);
+
+    if (plan.legacy)
+    {
+        // 每个子查询一个节点，放在引用它的那一步下面
+        int nRow = (int)plan.nodes.size();
+        std::map<int, int> groups;
+        for (int i=0; i<nRow; ++i)
+        {
+            int sid = selectIds[i];
+            if (sid == 0) continue;
+            auto it = groups.find(sid);
+            if (it == groups.end())
+            {
+                PlanNode g;
+                g.id = (int)plan.nodes.size() + 1;
+                g.detail = "SUBQUERY " + std::to_string(sid);
+                g.op = "SUBQUERY";
+                it = groups.insert(std::make_pair(sid, (int)plan.nodes.size())).first;
+                plan.nodes.push_back(g);
+            }
+            plan.nodes[i].parent = it->second;
+        }
+        for (auto it=groups.begin(); it!=groups.end(); ++it)
+        {
+            for (int i=0; i<nRow; ++i)
+            {
+                if (selectIds[i] == it->first || !mentionsSubquery(plan.nodes[i].detail, it->first)) continue;
+                // 不能挂到自己的子孙下面
+                int p = i;
+                while (p >= 0 && p != it->second) p = plan.nodes[p].parent;
+                if (p == it->second) continue;
+                plan.nodes[it->second].parent = i;
+                break;
+            }
+        }
+    }
+
+    for (int i=0; i<(int)plan.nodes.size(); ++i)
+    {
+        int p = plan.nodes[i].parent;
+        if (p >= 0)
+            plan.nodes[p].children.push_back(i);
+        else
+            plan.roots.push_back(i);
+    }
+    return plan.err.empty();
+}
+
+bool CSQLite3QueryPlan::Explain(sqlite3 *db, const CSQLite3Schema &schema, const string &path,
+                                const string &sql, const PlanOptions &opts, QueryPlan &plan)
+{
+    plan = QueryPlan();
+    plan.sql = sql;
+    if (db == NULL)
+    {
+        plan.err = "no database";
+        return false;
+    }
+    if (!ReadRows(db, sql, plan)) return false;
+
+    // sqlite_stat1中每个索引的行数和各前缀匹配的平均行数
+    std::map<string, vector<double> > stat1;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, "SELECT idx, stat FROM sqlite_stat1", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char* idx = (const char*)sqlite3_column_text(stmt, 0);
+            const char* stat = (const char*)sqlite3_column_text(stmt, 1);
+            if (idx == NULL || stat == NULL) continue;
+            vector<double>& v = stat1[StrLower(idx)];
+            vector<string> words = splitWords(stat);
+            for (size_t i=0; i<words.size() && isNumber(words[i]); ++i)
+                v.push_back(atof(words[i].c_str()));
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    CSQLite3RawScan scan;
+    bool canRead = opts.annotate && !path.empty() && scan.Open(path);
+    std::map<int, RawBtreeStats> measured;
+    for (auto it=plan.nodes.begin(); it!=plan.nodes.end(); ++it)
+    {
+        PlanNode& node = *it;
+        if (node.op.empty()) ParseDetail(node);
+        Resolve(schema, sql, node);
+
+        if (canRead && node.root > 0)
+        {
+            auto m = measured.find(node.root);
+            if (m == measured.end())
+            {
+                RawBtreeStats stats;
+                scan.Estimate(node.root, opts.probes, stats);
+                if (stats.pages <= opts.exactPages)
+                    scan.Analyze(node.root, stats);
+                m = measured.insert(std::make_pair(node.root, stats)).first;
+            }
+            node.stats = m->second;
+
+            const SchemaObject* key = schema.Find(node.btree);
+            auto s = stat1.find(StrLower(node.btree));
+            EstimateRows(s == stat1.end() ? NULL : &s->second, key, node);
+        }
+
+        if (node.fullScan && node.stats.pages >= opts.largeTreePages)
+        {
+            node.flagged = true;
+            node.note = "full scan of " + std::to_string(node.stats.pages) + " pages";
+        }
+        else if (node.automaticIndex)
+        {
+            node.flagged = true;
+            node.note = "automatic index built for every run: consider CREATE INDEX on "
+                      + (node.table.empty() ? node.object : node.table)
+                      + (node.constraint.empty() ? string() : "(" + constraintColumns(node.constraint) + ")");
+        }
+        else if (node.op == "SEARCH" && !node.index.empty() && !node.covering)
+        {
+            node.note = "plus a table lookup per row";
+        }
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef SQLITE3QUERYPLAN_H
+#define SQLITE3QUERYPLAN_H
+
+#include <string>
+#include <vector>
+#include "sqlite3.h"
+#include "SQLite3Schema.h"
+#include "SQLite3RawScan.h"
+
+using std::string;
+using std::vector;
+
+// 查询计划中的一步
+struct PlanNode
+{
+    int     id;             // EXPLAIN QUERY PLAN的id，旧格式时为生成的序号
+    int     parent;         // 父节点在nodes中的下标，-1表示顶层
+    string  detail;
+
+    string  op;             // SCAN、SEARCH、USE TEMP B-TREE等
+    string  object;         // 计划中的表名或别名
+    string  table;          // 解析出的表名
+    string  index;          // 使用的索引，按rowid/主键查找时为空
+    string  constraint;     // 括号中的条件，如"a=? AND b>?"
+    string  btree;          // 实际访问的b-tree
+    int     root;           // b-tree的根页，0表示没有
+    bool    fullScan;       // 扫描整个b-tree
+    bool    automaticIndex;
+    bool    tempBtree;      // 排序、去重等使用的临时b-tree
+    bool    covering;
+    bool    flagged;        // 需要注意的步骤
+    string  note;
+
+    RawBtreeStats stats;    // root的统计
+    double  estRows;        // 估计访问的行数，<0表示未知
+    string  rowsSource;     // estRows的来源：b-tree、stat1、sqlite或default
+
+    vector<int> children;
+
+    PlanNode()
+        : id(0), parent(-1), root(0), fullScan(false), automaticIndex(false)
+        , tempBtree(false), covering(false), flagged(false), estRows(-1)
+    {}
+};
+
+struct QueryPlan
+{
+    string  sql;
+    string  err;
+    bool    legacy;         // 3.24之前的selectid格式
+    vector<PlanNode> nodes; // 按输出顺序，旧格式后面是子查询节点
+    vector<int>      roots;
+
+    QueryPlan() : legacy(false) {}
+};
+
+struct PlanOptions
+{
+    int     largeTreePages; // 全扫描达到该页数的b-tree时标记
+    int     probes;         // 估计页数时从根页向下的次数
+    int     exactPages;     // 估计不超过该页数时完整遍历
+    bool    annotate;       // 读取数据库文件统计b-tree
+
+    PlanOptions() : largeTreePages(1000), probes(16), exactPages(5000), annotate(true) {}
+};
+
+/*
+** EXPLAIN QUERY PLAN as a tree, with the b-trees it touches measured.
+**
+** Both output formats are read: since 3.24 every row has an id and the
+** id of its parent; before that rows carry (selectid, order, from) and
+** the nesting is implied by "SUBQUERY n" in the detail of the row that
+** runs subquery n.  The detail text is parsed into the operation, the
+** table (aliases are looked up in the FROM clauses of the SQL) and the
+** index, which the schema catalogue maps to a root page.
+**
+** Each root page is then sized from the file with the page decoder: a
+** few random root-to-leaf descents give the page count, depth and entry
+** count, and trees that turn out small are walked exactly.  Full scans
+** of trees of largeTreePages or more and automatic indexes are flagged.
+** The file is read as committed, so uncommitted changes in the WAL are
+** not seen.  Only the first statement of the SQL is explained.
+*/
+class CSQLite3QueryPlan
+{
+public:
+    static bool Explain(sqlite3* db, const CSQLite3Schema& schema, const string& path,
+                        const string& sql, const PlanOptions& opts, QueryPlan& plan);
+
+    // 解析一步的detail，填写op、object、index等
+    static void ParseDetail(PlanNode& node);
+
+    // 由node.stats和b-tree的sqlite_stat1估计一步访问的行数，key为node.btree的对象
+    static void EstimateRows(const vector<double>* stat1, const SchemaObject* key, PlanNode& node);
+
+private:
+    static bool ReadRows(sqlite3* db, const string& sql, QueryPlan& plan);
+    static void Resolve(const CSQLite3Schema& schema, const string& sql, PlanNode& node);
+};
+
+#endif // SQLITE3QUERYPLAN_H
@@ -0,0 +1,733 @@
+#include "SQLite3RawScan.h"
+#include "SQLite3File.h"
+#include "Parallel.h"
+#include "CppSQLite3.h"
+
+#include <mutex>
+#include <map>
+#include <algorithm>
+#include <random>
+#include <string.h>
+
+// b-tree的最大深度，超过时认为页之间有环
+static const int RAWSCAN_MAX_DEPTH = 64;
+// 猜测页大小时检查的页数
+static const int RAWSCAN_GUESS_PAGES = 64;
+// 记录中最多的字段数(SQLITE_MAX_COLUMN的默认值)
+static const int RAWSCAN_MAX_COLUMNS = 2000;
+
+CSQLite3RawScan::CSQLite3RawScan()
+    : m_pageSize(0)
+    , m_usable(0)
+    , m_nPage(0)
+    , m_freelist(0)
+    , m_cancel(false)
+{
+}
+
+/*
+** Page size for a file whose header cannot be trusted: the candidate
+** under which the most of the first pages start with a b-tree page type
+** and a sane cell count.
+*/
+int CSQLite3RawScan::GuessPageSize()
+{
+    CSQLite3File file;
+    if (!file.Open(m_path)) return 0;
+    int64_t size = file.Size();
+    int best = 4096, bestScore = -1;
+    unsigned char hdr[8];
+    for (int ps=512; ps<=65536; ps*=2)
+    {
+        if (size < ps) break;
+        int score = 0;
+        int n = (int)std::min<int64_t>(size / ps, RAWSCAN_GUESS_PAGES);
+        for (int pg=2; pg<=n; ++pg)
+        {
+            file.Read((int64_t)(pg-1) * ps, hdr, 8);
+            int ncell = get2(hdr+3);
+            bool btree = hdr[0] == 2 || hdr[0] == 5 || hdr[0] == 10 || hdr[0] == 13;
+            if (btree && ncell * 2 + 12 <= ps) score++;
+        }
+        // 页越大，检查的页越少，按比例比较
+        score = n > 1 ? score * 1000 / (n - 1) : 0;
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = ps;
+        }
+    }
+    return best;
+}
+
+bool CSQLite3RawScan::Open(const string &path, int pageSize)
+{
+    m_path = path;
+    m_err.clear();
+    CSQLite3File file;
+    if (!file.Open(path))
+    {
+        m_err = "cannot open " + path;
+        return false;
+    }
+
+    int64_t size = file.Size();
+    unsigned char hdr[100];
+    file.Read(0, hdr, 100);
+    int reserved = 0;
+    m_freelist = 0;
+    if (memcmp(hdr, "SQLite format 3", 16) == 0)
+        m_freelist = (int)std::min<unsigned int>(get4(hdr+36), 0x7fffffff);
+    if (pageSize <= 0 && memcmp(hdr, "SQLite format 3", 16) == 0)
+    {
+        pageSize = get2(hdr+16);
+        if (pageSize == 1) pageSize = 65536;
+        reserved = hdr[20];
+    }
+    if (pageSize < 512 || pageSize > 65536 || (pageSize & (pageSize-1)) != 0)
+    {
+        file.Close();
+        pageSize = GuessPageSize();
+        reserved = 0;
+    }
+    if (pageSize <= 0 || reserved >= pageSize - 480)
+    {
+        m_err = "cannot determine the page size";
+        return false;
+    }
+
+    m_pageSize = pageSize;
+    m_usable = pageSize - reserved;
+    m_nPage = (int)std::min<int64_t>(size / pageSize, 0x7fffffff);
+    return true;
+}
+
+/*
+** List the leaves of the table b-tree at root, left to right.  Each
+** page is visited at most once, so a damaged tree that points back into
+** itself cannot loop.
+*/
+void CSQLite3RawScan::CollectLeaves(int root, vector<int> &leaves)
+{
+    CSQLite3File file;
+    if (!file.Open(m_path)) return;
+
+    vector<char> visited(m_nPage + 1, 0);
+    vector<unsigned char> page(m_pageSize);
+    // 栈中为(页号, 深度)，子页逆序入栈以保证从左到右
+    vector<pair<int, int> > stack;
+    stack.push_back(std::make_pair(root, 0));
+    while (!stack.empty() && !m_cancel)
+    {
+        int pgno = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+        if (pgno < 1 || pgno > m_nPage || visited[pgno] || depth > RAWSCAN_MAX_DEPTH)
+        {
+            m_stats.badPages++;
+            continue;
+        }
+        visited[pgno] = 1;
+
+        file.Read((int64_t)(pgno-1) * m_pageSize, &page[0], m_pageSize);
+        const unsigned char* hdr = &page[pgno == 1 ? 100 : 0];
+        if (hdr[0] == 13)
+        {
+            leaves.push_back(pgno);
+            continue;
+        }
+        if (hdr[0] != 5)
+        {
+            m_stats.badPages++;
+            continue;
+        }
+
+        m_stats.interior++;
+        int ncell = get2(hdr+3);
+        int cellPtrs = (int)(hdr - &page[0]) + 12;
+        if (cellPtrs + ncell*2 > m_usable)
+        {
+            m_stats.badPages++;
+            ncell = (m_usable - cellPtrs) / 2;
+        }
+        stack.push_back(std::make_pair((int)get4(hdr+8), depth+1));
+        for (int i=ncell-1; i>=0; --i)
+        {
+            int ofst = get2(&page[cellPtrs + i*2]);
+            if (ofst < cellPtrs || ofst + 4 > m_usable)
+            {
+                m_stats.badCells++;
+                continue;
+            }
+            stack.push_back(std::make_pair((int)get4(&page[ofst]), depth+1));
+        }
+    }
+}
+
+bool CSQLite3RawScan::ReadPayload(CSQLite3File &file, const unsigned char *local, int64_t nLocal,
+                                  int64_t nPayload, string &payload, RawScanStats &stats)
+{
+    payload.assign((const char*)local, (size_t)nLocal);
+    unsigned int ovfl = get4(local + nLocal);
+    int ovflSize = m_usable - 4;
+    int64_t maxPages = (nPayload - nLocal + ovflSize - 1) / ovflSize;
+    vector<unsigned char> buf(m_pageSize);
+    for (int64_t n=0; (int64_t)payload.size() < nPayload; ++n)
+    {
+        if (ovfl < 1 || (int)ovfl > m_nPage || n >= maxPages) return false;
+        file.Read((int64_t)(ovfl-1) * m_pageSize, &buf[0], m_pageSize);
+        stats.overflow++;
+        int64_t take = std::min<int64_t>(ovflSize, nPayload - payload.size());
+        payload.append((const char*)&buf[4], (size_t)take);
+        ovfl = get4(&buf[0]);
+    }
+    return true;
+}
+
+/*
+** Decode every cell of one table leaf and append its record to batch.
+** Records with fewer fields than the batch (columns added later with
+** ALTER TABLE) are padded with NULL; a longer record adds columns.
+*/
+void CSQLite3RawScan::DecodeLeaf(CSQLite3File &file, int pgno, const unsigned char *page,
+                                 const RawScanOptions &opts, RawBatch &batch, string &payload,
+                                 RawScanStats &stats)
+{
+    const unsigned char* hdr = page + (pgno == 1 ? 100 : 0);
+    int ncell = get2(hdr+3);
+    int cellPtrs = (int)(hdr - page) + 8;
+    if (cellPtrs + ncell*2 > m_usable)
+    {
+        stats.badPages++;
+        return;
+    }
+    stats.leaves++;
+
+    int64_t maxLocal = m_usable - 35;
+    int64_t minLocal = (int64_t)(m_usable - 12) * 32 / 255 - 23;
+    const unsigned char* pageEnd = page + m_usable;
+    ExportBatch& data = batch.data;
+
+    for (int i=0; i<ncell; ++i)
+    {
+        int ofst = get2(page + cellPtrs + i*2);
+        if (ofst < cellPtrs + ncell*2 || ofst >= m_usable)
+        {
+            stats.badCells++;
+            continue;
+        }
+
+        const unsigned char* p = page + ofst;
+        int64_t nPayload, rowid;
+        int n1 = getVarint(p, pageEnd, &nPayload);
+        int n2 = n1 ? getVarint(p + n1, pageEnd, &rowid) : 0;
+        if (n2 == 0 || nPayload < 0 || nPayload > 0x7fffffff)
+        {
+            stats.badCells++;
+            continue;
+        }
+        p += n1 + n2;
+
+        int64_t nLocal = nPayload;
+        if (nPayload > maxLocal)
+        {
+            int64_t surplus = minLocal + (nPayload - minLocal) % (m_usable - 4);
+            nLocal = surplus <= maxLocal ? surplus : minLocal;
+        }
+        if (p + nLocal + (nLocal < nPayload ? 4 : 0) > pageEnd)
+        {
+            stats.badCells++;
+            continue;
+        }
+
+        const unsigned char* rec = p;
+        if (nLocal < nPayload)
+        {
+            if (!ReadPayload(file, p, nLocal, nPayload, payload, stats))
+            {
+                stats.badCells++;
+                continue;
+            }
+            rec = (const unsigned char*)payload.data();
+        }
+        const unsigned char* recEnd = rec + nPayload;
+
+        // 记录头
+        int64_t hdrSize;
+        int n = getVarint(rec, recEnd, &hdrSize);
+        if (n == 0 || hdrSize < n || hdrSize > nPayload)
+        {
+            stats.badCells++;
+            continue;
+        }
+        const unsigned char* t = rec + n;
+        const unsigned char* tEnd = rec + hdrSize;
+        const unsigned char* v = tEnd;
+
+        // 先检查整条记录，再追加，避免损坏的记录只写入一半
+        int64_t types[RAWSCAN_MAX_COLUMNS];
+        int nField = 0;
+        bool ok = true;
+        int64_t bodyLen = 0;
+        while (t < tEnd && nField < RAWSCAN_MAX_COLUMNS)
+        {
+            int64_t st;
+            int k = getVarint(t, tEnd, &st);
+            if (k == 0) { ok = false; break; }
+            t += k;
+            types[nField++] = st;
+            if (st >= 12) bodyLen += (st - 12) / 2;
+            else if (st >= 1 && st <= 7) bodyLen += st == 5 ? 6 : st == 6 || st == 7 ? 8 : st;
+        }
+        if (!ok || t != tEnd || v + bodyLen > recEnd)
+        {
+            stats.badCells++;
+            continue;
+        }
+
+        int row = data.rows;
+        if ((int)data.columns.size() < nField)
+        {
+            size_t old = data.columns.size();
+            data.columns.resize(nField);
+            for (size_t c=old; c<data.columns.size(); ++c)
+            {
+                data.columns[c].types.assign(row, (unsigned char)SQLITE_NULL);
+            }
+        }
+        for (int c=0; c<(int)data.columns.size(); ++c)
+        {
+            ExportBatch::Column& col = data.columns[c];
+            int64_t st = c < nField ? types[c] : 0;
+            if (st == 0 || st == 10 || st == 11)
+            {
+                if (c == opts.ipkColumn)
+                {
+                    col.types.push_back(SQLITE_INTEGER);
+                    col.ints.push_back(rowid);
+                }
+                else
+                {
+                    col.types.push_back(SQLITE_NULL);
+                }
+            }
+            else if (st <= 6)
+            {
+                static const int sizes[] = { 0, 1, 2, 3, 4, 6, 8 };
+                int64_t x = (signed char)v[0];
+                for (int k=1; k<sizes[st]; ++k) x = (x << 8) | v[k];
+                v += sizes[st];
+                col.types.push_back(SQLITE_INTEGER);
+                col.ints.push_back(x);
+            }
+            else if (st == 7)
+            {
+                // 大端存储的IEEE 754
+                uint64_t bits = 0;
+                for (int k=0; k<8; ++k) bits = (bits << 8) | v[k];
+                v += 8;
+                double d;
+                memcpy(&d, &bits, 8);
+                col.types.push_back(SQLITE_FLOAT);
+                col.reals.push_back(d);
+            }
+            else if (st == 8 || st == 9)
+            {
+                col.types.push_back(SQLITE_INTEGER);
+                col.ints.push_back(st - 8);
+            }
+            else
+            {
+                uint32_t len = (uint32_t)((st - 12) / 2);
+                col.types.push_back((st & 1) ? SQLITE_TEXT : SQLITE_BLOB);
+                col.lens.push_back(len);
+                col.bytes.append((const char*)v, len);
+                v += len;
+            }
+        }
+        data.rows++;
+        batch.rowids.push_back(rowid);
+        batch.pgnos.push_back(pgno);
+    }
+}
+
+bool CSQLite3RawScan::Scan(int root, const RawScanOptions &opts,
+                           const std::function<void (const RawBatch &)> &onBatch,
+                           const std::function<void (int, int)> &onProgress)
+{
+    m_err.clear();
+    m_stats = RawScanStats();
+    int64_t start = NowMs();
+    if (m_pageSize == 0)
+    {
+        m_err = "file is not open";
+        return false;
+    }
+
+    // 要解码的页：表的叶子，或者文件中的每一页
+    vector<int> pages;
+    if (root > 0)
+    {
+        CollectLeaves(root, pages);
+        if (opts.order == RAWSCAN_PHYSICAL_ORDER)
+            std::sort(pages.begin(), pages.end());
+    }
+    else
+    {
+        pages.resize(m_nPage);
+        for (int i=0; i<m_nPage; ++i) pages[i] = i + 1;
+    }
+
+    // 均匀抽取sampleLeaves页，保持原来的顺序
+    m_stats.totalLeaves = (int)pages.size();
+    if (opts.sampleLeaves > 0 && opts.sampleLeaves < (int)pages.size())
+    {
+        std::mt19937 rng(opts.seed);
+        vector<int> picked(pages.size());
+        for (size_t i=0; i<picked.size(); ++i) picked[i] = (int)i;
+        for (int i=0; i<opts.sampleLeaves; ++i)
+        {
+            std::uniform_int_distribution<int> pick(i, (int)picked.size() - 1);
+            std::swap(picked[i], picked[pick(rng)]);
+        }
+        picked.resize(opts.sampleLeaves);
+        std::sort(picked.begin(), picked.end());
+        vector<int> sampled(picked.size());
+        for (size_t i=0; i<picked.size(); ++i) sampled[i] = pages[picked[i]];
+        pages.swap(sampled);
+    }
+
+    // 批按序号交给回调，先完成的批暂存
+    std::mutex mutex;
+    std::map<int64_t, RawBatch*> pending;
+    int64_t nextSeq = 0;
+    int done = 0;
+    int grain = opts.leavesPerBatch > 0 ? opts.leavesPerBatch : 64;
+    int total = (int)pages.size();
+
+    ParallelFor(total, grain, [&](int64_t begin, int64_t end) {
+        if (m_cancel) return;
+        CSQLite3File file;
+        if (!file.Open(m_path)) return;
+
+        RawBatch* batch = new RawBatch;
+        batch->seq = begin / grain;
+        RawScanStats stats;
+        string payload;
+        vector<unsigned char> page(m_pageSize);
+        for (int64_t i=begin; i<end && !m_cancel; ++i)
+        {
+            int pgno = pages[i];
+            file.Read((int64_t)(pgno-1) * m_pageSize, &page[0], m_pageSize);
+            const unsigned char* hdr = &page[pgno == 1 ? 100 : 0];
+            if (hdr[0] != 13)
+            {
+                // 扫描全部页时跳过不是表叶子的页
+                if (root > 0) stats.badPages++;
+                continue;
+            }
+            DecodeLeaf(file, pgno, &page[0], opts, *batch, payload, stats);
+        }
+
+        int64_t rows = batch->data.rows;
+        // 不要求顺序时在锁外处理，其他工作线程可以同时解码和合并
+        if (opts.unordered)
+        {
+            if (onBatch && !m_cancel) onBatch(*batch);
+            delete batch;
+            batch = NULL;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        m_stats.leaves += stats.leaves;
+        m_stats.overflow += stats.overflow;
+        m_stats.badPages += stats.badPages;
+        m_stats.badCells += stats.badCells;
+        m_stats.rows += rows;
+        done += (int)(end - begin);
+        if (batch) pending[batch->seq] = batch;
+        while (!pending.empty() && pending.begin()->first == nextSeq)
+        {
+            RawBatch* b = pending.begin()->second;
+            pending.erase(pending.begin());
+            nextSeq++;
+            if (onBatch && !m_cancel) onBatch(*b);
+            delete b;
+        }
+        if (onProgress) onProgress(done, total);
+    }, opts.nThreads);
+
+    for (auto it=pending.begin(); it!=pending.end(); ++it)
+    {
+        delete it->second;
+    }
+    m_stats.seconds = (NowMs() - start) / 1000.0;
+    return !m_cancel;
+}
+
+/*
+** Pages of one b-tree, table or index.  Only the interior pages and
+** the cell headers are read: the number of overflow pages of a cell
+** follows from its payload size, so overflow chains are not walked.
+*/
+int64_t CSQLite3RawScan::CountPages(int root)
+{
+    RawBtreeStats stats;
+    Analyze(root, stats);
+    return stats.pages + stats.overflow;
+}
+
+/*
+** One pass over the b-tree pages.  The overflow pages of a cell follow
+** from its payload size, so they are counted without being read.  Free
+** bytes are the gap between the cell pointers and the cell content, the
+** freeblock chain and the fragmented bytes.
+*/
+void CSQLite3RawScan::Analyze(int root, RawBtreeStats &stats)
+{
+    stats = RawBtreeStats();
+    CSQLite3File file;
+    if (m_pageSize == 0 || !file.Open(m_path)) return;
+
+    int ovflSize = m_usable - 4;
+    vector<char> visited(m_nPage + 1, 0);
+    vector<unsigned char> page(m_pageSize);
+    const unsigned char* pageEnd = &page[0] + m_usable;
+    vector<pair<int, int> > stack;
+    stack.push_back(std::make_pair(root, 0));
+    while (!stack.empty() && !m_cancel)
+    {
+        int pgno = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+        if (pgno < 1 || pgno > m_nPage || visited[pgno] || depth > RAWSCAN_MAX_DEPTH) continue;
+        visited[pgno] = 1;
+
+        file.Read((int64_t)(pgno-1) * m_pageSize, &page[0], m_pageSize);
+        const unsigned char* hdr = &page[pgno == 1 ? 100 : 0];
+        int type = hdr[0];
+        if (pgno == root) stats.rootType = type;
+        if (type != 2 && type != 5 && type != 10 && type != 13) continue;
+        stats.pages++;
+        stats.depth = std::max(stats.depth, depth + 1);
+
+        bool interior = type == 2 || type == 5;
+        if (!interior) stats.leaves++;
+        int ncell = get2(hdr+3);
+        int cellPtrs = (int)(hdr - &page[0]) + (interior ? 12 : 8);
+        if (cellPtrs + ncell*2 > m_usable) continue;
+        if (interior)
+            stack.push_back(std::make_pair((int)get4(hdr+8), depth+1));
+        if (type != 5)
+            stats.entries += ncell;
+
+        int content = get2(hdr+5);
+        if (content == 0) content = 65536;
+        int nFree = std::max(0, std::min(content, m_usable) - (cellPtrs + ncell*2)) + hdr[7];
+        int fb = get2(hdr+1);
+        for (int n=0; fb > 0 && fb + 4 <= m_usable && n < m_usable/4; ++n)
+        {
+            nFree += get2(&page[fb+2]);
+            int next = get2(&page[fb]);
+            if (next <= fb) break;
+            fb = next;
+        }
+        stats.freeBytes += std::min(nFree, m_usable - (int)(hdr - &page[0]));
+        stats.usableBytes += m_usable - (int)(hdr - &page[0]);
+
+        // 表叶子和索引页的cell有payload
+        int64_t maxLocal = type == 13 ? m_usable - 35 : (int64_t)(m_usable - 12) * 64 / 255 - 23;
+        int64_t minLocal = (int64_t)(m_usable - 12) * 32 / 255 - 23;
+        for (int i=0; i<ncell; ++i)
+        {
+            int ofst = get2(&page[cellPtrs + i*2]);
+            if (ofst < cellPtrs || ofst + 4 > m_usable) continue;
+            const unsigned char* p = &page[ofst];
+            if (interior)
+            {
+                stack.push_back(std::make_pair((int)get4(p), depth+1));
+                p += 4;
+            }
+            if (type == 5) continue;
+
+            int64_t nPayload;
+            if (getVarint(p, pageEnd, &nPayload) == 0 || nPayload <= maxLocal) continue;
+            int64_t surplus = minLocal + (nPayload - minLocal) % ovflSize;
+            int64_t nLocal = surplus <= maxLocal ? surplus : minLocal;
+            stats.overflow += (nPayload - nLocal + ovflSize - 1) / ovflSize;
+        }
+    }
+}
+
+/*
+** Knuth's estimate of the size of a tree: walk from the root to a leaf
+** choosing a child at random; a page reached through fan-outs n1..nk
+** stands for n1*...*nk pages of its level.  The average over a few
+** probes is unbiased, and it is exact for a tree of one page or one
+** with even fan-out.  Free space is scaled the same way, so Fill() is
+** an estimate too.  Costs probes*depth page reads.
+*/
+void CSQLite3RawScan::Estimate(int root, int probes, RawBtreeStats &stats)
+{
+    stats = RawBtreeStats();
+    stats.estimated = true;
+    CSQLite3File file;
+    if (m_pageSize == 0 || !file.Open(m_path) || root < 1 || root > m_nPage) return;
+    if (probes < 1) probes = 1;
+
+    double pages = 0, leaves = 0, entries = 0, freeBytes = 0, usableBytes = 0;
+    vector<unsigned char> page(m_pageSize);
+    uint32_t seed = (uint32_t)root * 2654435761u + 1;
+    for (int p=0; p<probes && !m_cancel; ++p)
+    {
+        int pgno = root;
+        double mult = 1;
+        for (int depth=0; depth<=RAWSCAN_MAX_DEPTH; ++depth)
+        {
+            if (pgno < 1 || pgno > m_nPage) break;
+            file.Read((int64_t)(pgno-1) * m_pageSize, &page[0], m_pageSize);
+            const unsigned char* hdr = &page[pgno == 1 ? 100 : 0];
+            int type = hdr[0];
+            if (depth == 0) stats.rootType = type;
+            if (type != 2 && type != 5 && type != 10 && type != 13) break;
+
+            bool interior = type == 2 || type == 5;
+            int ncell = get2(hdr+3);
+            int cellPtrs = (int)(hdr - &page[0]) + (interior ? 12 : 8);
+            if (cellPtrs + ncell*2 > m_usable) break;
+
+            int usable = m_usable - (int)(hdr - &page[0]);
+            int content = get2(hdr+5);
+            if (content == 0) content = 65536;
+            int nFree = std::max(0, std::min(content, m_usable) - (cellPtrs + ncell*2)) + hdr[7];
+            int fb = get2(hdr+1);
+            for (int n=0; fb > 0 && fb + 4 <= m_usable && n < m_usable/4; ++n)
+            {
+                nFree += get2(&page[fb+2]);
+                int next = get2(&page[fb]);
+                if (next <= fb) break;
+                fb = next;
+            }
+            pages += mult;
+            freeBytes += mult * std::min(nFree, usable);
+            usableBytes += mult * usable;
+            stats.depth = std::max(stats.depth, depth + 1);
+            if (type != 5) entries += mult * ncell;
+            if (!interior)
+            {
+                leaves += mult;
+                break;
+            }
+
+            // 选择一个子页，最右边的子页在页头中
+            seed = seed * 1103515245u + 12345u;
+            int k = (int)((seed >> 8) % (uint32_t)(ncell + 1));
+            if (k == ncell)
+            {
+                pgno = (int)get4(hdr+8);
+            }
+            else
+            {
+                int ofst = get2(&page[cellPtrs + k*2]);
+                if (ofst < cellPtrs || ofst + 4 > m_usable) break;
+                pgno = (int)get4(&page[ofst]);
+            }
+            mult *= ncell + 1;
+        }
+    }
+
+    stats.pages = (int64_t)(pages / probes + 0.5);
+    stats.leaves = (int64_t)(leaves / probes + 0.5);
+    stats.entries = (int64_t)(entries / probes + 0.5);
+    stats.freeBytes = (int64_t)(freeBytes / probes);
+    stats.usableBytes = (int64_t)(usableBytes / probes);
+}
+
+bool CSQLite3RawScan::ListTables(vector<RawTable> &tables)
+{
+    tables.clear();
+    RawScanOptions opts;
+    opts.nThreads = 1;
+    bool ok = Scan(1, opts, [&](const RawBatch& batch) {
+        const ExportBatch& data = batch.data;
+        if (data.columns.size() < 5) return;
+
+        // 每列的读位置
+        size_t ints[5] = {0}, lens[5] = {0}, bytes[5] = {0};
+        for (int r=0; r<data.rows; ++r)
+        {
+            RawTable t;
+            string* text[5] = { &t.type, &t.name, &t.tblName, NULL, &t.sql };
+            for (int c=0; c<5; ++c)
+            {
+                const ExportBatch::Column& col = data.columns[c];
+                int type = col.types[r];
+                if (type == SQLITE_INTEGER)
+                {
+                    int64_t v = col.ints[ints[c]++];
+                    if (c == 3) t.root = (int)v;
+                }
+                else if (type == SQLITE_TEXT || type == SQLITE_BLOB)
+                {
+                    uint32_t len = col.lens[lens[c]++];
+                    if (text[c]) text[c]->assign(col.bytes, bytes[c], len);
+                    bytes[c] += len;
+                }
+            }
+            tables.push_back(t);
+        }
+    });
+    return ok;
+}
+
+bool CSQLite3RawScan::ScanSql(const string &path, const string &table, int batchRows,
+                              const std::function<void (const ExportBatch &)> &onBatch,
+                              RawScanStats &stats, string &err)
+{
+    int64_t start = NowMs();
+    stats = RawScanStats();
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+    {
+        err = sqlite3_errmsg(db);
+        sqlite3_close(db);
+        return false;
+    }
+
+    string quoted = "\"";
+    for (auto it=table.begin(); it!=table.end(); ++it)
+    {
+        if (*it == '"') quoted += '"';
+        quoted += *it;
+    }
+    quoted += "\"";
+
+    sqlite3_stmt* stmt = NULL;
+    bool ok = sqlite3_prepare_v2(db, ("SELECT * FROM " + quoted).c_str(), -1, &stmt, NULL) == SQLITE_OK;
+    if (ok)
+    {
+        ExportBatch batch;
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            batch.Append(stmt);
+            if (batch.rows >= batchRows)
+            {
+                stats.rows += batch.rows;
+                if (onBatch) onBatch(batch);
+                batch.Clear();
+            }
+        }
+        if (batch.rows > 0)
+        {
+            stats.rows += batch.rows;
+            if (onBatch) onBatch(batch);
+        }
+        ok = rc == SQLITE_DONE;
+    }
+    if (!ok) err = sqlite3_errmsg(db);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    stats.seconds = (NowMs() - start) / 1000.0;
+    return ok;
+}
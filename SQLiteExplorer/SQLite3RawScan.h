@@ -0,0 +1,189 @@
+#ifndef SQLITE3RAWSCAN_H
+#define SQLITE3RAWSCAN_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "utils.h"
+#include "SQLite3Export.h"
+
+using std::string;
+using std::vector;
+using std::pair;
+
+class CSQLite3File;
+
+// sqlite_master中的一项，直接从页1的b-tree读出
+struct RawTable
+{
+    string  type;
+    string  name;
+    string  tblName;
+    int     root;
+    string  sql;
+
+    RawTable() : root(0) {}
+};
+
+enum RawScanOrder
+{
+    RAWSCAN_KEY_ORDER = 0,      // 按rowid顺序(从根页向下遍历)
+    RAWSCAN_PHYSICAL_ORDER      // 按叶子页在文件中的位置
+};
+
+struct RawScanOptions
+{
+    RawScanOrder order;
+    int          leavesPerBatch;    // 每批解码的叶子页数
+    int          ipkColumn;         // INTEGER PRIMARY KEY列的下标，该列用rowid填充，-1表示没有
+    int          nThreads;          // 0为CPU核数
+    int          sampleLeaves;      // >0时只解码均匀随机抽取的这么多个叶子，顺序不变
+    unsigned     seed;              // 抽样的随机数种子，相同时抽到相同的叶子
+    bool         unordered;         // 批解码后直接在工作线程上交给回调，不排序也不加锁，回调可能并发
+
+    RawScanOptions()
+        : order(RAWSCAN_KEY_ORDER), leavesPerBatch(64), ipkColumn(-1), nThreads(0)
+        , sampleLeaves(0), seed(1), unordered(false)
+    {}
+};
+
+struct RawScanStats
+{
+    int64_t rows;
+    int     leaves;
+    int     interior;
+    int     overflow;       // 读过的溢出页
+    int     badPages;       // 无法解析的页(类型错误、越界、环)
+    int64_t badCells;       // 无法解析的cell
+    int     totalLeaves;    // 抽样前要扫描的页数
+    double  seconds;
+
+    RawScanStats()
+        : rows(0), leaves(0), interior(0), overflow(0), badPages(0), badCells(0)
+        , totalLeaves(0), seconds(0)
+    {}
+};
+
+// 一棵b-tree的页统计
+struct RawBtreeStats
+{
+    int64_t pages;          // b-tree页，不含溢出页
+    int64_t leaves;
+    int64_t overflow;       // 溢出页，按payload大小计算
+    int64_t entries;        // 表为行数(叶子的cell)，索引为所有cell
+    int64_t freeBytes;      // b-tree页中未使用的字节
+    int64_t usableBytes;
+    int     depth;          // 层数，只有根页时为1
+    int     rootType;       // 根页的类型字节，0表示不是b-tree页
+    bool    estimated;      // 由Estimate抽样得到
+
+    RawBtreeStats()
+        : pages(0), leaves(0), overflow(0), entries(0), freeBytes(0), usableBytes(0)
+        , depth(0), rootType(0), estimated(false)
+    {}
+
+    // b-tree页的平均填充率，0~1
+    double Fill() const { return usableBytes > 0 ? 1.0 - (double)freeBytes / usableBytes : 0; }
+};
+
+// 一批解码后的记录，data.names为空
+struct RawBatch
+{
+    int64_t         seq;        // 批的序号，按扫描顺序从0开始
+    vector<int64_t> rowids;
+    vector<int>     pgnos;      // 每行所在的叶子页
+    ExportBatch     data;
+
+    RawBatch() : seq(0) {}
+};
+
+/*
+** Read the rows of a table b-tree straight from the file, without the
+** SQL engine.
+**
+** The interior pages are walked once to list the leaves (in key order,
+** or sorted by page number for physical order), then the leaves are
+** decoded on worker threads, each with its own CSQLite3File, into
+** column-major RawBatch objects that reach the callback in scan order.
+** With unordered the callback runs on the worker that decoded the batch,
+** outside the scan's lock, so it must be safe to call concurrently.
+** With sampleLeaves only a uniform random subset of the leaves is read.
+**
+** Nothing here needs sqlite to accept the file: the page size may be
+** given when the header is damaged, every pointer is bounds-checked and
+** cycles in the tree are cut, and bad cells are counted and skipped.
+** Root 0 scans every page that looks like a table leaf, which recovers
+** rows of tables whose schema or interior pages are gone (and rows left
+** on free pages).
+**
+** Only rowid tables are handled; WITHOUT ROWID tables and indexes are
+** index b-trees.  Text is returned as stored, in the database encoding.
+*/
+class CSQLite3RawScan
+{
+public:
+    CSQLite3RawScan();
+
+    // pageSize为0时从文件头读取，文件头损坏时猜测
+    bool Open(const string& path, int pageSize = 0);
+
+    int PageSize() const { return m_pageSize; }
+    int PageCount() const { return m_nPage; }
+    // 文件头中的自由页数，文件头损坏时为0
+    int FreelistCount() const { return m_freelist; }
+
+    // 读出sqlite_master，不经过sqlite
+    bool ListTables(vector<RawTable>& tables);
+
+    // 根页为root的b-tree(表或索引)占用的页数，包括溢出页
+    int64_t CountPages(int root);
+
+    // 遍历根页为root的b-tree，统计页数、行数和填充率，不读溢出页
+    void Analyze(int root, RawBtreeStats& stats);
+
+    // 从根页随机向下probes次估计上面的统计，不计溢出页
+    void Estimate(int root, int probes, RawBtreeStats& stats);
+
+    // 扫描根页为root的表，root为0时扫描文件中所有像表叶子的页
+    bool Scan(int root, const RawScanOptions& opts,
+              const std::function<void(const RawBatch&)>& onBatch,
+              const std::function<void(int done, int total)>& onProgress = nullptr);
+
+    void Cancel() { m_cancel = true; }
+    // 取消标志只在这里清除，不在Open/Scan中，这样启动线程后、扫描开始前的Cancel不会丢失
+    void ClearCancel() { m_cancel = false; }
+    bool IsCancelled() const { return m_cancel; }
+
+    const string& GetError() const { return m_err; }
+    const RawScanStats& GetStats() const { return m_stats; }
+
+    /*
+    ** The same rows through sqlite: "SELECT * FROM table" stepped into
+    ** ExportBatch objects of batchRows rows, for comparison with Scan.
+    */
+    static bool ScanSql(const string& path, const string& table, int batchRows,
+                        const std::function<void(const ExportBatch&)>& onBatch,
+                        RawScanStats& stats, string& err);
+
+private:
+    int GuessPageSize();
+    void CollectLeaves(int root, vector<int>& leaves);
+    void DecodeLeaf(CSQLite3File& file, int pgno, const unsigned char* page,
+                    const RawScanOptions& opts, RawBatch& batch, string& payload,
+                    RawScanStats& stats);
+    bool ReadPayload(CSQLite3File& file, const unsigned char* local, int64_t nLocal,
+                     int64_t nPayload, string& payload, RawScanStats& stats);
+
+private:
+    string              m_path;
+    int                 m_pageSize;
+    int                 m_usable;       // 页大小减去保留字节
+    int                 m_nPage;
+    int                 m_freelist;
+    std::atomic<bool>   m_cancel;
+    string              m_err;
+    RawScanStats        m_stats;
+};
+
+#endif // SQLITE3RAWSCAN_H
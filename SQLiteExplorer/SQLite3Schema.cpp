@@ -0,0 +1,345 @@
+#include "SQLite3Schema.h"
+#include "utils.h"
+
+#include <algorithm>
+
+CSQLite3Schema::CSQLite3Schema()
+    : m_cookie(0)
+    , m_loaded(false)
+{
+}
+
+void CSQLite3Schema::Clear()
+{
+    m_objects.clear();
+    m_byName.clear();
+    m_byRoot.clear();
+    m_cookie = 0;
+    m_loaded = false;
+}
+
+const SchemaObject *CSQLite3Schema::Find(const string &name) const
+{
+    auto it = m_byName.find(StrLower(name));
+    return it == m_byName.end() ? NULL : &m_objects[it->second];
+}
+
+const SchemaObject *CSQLite3Schema::FindByRoot(int rootpage) const
+{
+    auto it = m_byRoot.find(rootpage);
+    return it == m_byRoot.end() ? NULL : &m_objects[it->second];
+}
+
+SchemaObject *CSQLite3Schema::FindMutable(const string &name)
+{
+    auto it = m_byName.find(StrLower(name));
+    return it == m_byName.end() ? NULL : &m_objects[it->second];
+}
+
+bool CSQLite3Schema::Load(CppSQLite3DB &db, const std::function<int (int)> &pageType)
+{
+    Clear();
+    try
+    {
+        m_cookie = db.execScalar("PRAGMA schema_version");
+
+        // sqlite_master不在自身之中，列是固定的
+        SchemaObject master;
+        master.type = "table";
+        master.name = "sqlite_master";
+        master.tblName = "sqlite_master";
+        master.rootpage = 1;
+        const char* masterCols[] = { "type", "name", "tbl_name", "rootpage", "sql" };
+        const char* masterTypes[] = { "TEXT", "TEXT", "TEXT", "INTEGER", "TEXT" };
+        for (int i=0; i<5; ++i)
+        {
+            SchemaColumn col;
+            col.name = masterCols[i];
+            col.type = masterTypes[i];
+            col.cid = i;
+            master.columns.push_back(col);
+        }
+        m_objects.push_back(master);
+
+        CppSQLite3Query q = db.execQuery("SELECT type, name, tbl_name, rootpage, sql FROM sqlite_master");
+        for (; !q.eof(); q.nextRow())
+        {
+            SchemaObject obj;
+            obj.type = q.getStringField(0);
+            obj.name = q.getStringField(1);
+            obj.tblName = q.getStringField(2);
+            obj.rootpage = q.getIntField(3);
+            obj.sql = q.getStringField(4);
+            m_objects.push_back(obj);
+        }
+    }
+    catch (CppSQLite3Exception&)
+    {
+        Clear();
+        return false;
+    }
+
+    for (size_t i=0; i<m_objects.size(); ++i)
+    {
+        m_byName[StrLower(m_objects[i].name)] = (int)i;
+        if (m_objects[i].rootpage > 0)
+            m_byRoot[m_objects[i].rootpage] = (int)i;
+    }
+
+    LoadTableColumns(db);
+    LoadIndexColumns(db);
+    for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+    {
+        Derive(*it, pageType);
+    }
+    LoadPrimaryKeyColumns(db);
+
+    // "INTEGER PRIMARY KEY DESC"不是rowid别名，这时主键另有一个自动索引
+    for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+    {
+        if (it->type != "index" || it->nKey != 1 || it->name.compare(0, 17, "sqlite_autoindex_") != 0)
+            continue;
+        SchemaObject* tbl = FindMutable(it->tblName);
+        if (tbl && tbl->ipk >= 0 && tbl->Field(tbl->ipk)->cid == it->columns[0].cid)
+            tbl->ipk = -1;
+    }
+    m_loaded = true;
+    return true;
+}
+
+/*
+** Columns of every table with a b-tree.  Virtual tables are left out:
+** they have no pages, and one whose module is not loaded would make the
+** whole join fail.
+*/
+void CSQLite3Schema::LoadTableColumns(CppSQLite3DB &db)
+{
+    static const char* joins[] = {
+        "SELECT m.name, p.cid, p.name, p.type, p.\"notnull\", p.pk, p.hidden "
+        "FROM sqlite_master m, pragma_table_xinfo(m.name) p "
+        "WHERE m.type='table' AND m.rootpage>0 ORDER BY m.name, p.cid",
+        "SELECT m.name, p.cid, p.name, p.type, p.\"notnull\", p.pk, 0 "
+        "FROM sqlite_master m, pragma_table_info(m.name) p "
+        "WHERE m.type='table' AND m.rootpage>0 ORDER BY m.name, p.cid",
+    };
+    for (size_t j=0; j<sizeof(joins)/sizeof(joins[0]); ++j)
+    {
+        try
+        {
+            CppSQLite3Query q = db.execQuery(joins[j]);
+            for (; !q.eof(); q.nextRow())
+            {
+                SchemaObject* obj = FindMutable(q.getStringField(0));
+                if (obj == NULL) continue;
+                SchemaColumn col;
+                col.cid = q.getIntField(1);
+                col.name = q.getStringField(2);
+                col.type = q.getStringField(3);
+                col.notNull = q.getIntField(4) != 0;
+                col.pk = q.getIntField(5);
+                col.hidden = q.getIntField(6);
+                obj->columns.push_back(col);
+            }
+            return;
+        }
+        catch (CppSQLite3Exception&)
+        {
+            for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+            {
+                if (it->rootpage != 1) it->columns.clear();
+            }
+        }
+    }
+
+    // 3.16之前没有pragma函数
+    for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+    {
+        if (it->type != "table" || it->rootpage <= 1) continue;
+        try
+        {
+            string sql = "PRAGMA table_info(" + QuoteName(it->name) + ")";
+            CppSQLite3Query q = db.execQuery(sql.c_str());
+            for (; !q.eof(); q.nextRow())
+            {
+                SchemaColumn col;
+                col.cid = q.getIntField(0);
+                col.name = q.getStringField(1);
+                col.type = q.getStringField(2);
+                col.notNull = q.getIntField(3) != 0;
+                col.pk = q.getIntField(5);
+                it->columns.push_back(col);
+            }
+        }
+        catch (CppSQLite3Exception&)
+        {
+        }
+    }
+}
+
+void CSQLite3Schema::LoadIndexColumns(CppSQLite3DB &db)
+{
+    try
+    {
+        CppSQLite3Query q = db.execQuery(
+                    "SELECT m.name, p.cid, p.name, p.\"desc\", p.coll, p.key "
+                    "FROM sqlite_master m, pragma_index_xinfo(m.name) p "
+                    "WHERE m.type='index' ORDER BY m.name, p.seqno");
+        for (; !q.eof(); q.nextRow())
+        {
+            SchemaObject* obj = FindMutable(q.getStringField(0));
+            if (obj == NULL) continue;
+            SchemaColumn col;
+            col.cid = q.getIntField(1);
+            col.name = q.getStringField(2);
+            col.desc = q.getIntField(3) != 0;
+            col.collation = q.getStringField(4);
+            col.key = q.getIntField(5) != 0;
+            obj->columns.push_back(col);
+        }
+        return;
+    }
+    catch (CppSQLite3Exception&)
+    {
+        for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+        {
+            if (it->type == "index") it->columns.clear();
+        }
+    }
+
+    // 逐个索引查询，index_xinfo不存在时用index_info(只有键列)
+    for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+    {
+        if (it->type != "index") continue;
+        string quoted = "(" + QuoteName(it->name) + ")";
+        try
+        {
+            CppSQLite3Query q = db.execQuery(("PRAGMA index_xinfo" + quoted).c_str());
+            for (; !q.eof(); q.nextRow())
+            {
+                SchemaColumn col;
+                col.cid = q.getIntField(1);
+                col.name = q.getStringField(2);
+                col.desc = q.getIntField(3) != 0;
+                col.collation = q.getStringField(4);
+                col.key = q.getIntField(5) != 0;
+                it->columns.push_back(col);
+            }
+            continue;
+        }
+        catch (CppSQLite3Exception&)
+        {
+            it->columns.clear();
+        }
+        try
+        {
+            CppSQLite3Query q = db.execQuery(("PRAGMA index_info" + quoted).c_str());
+            for (; !q.eof(); q.nextRow())
+            {
+                SchemaColumn col;
+                col.cid = q.getIntField(1);
+                col.name = q.getStringField(2);
+                it->columns.push_back(col);
+            }
+        }
+        catch (CppSQLite3Exception&)
+        {
+        }
+    }
+}
+
+/*
+** Collation and order of the primary key columns of WITHOUT ROWID
+** tables.  The key is an index b-tree whose autoindex is not in
+** sqlite_master, but index_list still names it (origin 'pk') and
+** index_xinfo describes it.
+*/
+void CSQLite3Schema::LoadPrimaryKeyColumns(CppSQLite3DB &db)
+{
+    for (auto it=m_objects.begin(); it!=m_objects.end(); ++it)
+    {
+        if (it->type != "table" || !it->withoutRowid) continue;
+        try
+        {
+            string pkIndex;
+            CppSQLite3Query list = db.execQuery(("PRAGMA index_list(" + QuoteName(it->name) + ")").c_str());
+            // origin列从3.8.9开始才有
+            int origin = list.numFields() > 3 ? list.fieldIndex("origin") : -1;
+            for (; origin >= 0 && !list.eof(); list.nextRow())
+            {
+                if (string(list.getStringField(origin)) == "pk") pkIndex = list.getStringField(1);
+            }
+            list.finalize();
+            if (pkIndex.empty()) continue;
+
+            CppSQLite3Query q = db.execQuery(("PRAGMA index_xinfo(" + QuoteName(pkIndex) + ")").c_str());
+            for (; !q.eof(); q.nextRow())
+            {
+                int cid = q.getIntField(1);
+                if (q.getIntField(5) == 0 || cid < 0) continue;
+                for (auto c=it->columns.begin(); c!=it->columns.end(); ++c)
+                {
+                    if (c->cid != cid) continue;
+                    c->desc = q.getIntField(3) != 0;
+                    c->collation = q.getStringField(4);
+                }
+            }
+        }
+        catch (CppSQLite3Exception&)
+        {
+        }
+    }
+}
+
+/*
+** Record layout of one object.  A rowid table stores every column that
+** is not VIRTUAL generated, in declaration order, with NULL in place of
+** a rowid alias.  A WITHOUT ROWID table is an index b-tree keyed by its
+** primary key: the key columns come first, in key order, then the rest.
+*/
+void CSQLite3Schema::Derive(SchemaObject &obj, const std::function<int (int)> &pageType)
+{
+    obj.fields.clear();
+    if (obj.type == "index")
+    {
+        for (size_t i=0; i<obj.columns.size(); ++i)
+        {
+            obj.fields.push_back((int)i);
+            if (obj.columns[i].key) obj.nKey++;
+        }
+        return;
+    }
+    if (obj.type != "table") return;
+
+    if (obj.rootpage > 1 && pageType)
+    {
+        int type = pageType(obj.rootpage);
+        obj.withoutRowid = type == 2 || type == 10;
+    }
+
+    vector<int> pk;
+    for (size_t i=0; i<obj.columns.size(); ++i)
+    {
+        if (obj.columns[i].pk > 0) pk.push_back((int)i);
+    }
+    std::sort(pk.begin(), pk.end(), [&](int a, int b) {
+        return obj.columns[a].pk < obj.columns[b].pk;
+    });
+
+    if (obj.withoutRowid)
+        obj.fields = pk;
+    for (size_t i=0; i<obj.columns.size(); ++i)
+    {
+        const SchemaColumn& col = obj.columns[i];
+        if (col.hidden == 1 || col.hidden == 2) continue;
+        if (obj.withoutRowid && col.pk > 0) continue;
+        obj.fields.push_back((int)i);
+    }
+
+    if (!obj.withoutRowid && pk.size() == 1 && StrUpper(obj.columns[pk[0]].type) == "INTEGER")
+    {
+        for (size_t f=0; f<obj.fields.size(); ++f)
+        {
+            if (obj.fields[f] == pk[0]) obj.ipk = (int)f;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef SQLITE3SCHEMA_H
+#define SQLITE3SCHEMA_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "CppSQLite3.h"
+
+using std::string;
+using std::vector;
+
+// 表或索引的一列
+struct SchemaColumn
+{
+    string  name;       // 索引中的表达式和rowid列为空
+    string  type;       // 声明的类型
+    string  collation;  // 索引列的排序规则；WITHOUT ROWID表的主键列为主键中的排序规则
+    int     cid;        // 在表中的序号，索引中-1为rowid，-2为表达式
+    int     pk;         // 在主键中的位置，从1开始，0表示不是主键列
+    int     hidden;     // table_xinfo的hidden：1虚拟表隐藏列，2 VIRTUAL生成列，3 STORED生成列
+    bool    notNull;
+    bool    desc;       // 索引列降序；WITHOUT ROWID表的主键列为主键中的顺序
+    bool    key;        // 索引的键列，否则是附加的rowid/主键列
+
+    SchemaColumn() : cid(0), pk(0), hidden(0), notNull(false), desc(false), key(true) {}
+};
+
+// sqlite_master中的一项及其列
+struct SchemaObject
+{
+    string  type;
+    string  name;
+    string  tblName;
+    string  sql;
+    int     rootpage;
+    bool    withoutRowid;
+    int     ipk;        // rowid别名(INTEGER PRIMARY KEY)在记录中的下标，-1表示没有
+    int     nKey;       // 索引的键列数
+
+    vector<SchemaColumn> columns;   // 表按声明顺序，索引按index_xinfo顺序
+    vector<int>          fields;    // 记录中第i个字段对应的columns下标
+
+    SchemaObject() : rootpage(0), withoutRowid(false), ipk(-1), nKey(0) {}
+
+    // 记录中第i个字段的列，超出时为NULL
+    const SchemaColumn* Field(int i) const
+    {
+        return i >= 0 && i < (int)fields.size() ? &columns[fields[i]] : NULL;
+    }
+};
+
+/*
+** Catalogue of the schema, loaded once per schema cookie.
+**
+** The columns come from PRAGMA table_xinfo and index_xinfo, read for all
+** objects in one join over the pragma table-valued functions; older
+** libraries fall back to table_info, and to one pragma per object
+** before 3.16.  From them the record layout of every b-tree is derived:
+** which columns are stored (VIRTUAL generated columns are not), their
+** order (a WITHOUT ROWID table stores its primary key first), and which
+** column aliases the rowid.  Lookups by name or root page are hash
+** lookups, so decoders can consult it per cell.
+**
+** Whether a table is WITHOUT ROWID is read from the type of its root
+** page through pageType, not from the CREATE TABLE text.
+*/
+class CSQLite3Schema
+{
+public:
+    CSQLite3Schema();
+
+    bool Load(CppSQLite3DB& db, const std::function<int(int pgno)>& pageType);
+    void Clear();
+
+    bool IsLoaded() const { return m_loaded; }
+    int Cookie() const { return m_cookie; }
+
+    // 名称不区分大小写，没有时返回NULL
+    const SchemaObject* Find(const string& name) const;
+    const SchemaObject* FindByRoot(int rootpage) const;
+
+    const vector<SchemaObject>& Objects() const { return m_objects; }
+
+private:
+    void LoadTableColumns(CppSQLite3DB& db);
+    void LoadIndexColumns(CppSQLite3DB& db);
+    void LoadPrimaryKeyColumns(CppSQLite3DB& db);
+    void Derive(SchemaObject& obj, const std::function<int(int pgno)>& pageType);
+    SchemaObject* FindMutable(const string& name);
+
+private:
+    vector<SchemaObject>                m_objects;
+    std::unordered_map<string, int>     m_byName;   // 小写名称
+    std::unordered_map<int, int>        m_byRoot;
+    int                                 m_cookie;
+    bool                                m_loaded;
+};
+
+#endif // SQLITE3SCHEMA_H
@@ -0,0 +1,394 @@
+#include "SQLite3Search.h"
+#include "SQLite3File.h"
+#include "Parallel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <algorithm>
+#include <mutex>
+
+// 每个工作线程一次读取的块大小
+static const int64_t SEARCH_CHUNK_SIZE = 4*1024*1024;
+
+// 把整数按大端写入n个字节
+static string bigEndian(uint64_t v, int n)
+{
+    string s(n, '\0');
+    for (int i=n-1; i>=0; --i)
+    {
+        s[i] = (char)(v & 0xFF);
+        v >>= 8;
+    }
+    return s;
+}
+
+// 与sqlite3PutVarint相同的编码
+static string putVarint(uint64_t v)
+{
+    unsigned char buf[10];
+    int i, j, n;
+    if (v & (((uint64_t)0xff000000)<<32))
+    {
+        string s(9, '\0');
+        s[8] = (char)v;
+        v >>= 8;
+        for (i=7; i>=0; i--)
+        {
+            s[i] = (char)((v & 0x7f) | 0x80);
+            v >>= 7;
+        }
+        return s;
+    }
+    n = 0;
+    do
+    {
+        buf[n++] = (unsigned char)((v & 0x7f) | 0x80);
+        v >>= 7;
+    } while (v != 0);
+    buf[0] &= 0x7f;
+    string s(n, '\0');
+    for (i=0, j=n-1; j>=0; j--, i++)
+    {
+        s[i] = (char)buf[j];
+    }
+    return s;
+}
+
+// 单字节整数(类型1)的最小值和最大值
+static const int64_t SEARCH_MIN_INT8 = -128;
+static const int64_t SEARCH_MAX_INT8 = 127;
+
+// 记录中整数的编码：按sqlite选择的最小宽度
+static void integerPatterns(int64_t v, vector<string>& patterns)
+{
+    // 0和1只存为类型8和9，没有值的字节；其他单字节整数几乎每页都能匹配，同样跳过
+    if (v >= SEARCH_MIN_INT8 && v <= SEARCH_MAX_INT8) return;
+
+    uint64_t u = (uint64_t)v;
+    int len;
+    if (v >= -32768 && v <= 32767) len = 2;
+    else if (v >= -8388608 && v <= 8388607) len = 3;
+    else if (v >= -2147483647LL-1 && v <= 2147483647LL) len = 4;
+    else if (v >= -140737488355328LL && v <= 140737488355327LL) len = 6;
+    else len = 8;
+    patterns.push_back(bigEndian(u, len));
+
+    // rowid和内部页的key是varint编码，单字节的varint太容易误中，跳过
+    if (v > 127)
+    {
+        patterns.push_back(putVarint(u));
+    }
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// UTF8转UTF16，bigEndian决定字节序
+static string utf8ToUtf16(const string& s, bool bigEndian)
+{
+    string out;
+    size_t i = 0;
+    while (i < s.size())
+    {
+        unsigned char c = (unsigned char)s[i];
+        uint32_t cp;
+        int n;
+        if (c < 0x80) { cp = c; n = 1; }
+        else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; n = 2; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; n = 3; }
+        else { cp = c & 0x07; n = 4; }
+        for (int k=1; k<n && i+k<s.size(); ++k)
+        {
+            cp = (cp << 6) | ((unsigned char)s[i+k] & 0x3F);
+        }
+        i += n;
+
+        uint16_t units[2];
+        int nUnit = 1;
+        if (cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            units[0] = (uint16_t)(0xD800 + (cp >> 10));
+            units[1] = (uint16_t)(0xDC00 + (cp & 0x3FF));
+            nUnit = 2;
+        }
+        else
+        {
+            units[0] = (uint16_t)cp;
+        }
+        for (int k=0; k<nUnit; ++k)
+        {
+            if (bigEndian)
+            {
+                out.push_back((char)(units[k] >> 8));
+                out.push_back((char)(units[k] & 0xFF));
+            }
+            else
+            {
+                out.push_back((char)(units[k] & 0xFF));
+                out.push_back((char)(units[k] >> 8));
+            }
+        }
+    }
+    return out;
+}
+
+CSQLite3Search::CSQLite3Search()
+: m_cancel(false)
+{
+
+}
+
+bool CSQLite3Search::BuildPatterns(SearchMode mode, const string &query, int textEncoding,
+                                   vector<string> &patterns, string &err)
+{
+    patterns.clear();
+    string q = Trim(query, " \t\r\n");
+    if (q.empty())
+    {
+        err = "empty search text";
+        return false;
+    }
+
+    switch (mode)
+    {
+    case SEARCH_MODE_HEX:
+    {
+        string bytes;
+        int hi = -1;
+        for (size_t i=0; i<q.size(); ++i)
+        {
+            char c = q[i];
+            if (c == ' ' || c == '\t' || c == ',') continue;
+            if (c == '0' && i+1 < q.size() && (q[i+1] == 'x' || q[i+1] == 'X'))
+            {
+                ++i;
+                continue;
+            }
+            int v = hexValue(c);
+            if (v < 0)
+            {
+                err = "invalid hex digit";
+                return false;
+            }
+            if (hi < 0)
+            {
+                hi = v;
+            }
+            else
+            {
+                bytes.push_back((char)(hi*16 + v));
+                hi = -1;
+            }
+        }
+        if (hi >= 0)
+        {
+            err = "odd number of hex digits";
+            return false;
+        }
+        patterns.push_back(bytes);
+        break;
+    }
+    case SEARCH_MODE_TEXT:
+        if (textEncoding == 2) patterns.push_back(utf8ToUtf16(q, false));
+        else if (textEncoding == 3) patterns.push_back(utf8ToUtf16(q, true));
+        else patterns.push_back(q);
+        break;
+    case SEARCH_MODE_INTEGER:
+    {
+        char* end = NULL;
+        errno = 0;
+        long long v = strtoll(q.c_str(), &end, 0);
+        if (errno != 0 || end == q.c_str() || *end != '\0')
+        {
+            err = "invalid integer";
+            return false;
+        }
+        if (v == 0 || v == 1)
+        {
+            err = "0 and 1 are stored as serial types 8 and 9 in the record header, "
+                  "with no value bytes to search for";
+            return false;
+        }
+        if (v >= SEARCH_MIN_INT8 && v <= SEARCH_MAX_INT8)
+        {
+            err = "integers from -128 to 127 are stored as a single byte, "
+                  "which matches almost every page; use a larger value or a hex sequence";
+            return false;
+        }
+        integerPatterns(v, patterns);
+        break;
+    }
+    case SEARCH_MODE_REAL:
+    {
+        char* end = NULL;
+        double v = strtod(q.c_str(), &end);
+        if (end == q.c_str() || *end != '\0')
+        {
+            err = "invalid real number";
+            return false;
+        }
+        uint64_t u;
+        memcpy(&u, &v, 8);
+        patterns.push_back(bigEndian(u, 8));
+
+        // REAL亲和性的列中，整数值会以整数编码存储；单字节的整数不搜索
+        if (v == floor(v) && fabs(v) < 9.2e18)
+        {
+            integerPatterns((int64_t)v, patterns);
+        }
+        break;
+    }
+    }
+
+    std::sort(patterns.begin(), patterns.end());
+    patterns.erase(std::unique(patterns.begin(), patterns.end()), patterns.end());
+    patterns.erase(std::remove(patterns.begin(), patterns.end(), string()), patterns.end());
+    if (patterns.empty())
+    {
+        err = "nothing to search";
+        return false;
+    }
+    return true;
+}
+
+void CSQLite3Search::BuildSkipTable(const string &pattern, int *skip)
+{
+    int m = (int)pattern.size();
+    for (int i=0; i<256; ++i)
+    {
+        skip[i] = m;
+    }
+    for (int i=0; i<m-1; ++i)
+    {
+        skip[(unsigned char)pattern[i]] = m - 1 - i;
+    }
+}
+
+int64_t CSQLite3Search::Find(const unsigned char *buf, int64_t n, const string &pattern, const int *skip)
+{
+    int64_t m = pattern.size();
+    const unsigned char* p = (const unsigned char*)pattern.data();
+    if (m == 0 || n < m) return -1;
+
+    // 短模式用memchr找首字节(libc中的memchr已经向量化)，再比较剩余字节
+    if (m <= 3)
+    {
+        const unsigned char* s = buf;
+        const unsigned char* end = buf + n - m + 1;
+        while (s < end)
+        {
+            s = (const unsigned char*)memchr(s, p[0], end - s);
+            if (s == NULL) return -1;
+            if (memcmp(s, p, m) == 0) return s - buf;
+            ++s;
+        }
+        return -1;
+    }
+
+    // Boyer-Moore-Horspool
+    int64_t last = m - 1;
+    unsigned char cLast = p[last];
+    int64_t i = 0;
+    while (i <= n - m)
+    {
+        unsigned char c = buf[i + last];
+        if (c == cLast && memcmp(buf + i, p, last) == 0)
+        {
+            return i;
+        }
+        i += skip[c];
+    }
+    return -1;
+}
+
+bool CSQLite3Search::Run(const string &path, const vector<string> &patterns,
+                         const std::function<void (const vector<SearchHit> &)> &onHits,
+                         const std::function<void (int64_t, int64_t)> &onProgress,
+                         int nThreads)
+{
+
+    CSQLite3File file;
+    if (!file.Open(path) || patterns.empty())
+    {
+        return false;
+    }
+    int64_t szFile = file.Size();
+    int pagesize = file.PageSize();
+    if (pagesize <= 0) pagesize = 1024;
+    file.Close();
+
+    size_t maxLen = 0;
+    vector<vector<int> > skips(patterns.size(), vector<int>(256));
+    for (size_t i=0; i<patterns.size(); ++i)
+    {
+        BuildSkipTable(patterns[i], &skips[i][0]);
+        maxLen = std::max(maxLen, patterns[i].size());
+    }
+
+    // 块大小取页大小的整数倍，相邻块重叠maxLen-1字节，保证跨块的匹配不会漏掉
+    int64_t chunk = std::max<int64_t>(pagesize, SEARCH_CHUNK_SIZE / pagesize * pagesize);
+    int64_t nChunk = (szFile + chunk - 1) / chunk;
+    std::mutex lock;
+    std::atomic<int64_t> done(0);
+
+    ParallelFor(nChunk, 1, [&](int64_t begin, int64_t end) {
+        CSQLite3File f;
+        if (!f.Open(path)) return;
+
+        vector<unsigned char> buf;
+        vector<SearchHit> hits;
+        for (int64_t c=begin; c<end && !m_cancel; ++c)
+        {
+            int64_t ofst = c * chunk;
+            int64_t len = std::min(chunk, szFile - ofst);
+            int64_t nRead = std::min<int64_t>(len + maxLen - 1, szFile - ofst);
+            buf.resize(nRead);
+            nRead = f.Read(ofst, &buf[0], (int)nRead);
+
+            hits.clear();
+            for (size_t k=0; k<patterns.size(); ++k)
+            {
+                int64_t pos = 0;
+                for (;;)
+                {
+                    int64_t r = Find(&buf[0] + pos, nRead - pos, patterns[k], &skips[k][0]);
+                    if (r < 0 || pos + r >= len) break;
+                    pos += r;
+
+                    SearchHit hit;
+                    hit.fileOffset = ofst + pos;
+                    hit.pgno = (int)(hit.fileOffset / pagesize) + 1;
+                    hit.offset = (int)(hit.fileOffset % pagesize);
+                    hit.pattern = (int)k;
+                    hits.push_back(hit);
+                    ++pos;
+                }
+            }
+
+            std::sort(hits.begin(), hits.end(), [](const SearchHit& l, const SearchHit& r) {
+                return l.fileOffset < r.fileOffset;
+            });
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (!hits.empty() && onHits && !m_cancel)
+            {
+                onHits(hits);
+            }
+            done += len;
+            if (onProgress)
+            {
+                onProgress(done, szFile);
+            }
+        }
+    }, nThreads);
+
+    return !m_cancel;
+}
@@ -0,0 +1,70 @@
+#ifndef SQLITE3SEARCH_H
+#define SQLITE3SEARCH_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+enum SearchMode
+{
+    SEARCH_MODE_HEX = 0,    // 十六进制字节序列，如 "DE AD BE EF"
+    SEARCH_MODE_TEXT,       // 文本，按数据库编码匹配
+    SEARCH_MODE_INTEGER,    // 整数，按记录中的整数编码匹配
+    SEARCH_MODE_REAL        // 浮点数，按记录中的编码匹配
+};
+
+struct SearchHit
+{
+    int     pgno;       // 命中所在页
+    int     offset;     // 页内偏移
+    int64_t fileOffset; // 文件内偏移
+    int     pattern;    // 命中的模式下标
+};
+
+/*
+** Scan the whole database file for one or more byte patterns.
+**
+** The file is split into large chunks that are read and searched by
+** worker threads, each with its own file handle.  Hits are handed to the
+** callback chunk by chunk as soon as they are found, so the caller can
+** show results while the scan is still running.
+*/
+class CSQLite3Search
+{
+public:
+    CSQLite3Search();
+
+    // 根据查询内容生成要搜索的字节模式，失败时返回false并设置err
+    static bool BuildPatterns(SearchMode mode, const string& query, int textEncoding,
+                              vector<string>& patterns, string& err);
+
+    /*
+    ** Search the file at path.  onHits is called from the worker threads,
+    ** serialised by an internal lock.  onProgress receives the number of
+    ** bytes scanned so far.  Returns false if the scan was cancelled.
+    */
+    bool Run(const string& path, const vector<string>& patterns,
+             const std::function<void(const vector<SearchHit>&)>& onHits,
+             const std::function<void(int64_t done, int64_t total)>& onProgress = nullptr,
+             int nThreads = 0);
+
+    void Cancel() { m_cancel = true; }
+    bool IsCancelled() const { return m_cancel; }
+
+    // 在buf中查找pattern，返回第一个匹配位置，找不到返回-1
+    static int64_t Find(const unsigned char* buf, int64_t n,
+                        const string& pattern, const int* skip);
+
+    // 为pattern生成Horspool跳转表(256项)
+    static void BuildSkipTable(const string& pattern, int* skip);
+
+private:
+    std::atomic<bool> m_cancel;
+};
+
+#endif // SQLITE3SEARCH_H
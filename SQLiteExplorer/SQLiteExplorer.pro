@@ -39,7 +39,58 @@ SOURCES += \
     SQLWindow.cpp \
     DialogAbout.cpp \
     HexWindow.cpp \
-    highlighter.cpp
+    highlighter.cpp \
+    SQLite3File.cpp \
+    Parallel.cpp \
+    SQLite3Search.cpp \
+    SearchThread.cpp \
+    PageHash.cpp \
+    SQLite3Diff.cpp \
+    DiffThread.cpp \
+    DatabaseWatcher.cpp \
+    BtreeLayout.cpp \
+    ForceLayout.cpp \
+    ForceThread.cpp \
+    HeatmapWindow.cpp \
+    BtreeLocality.cpp \
+    DialogLocality.cpp \
+    VacuumPredict.cpp \
+    DialogVacuumPredict.cpp \
+    VacuumThread.cpp \
+    SQLite3Backup.cpp \
+    BackupThread.cpp \
+    DialogBackup.cpp \
+    SQLite3Export.cpp \
+    ExportThread.cpp \
+    DialogExport.cpp \
+    SQLite3Import.cpp \
+    ImportThread.cpp \
+    DialogImport.cpp \
+    SQLite3RawScan.cpp \
+    RawScanThread.cpp \
+    DialogRawScan.cpp \
+    OpenDatabaseThread.cpp \
+    BtreeSizeThread.cpp \
+    SQLite3Schema.cpp \\
+    Workspace.cpp \\
+    SQLite3Compare.cpp \\
+    CompareThread.cpp \\
+    DialogCompare.cpp \\
+    SQLite3Profile.cpp \\
+    ProfileView.cpp \
+    SQLite3QueryPlan.cpp \
+    PlanView.cpp \
+    SQLite3Advisor.cpp \
+    AdvisorThread.cpp \
+    DialogAdvisor.cpp \
+    SQLite3ColumnStats.cpp \
+    ColumnStatsThread.cpp \
+    DialogColumnStats.cpp \
+    SQLite3Analyze.cpp \
+    AnalyzeThread.cpp \
+    DialogAnalyze.cpp \
+    ProfileThread.cpp \
+    PageOwnerThread.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -53,7 +104,58 @@ HEADERS += \
     SQLWindow.h \
     DialogAbout.h \
     HexWindow.h \
-    highlighter.h
+    highlighter.h \
+    SQLite3File.h \
+    Parallel.h \
+    SQLite3Search.h \
+    SearchThread.h \
+    PageHash.h \
+    SQLite3Diff.h \
+    DiffThread.h \
+    DatabaseWatcher.h \
+    BtreeLayout.h \
+    ForceLayout.h \
+    ForceThread.h \
+    HeatmapWindow.h \
+    BtreeLocality.h \
+    DialogLocality.h \
+    VacuumPredict.h \
+    DialogVacuumPredict.h \
+    VacuumThread.h \
+    SQLite3Backup.h \
+    BackupThread.h \
+    DialogBackup.h \
+    SQLite3Export.h \
+    ExportThread.h \
+    DialogExport.h \
+    SQLite3Import.h \
+    ImportThread.h \
+    DialogImport.h \
+    SQLite3RawScan.h \
+    RawScanThread.h \
+    DialogRawScan.h \
+    OpenDatabaseThread.h \
+    BtreeSizeThread.h \
+    SQLite3Schema.h \\
+    Workspace.h \\
+    SQLite3Compare.h \\
+    CompareThread.h \\
+    DialogCompare.h \\
+    SQLite3Profile.h \\
+    ProfileView.h \
+    SQLite3QueryPlan.h \
+    PlanView.h \
+    SQLite3Advisor.h \
+    AdvisorThread.h \
+    DialogAdvisor.h \
+    SQLite3ColumnStats.h \
+    ColumnStatsThread.h \
+    DialogColumnStats.h \
+    SQLite3Analyze.h \
+    AnalyzeThread.h \
+    DialogAnalyze.h \
+    ProfileThread.h \
+    PageOwnerThread.h
 
 CONFIG += c++11
 
@@ -0,0 +1,61 @@
+#include "SearchThread.h"
+#include "SQLite3DB.h"
+
+#include <set>
+
+SearchThread::SearchThread(const string &path, const vector<string> &patterns, int maxHits, QObject *parent)
+    : QThread(parent)
+    , m_path(path)
+    , m_patterns(patterns)
+    , m_maxHits(maxHits)
+    , m_cancel(false)
+{
+
+}
+
+void SearchThread::cancel()
+{
+    m_cancel = true;
+    m_search.Cancel();
+}
+
+void SearchThread::run()
+{
+    int nHits = 0;
+    int lastPercent = -1;
+    std::set<int> hitPages;
+
+    m_search.Run(m_path, m_patterns,
+        [&](const vector<SearchHit>& hits) {
+            for (auto it=hits.begin(); it!=hits.end(); ++it)
+            {
+                if (nHits++ >= m_maxHits)
+                {
+                    m_search.Cancel();
+                    break;
+                }
+                hitPages.insert(it->pgno);
+                emit hitFound(it->pgno, it->offset, it->fileOffset, it->pattern);
+            }
+        },
+        [&](int64_t done, int64_t total) {
+            int percent = total > 0 ? (int)(done * 100 / total) : 100;
+            if (percent != lastPercent)
+            {
+                lastPercent = percent;
+                emit progress(percent);
+            }
+        });
+    if (m_cancel || hitPages.empty()) return;
+
+    // 页归属表在工作线程中用自己的连接建立，不碰界面线程的CSQLite3DB
+    CSQLite3DB db(m_path);
+    const PageOwnerMap& owners = db.GetPageOwners(true, &m_cancel);
+    if (m_cancel) return;
+    for (auto it=hitPages.begin(); it!=hitPages.end(); ++it)
+    {
+        int pgno = *it;
+        PageType type = pgno < (int)owners.type.size() ? owners.type[pgno] : PAGE_TYPE_UNKNOWN;
+        emit ownerFound(pgno, QString::fromStdString(owners.OwnerName(pgno)), (int)type);
+    }
+}
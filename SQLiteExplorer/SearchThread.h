@@ -0,0 +1,43 @@
+#ifndef SEARCHTHREAD_H
+#define SEARCHTHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <atomic>
+
+#include "SQLite3Search.h"
+
+/*
+** Run a CSQLite3Search in the background.  Hits are forwarded to the GUI
+** thread through queued signals while the scan is still in progress.
+** The owners of the hit pages need a walk of every b-tree, so they are
+** looked up after the scan, on a connection of the thread's own, and
+** sent once per page; cancel() also stops that walk.
+*/
+class SearchThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    SearchThread(const string& path, const vector<string>& patterns, int maxHits, QObject* parent = 0);
+
+    // 停止搜索，不等待线程结束
+    void cancel();
+
+signals:
+    void hitFound(int pgno, int offset, qint64 fileOffset, int pattern);
+    void ownerFound(int pgno, const QString& owner, int type);
+    void progress(int percent);
+
+protected:
+    void run();
+
+private:
+    string              m_path;
+    vector<string>      m_patterns;
+    int                 m_maxHits;
+    CSQLite3Search      m_search;
+    std::atomic<bool>   m_cancel;   // 用户取消；达到命中上限只停止m_search
+};
+
+#endif // SEARCHTHREAD_H
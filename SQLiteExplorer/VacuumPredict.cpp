@@ -0,0 +1,208 @@
+#include "VacuumPredict.h"
+#include "SQLite3File.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <algorithm>
+
+#define VACUUM_MB (1024.0*1024.0)
+
+// 锁字节页所在的偏移(1GB)
+static const int64_t VACUUM_PENDING_BYTE = 0x40000000;
+
+bool CVacuumPredict::Predict(CSQLite3DB *pSqlite, VacuumEstimate &out)
+{
+    out = VacuumEstimate();
+    m_error.clear();
+
+    CSQLite3File file;
+    unsigned char hdr[100];
+    if (pSqlite == NULL || !file.Open(pSqlite->GetPath()))
+    {
+        m_error = "cannot open database file";
+        return false;
+    }
+    if (file.Read(0, hdr, 100) != 100 || memcmp(hdr, "SQLite format 3", 16) != 0)
+    {
+        m_error = "not a database file";
+        return false;
+    }
+
+    out.pageSize = file.PageSize();
+    out.usableSize = out.pageSize - hdr[20];
+    out.curPages = (file.Size() + out.pageSize - 1) / out.pageSize;
+    out.freePages = decodeInt32(hdr+36);
+    bool autoVacuum = decodeInt32(hdr+52) != 0;
+    int usable = out.usableSize;
+    if (usable <= 0)
+    {
+        m_error = "bad page size";
+        return false;
+    }
+
+    int64_t total = 0;
+    vector<string> names = pSqlite->GetAllBtreeNames();
+    for (auto name=names.begin(); name!=names.end(); ++name)
+    {
+        VacuumBtreeEstimate est;
+        est.name = *name;
+
+        vector<PageUsageInfo> infos = pSqlite->GetBtreePageUsage(*name);
+        int64_t intCells = 0;
+        int64_t intBytes = 0;
+        bool page1 = false;
+        for (auto it=infos.begin(); it!=infos.end(); ++it)
+        {
+            // 页1的b-tree头在文件头之后
+            int hdrOffset = it->pgno == 1 ? 100 : 0;
+            page1 = page1 || it->pgno == 1;
+            switch (it->type)
+            {
+            case PAGE_TYPE_INDEX_LEAF:
+            case PAGE_TYPE_TABLE_LEAF:
+                est.leaves++;
+                est.cells += it->ncell;
+                est.cellBytes += usable - hdrOffset - 8 - it->nfree;
+                est.index = est.index || it->type == PAGE_TYPE_INDEX_LEAF;
+                break;
+            case PAGE_TYPE_INDEX_INTERIOR:
+            case PAGE_TYPE_TABLE_INTERIOR:
+                est.interiors++;
+                intCells += it->ncell;
+                intBytes += usable - hdrOffset - 12 - it->nfree;
+                est.index = est.index || it->type == PAGE_TYPE_INDEX_INTERIOR;
+                break;
+            case PAGE_TYPE_OVERFLOW:
+                est.overflows++;
+                break;
+            default:
+                break;
+            }
+        }
+        est.pages = (int)infos.size();
+        if (est.leaves > 0)
+            est.fill = (double)est.cellBytes / ((double)est.leaves * (usable - 8));
+
+        // 索引的内部页中也保存着记录，重建后和叶子中的记录一起分配(去掉4字节的子页号)
+        if (est.index)
+        {
+            est.cells += intCells;
+            est.cellBytes += intBytes - 4*intCells;
+        }
+
+        // 叶子装满整数个cell
+        int capacity = usable - 8 - (page1 ? 100 : 0);
+        double avgCell = est.cells > 0 ? (double)est.cellBytes / est.cells : 0;
+        if (est.cells == 0 || avgCell <= 0)
+        {
+            est.newLeaves = 1;
+        }
+        else
+        {
+            int64_t perPage = std::max<int64_t>(1, (int64_t)(capacity / avgCell));
+            est.newLeaves = (int)((est.cells + perPage - 1) / perPage);
+            est.newFill = std::min(1.0, (double)est.cellBytes / ((double)est.newLeaves * capacity));
+        }
+
+        // 内部页：表的内部cell只有子页号和rowid，索引的内部cell带完整的键
+        double avgInt;
+        if (est.index)
+            avgInt = avgCell + 4;
+        else
+            avgInt = intCells > 0 ? (double)intBytes / intCells : 4 + 9 + 2;
+        int newInteriors = 0;
+        int64_t children = est.newLeaves;
+        while (children > 1)
+        {
+            int64_t fanout = std::max<int64_t>(2, (int64_t)((usable - 12) / std::max(avgInt, 1.0)) + 1);
+            children = (children + fanout - 1) / fanout;
+            newInteriors += (int)children;
+        }
+
+        est.newPages = est.newLeaves + newInteriors + est.overflows;
+        total += est.newPages;
+        out.btrees.push_back(est);
+    }
+
+    // auto_vacuum的指针映射页，每页记录usable/5个页
+    if (autoVacuum)
+    {
+        int64_t perMap = usable / 5;
+        total += (total + perMap - 1) / perMap;
+    }
+    if (total * out.pageSize > VACUUM_PENDING_BYTE)
+        total += 1;
+    out.newPages = total;
+    return true;
+}
+
+void CVacuumPredict::EstimateRuntime(VacuumEstimate &est)
+{
+    est.seconds = 0;
+    if (est.readMBps <= 0 || est.writeMBps <= 0) return;
+
+    // 读旧文件，写临时库；再读临时库，写回原文件和日志
+    double curMB = est.curPages * est.pageSize / VACUUM_MB;
+    double newMB = est.newPages * est.pageSize / VACUUM_MB;
+    est.seconds = curMB / est.readMBps + newMB / est.writeMBps
+                + newMB / est.readMBps + 2 * newMB / est.writeMBps;
+}
+
+bool CVacuumPredict::MeasureThroughput(const string &path, double &readMBps, double &writeMBps, int nMB)
+{
+    readMBps = writeMBps = 0;
+    if (nMB <= 0) nMB = 1;
+
+    const int chunk = 1024*1024;
+    vector<char> buf(chunk, 0x5A);
+
+    // 1. 顺序读数据库文件(可能命中系统缓存，结果偏乐观)
+    CSQLite3File file;
+    if (!file.Open(path)) return false;
+    int64_t size = std::min<int64_t>(file.Size(), (int64_t)nMB * chunk);
+    auto start = std::chrono::steady_clock::now();
+    int64_t done = 0;
+    while (done < size)
+    {
+        int n = file.Read(done, &buf[0], chunk);
+        if (n <= 0) break;
+        done += n;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    file.Close();
+    if (done > 0)
+        readMBps = done / VACUUM_MB / std::max(sec, 1e-4);
+
+    // 2. 通过VFS写一个临时文件并同步到磁盘
+    sqlite3_vfs* vfs = sqlite3_vfs_find(NULL);
+    if (vfs == NULL) return false;
+    sqlite3_file* fd = (sqlite3_file*)calloc(1, vfs->szOsFile);
+    if (fd == NULL) return false;
+    int outFlags = 0;
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_DELETEONCLOSE | SQLITE_OPEN_TEMP_JOURNAL;
+    if (vfs->xOpen(vfs, NULL, fd, flags, &outFlags) != SQLITE_OK)
+    {
+        if (fd->pMethods) fd->pMethods->xClose(fd);
+        free(fd);
+        return false;
+    }
+
+    // VFS一次最多写一个最大页(64KB)
+    const int page = 65536;
+    int nWrite = nMB * (chunk / page);
+    bool ok = true;
+    start = std::chrono::steady_clock::now();
+    for (int i=0; i<nWrite && ok; ++i)
+    {
+        ok = fd->pMethods->xWrite(fd, &buf[0], page, (sqlite3_int64)i * page) == SQLITE_OK;
+    }
+    ok = ok && fd->pMethods->xSync(fd, SQLITE_SYNC_NORMAL) == SQLITE_OK;
+    sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fd->pMethods->xClose(fd);
+    free(fd);
+    if (ok)
+        writeMBps = nMB / std::max(sec, 1e-4);
+
+    return ok && readMBps > 0;
+}
@@ -0,0 +1,87 @@
+#ifndef VACUUMPREDICT_H
+#define VACUUMPREDICT_H
+
+#include <vector>
+#include <string>
+#include "SQLite3DB.h"
+
+using std::vector;
+using std::string;
+
+// 一棵b-tree在VACUUM前后的页数估计
+struct VacuumBtreeEstimate
+{
+    string  name;
+    bool    index;          // 索引或WITHOUT ROWID表
+    int     pages;          // 当前页数
+    int     leaves;
+    int     interiors;
+    int     overflows;
+    int64_t cells;          // 叶子中的cell数量
+    int64_t cellBytes;      // 叶子中cell占用的字节(含2字节指针)
+    double  fill;           // 当前叶子填充率
+    int     newPages;       // VACUUM后的页数
+    int     newLeaves;
+    double  newFill;        // VACUUM后叶子填充率
+
+    VacuumBtreeEstimate()
+        : index(false), pages(0), leaves(0), interiors(0), overflows(0)
+        , cells(0), cellBytes(0), fill(0), newPages(0), newLeaves(0), newFill(0)
+    {}
+};
+
+struct VacuumEstimate
+{
+    int     pageSize;
+    int     usableSize;
+    int64_t curPages;       // 当前文件页数
+    int64_t freePages;      // 自由页(trunk+leaf)
+    int64_t newPages;       // VACUUM后的页数
+    double  readMBps;       // 测得的读吞吐，0表示未测量
+    double  writeMBps;      // 测得的写吞吐(含fsync)
+    double  seconds;        // 估计的VACUUM时间，未测量吞吐时为0
+    vector<VacuumBtreeEstimate> btrees;
+
+    VacuumEstimate()
+        : pageSize(0), usableSize(0), curPages(0), freePages(0), newPages(0)
+        , readMBps(0), writeMBps(0), seconds(0)
+    {}
+};
+
+/*
+** Predict what VACUUM would do without running it.
+**
+** VACUUM copies every b-tree in key order into a fresh database, so
+** leaves come out packed: each holds as many whole cells as fit.  The
+** local bytes of the cells are taken from the pages as they are now
+** (page size minus header and unused bytes), interior levels are rebuilt
+** from the fan-out of the average interior cell, overflow chains keep
+** their length and the freelist disappears.
+**
+** The runtime is an I/O estimate: read the old file, write the temporary
+** database, read it back and write the result plus its journal, using
+** throughputs measured on the machine by MeasureThroughput().  CPU time
+** for sorting index keys is not included.
+*/
+class CVacuumPredict
+{
+public:
+    bool Predict(CSQLite3DB* pSqlite, VacuumEstimate& out);
+
+    // 计算VACUUM时间，readMBps/writeMBps须已设置
+    static void EstimateRuntime(VacuumEstimate& est);
+
+    /*
+    ** Measure sequential read throughput on up to nMB of the database file
+    ** and sequential write+sync throughput on a temporary file created
+    ** through the sqlite3 VFS.  Returns false if either measurement failed.
+    */
+    static bool MeasureThroughput(const string& path, double& readMBps, double& writeMBps, int nMB = 32);
+
+    const string& GetError() const { return m_error; }
+
+private:
+    string m_error;
+};
+
+#endif // VACUUMPREDICT_H
@@ -0,0 +1,205 @@
+#include "VacuumThread.h"
+#include "SQLite3File.h"
+
+#include <QFileInfo>
+#include <QFile>
+
+// 每执行多少条虚拟机指令调用一次进度回调
+static const int VACUUM_PROGRESS_OPS = 1000;
+// 两次报告进度的最小间隔(毫秒)
+static const int VACUUM_REPORT_MS = 100;
+// VACUUM INTO 从该版本开始支持
+static const int VACUUM_INTO_VERSION = 3027000;
+// 备份时每步复制的页数
+static const int VACUUM_BACKUP_PAGES = 256;
+
+VacuumThread::VacuumThread(const QString &path, const QString &intoPath, QObject *parent)
+    : QThread(parent)
+    , m_path(path)
+    , m_into(intoPath)
+    , m_cancel(false)
+    , m_ok(false)
+    , m_fallback(false)
+    , m_seconds(0)
+    , m_pDb(NULL)
+    , m_totalBytes(0)
+    , m_pageSize(0)
+    , m_phaseBase(0)
+    , m_phaseSpan(100)
+    , m_byOutputSize(false)
+    , m_lastReport(0)
+{
+
+}
+
+void VacuumThread::cancel()
+{
+    m_cancel = true;
+}
+
+int VacuumThread::onProgress(void *arg)
+{
+    VacuumThread* self = (VacuumThread*)arg;
+    if (self->m_cancel) return 1;
+    if (self->m_timer.elapsed() - self->m_lastReport < VACUUM_REPORT_MS) return 0;
+
+    // VACUUM INTO看输出文件的大小，原地VACUUM看从磁盘读入的页数
+    qint64 done = 0;
+    if (self->m_byOutputSize)
+    {
+        done = QFileInfo(self->m_into).size();
+    }
+    else if (self->m_pDb)
+    {
+        int cur = 0, hi = 0;
+        sqlite3_db_status(self->m_pDb, SQLITE_DBSTATUS_CACHE_MISS, &cur, &hi, 0);
+        done = (qint64)cur * self->m_pageSize;
+    }
+    self->report(done);
+    return 0;
+}
+
+void VacuumThread::report(qint64 done)
+{
+    qint64 now = m_timer.elapsed();
+    m_lastReport = now;
+    int percent = 99;
+    if (m_totalBytes > 0 && done < m_totalBytes)
+        percent = (int)(done * 99 / m_totalBytes);
+    percent = m_phaseBase + percent * m_phaseSpan / 100;
+    double mbps = now > 0 ? done / (1024.0*1024.0) / (now / 1000.0) : 0;
+    emit progress(percent, mbps);
+}
+
+bool VacuumThread::exec(sqlite3 *db, const char *sql, const QString &bind)
+{
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc == SQLITE_OK && !bind.isNull())
+    {
+        QByteArray utf8 = bind.toUtf8();
+        rc = sqlite3_bind_text(stmt, 1, utf8.constData(), utf8.size(), SQLITE_TRANSIENT);
+    }
+    if (rc == SQLITE_OK)
+    {
+        m_pDb = db;
+        sqlite3_progress_handler(db, VACUUM_PROGRESS_OPS, &VacuumThread::onProgress, this);
+        rc = sqlite3_step(stmt);
+        sqlite3_progress_handler(db, 0, NULL, NULL);
+        m_pDb = NULL;
+    }
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW)
+    {
+        m_err = m_cancel ? tr("Cancelled") : QString::fromUtf8(sqlite3_errmsg(db));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE || rc == SQLITE_ROW;
+}
+
+/*
+** Fallback for VACUUM INTO on sqlite older than 3.27.0: take a
+** consistent copy with the backup API, then vacuum the copy.
+*/
+bool VacuumThread::vacuumInto(sqlite3 *db)
+{
+    m_fallback = true;
+    QFile::remove(m_into);
+
+    sqlite3* dst = NULL;
+    if (sqlite3_open_v2(m_into.toUtf8().constData(), &dst,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK)
+    {
+        m_err = QString::fromUtf8(sqlite3_errmsg(dst));
+        sqlite3_close(dst);
+        return false;
+    }
+
+    bool ok = false;
+    sqlite3_backup* backup = sqlite3_backup_init(dst, "main", db, "main");
+    if (backup)
+    {
+        m_phaseBase = 0;
+        m_phaseSpan = 50;
+        int rc;
+        do
+        {
+            rc = sqlite3_backup_step(backup, VACUUM_BACKUP_PAGES);
+            int total = sqlite3_backup_pagecount(backup);
+            int remaining = sqlite3_backup_remaining(backup);
+            if (m_timer.elapsed() - m_lastReport >= VACUUM_REPORT_MS && total > 0)
+                report((qint64)(total - remaining) * m_totalBytes / total);
+            if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+                sqlite3_sleep(10);
+        } while (!m_cancel && (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
+        sqlite3_backup_finish(backup);
+        ok = rc == SQLITE_DONE && !m_cancel;
+        if (!ok)
+            m_err = m_cancel ? tr("Cancelled") : QString::fromUtf8(sqlite3_errmsg(dst));
+    }
+    else
+    {
+        m_err = QString::fromUtf8(sqlite3_errmsg(dst));
+    }
+
+    if (ok)
+    {
+        m_phaseBase = 50;
+        m_phaseSpan = 50;
+        ok = exec(dst, "VACUUM");
+    }
+    sqlite3_close(dst);
+    return ok;
+}
+
+void VacuumThread::run()
+{
+    m_timer.start();
+
+    // 文件头中的页数和自由页数，用来估计需要处理的数据量
+    CSQLite3File file;
+    unsigned char hdr[100];
+    if (file.Open(m_path.toStdString()) && file.Read(0, hdr, 100) == 100)
+    {
+        m_pageSize = file.PageSize();
+        qint64 pages = get4(hdr+28);
+        qint64 freePages = get4(hdr+36);
+        if (pages == 0) pages = file.Size() / qMax(m_pageSize, 1);
+        m_totalBytes = qMax<qint64>(pages - freePages, 1) * m_pageSize;
+    }
+    file.Close();
+
+    sqlite3* db = NULL;
+    if (sqlite3_open_v2(m_path.toUtf8().constData(), &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK)
+    {
+        m_err = QString::fromUtf8(sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    if (m_into.isEmpty())
+    {
+        // 原地VACUUM先把有效页读出复制到临时库，再从临时库读回，大约读两遍
+        m_totalBytes *= 2;
+        m_ok = exec(db, "VACUUM");
+    }
+    else if (sqlite3_libversion_number() >= VACUUM_INTO_VERSION)
+    {
+        // VACUUM INTO要求目标文件不存在或为空
+        QFile::remove(m_into);
+        m_byOutputSize = true;
+        m_ok = exec(db, "VACUUM INTO ?", m_into);
+    }
+    else
+    {
+        m_byOutputSize = true;
+        m_ok = vacuumInto(db);
+    }
+    sqlite3_close(db);
+
+    if (!m_ok && !m_into.isEmpty())
+        QFile::remove(m_into);
+    m_seconds = m_timer.elapsed() / 1000.0;
+    if (m_ok)
+        emit progress(100, m_seconds > 0 ? m_totalBytes / (1024.0*1024.0) / m_seconds : 0);
+}
@@ -0,0 +1,72 @@
+#ifndef VACUUMTHREAD_H
+#define VACUUMTHREAD_H
+
+#include <QThread>
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+
+#include "CppSQLite3.h"
+
+/*
+** Run VACUUM, or VACUUM INTO a new file, on a connection of its own so
+** the GUI stays responsive.  sqlite3_progress_handler() is used both to
+** report progress and to abort the statement when cancel() is called; an
+** interrupted VACUUM leaves the database untouched.
+**
+** VACUUM INTO needs sqlite 3.27.0.  With an older library the file is
+** copied with the backup API and the copy is vacuumed in place.
+*/
+class VacuumThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    // intoPath为空时原地VACUUM
+    VacuumThread(const QString& path, const QString& intoPath = QString(), QObject* parent = 0);
+
+    // 停止VACUUM，不等待线程结束
+    void cancel();
+
+    bool succeeded() const { return m_ok; }
+    bool cancelled() const { return m_cancel; }
+    QString error() const { return m_err; }
+    double seconds() const { return m_seconds; }
+
+    // 是否因为sqlite版本过低改用backup+VACUUM
+    bool usedFallback() const { return m_fallback; }
+
+signals:
+    // percent为估计的进度，mbPerSec为当前的读写吞吐
+    void progress(int percent, double mbPerSec);
+
+protected:
+    void run();
+
+private:
+    static int onProgress(void* arg);
+    void report(qint64 done);
+    bool exec(sqlite3* db, const char* sql, const QString& bind = QString());
+    bool vacuumInto(sqlite3* db);
+
+private:
+    QString             m_path;
+    QString             m_into;
+    std::atomic<bool>   m_cancel;
+    bool                m_ok;
+    bool                m_fallback;
+    QString             m_err;
+    double              m_seconds;
+
+    // 进度
+    sqlite3*            m_pDb;          // 当前执行VACUUM的连接
+    qint64              m_totalBytes;   // 需要处理的字节数(有效页)
+    int                 m_pageSize;
+    int                 m_phaseBase;    // 当前阶段在总进度中的起点和跨度(%)
+    int                 m_phaseSpan;
+    bool                m_byOutputSize; // 按输出文件大小计算进度
+    QElapsedTimer       m_timer;
+    qint64              m_lastReport;
+};
+
+#endif // VACUUMTHREAD_H
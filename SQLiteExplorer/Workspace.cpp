@@ -0,0 +1,136 @@
+#include "Workspace.h"
+
+#include <algorithm>
+
+// 默认的内存预算
+static const int64_t WORKSPACE_DEFAULT_BUDGET = (int64_t)512 << 20;
+// 每个连接至少保留的页缓存
+static const int64_t WORKSPACE_MIN_CACHE = (int64_t)256 << 10;
+// 工作线程自己打开的连接的页缓存，sqlite默认的cache_size=-2000
+static const int64_t WORKSPACE_WORKER_CACHE = (int64_t)2000 << 10;
+
+CWorkspace::CWorkspace()
+    : m_active(NULL)
+    , m_budget(WORKSPACE_DEFAULT_BUDGET)
+    , m_clock(0)
+{
+    m_pPool = new CWorkerPool(ParallelThreadCount());
+    CWorkerPool::SetInstance(m_pPool);
+}
+
+CWorkspace::~CWorkspace()
+{
+    CWorkerPool::SetInstance(NULL);
+    delete m_pPool;
+}
+
+void CWorkspace::Add(CSQLite3DB *db)
+{
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it)
+    {
+        if (it->db == db) return;
+    }
+    Entry e;
+    e.db = db;
+    e.lastUse = ++m_clock;
+    m_entries.push_back(e);
+    ApplyCacheSizes();
+}
+
+void CWorkspace::Remove(CSQLite3DB *db)
+{
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it)
+    {
+        if (it->db == db)
+        {
+            m_entries.erase(it);
+            break;
+        }
+    }
+    if (m_active == db) m_active = NULL;
+    ApplyCacheSizes();
+}
+
+void CWorkspace::Activate(CSQLite3DB *db)
+{
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it)
+    {
+        if (it->db == db) it->lastUse = ++m_clock;
+    }
+    if (m_active != db)
+    {
+        m_active = db;
+        ApplyCacheSizes();
+    }
+}
+
+void CWorkspace::SetBudget(int64_t bytes)
+{
+    m_budget = bytes;
+    ApplyCacheSizes();
+}
+
+int64_t CWorkspace::MemoryUsed() const
+{
+    int64_t used = 0;
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it)
+    {
+        used += it->db->MemoryUsed();
+    }
+    for (auto it=m_charges.begin(); it!=m_charges.end(); ++it)
+    {
+        used += it->second;
+    }
+    used += m_pPool->ThreadCount() * WORKSPACE_WORKER_CACHE;
+    return used;
+}
+
+int CWorkspace::Threads(int64_t workerBytes) const
+{
+    int64_t n = m_pPool->ThreadCount() + 1;
+    if (workerBytes > 0) n = std::min(n, WorkerBudget() / workerBytes);
+    return (int)std::max<int64_t>(1, n);
+}
+
+void CWorkspace::Charge(const void *owner, int64_t bytes)
+{
+    if (bytes > 0)
+        m_charges[owner] = bytes;
+    else
+        m_charges.erase(owner);
+}
+
+vector<CSQLite3DB *> CWorkspace::Trim(int64_t callerUsed)
+{
+    vector<CSQLite3DB*> evicted;
+    int64_t used = MemoryUsed() + callerUsed;
+    if (used <= m_budget) return evicted;
+
+    vector<Entry> lru(m_entries);
+    std::sort(lru.begin(), lru.end(), [](const Entry& a, const Entry& b) {
+        return a.lastUse < b.lastUse;
+    });
+    for (auto it=lru.begin(); it!=lru.end() && used > m_budget; ++it)
+    {
+        if (it->db == m_active) continue;
+        int64_t before = it->db->MemoryUsed();
+        it->db->ReleaseMemory();
+        used -= before - it->db->MemoryUsed();
+        evicted.push_back(it->db);
+    }
+    return evicted;
+}
+
+void CWorkspace::ApplyCacheSizes()
+{
+    if (m_entries.empty()) return;
+    int64_t cache = m_budget / 4;
+    int nOther = (int)m_entries.size() - (m_active ? 1 : 0);
+    int64_t active = nOther > 0 ? cache / 2 : cache;
+    int64_t other = nOther > 0 ? (cache - (m_active ? active : 0)) / nOther : 0;
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it)
+    {
+        int64_t bytes = it->db == m_active ? active : other;
+        it->db->SetCacheSize(std::max(bytes, WORKSPACE_MIN_CACHE));
+    }
+}
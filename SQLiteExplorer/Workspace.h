@@ -0,0 +1,94 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <vector>
+#include <map>
+#include "SQLite3DB.h"
+#include "Parallel.h"
+
+using std::vector;
+using std::map;
+
+/*
+** The open databases of the main window and the memory they may use.
+**
+** One budget covers the SQLite page caches of all connections, the
+** analysis results each CSQLite3DB keeps (page owners, page usage,
+** pragma values) and the caller's own caches built from them, such as
+** the main window's per-object tab cache.  A quarter of it goes to page
+** caches: half of that to the active database and the rest split evenly
+** over the others.  Another quarter is the limit the caller gives its
+** caches, and what they hold is passed to Trim() and counted with the
+** rest.  When the total is over budget, Trim() releases the caches of
+** the databases used least recently; they are rebuilt the next time the
+** database is shown, so dozens of large files can stay open.  The active
+** database is never trimmed.
+**
+** The workspace owns the worker pool and installs it as
+** CWorkerPool::Instance(), so parallel work of every database runs on
+** its threads.  Each pool thread may hold a connection of its own with
+** sqlite's default page cache; that cache is counted for every thread.
+** Memory held outside the databases, such as the heatmap's tiles, the
+** watcher's page hashes or the buffers of a running import, is reported
+** with Charge().  Threads() caps a job's threads so that their buffers
+** fit in WorkerBudget(), a quarter of the budget.  The workspace does not own the
+** databases.
+*/
+class CWorkspace
+{
+public:
+    CWorkspace();
+    ~CWorkspace();
+
+    void Add(CSQLite3DB* db);
+    void Remove(CSQLite3DB* db);
+
+    // 切换到db，它成为最近使用的数据库
+    void Activate(CSQLite3DB* db);
+    CSQLite3DB* Active() const { return m_active; }
+
+    void SetBudget(int64_t bytes);
+    int64_t Budget() const { return m_budget; }
+
+    int64_t MemoryUsed() const;
+
+    // 调用者自己的缓存(如标签页缓存)可用的内存
+    int64_t CallerBudget() const { return m_budget / 4; }
+
+    // 超出预算时按LRU释放不活跃数据库的缓存，返回被释放的数据库。
+    // callerUsed是调用者的缓存占用的内存，与数据库的一起计入预算
+    vector<CSQLite3DB*> Trim(int64_t callerUsed = 0);
+
+    CWorkerPool& Pool() { return *m_pPool; }
+
+    // 工作线程的缓冲区可用的内存
+    int64_t WorkerBudget() const { return m_budget / 4; }
+
+    // 每个线程需要workerBytes内存时，一个任务可以使用的线程数(含调用者)
+    int Threads(int64_t workerBytes) const;
+
+    // owner在数据库之外占用的内存，计入预算；bytes为0时取消
+    void Charge(const void* owner, int64_t bytes);
+
+private:
+    CWorkspace(const CWorkspace&);
+    CWorkspace& operator=(const CWorkspace&);
+
+    void ApplyCacheSizes();
+
+private:
+    struct Entry
+    {
+        CSQLite3DB* db;
+        int64_t     lastUse;
+    };
+
+    vector<Entry>   m_entries;
+    CSQLite3DB*     m_active;
+    int64_t         m_budget;
+    int64_t         m_clock;
+    CWorkerPool*    m_pPool;
+    map<const void*, int64_t> m_charges;
+};
+
+#endif // WORKSPACE_H
@@ -0,0 +1,41 @@
+#include "aggregatenode.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+AggregateNode::AggregateNode(const AggregateProp &prop)
+    : m_prop(prop)
+{
+    setZValue(-1);
+    setToolTip(QString("subtree of page %1\n%2 pages\n%3 cells\n%4% full")
+               .arg(prop.pgno).arg(prop.pages).arg(prop.cells)
+               .arg(prop.fill*100, 0, 'f', 1));
+}
+
+QRectF AggregateNode::boundingRect() const
+{
+    return m_prop.rc.adjusted(-1, -1, 1, 1);
+}
+
+void AggregateNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+    // 填充率越低颜色越浅
+    QColor fill = m_prop.color;
+    fill.setAlphaF(0.35 + 0.65*m_prop.fill);
+    painter->setPen(QPen(Qt::black, 0));
+    painter->setBrush(fill);
+    painter->drawRect(m_prop.rc);
+
+    // 文字大小不随缩放变化，放不下时不画
+    qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    if (lod <= 0 || m_prop.rc.height()*lod < 14 || m_prop.rc.width()*lod < 60)
+        return;
+
+    QFont font;
+    font.setPointSizeF(9 / lod);
+    painter->setFont(font);
+    painter->drawText(m_prop.rc, Qt::AlignCenter | Qt::TextWordWrap,
+                      QString("%1 pages\n%2 cells\n%3%")
+                      .arg(m_prop.pages).arg(m_prop.cells)
+                      .arg(m_prop.fill*100, 0, 'f', 1));
+}
@@ -0,0 +1,38 @@
+#ifndef AGGREGATENODE_H
+#define AGGREGATENODE_H
+
+#include <QGraphicsItem>
+#include <QColor>
+
+// 缩小显示时代替整棵子树的节点
+struct AggregateProp
+{
+    AggregateProp() : pages(0), cells(0), fill(0) {}
+    QRectF  rc;         // 子树在场景中占据的区域
+    int     pgno;       // 子树根页
+    int     pages;      // 子树中的页数
+    qint64  cells;      // 子树中的cell总数
+    double  fill;       // b-tree页的平均填充率 0~1
+    QColor  color;
+};
+
+//! [0]
+class AggregateNode : public QGraphicsItem
+{
+public:
+    AggregateNode(const AggregateProp& prop);
+
+    enum { Type = UserType + 3 };
+    int type() const Q_DECL_OVERRIDE { return Type; }
+
+    int pgno() const { return m_prop.pgno; }
+
+    QRectF boundingRect() const Q_DECL_OVERRIDE;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) Q_DECL_OVERRIDE;
+
+private:
+    AggregateProp m_prop;
+};
+//! [0]
+
+#endif // AGGREGATENODE_H
@@ -1,10 +1,12 @@
 HEADERS += \
     $$PWD/edge.h \
     $$PWD/node.h \
-    $$PWD/graphwidget.h
+    $$PWD/graphwidget.h \
+    $$PWD/aggregatenode.h
 SOURCES += \
     $$PWD/edge.cpp \
     $$PWD/node.cpp \
-    $$PWD/graphwidget.cpp
+    $$PWD/graphwidget.cpp \
+    $$PWD/aggregatenode.cpp
 
 INCLUDEPATH += $$PWD
\ No newline at end of file
@@ -51,21 +51,33 @@
 #include "graphwidget.h"
 #include "edge.h"
 #include "node.h"
+#include "aggregatenode.h"
+#include "ForceThread.h"
 
 #include <math.h>
 #include <QDebug>
 #include <QKeyEvent>
+#include <QHash>
+#include <QTimer>
+#include <QPainterPath>
 
-struct EdgeProp
+// 节点数超过该值时按层次细节显示
+static const int GRAPH_LOD_MIN_NODES = 2000;
+// 子树在屏幕上的高度小于该值(像素)时合并成一个节点
+static const qreal GRAPH_LOD_COLLAPSE_PX = 48;
+
+static QString treeNodeLabel(const TreeNodeData& node)
 {
-    EdgeProp(QString h, QString t): head(h), tail(t){}
-    QString head;
-    QString tail;
-};
+    if(node.overflowIdx > 0)
+        return QString("%1 overflow %2 from cell %3").arg(node.pgno).arg(node.overflowIdx).arg(node.overflowCell);
+    return QString("%1 ncells:%2").arg(node.pgno).arg(node.ncell);
+}
 
 //! [0]
 GraphWidget::GraphWidget(QWidget *parent)
-    : QGraphicsView(parent), timerId(0), m_start(false)
+    : QGraphicsView(parent), m_start(false)
+    , m_force(0), m_forcePinned(-1), m_forceApplying(false)
+    , m_lod(false), m_lodPending(false), m_treeH(0)
 {
     QGraphicsScene *scene = new QGraphicsScene(this);
     scene->setItemIndexMethod(QGraphicsScene::NoIndex);
@@ -78,6 +90,11 @@ GraphWidget::GraphWidget(QWidget *parent)
     //SetPath("");
 }
 
+GraphWidget::~GraphWidget()
+{
+    stopForce();
+}
+
 void GraphWidget::SetPath(QString path)
 {
     if(path.size() == 0)
@@ -145,41 +162,358 @@ void GraphWidget::SetPath(QString path)
         }
     }while(1);
 
+    SetGraph(nodes, edges, w, h);
+}
+
+void GraphWidget::SetGraph(const QList<NodeProp> &nodes, const QList<EdgeProp> &edges, qreal w, qreal h)
+{
+    stopForce();
+    m_lod = false;
+    m_tree.clear();
+    m_aggregates.clear();
     scene()->clear();
+    scene()->setItemIndexMethod(QGraphicsScene::NoIndex);
     scene()->setSceneRect(0, 0, w*200, h*100);
 
     //scale(qreal(0.8), qreal(0.8));
-    setMinimumSize(w/2, h/2);
+    setMinimumSize(qMin(w/2, 400.0), qMin(h/2, 300.0));
 
-    // create node
-    QMap<QString, Node*> mapNodes;
+    // create node，创建过程中移动节点不触发布局
+    m_forceApplying = true;
+    QHash<QString, Node*> mapNodes;
+    mapNodes.reserve(nodes.size());
     for(auto it = nodes.begin(); it!=nodes.end(); it++)
     {
         Node* node = new Node(this, *it);
         scene()->addItem(node);
-        QRectF& rc = it->rc;
+        const QRectF& rc = it->rc;
         node->setPos(rc.x()*100, h*100 - rc.y()*100);
         mapNodes[it->name] = node;
     }
 
     for(auto it = edges.begin(); it!=edges.end(); it++)
     {
-        QString& tail = it->tail;
-        QString& head = it->head;
-        scene()->addItem(new Edge(mapNodes[tail], mapNodes[head]));
+        Node* tail = mapNodes.value(it->tail);
+        Node* head = mapNodes.value(it->head);
+        if(tail && head)
+            scene()->addItem(new Edge(tail, head));
+    }
+    m_forceApplying = false;
+}
+
+void GraphWidget::SetTree(const QVector<TreeNodeData> &nodes, qreal w, qreal h)
+{
+    int n = nodes.size();
+    if(n <= GRAPH_LOD_MIN_NODES)
+    {
+        QList<NodeProp> props;
+        QList<EdgeProp> edges;
+        for(int i=0; i<n; ++i)
+        {
+            const TreeNodeData& node = nodes[i];
+            NodeProp np;
+            np.name = QString::number(node.pgno);
+            np.label = treeNodeLabel(node);
+            np.style = "filled";
+            np.shape = "record";
+            np.color = np.fillcolor = QColor(node.color).name();
+            np.rc = QRectF(node.x, node.y, node.w, 0.5);
+            props.push_back(np);
+            if(node.parent >= 0)
+                edges.push_back(EdgeProp(np.name, QString::number(nodes[node.parent].pgno)));
+        }
+        SetGraph(props, edges, w, h);
+        return;
+    }
+
+    stopForce();
+    scene()->clear();
+    scene()->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+    scene()->setSceneRect(0, 0, w*100, h*100);
+
+    m_lod = true;
+    m_tree = nodes;
+    m_treeH = h;
+
+    // 子节点表(CSR)
+    m_childStart.fill(0, n+1);
+    for(int i=0; i<n; ++i)
+    {
+        if(nodes[i].parent >= 0) m_childStart[nodes[i].parent+1]++;
+    }
+    for(int i=0; i<n; ++i)
+    {
+        m_childStart[i+1] += m_childStart[i];
+    }
+    m_children.resize(m_childStart[n]);
+    QVector<int> fill(m_childStart);
+    for(int i=0; i<n; ++i)
+    {
+        if(nodes[i].parent >= 0) m_children[fill[nodes[i].parent]++] = i;
+    }
+
+    // 按广度优先的逆序把子节点的统计合并到父节点
+    QVector<int> order;
+    order.reserve(n);
+    for(int i=0; i<n; ++i)
+    {
+        if(nodes[i].parent < 0) order.push_back(i);
+    }
+    for(int k=0; k<order.size(); ++k)
+    {
+        int i = order[k];
+        for(int c=m_childStart[i]; c<m_childStart[i+1]; ++c)
+            order.push_back(m_children[c]);
+    }
+
+    m_aggregates.resize(n);
+    for(int i=0; i<n; ++i)
+    {
+        // Node的宽度为标签宽度的120倍(像素)，高20像素
+        QPointF pos = treeNodePos(i);
+        qreal half = nodes[i].w*60;
+        TreeAggregate& agg = m_aggregates[i];
+        agg.rc = QRectF(pos.x()-half, pos.y()-12, half*2, 24);
+        agg.pages = 1;
+        agg.cells = nodes[i].ncell;
+        agg.used = nodes[i].used;
+        agg.size = nodes[i].size;
     }
+    for(int k=order.size()-1; k>=0; --k)
+    {
+        int i = order[k];
+        int parent = nodes[i].parent;
+        if(parent < 0) continue;
+        TreeAggregate& agg = m_aggregates[parent];
+        agg.rc = agg.rc.united(m_aggregates[i].rc);
+        agg.pages += m_aggregates[i].pages;
+        agg.cells += m_aggregates[i].cells;
+        agg.used += m_aggregates[i].used;
+        agg.size += m_aggregates[i].size;
+    }
+
+    // 初始显示整棵树
+    resetTransform();
+    QRectF rc = scene()->sceneRect();
+    qreal factor = qMin(viewport()->width() / qMax(rc.width(), 1.0),
+                        viewport()->height() / qMax(rc.height(), 1.0));
+    if(factor > 0 && factor < 1)
+        scale(factor, factor);
+    scheduleLod();
+}
+
+QPointF GraphWidget::treeNodePos(int i) const
+{
+    return QPointF(m_tree[i].x*100, m_treeH*100 - m_tree[i].y*100);
+}
+
+void GraphWidget::scheduleLod()
+{
+    if(m_lod && !m_lodPending)
+    {
+        m_lodPending = true;
+        QTimer::singleShot(0, this, SLOT(updateLod()));
+    }
+}
+
+void GraphWidget::updateLod()
+{
+    m_lodPending = false;
+    if(!m_lod) return;
+
+    scene()->clear();
+
+    // 只为可见区域(多留一屏边距)中的节点创建图元
+    QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+    visible.adjust(-visible.width()/2, -visible.height()/2, visible.width()/2, visible.height()/2);
+    qreal scale = transform().m11();
+
+    QPainterPath edges;
+    QVector<int> stack;
+    for(int i=0; i<m_tree.size(); ++i)
+    {
+        if(m_tree[i].parent < 0) stack.push_back(i);
+    }
+
+    while(!stack.isEmpty())
+    {
+        int i = stack.back();
+        stack.pop_back();
+
+        const TreeAggregate& agg = m_aggregates[i];
+        if(!agg.rc.intersects(visible)) continue;
+
+        const TreeNodeData& node = m_tree[i];
+        bool hasChildren = m_childStart[i] < m_childStart[i+1];
+        if(hasChildren && agg.rc.height()*scale < GRAPH_LOD_COLLAPSE_PX)
+        {
+            AggregateProp prop;
+            prop.rc = agg.rc;
+            prop.pgno = node.pgno;
+            prop.pages = agg.pages;
+            prop.cells = agg.cells;
+            prop.fill = agg.size > 0 ? (double)agg.used / agg.size : 0;
+            prop.color = QColor(node.color);
+            scene()->addItem(new AggregateNode(prop));
+            continue;
+        }
+
+        NodeProp np;
+        np.name = QString::number(node.pgno);
+        np.label = treeNodeLabel(node);
+        np.fillcolor = QColor(node.color).name();
+        np.rc = QRectF(node.x, node.y, node.w, 0.5);
+        Node* item = new Node(this, np);
+        item->setFlag(QGraphicsItem::ItemIsMovable, false);
+        item->setFlag(QGraphicsItem::ItemSendsGeometryChanges, false);
+        item->setPos(treeNodePos(i));
+        scene()->addItem(item);
+
+        QPointF from = treeNodePos(i) + QPointF(node.w*60, 0);
+        for(int c=m_childStart[i]; c<m_childStart[i+1]; ++c)
+        {
+            int child = m_children[c];
+            edges.moveTo(from);
+            edges.lineTo(treeNodePos(child) - QPointF(m_tree[child].w*60, 0));
+            stack.push_back(child);
+        }
+    }
+
+    QGraphicsPathItem* edgeItem = scene()->addPath(edges, QPen(Qt::black, 0));
+    edgeItem->setZValue(-2);
+}
+
+void GraphWidget::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+    scheduleLod();
+}
+
+void GraphWidget::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+    scheduleLod();
 }
 //! [1]
 
 //! [2]
 void GraphWidget::itemMoved()
 {
-    if (!timerId)
-        timerId = startTimer(1000 / 25);
+    if (m_forceApplying || !m_start || m_lod)
+        return;
+
+    if (!m_force)
+    {
+        startForce();
+        return;
+    }
+
+    // 被拖动的节点固定在鼠标位置
+    Node* grabbed = qgraphicsitem_cast<Node *>(scene()->mouseGrabberItem());
+    int i = m_forceIndex.value(grabbed, -1);
+    if (i >= 0)
+    {
+        m_force->pin(i, grabbed->pos());
+        m_forcePinned = i;
+    }
+}
+
+void GraphWidget::startForce()
+{
+    stopForce();
+
+    QVector<QPointF> pos;
+    QVector<QPair<int, int> > edges;
+    foreach (QGraphicsItem *item, scene()->items()) {
+        if (Node *node = qgraphicsitem_cast<Node *>(item))
+        {
+            m_forceIndex[node] = m_forceNodes.size();
+            m_forceNodes.push_back(node);
+            pos.push_back(node->pos());
+        }
+    }
+    if (m_forceNodes.isEmpty())
+        return;
+
+    foreach (QGraphicsItem *item, scene()->items()) {
+        if (Edge *edge = qgraphicsitem_cast<Edge *>(item))
+        {
+            int source = m_forceIndex.value(edge->sourceNode(), -1);
+            int dest = m_forceIndex.value(edge->destNode(), -1);
+            if (source >= 0 && dest >= 0)
+                edges.push_back(qMakePair(source, dest));
+        }
+    }
+
+    QRectF bounds = scene()->sceneRect().adjusted(10, 10, -10, -10);
+    m_force = new ForceThread(pos, edges, bounds);
+    connect(m_force, SIGNAL(snapshotReady()), this, SLOT(onForceSnapshot()));
+    connect(m_force, SIGNAL(converged(int)), this, SLOT(onForceConverged(int)));
+
+    Node* grabbed = qgraphicsitem_cast<Node *>(scene()->mouseGrabberItem());
+    int i = m_forceIndex.value(grabbed, -1);
+    if (i >= 0)
+    {
+        m_force->pin(i, grabbed->pos());
+        m_forcePinned = i;
+    }
+    m_force->start();
+}
+
+void GraphWidget::stopForce()
+{
+    if (m_force)
+    {
+        disconnect(m_force, 0, this, 0);
+        m_force->cancel();
+        m_force->wait();
+        delete m_force;
+        m_force = 0;
+    }
+    m_forceNodes.clear();
+    m_forceIndex.clear();
+    m_forcePinned = -1;
+}
+
+void GraphWidget::onForceSnapshot()
+{
+    if (!m_force)
+        return;
+
+    QVector<QPointF> pos;
+    if (!m_force->takeSnapshot(pos) || pos.size() != m_forceNodes.size())
+        return;
+
+    // 拖动结束后释放节点
+    QGraphicsItem* grabbed = scene()->mouseGrabberItem();
+    if (m_forcePinned >= 0 && m_forceNodes[m_forcePinned] != grabbed)
+    {
+        m_force->unpin(m_forcePinned);
+        m_forcePinned = -1;
+    }
+
+    m_forceApplying = true;
+    for (int i=0; i<pos.size(); ++i)
+    {
+        if (m_forceNodes[i] != grabbed)
+            m_forceNodes[i]->setPos(pos[i]);
+    }
+    m_forceApplying = false;
+}
+
+void GraphWidget::onForceConverged(int steps)
+{
+    Q_UNUSED(steps);
+    onForceSnapshot();
+    stopForce();
 }
 
 void GraphWidget::clear()
 {
+    stopForce();
+    m_lod = false;
+    m_tree.clear();
+    m_aggregates.clear();
     scene()->clear();
 }
 //! [2]
@@ -216,38 +550,6 @@ void GraphWidget::keyPressEvent(QKeyEvent *event)
 }
 //! [3]
 
-//! [4]
-void GraphWidget::timerEvent(QTimerEvent *event)
-{
-    Q_UNUSED(event);
-
-    if(!m_start)
-    {
-        return;
-    }
-    QList<Node *> nodes;
-    foreach (QGraphicsItem *item, scene()->items()) {
-        if (Node *node = qgraphicsitem_cast<Node *>(item))
-            nodes << node;
-    }
-
-    foreach (Node *node, nodes)
-        node->calculateForces();
-
-    bool itemsMoved = false;
-    foreach (Node *node, nodes) {
-        if (node->advance())
-        {
-            itemsMoved = true;
-        }
-    }
-
-    if (!itemsMoved) {
-        killTimer(timerId);
-        timerId = 0;
-    }
-}
-//! [4]
 
 #ifndef QT_NO_WHEELEVENT
 //! [5]
@@ -301,19 +603,27 @@ void GraphWidget::drawBackground(QPainter *painter, const QRectF &rect)
 void GraphWidget::scaleView(qreal scaleFactor)
 {
     qreal factor = transform().scale(scaleFactor, scaleFactor).mapRect(QRectF(0, 0, 1, 1)).width();
-    if (factor < 0.07 || factor > 100)
+    // 按层次细节显示时允许缩小到看见整棵树
+    qreal minFactor = m_lod ? 0.0001 : 0.07;
+    if (factor < minFactor || factor > 100)
         return;
 
     scale(scaleFactor, scaleFactor);
+    scheduleLod();
 }
 //! [7]
 
 void GraphWidget::shuffle()
 {
+    stopForce();
+    m_forceApplying = true;
     foreach (QGraphicsItem *item, scene()->items()) {
         if (qgraphicsitem_cast<Node *>(item))
             item->setPos(-150 + qrand() % 300, -150 + qrand() % 300);
     }
+    m_forceApplying = false;
+    if (m_start && !m_lod)
+        startForce();
 }
 
 void GraphWidget::zoomIn()
@@ -328,5 +638,10 @@ void GraphWidget::zoomOut()
 
 void GraphWidget::StartAnimate(bool start)
 {
+    Q_UNUSED(start);
     m_start = !m_start;
+    if (m_start && !m_lod)
+        startForce();
+    else
+        stopForce();
 }
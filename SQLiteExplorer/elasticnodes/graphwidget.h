@@ -52,8 +52,35 @@
 #define GRAPHWIDGET_H
 
 #include <QGraphicsView>
+#include <QVector>
+#include <QHash>
+#include <QRgb>
+#include "node.h"
+
+struct EdgeProp
+{
+    EdgeProp(QString h, QString t): head(h), tail(t){}
+    QString head;
+    QString tail;
+};
+
+// 树中一个页的数据，大图按层次细节显示时只保存这些
+struct TreeNodeData
+{
+    int    pgno;
+    int    parent;        // 父节点下标，根为-1
+    float  x, y;          // 布局位置(英寸)
+    float  w;             // 标签宽度(英寸)
+    int    ncell;
+    int    used;          // 已用字节，溢出页为0
+    int    size;          // 页大小，溢出页为0
+    int    overflowIdx;   // 溢出页在链中的序号，非溢出页为0
+    int    overflowCell;  // 溢出页所属的cell
+    QRgb   color;
+};
 
 class Node;
+class ForceThread;
 
 //! [0]
 class GraphWidget : public QGraphicsView
@@ -62,8 +89,16 @@ class GraphWidget : public QGraphicsView
 
 public:
     GraphWidget(QWidget *parent = 0);
+    ~GraphWidget();
 
     void SetPath(QString path);
+
+    // nodes的位置和大小以英寸为单位(与dot -Tplain的输出一致)，w,h为整个图的大小
+    void SetGraph(const QList<NodeProp>& nodes, const QList<EdgeProp>& edges, qreal w, qreal h);
+
+    // 显示布局好的树，节点较多时只为可见部分创建图元，缩小时把子树合并成一个节点
+    void SetTree(const QVector<TreeNodeData>& nodes, qreal w, qreal h);
+    bool IsLod() const { return m_lod; }
     void itemMoved();
 
     void clear();
@@ -74,20 +109,56 @@ public slots:
     void zoomOut();
     void StartAnimate(bool start);
 
+private slots:
+    void updateLod();
+    void onForceSnapshot();
+    void onForceConverged(int steps);
+
 protected:
     void keyPressEvent(QKeyEvent *event) Q_DECL_OVERRIDE;
-    void timerEvent(QTimerEvent *event) Q_DECL_OVERRIDE;
 #ifndef QT_NO_WHEELEVENT
     void wheelEvent(QWheelEvent *event) Q_DECL_OVERRIDE;
 #endif
     void drawBackground(QPainter *painter, const QRectF &rect) Q_DECL_OVERRIDE;
+    void scrollContentsBy(int dx, int dy) Q_DECL_OVERRIDE;
+    void resizeEvent(QResizeEvent *event) Q_DECL_OVERRIDE;
 
     void scaleView(qreal scaleFactor);
 
 private:
-    int timerId;
+    void scheduleLod();
+    QPointF treeNodePos(int i) const;
+    void startForce();
+    void stopForce();
+
+private:
     Node *centerNode;
     bool m_start;
+
+    // 后台力导向布局
+    ForceThread*            m_force;
+    QVector<Node*>          m_forceNodes;
+    QHash<Node*, int>       m_forceIndex;
+    int                     m_forcePinned;  // 正在被拖动的节点，-1表示没有
+    bool                    m_forceApplying;
+
+    // 子树在场景中的范围和统计
+    struct TreeAggregate
+    {
+        QRectF  rc;
+        int     pages;
+        qint64  cells;
+        qint64  used;
+        qint64  size;
+    };
+
+    bool                    m_lod;
+    bool                    m_lodPending;
+    qreal                   m_treeH;
+    QVector<TreeNodeData>   m_tree;
+    QVector<int>            m_childStart;   // m_children中第i个节点的子节点从m_childStart[i]开始
+    QVector<int>            m_children;
+    QVector<TreeAggregate>  m_aggregates;
 };
 //! [0]
 
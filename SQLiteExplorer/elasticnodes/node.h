@@ -84,9 +84,6 @@ public:
     enum { Type = UserType + 1 };
     int type() const Q_DECL_OVERRIDE { return Type; }
 
-    void calculateForces();
-    bool advance();
-
     QRectF boundingRect() const Q_DECL_OVERRIDE;
     QPainterPath shape() const Q_DECL_OVERRIDE;
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) Q_DECL_OVERRIDE;
@@ -99,7 +96,6 @@ protected:
 
 private:
     QList<Edge *> edgeList;
-    QPointF newPos;
     GraphWidget *graph;
     NodeProp m_np;
 };
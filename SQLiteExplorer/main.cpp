@@ -1,8 +1,76 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <QStringList>
+#include <stdio.h>
+#include <string.h>
+
+#include "SQLite3Compare.h"
+
+/*
+** SQLiteExplorer --compare [--io N] [--threshold Z] [-o out.csv] file...
+**
+** Compare the files without opening a window and write the grid of the
+** comparison dialog as CSV to out.csv, or to stdout.  Exits with 2 when
+** some value is an outlier, so scripts can check a batch of shards.
+*/
+static int runCompare(const QStringList& args)
+{
+    CompareOptions opts;
+    QString out;
+    vector<string> paths;
+    for (int i=1; i<args.size(); ++i)
+    {
+        const QString& arg = args[i];
+        if (arg == "--compare") continue;
+        if (arg == "--io" && i+1 < args.size())
+            opts.ioConcurrency = args[++i].toInt();
+        else if (arg == "--threshold" && i+1 < args.size())
+            opts.threshold = args[++i].toDouble();
+        else if (arg == "-o" && i+1 < args.size())
+            out = args[++i];
+        else
+            paths.push_back(arg.toStdString());
+    }
+    if (paths.empty())
+    {
+        fprintf(stderr, "usage: SQLiteExplorer --compare [--io N] [--threshold Z] [-o out.csv] file...\n");
+        return 1;
+    }
+
+    CSQLite3Compare compare;
+    compare.Run(paths, opts);
+    string err;
+    if (!compare.WriteCsv(out.toStdString(), err))
+    {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+
+    int nOutlier = 0;
+    for (auto it=compare.Objects().begin(); it!=compare.Objects().end(); ++it)
+    {
+        if (it->outliers) nOutlier++;
+    }
+    for (auto it=compare.Files().begin(); it!=compare.Files().end(); ++it)
+    {
+        if (it->outliers || it->err.size()) nOutlier++;
+    }
+    return nOutlier > 0 ? 2 : 0;
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i=1; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "--compare") == 0)
+        {
+            // 参数按Unicode取得，路径以UTF-8传给比较
+            QCoreApplication app(argc, argv);
+            return runCompare(app.arguments());
+        }
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.resize(1600, 800);
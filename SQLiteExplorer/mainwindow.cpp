@@ -7,19 +7,40 @@
 #include <QMessageBox>
 #include <QModelIndex>
 #include <QMimeData>
+#include <QProgressDialog>
+#include <QInputDialog>
 
 #include "qsqlitetableview.h"
 #include "SQLWindow.h"
 
 #include <QDebug>
-#include <QProcess>
+#include "BtreeLayout.h"
 #include <qevent.h>
 #include "DialogAbout.h"
+#include "DialogLocality.h"
+#include "DialogVacuumPredict.h"
+#include "VacuumThread.h"
+#include "DialogBackup.h"
+#include "DialogExport.h"
+#include "DialogImport.h"
+#include "DialogRawScan.h"
+#include "DialogCompare.h"
+#include "DialogAdvisor.h"
+#include "DialogColumnStats.h"
+#include "DialogAnalyze.h"
+#include "OpenDatabaseThread.h"
+#include "BtreeSizeThread.h"
+
+// m_objectCache的cost以KiB为单位，QCache的cost是int
+static const int OBJECT_CACHE_UNIT = 1024;
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    m_pCurSQLite3DB(NULL)
+    m_pCurSQLite3DB(NULL),
+    m_pObjectDB(NULL),
+    m_pVacuumThread(NULL),
+    m_pVacuumProgress(NULL)
 {
     ui->setupUi(this);
 
@@ -46,6 +67,54 @@ MainWindow::MainWindow(QWidget *parent) :
     m_pVacuumAction->setStatusTip(tr("Vacuum Database"));
     connect(m_pVacuumAction, &QAction::triggered, this, &MainWindow::onVacuumActionTriggered);
 
+    m_pVacuumIntoAction = new QAction(tr("Vacuum &Into..."), this);
+    m_pVacuumIntoAction->setStatusTip(tr("Write A Vacuumed Copy Of The Database"));
+    connect(m_pVacuumIntoAction, &QAction::triggered, this, &MainWindow::onVacuumIntoActionTriggered);
+
+    m_pLocalityAction = new QAction(tr("&Locality..."), this);
+    m_pLocalityAction->setStatusTip(tr("B-tree Leaf Locality"));
+    connect(m_pLocalityAction, &QAction::triggered, this, &MainWindow::onLocalityActionTriggered);
+
+    m_pVacuumPredictAction = new QAction(tr("&Predict Vacuum..."), this);
+    m_pVacuumPredictAction->setStatusTip(tr("Predict What Vacuum Would Reclaim"));
+    connect(m_pVacuumPredictAction, &QAction::triggered, this, &MainWindow::onVacuumPredictActionTriggered);
+
+    m_pSnapshotAction = new QAction(tr("&Snapshot..."), this);
+    m_pSnapshotAction->setStatusTip(tr("Copy The Database While It Is In Use"));
+    connect(m_pSnapshotAction, &QAction::triggered, this, &MainWindow::onSnapshotActionTriggered);
+
+    m_pExportAction = new QAction(tr("&Export..."), this);
+    m_pExportAction->setStatusTip(tr("Export Tables To CSV, JSON Lines Or Columnar Files"));
+    connect(m_pExportAction, &QAction::triggered, this, &MainWindow::onExportActionTriggered);
+
+    m_pImportAction = new QAction(tr("&Import..."), this);
+    m_pImportAction->setStatusTip(tr("Load A CSV Or JSON Lines File Into A Table"));
+    connect(m_pImportAction, &QAction::triggered, this, &MainWindow::onImportActionTriggered);
+
+    m_pRawScanAction = new QAction(tr("&Raw Scan..."), this);
+    m_pRawScanAction->setStatusTip(tr("Read Tables Straight From The B-Tree Pages, Also Of Damaged Files"));
+    connect(m_pRawScanAction, &QAction::triggered, this, &MainWindow::onRawScanActionTriggered);
+
+    m_pMemoryAction = new QAction(tr("&Memory Budget..."), this);
+    m_pMemoryAction->setStatusTip(tr("Limit The Memory Used By All Open Databases"));
+    connect(m_pMemoryAction, &QAction::triggered, this, &MainWindow::onMemoryActionTriggered);
+
+    m_pCompareAction = new QAction(tr("Co&mpare Databases..."), this);
+    m_pCompareAction->setStatusTip(tr("Compare Page Statistics Of Many Databases With The Same Schema"));
+    connect(m_pCompareAction, &QAction::triggered, this, &MainWindow::onCompareActionTriggered);
+
+    m_pAdvisorAction = new QAction(tr("Index &Advisor..."), this);
+    m_pAdvisorAction->setStatusTip(tr("Suggest Indexes For A Workload Of SQL Statements"));
+    connect(m_pAdvisorAction, &QAction::triggered, this, &MainWindow::onAdvisorActionTriggered);
+
+    m_pColumnStatsAction = new QAction(tr("Column &Statistics..."), this);
+    m_pColumnStatsAction->setStatusTip(tr("Null Fractions, Distinct Counts And Histograms From Sampled Leaf Pages"));
+    connect(m_pColumnStatsAction, &QAction::triggered, this, &MainWindow::onColumnStatsActionTriggered);
+
+    m_pAnalyzeAction = new QAction(tr("Offline A&NALYZE..."), this);
+    m_pAnalyzeAction->setStatusTip(tr("Compute sqlite_stat1 And sqlite_stat4 From The Index Pages Without Locking"));
+    connect(m_pAnalyzeAction, &QAction::triggered, this, &MainWindow::onAnalyzeActionTriggered);
+
     m_pAboutAction = new QAction(QIcon(":/toolicon/ui/info.png"), tr("&About..."), this);
     m_pAboutAction->setStatusTip(tr("About"));
     connect(m_pAboutAction, &QAction::triggered, this, &MainWindow::onAboutActionTriggered);
@@ -62,6 +131,18 @@ MainWindow::MainWindow(QWidget *parent) :
     QMenu *tool = menuBar()->addMenu(tr("&Database"));
     tool->addAction(m_pCheckAction);
     tool->addAction(m_pVacuumAction);
+    tool->addAction(m_pVacuumIntoAction);
+    tool->addAction(m_pVacuumPredictAction);
+    tool->addAction(m_pLocalityAction);
+    tool->addAction(m_pSnapshotAction);
+    tool->addAction(m_pExportAction);
+    tool->addAction(m_pImportAction);
+    tool->addAction(m_pRawScanAction);
+    tool->addAction(m_pMemoryAction);
+    tool->addAction(m_pCompareAction);
+    tool->addAction(m_pAdvisorAction);
+    tool->addAction(m_pColumnStatsAction);
+    tool->addAction(m_pAnalyzeAction);
 
     QMenu *help = menuBar()->addMenu(tr("Help"));
     help->addAction(m_pAboutAction);
@@ -83,6 +164,7 @@ MainWindow::MainWindow(QWidget *parent) :
         "alternate-background-color: rgb(141, 163, 215);}");
 
     connect(m_pTreeView,SIGNAL(signalCurrentChanged(QModelIndex)),this, SLOT(OnTreeViewClick(const QModelIndex)));
+    connect(m_pTreeView, SIGNAL(expanded(QModelIndex)), this, SLOT(onTreeViewExpanded(QModelIndex)));
 
     // Init Database Window
     m_pDatabase = new QTableWidget(this);
@@ -93,6 +175,7 @@ MainWindow::MainWindow(QWidget *parent) :
 
     // Init SQL Window
     m_pSQL = new QSQLiteQueryWindow(this);
+    connect(m_pSQL, SIGNAL(pageActivated(int,int)), this, SLOT(onHeatmapPageActivated(int,int)));
 
     // Init Design Window
     m_pDesign = new QTableWidget(this);
@@ -107,6 +190,10 @@ MainWindow::MainWindow(QWidget *parent) :
     // Init Graph Window
     m_pGraph = new GraphWindow(this);
 
+    // Init Heatmap Window
+    m_pHeatmap = new HeatmapWindow(this);
+    connect(m_pHeatmap, SIGNAL(pageActivated(int,int)), this, SLOT(onHeatmapPageActivated(int,int)));
+
     // Init QTabWidget
     m_pTabWidget = new QTabWidget(this);
     m_pTabWidget->addTab(m_pDatabase, "Database");
@@ -116,8 +203,11 @@ MainWindow::MainWindow(QWidget *parent) :
     m_pTabWidget->addTab(m_pHexWindow, "HexWindow");
     m_pTabWidget->addTab(m_pDDL, "DDL");
     m_pTabWidget->addTab(m_pGraph, "Graph");
+    m_pTabWidget->addTab(m_pHeatmap, "Heatmap");
 
     m_pTabWidget->setCurrentIndex(1);
+    connect(m_pTabWidget, SIGNAL(currentChanged(int)), this, SLOT(onTabChanged(int)));
+    m_objectCache.setMaxCost((int)(m_workspace.CallerBudget() / OBJECT_CACHE_UNIT));
 
     // Init Splitter
     m_pSplitter = new QSplitter(Qt::Horizontal);
@@ -132,11 +222,29 @@ MainWindow::MainWindow(QWidget *parent) :
     //onOpenActionTriggered();
 
     setAcceptDrops(true);
+
+    // Init Database Watcher
+    m_pWatcher = new DatabaseWatcher(this);
+    connect(m_pWatcher, SIGNAL(databaseChanged(QString,QVector<int>)), this, SLOT(onDatabaseChanged(QString,QVector<int>)));
 }
 
 
 MainWindow::~MainWindow()
 {
+    stopVacuum();
+
+    // 先停止后台线程，它们还在使用数据库
+    for(auto it=m_mapOpening.begin(); it!=m_mapOpening.end(); ++it)
+    {
+        (*it)->disconnect(this);
+        (*it)->cancel();
+        (*it)->wait();
+        delete *it;
+    }
+    m_mapOpening.clear();
+    qDeleteAll(m_mapSizeThreads);
+    m_mapSizeThreads.clear();
+
     for(QMap<QString, CSQLite3DB*>::iterator it=m_mapSqlite3DBs.begin(); it!=m_mapSqlite3DBs.end(); it++)
     {
         if(*it)
@@ -145,6 +253,11 @@ MainWindow::~MainWindow()
 
     m_mapSqlite3DBs.clear();
 
+    // 标签页和监视器的后台线程还可能在m_workspace的线程池中执行，先删除它们
+    m_pTabWidget->disconnect(this);
+    delete m_pTabWidget;
+    delete m_pWatcher;
+
     delete ui;
 }
 
@@ -192,6 +305,15 @@ void MainWindow::onCloseActionTriggered()
     QString path = m_mapSqlite3DBs.key(m_pCurSQLite3DB);
     if (path.size() && m_pCurSQLite3DB)
     {
+        if (m_pVacuumThread && m_pVacuumProgress && m_pVacuumProgress->property("path").toString() == path)
+            stopVacuum();
+        m_pSQL->StopProfile(path);
+        m_pWatcher->removePath(path);
+        delete m_mapSizeThreads.take(path);
+        forgetDatabase(path);
+        if (m_pHeatmap->GetDatabase() == m_pCurSQLite3DB)
+            m_pHeatmap->SetDatabase(NULL);
+        m_workspace.Remove(m_pCurSQLite3DB);
         delete m_pCurSQLite3DB;
         m_mapSqlite3DBs.remove(path);
 
@@ -249,16 +371,201 @@ void MainWindow::onVacuumActionTriggered()
     QString path = m_mapSqlite3DBs.key(m_pCurSQLite3DB);
     if (path.size())
     {
-        try
-        {
-            m_pCurSQLite3DB->execDML("VACUUM;");
-            QMessageBox::information(this, tr("SQLiteExplorer"), tr("Vacuum completed OK"));
-        }
-        catch(CppSQLite3Exception& e)
-        {
-            QMessageBox::information(this, tr("SQLiteExplorer"), QString::fromStdString(e.errorMessage()));
-        }
+        startVacuum(path, QString());
+    }
+}
+
+void MainWindow::onVacuumIntoActionTriggered()
+{
+    QString path = m_mapSqlite3DBs.key(m_pCurSQLite3DB);
+    if (path.isEmpty()) return;
+
+    QFileInfo fi(path);
+    QString into = QFileDialog::getSaveFileName(this, tr("Vacuum Into"),
+        fi.absolutePath() + "/" + fi.completeBaseName() + "-vacuum." + fi.suffix());
+    if (into.isEmpty()) return;
+    if (QFileInfo(into).absoluteFilePath() == fi.absoluteFilePath())
+    {
+        QMessageBox::information(this, tr("SQLiteExplorer"), tr("Choose a file other than the database itself"));
+        return;
+    }
+    startVacuum(path, into);
+}
+
+void MainWindow::startVacuum(const QString &path, const QString &intoPath)
+{
+    if (m_pVacuumThread)
+    {
+        QMessageBox::information(this, tr("SQLiteExplorer"), tr("A vacuum is already running"));
+        return;
+    }
+
+    // VACUUM在独立的连接上执行，界面不会被阻塞
+    m_pVacuumProgress = new QProgressDialog(this);
+    m_pVacuumProgress->setWindowTitle(intoPath.isEmpty() ? tr("Vacuum") : tr("Vacuum Into"));
+    m_pVacuumProgress->setLabelText(tr("Starting..."));
+    m_pVacuumProgress->setRange(0, 100);
+    m_pVacuumProgress->setMinimumDuration(0);
+    m_pVacuumProgress->setAutoClose(false);
+    m_pVacuumProgress->setAutoReset(false);
+    m_pVacuumProgress->setProperty("path", path);
+    m_pVacuumProgress->setProperty("into", intoPath);
+    m_pVacuumProgress->setValue(0);
+
+    m_pVacuumThread = new VacuumThread(path, intoPath);
+    connect(m_pVacuumThread, SIGNAL(progress(int,double)), this, SLOT(onVacuumProgress(int,double)));
+    connect(m_pVacuumThread, SIGNAL(finished()), this, SLOT(onVacuumFinished()));
+    connect(m_pVacuumProgress, &QProgressDialog::canceled, m_pVacuumThread, &VacuumThread::cancel, Qt::DirectConnection);
+    m_pVacuumAction->setEnabled(false);
+    m_pVacuumIntoAction->setEnabled(false);
+    m_pVacuumProgress->show();
+    m_pVacuumThread->start();
+}
+
+void MainWindow::stopVacuum()
+{
+    if (m_pVacuumThread)
+    {
+        m_pVacuumThread->disconnect(this);
+        m_pVacuumThread->cancel();
+        m_pVacuumThread->wait();
+        delete m_pVacuumThread;
+        m_pVacuumThread = NULL;
     }
+    if (m_pVacuumProgress)
+    {
+        delete m_pVacuumProgress;
+        m_pVacuumProgress = NULL;
+    }
+    m_pVacuumAction->setEnabled(true);
+    m_pVacuumIntoAction->setEnabled(true);
+}
+
+void MainWindow::onVacuumProgress(int percent, double mbPerSec)
+{
+    if (m_pVacuumProgress == NULL || m_pVacuumProgress->wasCanceled()) return;
+    m_pVacuumProgress->setValue(percent);
+    m_pVacuumProgress->setLabelText(tr("%1% done, %2 MB/s").arg(percent).arg(mbPerSec, 0, 'f', 1));
+}
+
+void MainWindow::onVacuumFinished()
+{
+    if (m_pVacuumThread == NULL) return;
+    QString path = m_pVacuumProgress->property("path").toString();
+    QString into = m_pVacuumProgress->property("into").toString();
+    bool ok = m_pVacuumThread->succeeded();
+    bool cancelled = m_pVacuumThread->cancelled();
+    QString err = m_pVacuumThread->error();
+    double seconds = m_pVacuumThread->seconds();
+    bool fallback = m_pVacuumThread->usedFallback();
+    stopVacuum();
+
+    if (ok && into.isEmpty())
+    {
+        // 文件被重写，由监视器比较页哈希后只刷新变化的部分
+        m_pWatcher->checkNow(path);
+    }
+
+    if (ok)
+    {
+        QString msg = tr("Vacuum completed OK in %1 s").arg(seconds, 0, 'f', 1);
+        if (into.size())
+            msg += "\n" + tr("Written to %1").arg(into);
+        if (fallback)
+            msg += "\n" + tr("SQLite %1 has no VACUUM INTO, the copy was made with the backup API").arg(sqlite3_libversion());
+        QMessageBox::information(this, tr("SQLiteExplorer"), msg);
+    }
+    else if (!cancelled)
+    {
+        QMessageBox::information(this, tr("SQLiteExplorer"), err);
+    }
+}
+
+void MainWindow::onVacuumPredictActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogVacuumPredict dlg(m_pCurSQLite3DB, this);
+    dlg.exec();
+}
+
+void MainWindow::onSnapshotActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogBackup dlg(m_pCurSQLite3DB, this);
+    dlg.exec();
+}
+
+void MainWindow::onExportActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogExport dlg(m_pCurSQLite3DB, QString(), this);
+    dlg.exec();
+}
+
+void MainWindow::onImportActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    QString path = m_mapSqlite3DBs.key(m_pCurSQLite3DB);
+    DialogImport dlg(m_pCurSQLite3DB, &m_workspace, this);
+    dlg.exec();
+
+    // 新建的表和新增的页由监视器比较后刷新
+    if (path.size())
+        m_pWatcher->checkNow(path);
+}
+
+void MainWindow::onRawScanActionTriggered()
+{
+    // 不需要打开数据库，sqlite无法打开的文件在对话框中选择
+    QString path = m_pCurSQLite3DB ? QString::fromStdString(m_pCurSQLite3DB->GetPath()) : QString();
+    DialogRawScan dlg(path, this);
+    dlg.exec();
+}
+
+void MainWindow::onMemoryActionTriggered()
+{
+    bool ok = false;
+    int mb = QInputDialog::getInt(this, tr("Memory Budget"),
+                                  tr("Memory for page caches and analysis results of all open databases (MB):"),
+                                  (int)(m_workspace.Budget() >> 20), 16, 1 << 20, 64, &ok);
+    if (!ok) return;
+    m_workspace.SetBudget((int64_t)mb << 20);
+    trimWorkspace();
+}
+
+void MainWindow::onCompareActionTriggered()
+{
+    // 已打开的数据库作为初始列表
+    DialogCompare dlg(m_mapSqlite3DBs.keys(), this);
+    dlg.exec();
+}
+
+void MainWindow::onAdvisorActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogAdvisor dlg(m_pCurSQLite3DB, this);
+    dlg.exec();
+}
+
+void MainWindow::onColumnStatsActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogColumnStats dlg(m_pCurSQLite3DB, this);
+    dlg.exec();
+}
+
+void MainWindow::onAnalyzeActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogAnalyze dlg(m_pCurSQLite3DB, this);
+    dlg.exec();
+}
+
+void MainWindow::onLocalityActionTriggered()
+{
+    if (m_pCurSQLite3DB == NULL) return;
+    DialogLocality dlg(m_pCurSQLite3DB, this);
+    dlg.exec();
 }
 
 void MainWindow::onAboutActionTriggered()
@@ -270,113 +577,306 @@ void MainWindow::onAboutActionTriggered()
 #define PathRole    Qt::UserRole+1
 #define LevelRole   Qt::UserRole+2
 #define TypeRole    Qt::UserRole+3
+#define NameRole    Qt::UserRole+4  // 对象名称，显示文本中可能带有大小
+#define RootRole    Qt::UserRole+5  // b-tree根页
+#define SizeRole    Qt::UserRole+6  // b-tree字节数，-1表示正在计算
+
+// 树节点的大小，如"1.5 MB"
+static QString sizeBadge(qint64 bytes)
+{
+    if (bytes < 1024)
+        return QString("%1 B").arg(bytes);
+    if (bytes < 1024*1024)
+        return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    if (bytes < 1024LL*1024*1024)
+        return QString("%1 MB").arg(bytes / (1024.0*1024), 0, 'f', 1);
+    return QString("%1 GB").arg(bytes / (1024.0*1024*1024), 0, 'f', 2);
+}
 
 bool MainWindow::openDatabaseFile(const QString &path)
 {
-    CSQLite3DB *pSqlite = new CSQLite3DB(path.toStdString());
-    m_mapSqlite3DBs[path] = pSqlite;
-    m_pCurSQLite3DB = pSqlite;
+    if (m_mapSqlite3DBs.contains(path) || m_mapOpening.contains(path))
+        return false;
 
     QFileInfo fi(path);
 
-    // 顶层
-    QStandardItem* root = new QStandardItem(QIcon(":/tableview/ui/db.png"), fi.baseName());
+    // 顶层，schema在后台读取，读到的表逐批加入
+    QStandardItem* root = new QStandardItem(QIcon(":/tableview/ui/db.png"), tr("%1 (opening...)").arg(fi.baseName()));
     root->setData(path, PathRole);      // Path
     root->setData(1, LevelRole);        // 1,2,3
     root->setData("db", TypeRole);      // db, table, index, trigger, view, freelist
+    root->setData(fi.baseName(), NameRole);
+    root->setToolTip(path);
     m_pTreeViewModel->appendRow(root);
+    m_mapSchemaTrees[path].root = root;
+
+    OpenDatabaseThread* thread = new OpenDatabaseThread(path);
+    connect(thread, SIGNAL(headerParsed(int,qint64,QString)), this, SLOT(onOpenHeaderParsed(int,qint64,QString)));
+    connect(thread, SIGNAL(objectsLoaded(QStringList,QStringList,QStringList,QVector<int>)),
+            this, SLOT(onOpenObjectsLoaded(QStringList,QStringList,QStringList,QVector<int>)));
+    connect(thread, SIGNAL(finished()), this, SLOT(onOpenFinished()));
+    m_mapOpening[path] = thread;
+    thread->start();
+    return true;
+}
 
+bool MainWindow::loadDatabaseTree(QStandardItem *root, CSQLite3DB *pSqlite)
+{
     table_content tb;
     cell_content hdr;
-    QString errmsg = QString::fromStdString(pSqlite->ExecuteCmd("select type, name, tbl_name from sqlite_master order by tbl_name, name", tb, hdr));
-    cell_content sqlite_master;
-    sqlite_master.push_back("table");
-    sqlite_master.push_back("sqlite_master");
-    sqlite_master.push_back("sqlite_master");
-    tb.push_back(sqlite_master);
-
+    QString errmsg = QString::fromStdString(pSqlite->ExecuteCmd(OpenDatabaseThread::schemaSql(), tb, hdr));
     if (errmsg.size() > 0)
     {
         QMessageBox::information(this, tr("SQLiteExplorer"), errmsg);
         return false;
     }
 
-    QMap<QString, QStringList> mapIndex;
-    QMap<QString, QStringList> mapTrigger;
-    QStringList listView;
-
-    while(!tb.empty())
+    SchemaTree tree;
+    tree.root = root;
+    for(auto it=tb.begin(); it!=tb.end(); ++it)
     {
-        cell_content cell = tb.front();
-        tb.pop_front();
-
-        const string& type = cell[0];
-        QString name = QString::fromStdString(cell[1]);
-        QString tbl_name = QString::fromStdString(cell[2]);
-        if (type == "table")
-        {
-            mapIndex[tbl_name];
-            mapTrigger[tbl_name];
-        }
-        else if (type == "index")
-        {
-            mapIndex[tbl_name].push_back(name);
-        }
-        else if (type == "trigger")
-        {
-            mapTrigger[tbl_name].push_back(name);
-        }
-        else if (type == "view")
-        {
-            listView.push_back(name);
-        }
+        const cell_content& cell = *it;
+        addSchemaObject(tree, QString::fromStdString(cell[0]), QString::fromStdString(cell[1]),
+                        QString::fromStdString(cell[2]), atoi(cell[3].c_str()));
     }
+    finishSchemaTree(tree);
+    return true;
+}
 
+/*
+** Add one row of sqlite_master to the tree.  Rows arrive ordered by
+** tbl_name, so the indexes and triggers of a table are next to it, but
+** they may come before the table row itself: indexes create the table
+** node, triggers wait until it exists.  Views are added at the end.
+*/
+void MainWindow::addSchemaObject(SchemaTree &tree, const QString &type, const QString &name,
+                                 const QString &tblName, int rootpage)
+{
+    if (type == "view")
+    {
+        tree.views.push_back(name);
+        return;
+    }
+    if (type == "trigger" && !tree.tables.contains(tblName))
+    {
+        tree.triggers[tblName].push_back(name);
+        return;
+    }
+    if (type != "table" && type != "index" && type != "trigger")
+        return;
 
-    for(auto it=mapIndex.begin(); it!=mapIndex.end(); ++it)
+    QStandardItem* item = tree.tables.value(tblName);
+    if (item == NULL)
     {
-        QString tblname = it.key();
-        const QStringList& idxList = it.value();
-        const QStringList& triggerList = mapTrigger[tblname];
-        QStandardItem* item = new QStandardItem(QIcon(":/tableview/ui/table.png"), tblname);
+        item = new QStandardItem(QIcon(":/tableview/ui/table.png"), tblName);
         item->setData(2, LevelRole);
         item->setData("table", TypeRole);
+        item->setData(tblName, NameRole);
+        tree.root->appendRow(item);
+        tree.tables[tblName] = item;
 
-        foreach(QString s, idxList)
-        {
-            QStandardItem* indexItem = new QStandardItem(QIcon(":/tableview/ui/index.jpg"), s);
-            indexItem->setData(3, LevelRole);
-            indexItem->setData("index", TypeRole);
-            item->appendRow(indexItem);
-        }
-
-        foreach(QString s, triggerList)
+        foreach(QString s, tree.triggers.take(tblName))
         {
             QStandardItem* triggerItem = new QStandardItem(QIcon(":/tableview/ui/trigger.png"), s);
             triggerItem->setData(3, LevelRole);
             triggerItem->setData("trigger", TypeRole);
+            triggerItem->setData(s, NameRole);
             item->appendRow(triggerItem);
         }
+    }
 
-        root->appendRow(item);
+    if (type == "table")
+    {
+        item->setData(rootpage, RootRole);
+    }
+    else if (type == "index")
+    {
+        // 索引在触发器之前
+        int row = 0;
+        while (row < item->rowCount() && item->child(row)->data(TypeRole).toString() == "index")
+            row++;
+        QStandardItem* indexItem = new QStandardItem(QIcon(":/tableview/ui/index.jpg"), name);
+        indexItem->setData(3, LevelRole);
+        indexItem->setData("index", TypeRole);
+        indexItem->setData(name, NameRole);
+        indexItem->setData(rootpage, RootRole);
+        item->insertRow(row, indexItem);
     }
+    else
+    {
+        QStandardItem* triggerItem = new QStandardItem(QIcon(":/tableview/ui/trigger.png"), name);
+        triggerItem->setData(3, LevelRole);
+        triggerItem->setData("trigger", TypeRole);
+        triggerItem->setData(name, NameRole);
+        item->appendRow(triggerItem);
+    }
+}
 
-    foreach(QString s, listView)
+void MainWindow::finishSchemaTree(SchemaTree &tree)
+{
+    foreach(QString s, tree.views)
     {
         QStandardItem* viewItem = new QStandardItem(QIcon(":/tableview/ui/view.png"), s);
         viewItem->setData(2, LevelRole);
         viewItem->setData("view", TypeRole);
-        root->appendRow(viewItem);
+        viewItem->setData(s, NameRole);
+        tree.root->appendRow(viewItem);
     }
 
     // 设置自由页
     QStandardItem* freeListItem = new QStandardItem(QIcon(":/tableview/ui/freelist.png"), "freelist");
     freeListItem->setData(2, LevelRole);
     freeListItem->setData("freelist", TypeRole);
-    root->appendRow(freeListItem);
+    freeListItem->setData("freelist", NameRole);
+    tree.root->appendRow(freeListItem);
+}
 
-    m_pTreeView->expand(root->index());
-    return true;
+QStandardItem *MainWindow::findDatabaseItem(const QString &path)
+{
+    for(int i=0; i<m_pTreeViewModel->rowCount(); i++)
+    {
+        if(m_pTreeViewModel->item(i)->data(PathRole).toString() == path)
+            return m_pTreeViewModel->item(i);
+    }
+    return NULL;
+}
+
+void MainWindow::onOpenHeaderParsed(int pageSize, qint64 pages, const QString &encoding)
+{
+    OpenDatabaseThread* thread = qobject_cast<OpenDatabaseThread*>(sender());
+    if (thread == NULL || !m_mapSchemaTrees.contains(thread->path())) return;
+    QStandardItem* root = m_mapSchemaTrees[thread->path()].root;
+    root->setToolTip(tr("%1\nPage size %2, %3 pages, %4")
+                     .arg(thread->path()).arg(pageSize).arg(pages).arg(encoding));
+}
+
+void MainWindow::onOpenObjectsLoaded(const QStringList &types, const QStringList &names,
+                                     const QStringList &tblNames, const QVector<int> &roots)
+{
+    OpenDatabaseThread* thread = qobject_cast<OpenDatabaseThread*>(sender());
+    if (thread == NULL || !m_mapSchemaTrees.contains(thread->path())) return;
+    SchemaTree& tree = m_mapSchemaTrees[thread->path()];
+    for (int i=0; i<types.size(); ++i)
+    {
+        addSchemaObject(tree, types[i], names[i], tblNames[i], roots[i]);
+    }
+    m_pTreeView->expand(tree.root->index());
+}
+
+void MainWindow::onOpenFinished()
+{
+    OpenDatabaseThread* thread = qobject_cast<OpenDatabaseThread*>(sender());
+    if (thread == NULL || !m_mapOpening.contains(thread->path())) return;
+    QString path = thread->path();
+    m_mapOpening.remove(path);
+    SchemaTree tree = m_mapSchemaTrees.take(path);
+    thread->wait();
+
+    if (!thread->succeeded())
+    {
+        QString err = thread->error();
+        delete thread;
+        m_pTreeViewModel->removeRow(tree.root->row());
+        QMessageBox::information(this, tr("SQLiteExplorer"), err);
+        return;
+    }
+
+    CSQLite3DB* pSqlite = thread->takeDatabase();
+    delete thread;
+    finishSchemaTree(tree);
+    tree.root->setText(tree.root->data(NameRole).toString());
+
+    m_mapSqlite3DBs[path] = pSqlite;
+    m_pCurSQLite3DB = pSqlite;
+    m_workspace.Add(pSqlite);
+    m_workspace.Activate(pSqlite);
+    trimWorkspace();
+    m_pHeatmap->SetDatabase(pSqlite);
+    m_pTreeView->expand(tree.root->index());
+    m_pWatcher->addPath(path);
+
+    QList<QStandardItem*> items;
+    for (int i=0; i<tree.root->rowCount(); ++i)
+    {
+        items.push_back(tree.root->child(i));
+    }
+    requestSizeBadges(path, items);
+}
+
+/*
+** Queue the b-trees behind items for their size badges.  The badge is
+** only a suffix of the display text; the object name stays in NameRole.
+*/
+void MainWindow::requestSizeBadges(const QString &path, const QList<QStandardItem *> &items)
+{
+    QStringList names;
+    QVector<int> roots;
+    foreach (QStandardItem* item, items)
+    {
+        int rootpage = item->data(RootRole).toInt();
+        if (rootpage <= 0) continue;
+        item->setData(-1, SizeRole);
+        names.push_back(item->data(NameRole).toString());
+        roots.push_back(rootpage);
+    }
+    if (names.isEmpty()) return;
+
+    BtreeSizeThread* thread = m_mapSizeThreads.value(path);
+    if (thread == NULL)
+    {
+        thread = new BtreeSizeThread(path);
+        connect(thread, SIGNAL(sized(QStringList,QVector<qint64>)), this, SLOT(onBtreeSized(QStringList,QVector<qint64>)));
+        m_mapSizeThreads[path] = thread;
+    }
+    thread->enqueue(names, roots);
+}
+
+void MainWindow::onTreeViewExpanded(const QModelIndex &index)
+{
+    QStandardItem* item = m_pTreeViewModel->itemFromIndex(index);
+    if (item == NULL) return;
+    QString path = item->data(LevelRole).toInt() == 1 ? item->data(PathRole).toString()
+                                                      : index.parent().data(PathRole).toString();
+    if (!m_mapSqlite3DBs.contains(path)) return;
+
+    // 只计算还没有大小的子节点
+    QList<QStandardItem*> items;
+    for (int i=0; i<item->rowCount(); ++i)
+    {
+        if (!item->child(i)->data(SizeRole).isValid())
+            items.push_back(item->child(i));
+    }
+    requestSizeBadges(path, items);
+}
+
+void MainWindow::onBtreeSized(const QStringList &names, const QVector<qint64> &bytes)
+{
+    BtreeSizeThread* thread = qobject_cast<BtreeSizeThread*>(sender());
+    if (thread == NULL) return;
+    QStandardItem* root = findDatabaseItem(thread->path());
+    if (root == NULL) return;
+
+    // 等待大小的节点
+    QHash<QString, QStandardItem*> pending;
+    for (int i=0; i<root->rowCount(); ++i)
+    {
+        QStandardItem* item = root->child(i);
+        if (item->data(SizeRole).toLongLong() == -1)
+            pending[item->data(NameRole).toString()] = item;
+        for (int j=0; j<item->rowCount(); ++j)
+        {
+            if (item->child(j)->data(SizeRole).toLongLong() == -1)
+                pending[item->child(j)->data(NameRole).toString()] = item->child(j);
+        }
+    }
+
+    for (int i=0; i<names.size(); ++i)
+    {
+        QStandardItem* item = pending.value(names[i]);
+        if (item == NULL) continue;
+        item->setData(bytes[i], SizeRole);
+        item->setText(QString("%1  [%2]").arg(names[i]).arg(sizeBadge(bytes[i])));
+    }
 }
 
 void MainWindow::OnTreeViewClick(const QModelIndex& index)
@@ -388,14 +888,14 @@ void MainWindow::OnTreeViewClick(const QModelIndex& index)
     if(level == 2)
     {
         path = index.parent().data(PathRole).toString();
-        name = index.data().toString();
+        name = index.data(NameRole).toString();
         tableName = name;
     }
     else if (level == 3)
     {
         path = index.parent().parent().data(PathRole).toString();
-        name = index.data().toString();
-        tableName = index.parent().data().toString();
+        name = index.data(NameRole).toString();
+        tableName = index.parent().data(NameRole).toString();
     }
     else
     {
@@ -407,268 +907,442 @@ void MainWindow::OnTreeViewClick(const QModelIndex& index)
     if (it != m_mapSqlite3DBs.end())
     {
         m_pCurSQLite3DB = it.value();
+        m_workspace.Activate(m_pCurSQLite3DB);
+        m_pHeatmap->SetDatabase(m_pCurSQLite3DB);
+
+        // 只加载当前可见的标签页，其他的在切换过去时加载
+        m_pObjectDB = m_pCurSQLite3DB;
+        m_objectName = name;
+        m_objectTable = tableName;
+        m_objectType = type;
+        loadCurrentTab();
+        trimWorkspace();
+    }
+}
 
-        QString sqls;
-        QString sql;
-        table_content tb;
-        cell_content cc;
+void MainWindow::onTabChanged(int index)
+{
+    Q_UNUSED(index)
+    loadCurrentTab();
+}
 
+QString MainWindow::objectKey() const
+{
+    return QString("%1|%2|%3|%4|%5").arg(QString::fromStdString(m_pObjectDB->GetPath()))
+            .arg(m_objectType).arg(m_objectTable).arg(m_objectName).arg(m_pObjectDB->GetChangeCounter());
+}
 
-        // Init Database Window
-        m_pDatabase->clear();
-        QStringList header;
-        header << "Name" << "Value";
-        m_pDatabase->setColumnCount(header.size());
-
-        m_pDatabase->setHorizontalHeaderLabels(header);
-        map<string, string> vals = m_pCurSQLite3DB->GetDatabaseInfo();
-        m_pDatabase->setRowCount(vals.size());
-        size_t i=0;
-        for(auto it=vals.begin(); it!=vals.end(); ++it, ++i)
+int64_t MainWindow::ObjectData::MemoryUsed() const
+{
+    int64_t used = sizeof(ObjectData);
+    used += pages.capacity() * sizeof(pages[0]);
+    used += infos.capacity() * sizeof(PageUsageInfo);
+    for (auto it=infos.begin(); it!=infos.end(); ++it)
+    {
+        used += it->desc.capacity();
+    }
+    used += nodes.capacity() * sizeof(TreeNodeData);
+    for (auto it=design.begin(); it!=design.end(); ++it)
+    {
+        for (auto cell=it->begin(); cell!=it->end(); ++cell)
         {
-            QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
-            name->setText(QString::fromStdString(it->first));//设置内容
-            m_pDatabase->setItem(i,0,name);//把这个Item加到第一行第二列中
-
-            name=new QTableWidgetItem();//创建一个Item
-            name->setText(QString::fromStdString(it->second));//设置内容
-            m_pDatabase->setItem(i,1,name);//把这个Item加到第一行第二列中
+            used += sizeof(string) + cell->capacity();
         }
+    }
+    used += ddl.capacity() * sizeof(QChar);
+    return used;
+}
 
-        // Init Design Window
-        m_pDesign->clear();
+MainWindow::ObjectData *MainWindow::objectData()
+{
+    QString key = objectKey();
+    ObjectData* data = m_objectCache.object(key);
+    if (data == NULL)
+    {
+        data = new ObjectData;
+        m_objectCache.insert(key, data, 1);
+    }
+    return data;
+}
 
-        if(type != "freelist")
-        {
-            sql = QString("PRAGMA table_info(%1);").arg(tableName);
-            string err = m_pCurSQLite3DB->ExecuteCmd(sql.toStdString(), tb, cc);
+// 内容加载之后按实际大小重新计算cost，超出预算的部分由QCache按LRU丢弃
+void MainWindow::updateObjectCost()
+{
+    QString key = objectKey();
+    ObjectData* data = m_objectCache.take(key);
+    if (data == NULL) return;
+    int cost = (int)qMin<qint64>(data->MemoryUsed() / OBJECT_CACHE_UNIT + 1, 1 << 30);
+    m_objectCache.insert(key, data, cost);
+}
 
-            m_pDesign->setColumnCount(cc.size());
-            header.clear();
+/*
+** Fill the visible tab for the selected object, unless it already shows
+** it.  The key includes the change counter of the database, so a tab is
+** refreshed after the file was modified and left alone otherwise.
+*/
+void MainWindow::loadCurrentTab()
+{
+    if (m_pObjectDB == NULL || m_pObjectDB != m_pCurSQLite3DB) return;
+
+    QWidget* tab = m_pTabWidget->currentWidget();
+    QString key = tab == m_pDatabase
+            ? QString("%1|%2").arg(QString::fromStdString(m_pObjectDB->GetPath())).arg(m_pObjectDB->GetChangeCounter())
+            : objectKey();
+    if (m_tabKeys.value(tab) == key) return;
+
+    if (tab == m_pDatabase)
+        loadDatabaseTab();
+    else if (tab == m_pData)
+        loadDataTab();
+    else if (tab == m_pDesign)
+        loadDesignTab();
+    else if (tab == m_pHexWindow)
+        loadHexTab();
+    else if (tab == m_pDDL)
+        loadDdlTab();
+    else if (tab == m_pGraph)
+        loadGraphTab();
+    else
+        return;
+    if (tab != m_pDatabase) updateObjectCost();
+    m_tabKeys[tab] = key;
+}
 
-            for(auto it=cc.begin(); it!=cc.end(); ++it)
-            {
-                header.push_back(QString::fromStdString(*it));
-            }
+void MainWindow::loadDatabaseTab()
+{
+    m_pDatabase->clear();
+    QStringList header;
+    header << "Name" << "Value";
+    m_pDatabase->setColumnCount(header.size());
+
+    m_pDatabase->setHorizontalHeaderLabels(header);
+    map<string, string> vals = m_pObjectDB->GetDatabaseInfo();
+    m_pDatabase->setRowCount(vals.size());
+    size_t i=0;
+    for(auto it=vals.begin(); it!=vals.end(); ++it, ++i)
+    {
+        QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
+        name->setText(QString::fromStdString(it->first));//设置内容
+        m_pDatabase->setItem(i,0,name);//把这个Item加到第一行第二列中
 
-            m_pDesign->setHorizontalHeaderLabels(header);
-            m_pDesign->setRowCount(tb.size());
-            for(size_t i=0; i<tb.size(); ++i)
-            {
-                const cell_content& cell = tb[i];
-                for(size_t j=0; j<cell.size(); ++j)
-                {
-                    QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
-                    name->setText(QString::fromStdString(cell[j]));//设置内容
-                    m_pDesign->setItem(i,j,name);//把这个Item加到第一行第二列中
-                }
-            }
-            tb.clear();
-            cc.clear();
-        }
+        name=new QTableWidgetItem();//创建一个Item
+        name->setText(QString::fromStdString(it->second));//设置内容
+        m_pDatabase->setItem(i,1,name);//把这个Item加到第一行第二列中
+    }
+}
+
+void MainWindow::loadDataTab()
+{
+    if(m_objectType != "freelist")
+    {
+        QString getAllData = "SELECT * FROM " + m_objectTable;
+        emit signalSQLiteQuery(getAllData);
+    }
+}
 
-        // Init Hex Window
-        m_pHexWindow->SetTableName(name, tableName, type);
-        vector<pair<int, PageType>> pages = m_pCurSQLite3DB->GetAllPageIdsAndType(name.toStdString());
-        vector<PageUsageInfo> infos = m_pCurSQLite3DB->GetPageUsageInfos(type == "freelist");
+void MainWindow::loadDesignTab()
+{
+    m_pDesign->clear();
+    m_pDesign->setRowCount(0);
+    if(m_objectType == "freelist")
+        return;
 
-        if(type != "freelist")
+    ObjectData* data = objectData();
+    if(!data->designLoaded)
+    {
+        QString sql = QString("PRAGMA table_info(%1);").arg(m_objectTable);
+        m_pObjectDB->ExecuteCmd(sql.toStdString(), data->design, data->designHeaders);
+        data->designLoaded = true;
+    }
+
+    QStringList header;
+    for(auto it=data->designHeaders.begin(); it!=data->designHeaders.end(); ++it)
+    {
+        header.push_back(QString::fromStdString(*it));
+    }
+    m_pDesign->setColumnCount(header.size());
+    m_pDesign->setHorizontalHeaderLabels(header);
+    m_pDesign->setRowCount(data->design.size());
+    for(size_t i=0; i<data->design.size(); ++i)
+    {
+        const cell_content& cell = data->design[i];
+        for(size_t j=0; j<cell.size(); ++j)
         {
-            m_pHexWindow->SetPageNosAndType(pages);
+            QTableWidgetItem *name=new QTableWidgetItem();//创建一个Item
+            name->setText(QString::fromStdString(cell[j]));//设置内容
+            m_pDesign->setItem(i,j,name);//把这个Item加到第一行第二列中
+        }
+    }
+}
 
-            if(type == "table")
-                sql = QString("SELECT * FROM SQLITE_MASTER WHERE tbl_name='%1'").arg(tableName);
-            else
-                sql = QString("SELECT * FROM SQLITE_MASTER WHERE name='%1'").arg(name);
-            // Init DDL Window
-            tb.clear();
-            cc.clear();
-            m_pCurSQLite3DB->ExecuteCmd(sql.toStdString(), tb, cc);
-            while(!tb.empty())
+// HexWindow和Graph共用一次b-tree遍历
+void MainWindow::loadObjectUsage(ObjectData *data)
+{
+    if(!data->usageLoaded)
+    {
+        data->pages = m_pObjectDB->GetAllPageIdsAndType(m_objectName.toStdString());
+        data->infos = m_pObjectDB->GetPageUsageInfos(m_objectType == "freelist");
+        if(m_objectType == "freelist")
+        {
+            data->pages.clear();
+            foreach (PageUsageInfo info, data->infos)
             {
-                cell_content cc = tb.front();
-                tb.pop_front();
-                if(cc[4].size() > 0)
-                    sqls += QString::fromStdString(cc[4]);
-                else
-                    sqls += QString::fromStdString("--" + cc[1]);
-
-                sqls += "\n\n\n";
+                data->pages.push_back(make_pair(info.pgno, info.type));
             }
-            m_pDDL->setText(sqls);
+            std::sort(data->pages.begin(), data->pages.end());
         }
+        data->usageLoaded = true;
+    }
+}
+
+void MainWindow::loadHexTab()
+{
+    ObjectData* data = objectData();
+    loadObjectUsage(data);
+    m_pHexWindow->SetTableName(m_objectName, m_objectTable, m_objectType);
+    m_pHexWindow->SetPageNosAndType(data->pages);
+}
+
+void MainWindow::loadDdlTab()
+{
+    if(m_objectType == "freelist")
+    {
+        m_pDDL->clear();
+        return;
+    }
+
+    ObjectData* data = objectData();
+    if(!data->ddlLoaded)
+    {
+        QString sql;
+        if(m_objectType == "table")
+            sql = QString("SELECT * FROM SQLITE_MASTER WHERE tbl_name='%1'").arg(m_objectTable);
         else
+            sql = QString("SELECT * FROM SQLITE_MASTER WHERE name='%1'").arg(m_objectName);
+
+        table_content tb;
+        cell_content cc;
+        m_pObjectDB->ExecuteCmd(sql.toStdString(), tb, cc);
+        while(!tb.empty())
         {
-            vector<pair<int, PageType>> pages;
-            foreach (PageUsageInfo info, infos)
-            {
-                pages.push_back(make_pair(info.pgno, info.type));
-            }
+            cell_content cc = tb.front();
+            tb.pop_front();
+            if(cc[4].size() > 0)
+                data->ddl += QString::fromStdString(cc[4]);
+            else
+                data->ddl += QString::fromStdString("--" + cc[1]);
 
-            std::sort(pages.begin(), pages.end());
-            m_pHexWindow->SetPageNosAndType(pages);
+            data->ddl += "\n\n\n";
         }
+        data->ddlLoaded = true;
+    }
+    m_pDDL->setText(data->ddl);
+}
+
+void MainWindow::loadGraphTab()
+{
+    ObjectData* data = objectData();
+    if(data->graphLoaded)
+    {
+        m_pGraph->SetTree(data->nodes, data->graphWidth, data->graphHeight);
+        return;
+    }
 
-        // Init Data Window
-        if(type != "freelist")
+    loadObjectUsage(data);
+    const vector<PageUsageInfo>& infos = data->infos;
+    int pageSize = m_pObjectDB->GetPageSize();
+    QVector<TreeNodeData>& nodes = data->nodes;
+    vector<double> widths;
+    nodes.reserve(infos.size());
+    for(auto it=infos.begin(); it!=infos.end(); ++it)
+    {
+        const PageUsageInfo& info = *it;
+        QColor color("lightgrey");
+        switch(info.type)
         {
-            QString getAllData = "SELECT * FROM " + tableName;
-            emit signalSQLiteQuery(getAllData);
+        case PAGE_TYPE_OVERFLOW:
+            color = QColor("#FEE3BA");
+            break;
+        case PAGE_TYPE_INDEX_INTERIOR:
+        case PAGE_TYPE_TABLE_INTERIOR:
+            color = QColor("#E1C4C4");
+            break;
+        case PAGE_TYPE_INDEX_LEAF:
+        case PAGE_TYPE_TABLE_LEAF:
+            color = QColor("#62C544");
+            break;
+        default:
+            break;
         }
 
-        // Init Graph Window
-        QString content = "digraph g { node [shape = record,style=\"filled\"];rankdir=LR;";
-
-        for(auto it=infos.begin(); it!=infos.end(); ++it)
+        TreeNodeData node;
+        node.pgno = info.pgno;
+        node.parent = -1;
+        node.x = node.y = 0;
+        // ncell为页面cell数量，内部页有一个RightChild，所以ncell+1
+        node.ncell = info.ncell;
+        if(info.type == PAGE_TYPE_INDEX_INTERIOR || info.type == PAGE_TYPE_TABLE_INTERIOR)
+            node.ncell += 1;
+        node.overflowIdx = 0;
+        node.overflowCell = 0;
+        node.used = 0;
+        node.size = 0;
+        node.color = color.rgb();
+        int labelSize;
+        if(info.type == PAGE_TYPE_OVERFLOW)
         {
-            PageUsageInfo& info = *it;
-            QString color;
-            QString scell;
-            switch(info.type)
-            {
-            case PAGE_TYPE_OVERFLOW:
-                color = "#FEE3BA";
-                break;
-            case PAGE_TYPE_INDEX_INTERIOR:
-            case PAGE_TYPE_TABLE_INTERIOR:
-                color = "#E1C4C4";
-                break;
-            case PAGE_TYPE_INDEX_LEAF:
-            case PAGE_TYPE_TABLE_LEAF:
-                color = "#62C544";
-                break;
-            default:
-                break;
-            }
+            // PageNo是从1开始计数
+            // 此处cell_idx从0开始计数
+            node.overflowIdx = info.overflow_page_idx;
+            node.overflowCell = info.overflow_cell_idx;
+            labelSize = QString("%1 overflow %2 from cell %3")
+                    .arg(info.pgno).arg(info.overflow_page_idx).arg(info.overflow_cell_idx).size();
+        }
+        else
+        {
+            node.used = pageSize - info.nfree;
+            node.size = pageSize;
+            labelSize = QString("%1 ncells:%2").arg(info.pgno).arg(node.ncell).size();
+        }
 
-            // ncell为页面cell数量
-            if(info.ncell>0)
-            {
-                int ncell = info.ncell;
-                // 内部页有一个RightChild，所以ncell+1
-                if(info.type == PAGE_TYPE_INDEX_INTERIOR || info.type == PAGE_TYPE_TABLE_INTERIOR)
-                    ncell += 1;
-                scell = QString("%1").arg(ncell);
-            }
+        // 与dot一样以英寸为单位，高0.5英寸，宽度随标签长度变化
+        node.w = 0.2 + labelSize*0.11;
+        widths.push_back(node.w*1.2);
+        nodes.push_back(node);
+    }
 
-            if(info.type == PAGE_TYPE_OVERFLOW)
-            {
-                // PageNo是从1开始计数
-                // 此处cell_idx从0开始计数
-                content.push_back(QString("%1[color=\"%2\", label=\"%1 overflow %3 from cell %4\"];")
-                                  .arg(info.pgno)
-                                  .arg(color)
-                                  .arg(info.overflow_page_idx)
-                                  .arg(info.overflow_cell_idx));
-            }
-            else
-            {
-                content.push_back(QString("%1[color=\"%2\", label=\"%1 ncells:%3\"];").arg(info.pgno).arg(color).arg(scell));
-            }
+    // 进程内分层布局，不再依赖graphviz
+    vector<BtreeLayoutPos> pos;
+    LayoutBtree(infos, widths, 0.6, 0.3, pos, &data->graphWidth, &data->graphHeight);
+    for(size_t i=0; i<pos.size(); ++i)
+    {
+        nodes[i].x = pos[i].x;
+        nodes[i].y = pos[i].y;
+        nodes[i].parent = pos[i].parent;
+    }
+    data->graphLoaded = true;
+    m_pGraph->SetTree(data->nodes, data->graphWidth, data->graphHeight);
+}
+
+// 关闭数据库后丢弃它的缓存
+void MainWindow::forgetDatabase(const QString &path)
+{
+    QString prefix = path + "|";
+    foreach (QString key, m_objectCache.keys())
+    {
+        if (key.startsWith(prefix))
+            m_objectCache.remove(key);
+    }
+    for (auto it=m_tabKeys.begin(); it!=m_tabKeys.end(); )
+    {
+        if (it.value().startsWith(prefix))
+            it = m_tabKeys.erase(it);
+        else
+            ++it;
+    }
+    if (m_pObjectDB && m_pObjectDB->GetPath() == path.toStdString())
+        m_pObjectDB = NULL;
+}
+
+// 超出内存预算时释放最久未用的数据库的缓存，标签页内容也一并丢弃
+void MainWindow::trimWorkspace()
+{
+    // 预算可能已改变，QCache在上限降低时自己丢弃最久未用的对象
+    m_objectCache.setMaxCost((int)(m_workspace.CallerBudget() / OBJECT_CACHE_UNIT));
+    m_workspace.Charge(m_pHeatmap, m_pHeatmap->CacheBytes());
+    m_workspace.Charge(m_pWatcher, m_pWatcher->memoryUsed());
+    vector<CSQLite3DB*> evicted = m_workspace.Trim((int64_t)m_objectCache.totalCost() * OBJECT_CACHE_UNIT);
+    for (auto it=evicted.begin(); it!=evicted.end(); ++it)
+    {
+        forgetDatabase(m_mapSqlite3DBs.key(*it));
+    }
+}
+
+void MainWindow::onHeatmapPageActivated(int pgno, int type)
+{
+    m_pHexWindow->ShowPage(pgno, (PageType)type);
+    m_pTabWidget->setCurrentWidget(m_pHexWindow);
+}
+
+void MainWindow::onDatabaseChanged(const QString &path, const QVector<int> &pages)
+{
+    auto it = m_mapSqlite3DBs.find(path);
+    if (it == m_mapSqlite3DBs.end()) return;
+    CSQLite3DB* pSqlite = it.value();
+
+    // 只重新遍历变化的页所属的b-tree
+    vector<string> objects;
+    vector<int> pgnos(pages.begin(), pages.end());
+    bool schemaChanged = pSqlite->Reload(pgnos, objects);
+    if (m_pHeatmap->GetDatabase() == pSqlite)
+        m_pHeatmap->PagesChanged(pages);
+
+    QStandardItem* root = findDatabaseItem(path);
+    if(root == NULL) return;
+
+    QModelIndex cur = m_pTreeView->currentIndex();
+    QString curName = cur.data(NameRole).toString();
+    QString curTable = cur.data(LevelRole).toInt() == 3 ? cur.parent().data(NameRole).toString() : curName;
+    bool curInDb = cur.isValid() && (cur.parent() == root->index() || cur.parent().parent() == root->index());
+
+    QStringList changed;
+    for(auto obj=objects.begin(); obj!=objects.end(); ++obj)
+    {
+        changed.push_back(QString::fromStdString(*obj));
+    }
+
+    if(schemaChanged)
+    {
+        // schema变化时重建这个数据库的树，并重新选中原来的对象
+        root->removeRows(0, root->rowCount());
+        loadDatabaseTree(root, pSqlite);
+        m_pTreeView->expand(root->index());
+        if(curInDb && root->rowCount())
+        {
+            QList<QModelIndex> found = m_pTreeViewModel->match(root->child(0)->index(), NameRole, curName, 1,
+                                                               Qt::MatchExactly | Qt::MatchRecursive);
+            if(found.size())
+                m_pTreeView->setCurrentIndex(found.front());
+        }
+        QList<QStandardItem*> items;
+        for(int i=0; i<root->rowCount(); i++)
+        {
+            items.push_back(root->child(i));
         }
+        requestSizeBadges(path, items);
+        statusBar()->showMessage(tr("%1: schema changed").arg(QFileInfo(path).fileName()), 5000);
+        return;
+    }
 
-        for(auto it=infos.begin(); it!=infos.end(); ++it)
+    // 当前显示的对象受影响时才刷新视图
+    if(curInDb)
+    {
+        foreach (QString obj, changed)
         {
-            PageUsageInfo& info = *it;
-            if(info.parent != 0)
+            if(obj.compare(curName, Qt::CaseInsensitive) == 0 || obj.compare(curTable, Qt::CaseInsensitive) == 0)
             {
-                content.push_back(QString("%1 -> %2;").arg(info.parent).arg(info.pgno));
-                /*
-                qDebug() << "type:" << info.type
-                         << " parent:" << info.parent
-                         << " pgno:" << info.pgno
-                         << " desc:" << info.desc.c_str();
-                */
+                OnTreeViewClick(cur);
+                break;
             }
         }
+    }
 
-        content.push_back("}");
-
-        //qDebug() << content;
-        QFile f("tmp.dot");
-        if(!f.open(QIODevice::ReadWrite | QIODevice::Text|QIODevice::Truncate)) {
-            qDebug() << "Can't open the file!";
+    // 已经显示了大小的对象重新计算
+    QList<QStandardItem*> resized;
+    for(int i=0; i<root->rowCount(); i++)
+    {
+        QStandardItem* item = root->child(i);
+        for(int j=-1; j<item->rowCount(); j++)
+        {
+            QStandardItem* obj = j < 0 ? item : item->child(j);
+            if(obj->data(SizeRole).isValid() && changed.contains(obj->data(NameRole).toString(), Qt::CaseInsensitive))
+                resized.push_back(obj);
         }
-
-        f.write(content.toStdString().c_str());
-        f.close();
-        // dot: 渲染的图具有明确的方向性
-        // neato:渲染的图缺乏方向性
-        // twopi:渲染的图采用放射性布局
-        // circo:渲染的图采用环型布局
-        // fdp:渲染的图缺乏方向性
-        // sfdp:渲染大型的图，图片缺乏方向性
-        // patchwork: 主要用于树哈希图（tree map）
-        QString program = "graphviz2.38/dot";
-        QStringList arguments;
-        arguments << "-Tplain" << "tmp.dot" << "-o" << "tmp.plain";
-        QProcess *myProcess = new QProcess(this);
-        connect(myProcess, SIGNAL(finished(int)), this, SLOT(onProcessFinished(int)));
-        myProcess->start(program, arguments);
-
-
-        arguments.clear();
-        arguments << "-Tpng" << "tmp.dot" << "-o" << "tmp.png";
-        QProcess *myProcess2 = new QProcess(this);
-        connect(myProcess2, SIGNAL(finished(int)), this, SLOT(onProcessFinished(int)));
-        myProcess2->start(program, arguments);
-
-//        plain ,
-//        plain-ext
-//        The plain and plain-ext formats produce output using a simple, line-based language. The latter format differs in that, on edges,
-//                it provides port names on head and tail nodes when applicable.
-//        There are four types of statements.
-
-//         graph scale width height
-//         node name x y width height label style shape color fillcolor
-//         edge tail head n x1 y1 .. xn yn [label xl yl] style color
-//         stop
-//        graph
-//        The width and height values give the width and height of the drawing. The lower left corner of the drawing is at the origin.
-//                The scale value indicates how the drawing should be scaled if a size attribute was given and the drawing needs to be
-//                scaled to conform to that size. If no scaling is necessary, it will be set to 1.0. Note that all graph, node and edge
-//                coordinates and lengths are given unscaled.
-//        node
-//        The name value is the name of the node, and x and y give the node's position. The width and height are the width and height
-//                of the node. The label, style, shape, color and fillcolor give the node's label, style, shape, color and fillcolor,
-//                respectively, using attribute default values where necessary. If the node does not have a style attribute, "solid" is used.
-//        edge
-//        The tail and head values give the names of the head and tail nodes. In plain-ext format, the head or tail name will be appended
-//                with a colon and a portname if the edge connects to the node at a port. n is the number of control points defining the
-//                B-spline forming the edge. This is followed by 2*n numbers giving the x and y coordinates of the control points in order
-//                from tail to head. If the edge has a label, this comes next followed by the x and y coordinates of the label's position.
-//                The edge description is completed by the edge's style and color. As with nodes, if a style is not defined, "solid" is used.
-//        Note: The control points given in an edge statement define the body of the edge. In particular, if the edge has an arrowhead to
-//              the head or tail node, there will be a gap between the last or first control points and the boundary of the associated node.
-//              There are at least 3 possible ways of handling this gap:
-
-//        Arrange that the input graph uses dir=none, arrowhead=none, or arrowtail=none for all edges. In this case, the terminating control
-//              points will always touch the node.
-//        Consider the line segment joining the control point and the center of the node, and determine the point where the segment intersects
-//              the node's boundary. Then use the control point and the intersection point as the main axis of an arrowhead. The problem with
-//              this approach is that, if the edge has a port, the edge will not be pointing to the center of the node. In this case, rather
-//              than use the control point and center point, one can use the control point and its tangent.
-//        Arrange that the input graph uses headclip=false or tailclip=false. In this case, the edge will terminate at the node's center rather
-//              than its boundary. If arrowheads are used, there will still be a gap, but normally this will occur within the node. The application
-//              will still need to clip the spline to the node boundary. Also, as with the previous item, if the edge points to a node port, this
-//              technique will fail.
-//        The output consists of one graph line, a sequence of node lines, one per node, a sequence of edge lines, one per edge, and a final stop
-//              line. All units are in inches, represented by a floating point number.
-//        Note that the plain formats provide minimal information, really giving not much more than node positions and sizes, and edge spline control
-//              points. These formats are usually most useful to applications wanting just this geometric information, and willing to fill in all of
-//              the graphical details. The only real advantages to these formats is their terseness and their ease of parsing. In general, the dot
-//              and xdot are preferable in terms of the quantity of information provided.
-    }
-}
-
-void MainWindow::onProcessFinished(int ret)
-{
-    QProcess* process = qobject_cast<QProcess*>(sender());
-    if(process)
-    {
-        QStringList arg = process->arguments();
-        m_pGraph->SetPath(arg[arg.size()-1]);
-
-        delete process;
     }
+    requestSizeBadges(path, resized);
+
+    statusBar()->showMessage(tr("%1: %2 pages changed in %3")
+                             .arg(QFileInfo(path).fileName())
+                             .arg(pages.size())
+                             .arg(changed.join(", ")), 5000);
 }
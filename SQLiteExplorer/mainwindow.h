@@ -23,13 +23,17 @@
 #include "pixitem.h"
 #include <QPixmap>
 #include <QTimerEvent>
+#include <QCache>
 
 #include "HexWindow.h"
 #include "QSQLiteMasterTreeView.h"
 #include "SQLite3DB.h"
+#include "Workspace.h"
 
 #include "GraphWindow.h"
 #include "DataWindow.h"
+#include "DatabaseWatcher.h"
+#include "HeatmapWindow.h"
 
 namespace Ui {
 class MainWindow;
@@ -37,6 +41,10 @@ class MainWindow;
 
 class QSQLiteTableView;
 class QSQLiteQueryWindow;
+class QProgressDialog;
+class VacuumThread;
+class OpenDatabaseThread;
+class BtreeSizeThread;
 
 class MainWindow : public QMainWindow
 {
@@ -63,16 +71,99 @@ signals:
 
 private Q_SLOTS:
     void OnTreeViewClick(const QModelIndex& index);
-    void onProcessFinished(int ret);
+    void onTabChanged(int index);
 
     void onOpenActionTriggered();
     void onCloseActionTriggered();
     void onCheckActionTriggered();
     void onVacuumActionTriggered();
+    void onVacuumIntoActionTriggered();
+    void onVacuumProgress(int percent, double mbPerSec);
+    void onVacuumFinished();
+    void onLocalityActionTriggered();
+    void onVacuumPredictActionTriggered();
+    void onSnapshotActionTriggered();
+    void onExportActionTriggered();
+    void onImportActionTriggered();
+    void onRawScanActionTriggered();
+    void onMemoryActionTriggered();
+    void onCompareActionTriggered();
+    void onAdvisorActionTriggered();
+    void onColumnStatsActionTriggered();
+    void onAnalyzeActionTriggered();
     void onAboutActionTriggered();
 
+    void onDatabaseChanged(const QString& path, const QVector<int>& pages);
+    void onHeatmapPageActivated(int pgno, int type);
+
+    void onOpenHeaderParsed(int pageSize, qint64 pages, const QString& encoding);
+    void onOpenObjectsLoaded(const QStringList& types, const QStringList& names,
+                             const QStringList& tblNames, const QVector<int>& roots);
+    void onOpenFinished();
+    void onTreeViewExpanded(const QModelIndex& index);
+    void onBtreeSized(const QStringList& names, const QVector<qint64>& bytes);
+
 private:
+    // 逐步构建中的数据库树
+    struct SchemaTree
+    {
+        QStandardItem*                  root;
+        QMap<QString, QStandardItem*>   tables;     // tbl_name对应的表节点
+        QMap<QString, QStringList>      triggers;   // 表节点出现之前读到的触发器
+        QStringList                     views;
+
+        SchemaTree() : root(NULL) {}
+    };
+
+    // 一个对象的各标签页内容，按(数据库, 对象, change counter)缓存
+    struct ObjectData
+    {
+        bool                            usageLoaded;
+        vector<pair<int, PageType> >    pages;
+        vector<PageUsageInfo>           infos;
+
+        bool                            graphLoaded;
+        QVector<TreeNodeData>           nodes;
+        double                          graphWidth;
+        double                          graphHeight;
+
+        bool                            designLoaded;
+        table_content                   design;
+        cell_content                    designHeaders;
+
+        bool                            ddlLoaded;
+        QString                         ddl;
+
+        ObjectData() : usageLoaded(false), graphLoaded(false), graphWidth(0), graphHeight(0)
+                     , designLoaded(false), ddlLoaded(false) {}
+
+        // 估计占用的字节数，作为在m_objectCache中的cost
+        int64_t MemoryUsed() const;
+    };
+
+    QString objectKey() const;
+    ObjectData* objectData();
+    void updateObjectCost();
+    void loadObjectUsage(ObjectData* data);
+    void loadCurrentTab();
+    void loadDatabaseTab();
+    void loadDataTab();
+    void loadDesignTab();
+    void loadHexTab();
+    void loadDdlTab();
+    void loadGraphTab();
+    void forgetDatabase(const QString& path);
+    void trimWorkspace();
+
     bool openDatabaseFile(const QString& path);
+    bool loadDatabaseTree(QStandardItem* root, CSQLite3DB* pSqlite);
+    void addSchemaObject(SchemaTree& tree, const QString& type, const QString& name,
+                         const QString& tblName, int rootpage);
+    void finishSchemaTree(SchemaTree& tree);
+    QStandardItem* findDatabaseItem(const QString& path);
+    void requestSizeBadges(const QString& path, const QList<QStandardItem*>& items);
+    void startVacuum(const QString& path, const QString& intoPath);
+    void stopVacuum();
 
 private:
     // Menu and Tool
@@ -80,6 +171,18 @@ private:
     QAction* m_pCloseAction;
     QAction* m_pCheckAction;
     QAction* m_pVacuumAction;
+    QAction* m_pVacuumIntoAction;
+    QAction* m_pLocalityAction;
+    QAction* m_pVacuumPredictAction;
+    QAction* m_pSnapshotAction;
+    QAction* m_pExportAction;
+    QAction* m_pImportAction;
+    QAction* m_pRawScanAction;
+    QAction* m_pMemoryAction;
+    QAction* m_pCompareAction;
+    QAction* m_pAdvisorAction;
+    QAction* m_pColumnStatsAction;
+    QAction* m_pAnalyzeAction;
     QAction* m_pAboutAction;
 
 
@@ -97,6 +200,7 @@ private:
     QTableWidget*       m_pDesign;
     QTextEdit*          m_pDDL;
     GraphWindow*        m_pGraph;
+    HeatmapWindow*      m_pHeatmap;
 
     // QSplitter
     QSplitter* m_pSplitter;
@@ -104,6 +208,29 @@ private:
     // sqlite3tools
     QMap<QString, CSQLite3DB*> m_mapSqlite3DBs;
     CSQLite3DB* m_pCurSQLite3DB;
+    CWorkspace  m_workspace;
+
+    // 树中选中的对象，标签页显示时才加载它的内容
+    CSQLite3DB* m_pObjectDB;
+    QString     m_objectName;
+    QString     m_objectTable;
+    QString     m_objectType;
+    QMap<QWidget*, QString>     m_tabKeys;      // 各标签页正在显示的对象
+    QCache<QString, ObjectData> m_objectCache;
+
+    // 正在后台打开的数据库
+    QMap<QString, OpenDatabaseThread*> m_mapOpening;
+    QMap<QString, SchemaTree>          m_mapSchemaTrees;
+
+    // 每个数据库计算树节点大小的线程
+    QMap<QString, BtreeSizeThread*>    m_mapSizeThreads;
+
+    // 监视已打开的数据库文件被其他进程修改
+    DatabaseWatcher* m_pWatcher;
+
+    // 后台执行的VACUUM
+    VacuumThread*    m_pVacuumThread;
+    QProgressDialog* m_pVacuumProgress;
 };
 
 #endif // MAINWINDOW_H
@@ -7,6 +7,7 @@
 QSQLiteTableView::QSQLiteTableView(QWidget *parent)
 : QTableWidget(parent)
 , m_pCurSQLite3DB(nullptr)
+, m_queryOpen(false)
 , m_rowThresh(100)
 {
 //    MainWindow* pMainWindow = qobject_cast<MainWindow*>(parent);
@@ -38,6 +39,7 @@ void QSQLiteTableView::onSQLiteQueryReceived(const QString &sql)
     {
         string s = sql.toStdString();
         m_curQuery = m_pCurSQLite3DB->execQuery(s.c_str());
+        m_queryOpen = true;
         CppSQLite3Query& q = m_curQuery;
 
         QStringList headers;
@@ -87,7 +89,7 @@ void QSQLiteTableView::onValueChanged(int value)
 {
 //    qDebug() << "value =" << value << ", VSBar Max =" << verticalScrollBar()->maximum()
 //             << ", m_rowThresh =" << m_rowThresh;
-    if(value == verticalScrollBar()->maximum() && !m_curQuery.eof())
+    if(m_queryOpen && value == verticalScrollBar()->maximum() && !m_curQuery.eof())
     {
         //qDebug() << "Enter ";
         m_rowThresh *= 2;
@@ -120,3 +122,30 @@ void QSQLiteTableView::onValueChanged(int value)
         //qDebug() << msg;
     }
 }
+
+void QSQLiteTableView::ShowRows(const vector<string> &columns, const vector<vector<string> > &rows)
+{
+    // 结束之前的查询，它会一直占用读事务
+    m_curQuery = CppSQLite3Query();
+    m_queryOpen = false;
+
+    clear();
+    setRowCount(0);
+    QStringList headers;
+    for(auto it=columns.begin(); it!=columns.end(); ++it)
+    {
+        headers.push_back(QString::fromStdString(*it));
+    }
+    setColumnCount(headers.size());
+    setHorizontalHeaderLabels(headers);
+    setRowCount((int)rows.size());
+    for(size_t r=0; r<rows.size(); ++r)
+    {
+        for(size_t c=0; c<rows[r].size(); ++c)
+        {
+            QTableWidgetItem *name = new QTableWidgetItem();
+            name->setText(QString::fromStdString(rows[r][c]));
+            setItem((int)r, (int)c, name);
+        }
+    }
+}
@@ -20,6 +20,9 @@ public:
         m_pCurSQLite3DB = pDb;
     }
 
+    // 显示已经取得的结果(例如性能分析时)，不再从查询中继续加载
+    void ShowRows(const vector<string>& columns, const vector<vector<string> >& rows);
+
 signals:
     void dataLoaded(const QString& msg);
 
@@ -31,6 +34,7 @@ private:
     //MainWindow* m_pParent;
     CSQLite3DB* m_pCurSQLite3DB;
     CppSQLite3Query m_curQuery;
+    bool m_queryOpen;
     int m_rowThresh;
 };
 
@@ -6,6 +6,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <iomanip>
+#include <chrono>
 #include <sys/stat.h>
 
 #if defined(WIN32) 
@@ -51,6 +52,12 @@ int64_t StrToInt64( const char* str )
     return v;
 }
 
+int64_t NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 std::string StrUpper( const string& text )
 {
     string r;
@@ -67,6 +74,17 @@ std::string StrLower( const string& text )
     return r;
 }
 
+std::string QuoteName( const string& name )
+{
+    string r = "\"";
+    for (size_t i=0; i<name.size(); ++i)
+    {
+        if (name[i] == '"') r += '"';
+        r += name[i];
+    }
+    return r + "\"";
+}
+
 
 #ifdef WIN32
 ///convert wide chars to multibytes
@@ -26,9 +26,15 @@ int64_t StrToInt64(const char* str);
 string StrUpper(const string& text);
 string StrLower(const string& text);
 
+// 加双引号作为SQL标识符
+string QuoteName(const string& name);
+
 int StrPos(const string& text, unsigned int start, const string& needle);
 vector<string> StrSplit(const string& src, const string& split);
 
+// 单调时钟的毫秒数，用于计算耗时
+int64_t NowMs();
+
 
 	/*!
     将UTF8字符串转换成本地字符串